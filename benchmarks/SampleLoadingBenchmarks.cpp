@@ -0,0 +1,520 @@
+// Sample loading through SampleLoadManager, on soundsets generated on the fly: bK style WAV sets at
+// 16 and 24 bits with 2 and 8 velocity layers, one set per sample type, and an SF2 file.
+//
+// The "performance" benchmarks time cold loads (nothing loaded or cached in the process) and warm
+// ones (the set shared from another instance, or restored from its .bkcache file) in each storage
+// and loading mode. The "memory" test case prints, for one load in each mode, the time taken, how
+// much the resident set grew while loading and once loaded, and the time for each sample type on its own.
+//
+// The run has preferences of its own, in a temporary folder with the soundsets, so the .bkcache files and
+// soundfont index it writes stay out of the user's; the preferences each mode needs are set for the
+// duration and then put back.
+
+#include "../tests/helpers/test_helpers.h"
+#include "PluginProcessor.h"
+#include "SampleLoadManager.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include <cstdio>
+#include <iostream>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+namespace
+{
+    constexpr double kSampleRate = 48000.;
+
+    //==============================================================================
+    void writeWav (const juce::File& file, int numChannels, int bitsPerSample, double seconds, double frequency)
+    {
+        const auto wav = makeTestWav (numChannels, (int) (seconds * kSampleRate), bitsPerSample, kSampleRate, frequency, 3.0);
+        file.getParentDirectory().createDirectory();
+        file.replaceWithData (wav.getData(), wav.getSize());
+    }
+
+    double frequencyOf (int midiNote) { return 440.0 * std::pow (2.0, (midiNote - 69) / 12.0); }
+
+    // the pitches bK sample libraries have, a minor third apart from A0 to C8
+    juce::Array<std::pair<juce::String, int>> bKPitches()
+    {
+        juce::Array<std::pair<juce::String, int>> pitches;
+        const char* names[] = { "C", "D#", "F#", "A" };
+        for (int octave = 0; octave <= 8; ++octave)
+            for (int i = 0; i < 4; ++i)
+                if (const auto note = 12 * (octave + 1) + 3 * i; note >= 21 && note <= 108)
+                    pitches.add ({ juce::String (names[i]) + juce::String (octave), note });
+        return pitches;
+    }
+
+    /** Writes the sample types asked for, named like the Yamaha/Salamander samples. */
+    void writeBKSoundset (const juce::File& directory, int bitsPerSample, int numLayers,
+                          bool main, bool hammers, bool resonance, bool pedals)
+    {
+        const auto pitches = bKPitches();
+
+        if (main)
+            for (const auto& [name, note] : pitches)
+                for (int layer = 1; layer <= numLayers; ++layer)
+                    writeWav (directory.getChildFile ("main").getChildFile (name + "v" + juce::String (layer) + ".wav"),
+                              2, bitsPerSample, 0.5, frequencyOf (note));
+
+        if (hammers)
+            for (int key = 1; key <= 88; ++key)
+                writeWav (directory.getChildFile ("hammer").getChildFile ("rel" + juce::String (key) + ".wav"),
+                          2, bitsPerSample, 0.1, frequencyOf (key + 20) * 3.0);
+
+        if (resonance)
+            for (const auto& [name, note] : pitches)
+                for (int layer = 1; layer <= juce::jmin (numLayers, 3); ++layer)
+                    writeWav (directory.getChildFile ("resonance").getChildFile ("harm" + name + "v" + juce::String (layer) + ".wav"),
+                              2, bitsPerSample, 0.5, frequencyOf (note + 12));
+
+        if (pedals)
+            for (auto* name : { "pedalD1", "pedalD2", "pedalU1", "pedalU2" })
+                writeWav (directory.getChildFile ("pedal").getChildFile (juce::String (name) + ".wav"),
+                          2, bitsPerSample, 0.3, 60.0);
+    }
+
+    //==============================================================================
+    void writeChunk (juce::MemoryOutputStream& out, const char* id, const juce::MemoryOutputStream& body)
+    {
+        out.write (id, 4);
+        out.writeInt ((int) body.getDataSize());
+        out.write (body.getData(), body.getDataSize());
+        if (body.getDataSize() % 2 != 0)
+            out.writeByte (0);
+    }
+
+    void writeList (juce::MemoryOutputStream& out, const char* type, const juce::MemoryOutputStream& chunks)
+    {
+        juce::MemoryOutputStream list;
+        list.write (type, 4);
+        list.write (chunks.getData(), chunks.getDataSize());
+        writeChunk (out, "LIST", list);
+    }
+
+    void writeName (juce::MemoryOutputStream& out, const juce::String& name)
+    {
+        char field[20] = {};
+        name.copyToUTF8 (field, sizeof (field) - 1);
+        out.write (field, sizeof (field));
+    }
+
+    /**
+     * Writes an SF2 file with numPresets presets, each an instrument that spreads numZones mono
+     * samples across the keyboard. The presets share the samples, as the presets in a General MIDI
+     * bank often do.
+     */
+    void writeSF2 (const juce::File& file, int numPresets, int numZones, double seconds)
+    {
+        constexpr int kPadding = 46; // zero frames the spec wants after every sample
+        const auto length = (int) (seconds * kSampleRate);
+
+        juce::MemoryOutputStream info, smpl, sdta, phdr, pbag, pmod, pgen, inst, ibag, imod, igen, shdr, pdta;
+
+        info.write ("ifil", 4);
+        info.writeInt (4);
+        info.writeShort (2);
+        info.writeShort (1);
+        juce::MemoryOutputStream name;
+        name.write ("Synthetic\0", 10);
+        writeChunk (info, "INAM", name);
+
+        juce::Random random (numZones);
+        for (int zone = 0; zone < numZones; ++zone)
+        {
+            const auto lo = 21 + zone * 88 / numZones;
+            const auto hi = 21 + (zone + 1) * 88 / numZones - 1;
+            const auto root = (lo + hi) / 2;
+            const auto start = zone * (length + kPadding);
+
+            for (int i = 0; i < length; ++i)
+            {
+                const auto t = (double) i / kSampleRate;
+                const auto value = 0.5 * std::exp (-3.0 * t) * std::sin (juce::MathConstants<double>::twoPi * frequencyOf (root) * t)
+                                 + 0.01 * (random.nextDouble() - 0.5);
+                smpl.writeShort ((short) (value * 32767.0));
+            }
+            for (int i = 0; i < kPadding; ++i)
+                smpl.writeShort (0);
+
+            writeName (shdr, "Zone " + juce::String (zone));
+            shdr.writeInt (start);
+            shdr.writeInt (start + length);
+            shdr.writeInt (start + length / 4);
+            shdr.writeInt (start + length - 100);
+            shdr.writeInt ((int) kSampleRate);
+            shdr.writeByte ((char) root);
+            shdr.writeByte (0);  // pitch correction
+            shdr.writeShort (0); // sample link
+            shdr.writeShort (1); // mono
+        }
+        writeName (shdr, "EOS");
+        shdr.writeRepeatedByte (0, 26);
+
+        for (int preset = 0; preset < numPresets; ++preset)
+        {
+            writeName (phdr, "Preset " + juce::String (preset));
+            phdr.writeShort ((short) preset);
+            phdr.writeShort (0);              // bank
+            phdr.writeShort ((short) preset); // one bag each
+            phdr.writeRepeatedByte (0, 12);   // library, genre, morphology
+
+            pbag.writeShort ((short) preset);
+            pbag.writeShort (0);
+            pgen.writeShort (41); // instrument
+            pgen.writeShort ((short) preset);
+
+            writeName (inst, "Instrument " + juce::String (preset));
+            inst.writeShort ((short) (preset * numZones));
+
+            for (int zone = 0; zone < numZones; ++zone)
+            {
+                ibag.writeShort ((short) ((preset * numZones + zone) * 2));
+                ibag.writeShort (0);
+
+                igen.writeShort (43); // keyRange
+                igen.writeByte ((char) (21 + zone * 88 / numZones));
+                igen.writeByte ((char) (21 + (zone + 1) * 88 / numZones - 1));
+                igen.writeShort (53); // sampleID
+                igen.writeShort ((short) zone);
+            }
+        }
+
+        // the terminal records
+        writeName (phdr, "EOP");
+        phdr.writeRepeatedByte (0, 2 + 2);
+        phdr.writeShort ((short) numPresets);
+        phdr.writeRepeatedByte (0, 12);
+        pbag.writeShort ((short) numPresets);
+        pbag.writeShort (0);
+        pmod.writeRepeatedByte (0, 10);
+        pgen.writeInt (0);
+        writeName (inst, "EOI");
+        inst.writeShort ((short) (numPresets * numZones));
+        ibag.writeShort ((short) (numPresets * numZones * 2));
+        ibag.writeShort (0);
+        imod.writeRepeatedByte (0, 10);
+        igen.writeInt (0);
+
+        writeChunk (sdta, "smpl", smpl);
+
+        writeChunk (pdta, "phdr", phdr);
+        writeChunk (pdta, "pbag", pbag);
+        writeChunk (pdta, "pmod", pmod);
+        writeChunk (pdta, "pgen", pgen);
+        writeChunk (pdta, "inst", inst);
+        writeChunk (pdta, "ibag", ibag);
+        writeChunk (pdta, "imod", imod);
+        writeChunk (pdta, "igen", igen);
+        writeChunk (pdta, "shdr", shdr);
+
+        juce::MemoryOutputStream lists, riff;
+        writeList (lists, "INFO", info);
+        writeList (lists, "sdta", sdta);
+        writeList (lists, "pdta", pdta);
+
+        riff.write ("sfbk", 4);
+        riff.write (lists.getData(), lists.getDataSize());
+
+        juce::MemoryOutputStream out;
+        writeChunk (out, "RIFF", riff);
+        file.getParentDirectory().createDirectory();
+        file.replaceWithData (out.getData(), out.getDataSize());
+    }
+
+    //==============================================================================
+    /** The soundsets, written once per run into a temporary folder, and the run's preferences. */
+    struct SyntheticSoundsets
+    {
+        SyntheticSoundsets()
+        {
+            // before any SampleLoadManager reads its soundfont index from beside the settings file; the
+            // user's own settings are dropped so each mode runs on the defaults plus what it sets
+            preferences->file = root.getChildFile ("preferences").getChildFile ("bitklavier.settings");
+            preferences->tree.removeAllProperties (nullptr);
+
+            for (int bits : { 16, 24 })
+                for (int layers : { 2, 8 })
+                    writeBKSoundset (samples.getChildFile (bKSet (bits, layers)), bits, layers, true, true, true, true);
+
+            for (const auto& type : sampleTypes())
+                writeBKSoundset (samples.getChildFile (typeSet (type)), 24, 4,
+                                 type == "main", type == "hammer", type == "resonance", type == "pedal");
+
+            writeSF2 (soundfonts.getChildFile (sf2), 4, 16, 2.0);
+        }
+
+        ~SyntheticSoundsets() { root.deleteRecursively(); }
+
+        static juce::String bKSet (int bits, int layers) { return "Synthetic " + juce::String (bits) + "-bit " + juce::String (layers) + " layers"; }
+        static juce::String typeSet (const juce::String& type) { return "Synthetic " + type + " only"; }
+        static juce::StringArray sampleTypes() { return { "main", "hammer", "resonance", "pedal" }; }
+
+        juce::File root = juce::File::getSpecialLocation (juce::File::tempDirectory).getNonexistentChildFile ("bK sample benchmarks", {});
+        juce::File samples = root.getChildFile ("samples");
+        juce::File soundfonts = root.getChildFile ("soundfonts");
+        juce::String sf2 = "Synthetic.sf2";
+
+        // held for the whole run, so the shared preferences aren't recreated from the user's file
+        juce::SharedResourcePointer<UserPreferences> preferences;
+    };
+
+    /** Call before creating a PluginProcessor, so it picks up the run's preferences. */
+    SyntheticSoundsets& getSoundsets()
+    {
+        static SyntheticSoundsets soundsets;
+        return soundsets;
+    }
+
+    /** Sets preferences for as long as it exists, then puts back what was there. */
+    class PreferenceOverride
+    {
+    public:
+        explicit PreferenceOverride (const std::vector<std::pair<const char*, juce::var>>& values)
+        {
+            auto& soundsets = getSoundsets();
+            set ("default_sample_path", soundsets.samples.getFullPathName());
+            set ("default_soundfonts_path", soundsets.soundfonts.getFullPathName());
+
+            // each mode starts from the defaults, whatever this machine's preferences say
+            for (const auto& [name, value] : UserPreferences::getSampleLoadingDefaults())
+                set (name, value);
+
+            for (const auto& [name, value] : values)
+                set (name, value);
+        }
+
+        ~PreferenceOverride()
+        {
+            for (const auto& [name, value] : original)
+            {
+                if (value.isVoid())
+                    tree.removeProperty (name, nullptr);
+                else
+                    tree.setProperty (name, value, nullptr);
+            }
+        }
+
+    private:
+        void set (const juce::Identifier& id, const juce::var& value)
+        {
+            if (original.count (id) == 0)
+                original[id] = tree.getProperty (id);
+            tree.setProperty (id, value, nullptr);
+        }
+
+        juce::SharedResourcePointer<UserPreferences> preferences;
+        juce::ValueTree tree = preferences->tree;
+        std::map<juce::Identifier, juce::var> original;
+    };
+
+    struct LoadingMode
+    {
+        const char* name;
+        std::vector<std::pair<const char*, juce::var>> preferences;
+    };
+
+    const LoadingMode bKModes[] = {
+        { "native", {} },
+        { "int16", { { "sample_storage", "int16" } } },
+        { "int24", { { "sample_storage", "int24" } } },
+        { "float", { { "sample_storage", "float" } } },
+        { "streamed", { { "sample_streaming", true } } },
+        { "memory-mapped", { { "sample_memory_map", true } } },
+        { "lazy", { { "sample_lazy_loading", true } } },
+    };
+
+    const LoadingMode soundfontModes[] = {
+        { "sfzq", {} },
+        { "predecoded", { { "sfz_predecode_float", true } } },
+        { "memory-mapped", { { "sample_memory_map", true } } },
+    };
+
+    //==============================================================================
+    double residentMegabytes()
+    {
+       #if JUCE_LINUX
+        long pages = 0, residentPages = 0;
+        if (auto* statm = std::fopen ("/proc/self/statm", "r"))
+        {
+            if (std::fscanf (statm, "%ld %ld", &pages, &residentPages) != 2)
+                residentPages = 0;
+            std::fclose (statm);
+        }
+        return (double) residentPages * (double) sysconf (_SC_PAGESIZE) / (1024.0 * 1024.0);
+       #elif JUCE_MAC
+        mach_task_basic_info info {};
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+            return 0.0;
+        return (double) info.resident_size / (1024.0 * 1024.0);
+       #else
+        return 0.0;
+       #endif
+    }
+
+    /**
+     * Loads soundset and runs the message thread's part of the load until it's done. If peakResident
+     * is given, it is raised to the highest resident set size seen while waiting.
+     */
+    bool loadAndWait (SampleLoadManager& manager, const juce::String& soundset, double* peakResident = nullptr)
+    {
+        // soundfonts are only registered under their preset's key once some tree takes them
+        if (! manager.loadSamples (soundset, juce::ValueTree ("Benchmark"), false))
+            return false;
+
+        const auto deadline = juce::Time::getMillisecondCounter() + 120000;
+        while (manager.getSoundsetProgress (soundset.toStdString()) >= 0.0f)
+        {
+            if (juce::Time::getMillisecondCounter() > deadline)
+                return false;
+
+            manager.handleUpdateNowIfNeeded();
+            if (peakResident != nullptr)
+                *peakResident = juce::jmax (*peakResident, residentMegabytes());
+            juce::Thread::sleep (1);
+        }
+
+        return true;
+    }
+
+    /** Unloads everything, and loads soundset as if for the first time in the process. */
+    void coldLoad (SampleLoadManager& manager, const juce::String& soundset)
+    {
+        manager.clearAllSamples();
+        REQUIRE (loadAndWait (manager, soundset));
+    }
+
+    juce::File getCacheFile (const juce::String& soundset, const juce::String& storage)
+    {
+        // where SampleLoadManager puts them
+        juce::SharedResourcePointer<UserPreferences> preferences;
+        return preferences->file.getParentDirectory()
+            .getChildFile ("soundset cache")
+            .getChildFile (juce::File::createLegalFileName (soundset + " " + storage) + ".bkcache");
+    }
+
+    //==============================================================================
+    // both relative to the resident set before the load: getrusage's peak is the whole process's so far, not this load's
+    void report (const juce::String& what, double ms, double residentBefore, double peakResident)
+    {
+        std::cout << what.paddedRight (' ', 48)
+                  << juce::String (ms, 1).paddedLeft (' ', 10) << " ms"
+                  << juce::String (residentMegabytes() - residentBefore, 1).paddedLeft (' ', 10) << " MB resident"
+                  << juce::String (peakResident - residentBefore, 1).paddedLeft (' ', 10) << " MB peak" << std::endl;
+    }
+}
+
+//==============================================================================
+TEST_CASE ("Sample loading performance")
+{
+    getSoundsets();
+    PluginProcessor plugin;
+    auto& manager = *plugin.sampleLoadManager;
+
+    for (const auto& mode : bKModes)
+    {
+        PreferenceOverride preferences (mode.preferences);
+
+        for (int bits : { 16, 24 })
+        {
+            for (int layers : { 2, 8 })
+            {
+                const auto soundset = SyntheticSoundsets::bKSet (bits, layers);
+
+                BENCHMARK ("Cold load, " + soundset.toStdString() + ", " + mode.name)
+                {
+                    coldLoad (manager, soundset);
+                };
+            }
+        }
+    }
+
+    for (const auto& mode : soundfontModes)
+    {
+        PreferenceOverride preferences (mode.preferences);
+        const auto soundset = getSoundsets().sf2;
+
+        BENCHMARK ("Cold load, " + soundset.toStdString() + ", " + mode.name)
+        {
+            coldLoad (manager, soundset);
+        };
+    }
+}
+
+TEST_CASE ("Warm sample loading performance")
+{
+    PreferenceOverride preferences ({ { "soundset_cache_files", true } });
+    const auto soundset = SyntheticSoundsets::bKSet (24, 8);
+
+    // the run's own preferences folder, so only the shared load below writes it
+    const auto cacheFile = getCacheFile (soundset, "native");
+    cacheFile.deleteFile();
+
+    PluginProcessor plugin, otherPlugin;
+    auto& manager = *plugin.sampleLoadManager;
+
+    // another instance has it loaded: this one just attaches
+    REQUIRE (loadAndWait (*otherPlugin.sampleLoadManager, soundset));
+    BENCHMARK ("Warm load, shared with another instance")
+    {
+        coldLoad (manager, soundset);
+    };
+    otherPlugin.sampleLoadManager->clearAllSamples();
+
+    // restored from the .bkcache file written after the other instance's load
+    for (int wait = 0; wait < 60000 && ! cacheFile.existsAsFile(); wait += 10)
+        juce::Thread::sleep (10);
+    REQUIRE (cacheFile.existsAsFile());
+
+    BENCHMARK ("Warm load, from .bkcache file")
+    {
+        coldLoad (manager, soundset);
+    };
+
+    manager.clearAllSamples();
+    cacheFile.deleteFile();
+}
+
+TEST_CASE ("Sample loading memory")
+{
+    getSoundsets();
+    PluginProcessor plugin;
+    auto& manager = *plugin.sampleLoadManager;
+    std::cout << std::endl;
+
+    auto measure = [&] (const juce::String& what, const juce::String& soundset)
+    {
+        manager.clearAllSamples();
+        const auto residentBefore = residentMegabytes();
+        auto peakResident = residentBefore;
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        REQUIRE (loadAndWait (manager, soundset, &peakResident));
+        const auto ms = juce::Time::getMillisecondCounterHiRes() - start;
+        report (what, ms, residentBefore, juce::jmax (peakResident, residentMegabytes()));
+    };
+
+    for (const auto& mode : bKModes)
+    {
+        PreferenceOverride preferences (mode.preferences);
+        measure (SyntheticSoundsets::bKSet (24, 8) + ", " + mode.name, SyntheticSoundsets::bKSet (24, 8));
+    }
+
+    for (const auto& mode : soundfontModes)
+    {
+        PreferenceOverride preferences (mode.preferences);
+        measure (getSoundsets().sf2 + ", " + mode.name, getSoundsets().sf2);
+    }
+
+    // each sample type on its own, 24-bit with 4 layers
+    PreferenceOverride preferences ({});
+    for (const auto& type : SyntheticSoundsets::sampleTypes())
+        measure (SyntheticSoundsets::typeSet (type), SyntheticSoundsets::typeSet (type));
+
+    manager.clearAllSamples();
+}
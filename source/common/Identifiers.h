@@ -159,6 +159,8 @@ namespace IDs
 
     DECLARE_ID(global_A440)
     DECLARE_ID(global_tempo_multiplier)
+    // Gallery-wide: 0 = process the audio graph serially, 1 (default) = run independent preparations in parallel
+    DECLARE_ID(global_parallel_graph)
     // Gallery-wide: UUID of the Tuning preparation selected as the MTS-ESP master
     // source. Empty/absent = none. Only one Tuning per gallery may be the master.
     DECLARE_ID(mtsMasterTuningUuid)
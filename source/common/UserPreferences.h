@@ -67,6 +67,10 @@ public:
         if (! tree.hasProperty ("showHints"))
             tree.setProperty ("showHints", true, nullptr);
 
+        for (const auto& [name, value] : getSampleLoadingDefaults())
+            if (! tree.hasProperty (name))
+                tree.setProperty (name, value, nullptr);
+
         if (tree.getChildWithName ("KNOWNPLUGINS").isValid())
         {
             knownPluginList.recreateFromXml (*tree.getChildWithName ("KNOWNPLUGINS").createXml());
@@ -84,6 +88,35 @@ public:
         //formatManager.addDefaultFormats();
     }
 
+    /** The sample loading preferences, with the values they have until the user changes them. */
+    static const std::vector<std::pair<juce::Identifier, juce::var>>& getSampleLoadingDefaults()
+    {
+        static const std::vector<std::pair<juce::Identifier, juce::var>> defaults {
+            // decode SFZ/SF2 samples to planar float at load time (faster playback, ~2x the memory of 16-bit PCM)
+            { "sfz_predecode_float", false },
+
+            // how bK format samples are held in memory: native (16/24-bit files stay 16/24-bit), int16, int24 or float
+            { "sample_storage", "native" },
+
+            // stream bK format samples from disk, keeping only the first sample_streaming_head_ms of each in memory
+            { "sample_streaming", false },
+            { "sample_streaming_head_ms", 300 },
+
+            // play WAV and SF2 sample data straight from memory-mapped files, shared with other processes through the page cache
+            { "sample_memory_map", false },
+
+            // save each bK soundset decoded to a .bkcache file after loading it, and map that on later loads
+            { "soundset_cache_files", false },
+
+            // load bK soundsets only for the keys the gallery's keymaps use (and this many keys either side),
+            // fetch the rest the first time they're played, and unload those again after the given idle time (0 = never)
+            { "sample_lazy_loading", false },
+            { "sample_lazy_prefetch_keys", 3 },
+            { "sample_lazy_evict_seconds", 120 },
+        };
+        return defaults;
+    }
+
     void changeListenerCallback(juce::ChangeBroadcaster *source) override {
         if (tree.getChildWithName("KNOWNPLUGINS").isValid()) {
             auto pluginList = tree.getChildWithName("KNOWNPLUGINS");
@@ -288,20 +288,6 @@ TuningParametersView::TuningParametersView(
         })
     };
 
-    tuningCallbacks += { listeners.addParameterListener (param.tuningState.springTuningParams.rate,
-        chowdsp::ParameterListenerThread::MessageThread,
-        [this] {
-            params.tuningState.springTuner->rateChanged();
-        })
-    };
-
-    tuningCallbacks += { listeners.addParameterListener (param.tuningState.springTuningParams.drag,
-        chowdsp::ParameterListenerThread::MessageThread,
-        [this] {
-            params.tuningState.springTuner->dragChanged();
-        })
-    };
-
     tuningCallbacks += { listeners.addParameterListener (param.tuningState.springTuningParams.tetherStiffness,
         chowdsp::ParameterListenerThread::MessageThread,
         [this] {
@@ -341,7 +327,6 @@ void TuningParametersView::showAdaptiveTuning(bool show)
 void TuningParametersView::showSpringTuning(bool show)
 {
     springTuningSection->setVisible (show);
-    params.tuningState.springTuner->setRate (params.tuningState.springTuningParams.rate->getCurrentValue(), show);
 }
 
 void TuningParametersView::showScalaKbm(bool show)
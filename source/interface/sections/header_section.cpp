@@ -891,6 +891,7 @@ void HeaderSection::buttonClicked(juce::Button *clicked_button) {
                 // Open a simple dialog to edit global_A440 and global_tempo_multiplier
                 double currentA440 = (double) gallery.getProperty(IDs::global_A440, 440.0);
                 double currentTempoMult = (double) gallery.getProperty(IDs::global_tempo_multiplier, 1.0);
+                bool currentParallel = (bool) gallery.getProperty(IDs::global_parallel_graph, true);
 
                 // Use async modal (runModalLoop is not available in newer JUCE)
                 auto* aw = new juce::AlertWindow ("Gallery Settings",
@@ -902,9 +903,13 @@ void HeaderSection::buttonClicked(juce::Button *clicked_button) {
                 aw->addTextEditor ("tempo",
                                    juce::String (currentTempoMult, 6),
                                    "Tempo Multiplier");
+                aw->addComboBox ("graph",
+                                 { "Parallel", "Serial" },
+                                 "Preparation Processing");
+                aw->getComboBoxComponent ("graph")->setSelectedItemIndex (currentParallel ? 0 : 1, juce::dontSendNotification);
                 aw->addButton ("OK", 1, juce::KeyPress (juce::KeyPress::returnKey));
                 aw->addButton ("Cancel", 0, juce::KeyPress (juce::KeyPress::escapeKey));
-                aw->centreAroundComponent (getTopLevelComponent(), 420, 260);
+                aw->centreAroundComponent (getTopLevelComponent(), 420, 300);
 
                 // Keep a safe pointer to the window so we can read values in the callback
                 juce::Component::SafePointer<juce::AlertWindow> awPtr (aw);
@@ -931,6 +936,9 @@ void HeaderSection::buttonClicked(juce::Button *clicked_button) {
                             auto tempoTrim = tempoText.trim();
                             if (tempoTrim.isNotEmpty() && tempoTrim != "." && newTempo > 0.0)
                                 gallery.setProperty (IDs::global_tempo_multiplier, newTempo, nullptr);
+
+                            if (auto* graphBox = awPtr->getComboBoxComponent ("graph"))
+                                gallery.setProperty (IDs::global_parallel_graph, graphBox->getSelectedItemIndex() == 0, nullptr);
                         }
                     }
                 }),
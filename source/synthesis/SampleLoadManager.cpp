@@ -6,6 +6,8 @@
 //
 
 #include "SampleLoadManager.h"
+#include "SoundsetCacheFile.h"
+#include "SoundfontIndex.h"
 #include "Synthesiser/Sample.h"
 #include "synth_base.h"
 
@@ -30,6 +32,29 @@ static inline juce::String makeSFZKey(const juce::String &base, const juce::Stri
     return base + "||" + preset;
 }
 
+// appended to a bK soundset's name for each sample type's entry in samplerSoundset (see loadSamples_sub)
+static const char* const soundsetSuffixes[] = { "", "Hammers", "ReleaseResonance", "Pedals" };
+
+SoundsetAssembly::SoundsetAssembly (juce::ReferenceCountedArray<BKSynthesiserSound>* soundsetToFill, const juce::String& key, int numParts)
+    : soundset (soundsetToFill),
+      soundsetKey (key),
+      parts ((size_t) numParts),
+      partsRemaining (numParts) {
+}
+
+SoundsetAssembly::~SoundsetAssembly() = default;
+
+void SoundsetAssembly::partLoaded (juce::CriticalSection& soundsetLock) {
+    // acq_rel: the last job sees every other job's part
+    if (partsRemaining.fetch_sub (1, std::memory_order_acq_rel) != 1)
+        return;
+
+    juce::ScopedLock sl (soundsetLock);
+    for (auto& part : parts)
+        soundset->addArray (part);
+    parts.clear();
+}
+
 void SampleSetProgress::markComplete() {
     if (targetTrees.isEmpty())
         return;
@@ -58,11 +83,21 @@ SampleLoadManager::SampleLoadManager(SynthBase *parent,
             allPitches.add(noteOctave);
         }
     }
+
+    // beside the settings, not in the soundset cache folder: it's kept whether or not cache files are on
+    if (preferences != nullptr) {
+        soundfontIndex.load (preferences->userPreferences->file.getSiblingFile ("soundfonts.bkindex"));
+        refreshSoundfontIndex (getSoundfontFiles());
+    }
 }
 
 SampleLoadManager::~SampleLoadManager() {
     shuttingDown = true;
+    stopTimer();
     sampleLoader.removeAllJobs (true, 5000);
+    sampleFetcher.removeAllJobs (true, 5000);
+    cacheFileWriter.removeAllJobs (true, 5000); // a half-written file is just discarded
+    soundfontIndexer.removeAllJobs (true, 5000); // the scan stops between files, and the index is saved next time
     clearAllSamples();
 }
 
@@ -75,6 +110,382 @@ void SampleLoadManager::clearAllSamples() {
         }
     }
     samplerSoundset.clear();
+    sfzPlanarData.clear(); // samples that are still alive keep their own reference
+    sharedSoundsets.clear(); // freed here if no other instance is using them
+
+    // a fetch that's already running holds its pitch, and just finishes into sounds nobody uses
+    sampleFetcher.removeAllJobs (false, 0);
+    deferredPitches.clear();
+}
+
+bool SampleLoadManager::shouldPredecodeSoundfonts() const {
+    if (preferences == nullptr)
+        return false;
+    return (bool) preferences->tree.getProperty ("sfz_predecode_float", false);
+}
+
+SampleStorage SampleLoadManager::getSampleStorage() const {
+    if (preferences == nullptr)
+        return SampleStorage::native;
+    return bitklavier::samplestorage::fromString (preferences->tree.getProperty ("sample_storage", "native").toString());
+}
+
+std::shared_ptr<BKSampleStreamer> SampleLoadManager::getSampleStreamer() const {
+    juce::ScopedLock sl (soundsetLock);
+    return sampleStreamer;
+}
+
+double SampleLoadManager::getStreamingHeadSeconds() const {
+    if (preferences == nullptr)
+        return 0.3;
+    return juce::jmax (0.05, (double) preferences->tree.getProperty ("sample_streaming_head_ms", 300) * 0.001);
+}
+
+bool SampleLoadManager::shouldMemoryMapSamples() const {
+    if (preferences == nullptr)
+        return false;
+    return (bool) preferences->tree.getProperty ("sample_memory_map", false);
+}
+
+bool SampleLoadManager::shouldUseSoundsetCacheFiles() const {
+    if (preferences == nullptr)
+        return false;
+    return (bool) preferences->tree.getProperty ("soundset_cache_files", false);
+}
+
+bool SampleLoadManager::shouldLoadLazily() const {
+    if (preferences == nullptr)
+        return false;
+    return (bool) preferences->tree.getProperty ("sample_lazy_loading", false);
+}
+
+int SampleLoadManager::getLazyPrefetchKeys() const {
+    if (preferences == nullptr)
+        return 3;
+    return juce::jlimit (0, 127, (int) preferences->tree.getProperty ("sample_lazy_prefetch_keys", 3));
+}
+
+std::shared_ptr<Sample<juce::AudioFormatReader>> SampleLoadManager::makeSample (std::unique_ptr<juce::AudioFormatReader> reader,
+                                                                                const juce::File& file,
+                                                                                bool decodeAll) const {
+    if (decodeAll)
+        return std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, getSampleStorage());
+
+    if (shouldMemoryMapSamples())
+        if (auto mapped = MappedWaveFile::open (file))
+            return std::make_shared<Sample<juce::AudioFormatReader>> (std::move (mapped), 90);
+
+    // the streamer opens the file again when a note needs the rest of it, possibly after this
+    // manager has gone, so the reader comes from formats of its own
+    if (auto streamer = getSampleStreamer(); streamer != nullptr && file.existsAsFile())
+        return std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, getSampleStorage(),
+            std::move (streamer), getStreamingHeadSeconds(),
+            [file] {
+                juce::AudioFormatManager formats;
+                formats.registerBasicFormats();
+                return std::unique_ptr<juce::AudioFormatReader> (formats.createReaderFor (file));
+            });
+
+    return std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, getSampleStorage());
+}
+
+static void findKeymapKeys (const juce::ValueTree& tree, juce::BigInteger& keys, bool& foundKeymap, bool& foundDirect) {
+    if (tree.hasType (IDs::keymap)) {
+        foundKeymap = true;
+        if (! tree.hasProperty ("keyOn")) {
+            keys.setRange (0, 128, true);
+        } else {
+            const auto keyOn = bitklavier::utils::stringToBitset (tree.getProperty ("keyOn").toString());
+            for (int key = 0; key < 128; ++key)
+                if (keyOn[(size_t) key])
+                    keys.setBit (key);
+        }
+    } else if (tree.hasType (IDs::direct)) {
+        foundDirect = true;
+    }
+
+    for (const auto& child : tree)
+        findKeymapKeys (child, keys, foundKeymap, foundDirect);
+}
+
+SampleLoadManager::LazyLoadPlan SampleLoadManager::getLazyLoadPlan (const juce::ValueTree& gallery) const {
+    juce::BigInteger keymapKeys;
+    bool foundKeymap = false;
+    LazyLoadPlan plan;
+    findKeymapKeys (gallery, keymapKeys, foundKeymap, plan.directSamples);
+
+    // nothing to go by (no gallery yet): load it all
+    if (! foundKeymap) {
+        plan.keys.setRange (0, 128, true);
+        plan.directSamples = true;
+        return plan;
+    }
+
+    const int radius = getLazyPrefetchKeys();
+    for (int key = keymapKeys.findNextSetBit (0); key >= 0; key = keymapKeys.findNextSetBit (key + 1)) {
+        const int low = juce::jmax (0, key - radius);
+        plan.keys.setRange (low, juce::jmin (127, key + radius) - low + 1, true);
+    }
+    return plan;
+}
+
+void SampleLoadManager::addDeferredPitch (std::shared_ptr<DeferredPitch> pitch) {
+    juce::ScopedLock sl (soundsetLock);
+    deferredPitches.push_back (std::move (pitch));
+}
+
+void SampleLoadManager::timerCallback() {
+    std::vector<std::shared_ptr<DeferredPitch>> pitches;
+    {
+        juce::ScopedLock sl (soundsetLock);
+        pitches = deferredPitches;
+    }
+
+    if (pitches.empty()) {
+        stopTimer();
+        return;
+    }
+
+    auto fetch = [this] (const std::shared_ptr<DeferredPitch>& pitch) {
+        auto expected = DeferredPitch::State::unloaded;
+        if (pitch->state.compare_exchange_strong (expected, DeferredPitch::State::queued))
+            sampleFetcher.addJob ([this, pitch] { fetchDeferredPitch (*pitch); });
+    };
+
+    // a played pitch first, then the ones around it, which are likely to be played next
+    const int radius = getLazyPrefetchKeys();
+    for (const auto& pitch : pitches) {
+        bool requested = false;
+        for (auto* sound : pitch->sounds)
+            requested = sound->takeLoadRequest() || requested;
+
+        if (! requested)
+            continue;
+
+        fetch (pitch);
+
+        juce::BigInteger nearby;
+        const int low = juce::jmax (0, pitch->keys.findNextSetBit (0) - radius);
+        nearby.setRange (low, juce::jmin (127, pitch->keys.getHighestBit() + radius) - low + 1, true);
+
+        for (const auto& other : pitches)
+            if (other->soundsetKey == pitch->soundsetKey && ! (other->keys & nearby).isZero())
+                fetch (other);
+    }
+
+    const int evictSeconds = preferences != nullptr ? (int) preferences->tree.getProperty ("sample_lazy_evict_seconds", 120) : 0;
+    if (evictSeconds <= 0)
+        return;
+
+    const auto now = juce::Time::getMillisecondCounter();
+    for (const auto& pitch : pitches) {
+        if (pitch->state != DeferredPitch::State::loaded)
+            continue;
+
+        // unsigned, so these are right across the counter wrapping
+        auto idle = now - pitch->loadedAt.load();
+        for (auto* sound : pitch->sounds)
+            idle = juce::jmin (idle, now - sound->getLastUsedTime());
+
+        if (idle > (juce::uint32) evictSeconds * 1000)
+            unloadDeferredPitch (*pitch);
+    }
+}
+
+void SampleLoadManager::fetchDeferredPitch (DeferredPitch& pitch) {
+    // the same files, in the same order, as the SampleLoadJob that made the sounds
+    auto files = pitch.files->clone();
+    float dBFSBelow = -50.f;
+
+    for (auto* s : pitch.sounds) {
+        auto [reader, filename] = files->make (*audioFormatManager);
+        if (reader == nullptr || isShuttingDown())
+            break;
+
+        auto* sound = static_cast<BKSamplerSound<juce::AudioFormatReader>*> (s->getSamplerSoundBase());
+        sound->setLoadedSample (makeSample (std::move (reader), files->getLastFile(), false), dBFSBelow);
+
+        if (pitch.layered)
+            dBFSBelow = sound->dBFSLevel;
+    }
+
+    // anything missing stays silent; unloading sorts out whatever did load
+    pitch.loadedAt = juce::Time::getMillisecondCounter();
+    pitch.state = DeferredPitch::State::loaded;
+}
+
+bool SampleLoadManager::unloadDeferredPitch (DeferredPitch& pitch) {
+    // all or nothing, so a pitch never has some layers loaded and some not; a sound whose sample
+    // couldn't be read never got loaded, and must not be "restored" to loaded without one
+    juce::Array<BKSynthesiserSound*> unloading;
+    for (auto* s : pitch.sounds) {
+        if (! s->isLoaded())
+            continue;
+
+        if (! s->beginUnload()) {
+            for (auto* u : unloading)
+                u->cancelUnload();
+            return false;
+        }
+        unloading.add (s);
+    }
+
+    for (auto* s : unloading)
+        static_cast<BKSamplerSound<juce::AudioFormatReader>*> (s->getSamplerSoundBase())->releaseSample();
+
+    pitch.state = DeferredPitch::State::unloaded;
+    DBG ("Unloaded idle pitch of " + pitch.soundsetKey);
+    return true;
+}
+
+void SampleLoadManager::updateSampleStreamer() {
+    const bool streaming = preferences != nullptr && (bool) preferences->tree.getProperty ("sample_streaming", false);
+
+    // samples that are already streamed hold on to their streamer, so turning it off here only affects new loads
+    juce::ScopedLock sl (soundsetLock);
+    if (! streaming)
+        sampleStreamer.reset();
+    else if (sampleStreamer == nullptr)
+        sampleStreamer = std::make_shared<BKSampleStreamer>();
+}
+
+juce::String SampleLoadManager::getSoundsetCacheKey (const juce::File& directory) const {
+    // samples loaded with different options aren't interchangeable
+    juce::String mode = "resident";
+    if (shouldUseSoundsetCacheFiles())
+        mode = "cached";
+    else if (shouldMemoryMapSamples())
+        mode = "mapped";
+    else if (preferences != nullptr && (bool) preferences->tree.getProperty ("sample_streaming", false))
+        mode = "streamed " + juce::String (getStreamingHeadSeconds());
+
+    return directory.getFullPathName() + "|" + bitklavier::samplestorage::toString (getSampleStorage()) + "|" + mode;
+}
+
+bool SampleLoadManager::attachSharedSoundset (const juce::String& soundsetName, const juce::String& cacheKey) {
+    auto soundset = soundsetCache->find (cacheKey);
+    if (soundset == nullptr)
+        return false;
+
+    useSoundset (soundsetName, *soundset);
+
+    DBG ("Soundset " + soundsetName + " is already loaded in another instance; sharing it.");
+    sharedSoundsets[soundsetName] = std::move (soundset);
+    return true;
+}
+
+void SampleLoadManager::shareLoadedSoundset (const juce::String& soundsetName, const juce::String& cacheKey) {
+    std::shared_ptr<const SharedSoundset> offered = collectLoadedSoundset (soundsetName);
+    if (offered == nullptr)
+        return;
+
+    // if another instance finished loading the same set first, theirs stays cached and we keep using ours
+    if (soundsetCache->add (cacheKey, offered) == offered)
+        sharedSoundsets[soundsetName] = std::move (offered);
+}
+
+void SampleLoadManager::useSoundset (const juce::String& soundsetName, const SharedSoundset& soundset) {
+    // our own arrays, holding sounds that may also be in other instances' arrays
+    juce::ScopedLock sl (soundsetLock);
+    for (const auto& [suffix, sounds] : soundset.sounds) {
+        auto& entry = samplerSoundset[soundsetName + suffix];
+        if (entry == nullptr)
+            entry = new juce::ReferenceCountedArray<BKSynthesiserSound> (sounds);
+    }
+}
+
+std::shared_ptr<SharedSoundset> SampleLoadManager::collectLoadedSoundset (const juce::String& soundsetName) {
+    auto soundset = std::make_shared<SharedSoundset>();
+    {
+        juce::ScopedLock sl (soundsetLock);
+        for (auto* suffix : soundsetSuffixes)
+            if (auto it = samplerSoundset.find (soundsetName + suffix); it != samplerSoundset.end() && it->second != nullptr)
+                soundset->sounds[suffix] = *it->second;
+    }
+
+    if (soundset->sounds.empty())
+        return nullptr;
+    return soundset;
+}
+
+juce::File SampleLoadManager::getSoundsetCacheFile (const juce::String& soundsetName) const {
+    // the storage option changes what's in the file, so each gets its own
+    const auto storage = bitklavier::samplestorage::toString (getSampleStorage());
+    return preferences->userPreferences->file.getParentDirectory()
+        .getChildFile ("soundset cache")
+        .getChildFile (juce::File::createLegalFileName (soundsetName + " " + storage) + ".bkcache");
+}
+
+juce::int64 SampleLoadManager::getSoundsetFingerprint (const juce::File& directory) const {
+    // the same files loadSamples_sub reads
+    using namespace bitklavier::utils;
+    juce::Array<juce::File> sources;
+    for (int type = BKPianoMain; type <= BKPianoPedal; ++type) {
+        juce::File subfolder (directory.getFullPathName() + juce::String (BKPianoSampleType_string[type]));
+        auto files = subfolder.findChildFiles (juce::File::findFiles, false, "*.wav");
+        files.sort();
+        sources.addArray (files);
+    }
+
+    return SoundsetCacheFile::fingerprint (sources, bitklavier::samplestorage::toString (getSampleStorage()));
+}
+
+bool SampleLoadManager::restoreCachedSoundset (const juce::String& soundsetName, const juce::File& cacheFile, juce::int64 fingerprint) {
+    auto soundset = SoundsetCacheFile::read (cacheFile, fingerprint);
+    if (soundset == nullptr)
+        return false;
+
+    useSoundset (soundsetName, *soundset);
+    DBG ("Soundset " + soundsetName + " restored from " + cacheFile.getFullPathName());
+    return true;
+}
+
+void SampleLoadManager::writeSoundsetCacheFile (const juce::String& soundsetName, const juce::File& cacheFile, juce::int64 fingerprint) {
+    auto soundset = collectLoadedSoundset (soundsetName);
+    if (soundset == nullptr)
+        return;
+
+    // the job holds the sounds, so it doesn't matter if the soundset is unloaded before it's done
+    cacheFileWriter.addJob ([soundset, cacheFile, fingerprint] {
+        const bool written = SoundsetCacheFile::write (cacheFile, fingerprint, *soundset, [] {
+            return juce::ThreadPoolJob::getCurrentThreadPoolJob()->shouldExit();
+        });
+
+        DBG ((written ? "Wrote " : "Couldn't write ") + cacheFile.getFullPathName());
+        juce::ignoreUnused (written);
+    });
+}
+
+void SampleLoadManager::attachPlanarData (const SFZSound& bank, Sample<SFZRegion>& sample, SFZRegion& region) {
+    if (region.sample == nullptr || region.sample->buffer == nullptr || !region.sample->buffer->valid())
+        return;
+
+    SampleBuffer* buffer = region.sample->buffer;
+    std::shared_ptr<const PlanarSampleData> planar;
+    {
+        juce::ScopedLock sl (soundsetLock);
+        if (auto bankIt = sfzPlanarData.find (&bank); bankIt != sfzPlanarData.end())
+            if (auto it = bankIt->second.find (buffer); it != bankIt->second.end())
+                planar = it->second;
+    }
+
+    if (planar == nullptr)
+    {
+        // decode outside the lock; for SF2 this is the whole smpl chunk, done once
+        auto decoded = std::make_shared<const PlanarSampleData> (*buffer);
+        juce::ScopedLock sl (soundsetLock);
+        planar = sfzPlanarData[&bank].try_emplace (buffer, std::move (decoded)).first->second;
+    }
+
+    sample.setPlanarData (std::move (planar));
+}
+
+void SampleLoadManager::storeSFZBank (const juce::String& key, std::unique_ptr<SFZSound> bank) {
+    juce::ScopedLock sl (soundsetLock);
+    auto& slot = sfzBanks[key];
+    if (slot != nullptr)
+        sfzPlanarData.erase (slot.get()); // samples that are still alive keep their own reference
+    slot = std::move (bank);
 }
 
 void SampleLoadManager::handleAsyncUpdate() {
@@ -106,6 +517,12 @@ void SampleLoadManager::handleAsyncUpdate() {
                 progress->currentProgress = 1.0f;
 
                 progress->markComplete(); // Message thread safe
+
+                if (progress->cacheKey.isNotEmpty())
+                    shareLoadedSoundset (juce::String (name), progress->cacheKey);
+
+                if (progress->cacheFile != juce::File())
+                    writeSoundsetCacheFile (juce::String (name), progress->cacheFile, progress->cacheFingerprint);
             }
 
             // erase returns the next iterator
@@ -116,6 +533,12 @@ void SampleLoadManager::handleAsyncUpdate() {
             ++it;
         }
     }
+
+    {
+        juce::ScopedLock sl (soundsetLock);
+        if (! deferredPitches.empty() && ! isTimerRunning())
+            startTimer (100);
+    }
     parent->finishedSampleLoading();
 }
 
@@ -230,21 +653,13 @@ const std::vector<std::string> SampleLoadManager::getAllSampleSets()
     sampleSets.push_back("menuSeparator"); // to display separator between bK samplesets and soundfonts
     size_t pivot_index = sampleSets.size(); // for sorting soundfonts
 
-    samplePath = preferences->userPreferences->tree.getProperty("default_soundfonts_path");
-    juce::File baseSFDir(samplePath);
+    // 2. .sf2 and .sfz files
+    const auto sfFiles = getSoundfontFiles();
+    for (auto &f: sfFiles)
+        sampleSets.push_back(f.getFileName().toStdString());
 
-    if (baseSFDir.isDirectory())
-    {
-        // 2. .sf2 and .sfz files
-        juce::Array<juce::File> sfFiles = baseSFDir.findChildFiles(
-            juce::File::findFiles,
-            false,
-            "*.sf2;*.sfz" // JUCE supports ";"-separated patterns
-        );
-
-        for (auto &f: sfFiles)
-            sampleSets.push_back(f.getFileName().toStdString());
-    }
+    // pick up soundfonts added or changed since the index was last refreshed
+    refreshSoundfontIndex (sfFiles);
 
     // alphabetically sort soundfonts, ignoring case
     std::sort(sampleSets.begin() + pivot_index, sampleSets.end(), [](const std::string& a, const std::string& b) {
@@ -260,6 +675,31 @@ const std::vector<std::string> SampleLoadManager::getAllSampleSets()
     return sampleSets;
 }
 
+juce::Array<juce::File> SampleLoadManager::getSoundfontFiles() const
+{
+    if (preferences == nullptr)
+        return {};
+
+    juce::File baseSFDir (preferences->userPreferences->tree.getProperty ("default_soundfonts_path").toString());
+    if (! baseSFDir.isDirectory())
+        return {};
+
+    return baseSFDir.findChildFiles (juce::File::findFiles, false, "*.sf2;*.sfz"); // JUCE supports ";"-separated patterns
+}
+
+void SampleLoadManager::refreshSoundfontIndex (const juce::Array<juce::File>& soundfonts)
+{
+    if (soundfonts.isEmpty() || soundfontIndexRefreshing.exchange (true))
+        return;
+
+    soundfontIndexer.addJob ([this, soundfonts] {
+        soundfontIndex.refresh (soundfonts, [] {
+            return juce::ThreadPoolJob::getCurrentThreadPoolJob()->shouldExit();
+        });
+        soundfontIndexRefreshing = false;
+    });
+}
+
 // Helper: decide if this tree represents the "global/gallery" target.
 static bool isGalleryTree(const juce::ValueTree &vt)
 {
@@ -401,7 +841,8 @@ bool SampleLoadManager::loadSamples(const juce::String &soundsetName,
 
     // need this to remove the || containing the preset number from soundfonts
     juce::String setName = soundsetName;
-    if (soundsetName.contains(".sf2") or soundsetName.contains(".sfz"))
+    const bool isSoundfontName = soundsetName.contains(".sf2") or soundsetName.contains(".sfz");
+    if (isSoundfontName)
     {
         samplePath = preferences->userPreferences->tree.getProperty("default_soundfonts_path");
         baseDir = preferences->userPreferences->tree.getProperty("default_soundfonts_path").toString();
@@ -411,6 +852,39 @@ bool SampleLoadManager::loadSamples(const juce::String &soundsetName,
     juce::File directory = baseDir.getChildFile(setName);
 
     DBG("sample path = " + directory.getFullPathName());
+
+    // Another bitKlavier instance in this process may have the same set loaded already.
+    // Soundfonts aren't shared: their SFZSound is per instance, and switching presets changes it.
+    // Failing that, it may have been saved decoded to a .bkcache file by an earlier load.
+    // Lazily loaded sets are neither: what's loaded depends on the gallery, and changes as it's played.
+    juce::String cacheKey;
+    juce::File cacheFile;
+    juce::int64 cacheFingerprint = 0;
+    const bool lazy = ! isSoundfontName && shouldLoadLazily();
+    if (! isSoundfontName && ! lazy)
+    {
+        cacheKey = getSoundsetCacheKey (directory);
+        bool attached = attachSharedSoundset (soundsetName, cacheKey);
+
+        if (! attached && shouldUseSoundsetCacheFiles())
+        {
+            cacheFile = getSoundsetCacheFile (soundsetName);
+            cacheFingerprint = getSoundsetFingerprint (directory);
+            attached = restoreCachedSoundset (soundsetName, cacheFile, cacheFingerprint);
+            if (attached)
+                shareLoadedSoundset (soundsetName, cacheKey);
+        }
+
+        if (attached)
+        {
+            if (vtToWrite.isValid())
+                vtToWrite.setProperty(IDs::soundset, soundsetName, nullptr);
+            if (parent)
+                parent->reloadAllLoadedSamples();
+            return true;
+        }
+    }
+
     // Progress entry
     //but we want that || in the actual name used to match in the soundsetProgressMap, samplerSoundsets, and sfzBank map
     auto &progressPtr = soundsetProgressMap[soundsetName.toStdString()];
@@ -421,6 +895,9 @@ bool SampleLoadManager::loadSamples(const juce::String &soundsetName,
     if (vtToWrite.isValid())
         progressPtr->targetTrees.addIfNotAlreadyThere (vtToWrite); // store where to write soundset / completion callbacks
     progressPtr->load_manager = this;
+    progressPtr->cacheKey = cacheKey;
+    progressPtr->cacheFile = cacheFile;
+    progressPtr->cacheFingerprint = cacheFingerprint;
 
     /*
      * handle soundfonts, otherwise move on to regular bK sample types
@@ -450,10 +927,17 @@ bool SampleLoadManager::loadSamples(const juce::String &soundsetName,
     for (auto file: allSamples)
         DBG(file.getFullPathName() + " " + juce::String (++i));
 
-    loadSamples_sub(bitklavier::utils::BKPianoMain, soundsetName.toStdString());
-    loadSamples_sub(bitklavier::utils::BKPianoHammer, soundsetName.toStdString());
-    loadSamples_sub(bitklavier::utils::BKPianoReleaseResonance, soundsetName.toStdString());
-    loadSamples_sub(bitklavier::utils::BKPianoPedal, soundsetName.toStdString());
+    updateSampleStreamer();
+
+    LazyLoadPlan lazyPlan;
+    if (lazy)
+        lazyPlan = getLazyLoadPlan (targetTree.isValid() ? targetTree.getRoot() : t);
+    const LazyLoadPlan* plan = lazy ? &lazyPlan : nullptr;
+
+    loadSamples_sub(bitklavier::utils::BKPianoMain, soundsetName.toStdString(), plan);
+    loadSamples_sub(bitklavier::utils::BKPianoHammer, soundsetName.toStdString(), plan);
+    loadSamples_sub(bitklavier::utils::BKPianoReleaseResonance, soundsetName.toStdString(), plan);
+    loadSamples_sub(bitklavier::utils::BKPianoPedal, soundsetName.toStdString(), plan);
 
     // Defence-in-depth: if validation said Ok but every loadSamples_sub
     // returned without adding a job (e.g. .wav files are not in the bK
@@ -473,7 +957,7 @@ bool SampleLoadManager::loadSamples(const juce::String &soundsetName,
 }
 
 
-void SampleLoadManager::loadSamples_sub(bitklavier::utils::BKPianoSampleType thisSampleType, std::string name) {
+void SampleLoadManager::loadSamples_sub(bitklavier::utils::BKPianoSampleType thisSampleType, std::string name, const LazyLoadPlan* lazy) {
     using namespace bitklavier::utils;
     // maybe better to do this with templates, but for now...
     juce::String soundsetName = name;
@@ -578,21 +1062,41 @@ void SampleLoadManager::loadSamples_sub(bitklavier::utils::BKPianoSampleType thi
         newPitchSamples.numLayers = onePitchSamples.size();
         newPitchSamples.newMidiRange = midirange;
         newPitchSamples.sampleReaderArray = std::make_unique<FileArrayAudioFormatReaderFactory>(onePitchSamples);
+
+        if (lazy != nullptr) {
+            // hammers and pedals are single keys, whatever range the pitch covers
+            juce::BigInteger keys = midirange;
+            if (thisSampleType == BKPianoHammer || thisSampleType == BKPianoPedal) {
+                keys.clear();
+                keys.setBit (noteNameToRoot (pitchName));
+            }
+
+            const bool typeUsed = thisSampleType == BKPianoMain || lazy->directSamples;
+            newPitchSamples.deferred = ! typeUsed || (keys & lazy->keys).isZero();
+        }
         pitchesVector.push_back(std::move(newPitchSamples));
     }
 
-    int totalUnits = 0;
-    for (auto &ps: pitchesVector)
-        totalUnits += std::max(1, ps.numLayers);
+    if (pitchesVector.empty())
+        return;
 
-    progressPtr->totalJobs++; // one job per sample type
+    // one job per pitch, so every sampleLoader thread has work; the assembly puts the
+    // soundset together in pitch order once they're all done
     samplerSoundset[soundsetName] = new juce::ReferenceCountedArray<BKSynthesiserSound>();
-    sampleLoader.addJob(new SampleLoadJob(
-                            audioFormatManager.get(),
-                            std::move(pitchesVector),
-                            samplerSoundset[soundsetName],
-                            this, progressPtr,
-                            totalUnits, *this), true);
+    auto assembly = std::make_shared<SoundsetAssembly> (samplerSoundset[soundsetName], soundsetName, (int) pitchesVector.size());
+
+    for (int part = 0; part < (int) pitchesVector.size(); ++part) {
+        std::vector<PitchSamplesInfo> pitch;
+        pitch.push_back (std::move (pitchesVector[(size_t) part]));
+
+        progressPtr->totalJobs++;
+        sampleLoader.addJob(new SampleLoadJob(
+                                audioFormatManager.get(),
+                                std::move(pitch),
+                                assembly, part,
+                                this, progressPtr,
+                                1, *this), true);
+    }
 }
 
 
@@ -675,33 +1179,17 @@ juce::StringArray SampleLoadManager::getOrLoadSFZPresetNamesLightweight(const ju
         }
     }
 
-    // Check metadata cache
-    if (auto it = sfzPresetMetadataCache_.find(baseFilename.toStdString()); it != sfzPresetMetadataCache_.end())
-        return it->second;
-
-    // Lightweight load: read file structure only, no PCM data
+    // Otherwise the soundfont index, which only scans the file (no PCM data) if it's new or changed
     juce::String soundfontsPath = preferences->userPreferences->tree.getProperty("default_soundfonts_path");
     juce::File sfFile = juce::File(soundfontsPath).getChildFile(baseFilename);
 
     juce::StringArray presets;
     if (sfFile.existsAsFile()) {
-        const juce::String ext = sfFile.getFileExtension().toLowerCase();
-        std::unique_ptr<SFZSound> tempSound;
-        if (ext == ".sf2")
-            tempSound = std::make_unique<SF2Sound>(sfFile.getFullPathName().toStdString());
-        else if (ext == ".sfz")
-            tempSound = std::make_unique<SFZSound>(sfFile.getFullPathName().toStdString());
-        if (tempSound) {
-            tempSound->load_regions();
-            const juce::juce_wchar bellChar = 7;
-            for (int i = 0; i < tempSound->num_subsounds(); ++i) {
-                juce::String name(tempSound->subsound_name(i));
-                presets.add(name.removeCharacters(juce::String::charToString(bellChar)));
-            }
-        }
+        const juce::juce_wchar bellChar = 7;
+        for (const auto& preset : soundfontIndex.getOrScan(sfFile).presets)
+            presets.add(preset.name.removeCharacters(juce::String::charToString(bellChar)));
     }
 
-    sfzPresetMetadataCache_[baseFilename.toStdString()] = presets;
     return presets;
 }
 
@@ -715,8 +1203,6 @@ void SampleLoadManager::resolveSubsoundIndicesInTree (juce::ValueTree& tree)
     juce::File soundfontsDir (
         preferences->userPreferences->tree.getProperty ("default_soundfonts_path").toString());
 
-    // Cache: soundfont base filename → loaded SFZSound (regions only, no audio data)
-    std::map<juce::String, std::unique_ptr<SFZSound>> sfCache;
 
     std::function<void (juce::ValueTree&)> walk = [&] (juce::ValueTree& node)
     {
@@ -731,37 +1217,13 @@ void SampleLoadManager::resolveSubsoundIndicesInTree (juce::ValueTree& tree)
                 const int index    = preset.substring (1).getIntValue();
                 juce::String base  = sfzBaseFromKey (soundsetKey);
 
-                // Find or load the soundfont metadata
-                SFZSound* sfz = nullptr;
-                auto it = sfCache.find (base);
-                if (it == sfCache.end())
+                // Look the preset up in the soundfont index (scanned now if it's new or changed)
+                juce::File sfFile = soundfontsDir.getChildFile (base);
+                if (sfFile.existsAsFile())
                 {
-                    juce::File sfFile = soundfontsDir.getChildFile (base);
-                    if (sfFile.existsAsFile())
-                    {
-                        const juce::String ext = sfFile.getFileExtension().toLowerCase();
-                        std::unique_ptr<SFZSound> newSound;
-                        if (ext == ".sf2")
-                            newSound = std::make_unique<SF2Sound> (sfFile.getFullPathName().toStdString());
-                        else if (ext == ".sfz")
-                            newSound = std::make_unique<SFZSound> (sfFile.getFullPathName().toStdString());
-                        if (newSound)
-                            newSound->load_regions(); // metadata only — no audio loaded
-                        sfCache.emplace (base, std::move (newSound));
-                    }
-                    else
-                    {
-                        sfCache.emplace (base, nullptr); // mark as tried-and-failed
-                    }
-                    it = sfCache.find (base);
-                }
-                if (it != sfCache.end())
-                    sfz = it->second.get();
-
-                if (sfz != nullptr && index >= 0 && index < sfz->num_subsounds())
-                {
-                    juce::String actualName (sfz->subsound_name (index));
-                    node.setProperty (IDs::soundset, makeSFZKey (base, actualName), nullptr);
+                    const auto presets = soundfontIndex.getOrScan (sfFile).presets;
+                    if (index >= 0 && index < (int) presets.size())
+                        node.setProperty (IDs::soundset, makeSFZKey (base, presets[(size_t) index].name), nullptr);
                 }
             }
         }
@@ -846,6 +1308,8 @@ bool SampleLoadManager::changeSFZPresetAndUpdateTree(const juce::String &current
             // --- Wrap the reader into your Sample class ---
             std::shared_ptr<Sample<SFZRegion> > sample =
                     std::make_shared<Sample<SFZRegion> >(*region);
+            if (shouldPredecodeSoundfonts())
+                attachPlanarData(sound, *sample, *region);
 
             // --- Define note and velocity ranges ---
             juce::BigInteger noteRange;
@@ -936,7 +1400,20 @@ juce::ThreadPoolJob::JobStatus SampleLoadJob::runJob() {
                 progress->hadFailure.store (true);
             return jobHasFinished;
         }
-        return jobNeedsRunningAgain;
+
+        // a job the pool is stopping just goes; its soundset is being thrown away
+        if (shouldExit() || samplerLoader.isShuttingDown())
+            return jobHasFinished;
+
+        // a pitch that fails is skipped, so this is an interruption; still, don't re-queue forever
+        if (++attempts < maxAttempts)
+            return jobNeedsRunningAgain;
+
+        DBG ("SampleLoadJob giving up after " + juce::String (attempts) + " attempts");
+        if (progress)
+            progress->hadFailure.store (true);
+        loadedSounds().clear();
+        assembly->partLoaded (samplerLoader.getSoundsetLock()); // so the rest of the soundset still comes together
     }
     return jobHasFinished;
 }
@@ -988,8 +1465,17 @@ bool SampleLoadJob::loadSamples() {
     bool loadSuccess = false;
     if (sampleReaderVector.empty() && sfzFile.exists())
         return loadSoundFont(sfzFile);
-    for (int i = continueValue; i < sampleReaderVector.size(); i++) {
-        auto &samplePitch = sampleReaderVector[i];
+    if (assembly == nullptr)
+        return false; // a soundfont job whose file has gone
+
+    // if we're run again after giving up part way, start the part over
+    loadedSounds().clear();
+    completedUnits = 0;
+    std::vector<std::shared_ptr<DeferredPitch>> deferred;
+
+    for (auto &samplePitch : sampleReaderVector) {
+        const int firstSound = loadedSounds().size();
+        deferringSamples = samplePitch.deferred;
         thisSampleType = samplePitch.sampleType;
         velocityLayers = samplePitch.numLayers;
         thisMidiRange = samplePitch.newMidiRange;
@@ -1001,7 +1487,7 @@ bool SampleLoadJob::loadSamples() {
         // DBG ("BigInteger range: start = " + juce::String (start)
         //      + ", end = " + juce::String (end)
         //      + ", length = " + juce::String (end - start + 1));
-        sampleReader = std::move(samplePitch.sampleReaderArray);
+        sampleReader = samplePitch.sampleReaderArray->clone();
 
         //DBG ("loadSamples called for " + juce::String (BKPianoSampleType_string[thisSampleType]));
 
@@ -1015,14 +1501,51 @@ bool SampleLoadJob::loadSamples() {
             loadSuccess = loadPedalSamples();
 
         if (!loadSuccess) {
-            continueValue = i;
-            DBG("SampleLoadJob::loadSamples() did not load some samples successfully");
-            return false;
+            if (shouldExit() || samplerLoader.isShuttingDown())
+                return false;
+
+            // a pitch that can't be loaded won't load next time either: leave it out of the soundset
+            // and count it as done, rather than re-queueing the job and never finishing the soundset
+            DBG("SampleLoadJob::loadSamples() skipping a pitch it couldn't load, at " + sampleReader->getLastFile().getFileName());
+            loadedSounds().removeRange (firstSound, loadedSounds().size() - firstSound);
+            tickProgress();
+            continue;
+        }
+
+        if (deferringSamples) {
+            auto pitch = std::make_shared<DeferredPitch>();
+            pitch->soundsetKey = assembly->soundsetKey;
+            pitch->layered = thisSampleType == BKPianoMain || thisSampleType == BKPianoReleaseResonance;
+            pitch->files = samplePitch.sampleReaderArray->clone();
+            for (int i = firstSound; i < loadedSounds().size(); ++i) {
+                auto* sound = static_cast<BKSamplerSound<juce::AudioFormatReader>*> (loadedSounds()[i]->getSamplerSoundBase());
+                pitch->keys |= sound->getMidiNotes();
+                pitch->sounds.add (sound);
+            }
+            deferred.push_back (std::move (pitch));
         }
         tickProgress();
     }
 
-    return loadSuccess;
+    for (auto& pitch : deferred)
+        samplerLoader.addDeferredPitch (std::move (pitch));
+    assembly->partLoaded (samplerLoader.getSoundsetLock());
+    return true;
+}
+
+std::shared_ptr<Sample<juce::AudioFormatReader>> SampleLoadJob::makeSample (std::unique_ptr<juce::AudioFormatReader> reader) {
+    if (deferringSamples)
+        return nullptr;
+
+    // a soundset being saved to a .bkcache file needs every sample decoded
+    const bool decodeAll = progress != nullptr && progress->cacheFile != juce::File();
+
+    // a file that opens but has no audio in it (e.g. truncated) fails its pitch, like a bad layer count
+    try {
+        return samplerLoader.makeSample (std::move (reader), sampleReader->getLastFile(), decodeAll);
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
 }
 
 bool SampleLoadJob::loadHammerSamples() {
@@ -1035,7 +1558,9 @@ bool SampleLoadJob::loadHammerSamples() {
         if (!reader)
             break; // Break the loop if the reader is null
 
-        auto sample = new Sample(*(reader.get()), 90);
+        auto sample = makeSample (std::move (reader));
+        if (sample == nullptr && ! deferringSamples)
+            return false;
 
         // isolate MIDI
         juce::StringArray stringArray;
@@ -1054,13 +1579,9 @@ bool SampleLoadJob::loadHammerSamples() {
         if (shouldExit() || samplerLoader.isShuttingDown())
             return false;
 
-        BKSynthesiserSound* sound;
-        {
-            juce::ScopedLock sl (samplerLoader.getSoundsetLock());
-            sound = soundset->add (new BKSamplerSound<juce::AudioFormatReader> (
-                filename, std::shared_ptr<Sample<juce::AudioFormatReader>> (sample), midiNoteRange, midiNote, 0, velRange,
-                1, dBFSBelow));
-        }
+        loadedSounds().add (new BKSamplerSound<juce::AudioFormatReader> (
+            filename, sample, midiNoteRange, midiNote, 0, velRange,
+            1, dBFSBelow));
     }
     // DBG ("done loading hammer samples");
     return true;
@@ -1081,7 +1602,9 @@ bool SampleLoadJob::loadReleaseResonanceSamples() {
             break; // Break the loop if the reader is null
 
         //            DBG ("**** loading resonance sample: " + filename);
-        auto sample = new Sample(*(reader.get()), 90);
+        auto sample = makeSample (std::move (reader));
+        if (sample == nullptr && ! deferringSamples)
+            return false;
 
         juce::StringArray stringArray;
         stringArray.addTokens(filename, "v", "");
@@ -1089,6 +1612,10 @@ bool SampleLoadJob::loadReleaseResonanceSamples() {
         juce::String velLayer = stringArray[1];
         int midiNote = noteNameToRoot(noteName);
 
+        if (currentVelLayer >= layers) {
+            DBG("more samples than velocity layers at " + filename);
+            return false;
+        }
         auto [begin, end] = ranges.getUnchecked(currentVelLayer++);
         juce::BigInteger velRange;
         velRange.setRange(begin, end - begin, true);
@@ -1096,13 +1623,9 @@ bool SampleLoadJob::loadReleaseResonanceSamples() {
         if (shouldExit() || samplerLoader.isShuttingDown())
             return false;
 
-        BKSynthesiserSound* sound;
-        {
-            juce::ScopedLock sl (samplerLoader.getSoundsetLock());
-            sound = soundset->add (new BKSamplerSound<juce::AudioFormatReader> (
-                filename, std::shared_ptr<Sample<juce::AudioFormatReader>> (sample), thisMidiRange, midiNote, 0, velRange,
-                layers, dBFSBelow));
-        }
+        auto* sound = loadedSounds().add (new BKSamplerSound<juce::AudioFormatReader> (
+            filename, sample, thisMidiRange, midiNote, 0, velRange,
+            layers, dBFSBelow));
 
         dBFSBelow = sound->dBFSLevel; // to pass on to next sample, which should be the next velocity layer above
         //DBG ("**** loading resonance sample: " + filename);
@@ -1128,7 +1651,9 @@ bool SampleLoadJob::loadPedalSamples() {
         if (!reader)
             break; // Break the loop if the reader is null
 
-        auto sample = new Sample(*(reader.get()), 90);
+        auto sample = makeSample (std::move (reader));
+        if (sample == nullptr && ! deferringSamples)
+            return false;
 
         int midiNote;
         if (filename.contains("D"))
@@ -1142,6 +1667,10 @@ bool SampleLoadJob::loadPedalSamples() {
         juce::BigInteger midiNoteRange;
         midiNoteRange.setRange(midiNote, 1, true);
 
+        if (currentVelLayer >= layers) {
+            DBG("more samples than velocity layers at " + filename);
+            return false;
+        }
         auto [begin, end] = ranges.getUnchecked(currentVelLayer++);
         juce::BigInteger velRange;
         velRange.setRange(begin, end - begin, true);
@@ -1150,13 +1679,9 @@ bool SampleLoadJob::loadPedalSamples() {
         if (shouldExit() || samplerLoader.isShuttingDown())
             return false;
 
-        BKSynthesiserSound* sound;
-        {
-            juce::ScopedLock sl (samplerLoader.getSoundsetLock());
-            sound = soundset->add (new BKSamplerSound<juce::AudioFormatReader> (
-                filename, std::shared_ptr<Sample<juce::AudioFormatReader>> (sample), midiNoteRange, midiNote, 0, velRange,
-                1, dBFSBelow));
-        }
+        loadedSounds().add (new BKSamplerSound<juce::AudioFormatReader> (
+            filename, sample, midiNoteRange, midiNote, 0, velRange,
+            1, dBFSBelow));
     }
 
     DBG("done loading pedal samples");
@@ -1177,13 +1702,19 @@ bool SampleLoadJob::loadMainSamplesByPitch() {
         auto [reader, filename] = sampleReader->make(*manager);
         if (!reader)
             break; // Break the loop if the reader is null
-        auto sample = std::make_shared<Sample<juce::AudioFormatReader> >(*(reader.get()), 90);
+        auto sample = makeSample (std::move (reader));
+        if (sample == nullptr && ! deferringSamples)
+            return false;
         juce::StringArray stringArray;
         stringArray.addTokens(filename, "v", "");
         juce::String noteName = stringArray[0];
         juce::String velLayer = stringArray[1];
         int midiNote = noteNameToRoot(noteName);
         // DBG(velLayer + "= " +  juce::String(currentVelLayer));
+        if (currentVelLayer >= layers) {
+            DBG("more samples than velocity layers at " + filename);
+            return false;
+        }
         auto [begin, end] = ranges.getUnchecked(currentVelLayer++);
         juce::BigInteger velRange;
         velRange.setRange(begin, end - begin, true);
@@ -1193,13 +1724,10 @@ bool SampleLoadJob::loadMainSamplesByPitch() {
             return false;
         }
 
-        BKSynthesiserSound* sound;
-        {
-            juce::ScopedLock sl (samplerLoader.getSoundsetLock());
-            sound = soundset->add (
-                new BKSamplerSound<juce::AudioFormatReader> (filename, sample, thisMidiRange, midiNote, 0, velRange, layers,
-                    dBFSBelow));
-        }
+        // our own part of the soundset, so no lock
+        auto* sound = loadedSounds().add (
+            new BKSamplerSound<juce::AudioFormatReader> (filename, sample, thisMidiRange, midiNote, 0, velRange, layers,
+                dBFSBelow));
 
         dBFSBelow = sound->dBFSLevel; // to pass on to next sample, which should be the next velocity layer above
         //DBG ("done loading main samples for " + filename);
@@ -1247,6 +1775,7 @@ bool SampleLoadJob::loadSoundFont(juce::File sfzFile) {
     }
 
     // --- Load the soundfont ---
+    sound->set_memory_mapped(samplerLoader.shouldMemoryMapSamples());
     sound->load_regions();
     sound->load_samples();
 
@@ -1301,6 +1830,8 @@ bool SampleLoadJob::loadSoundFont(juce::File sfzFile) {
         // --- Wrap the reader into your Sample class ---
         std::shared_ptr<Sample<SFZRegion> > sample =
                 std::make_shared<Sample<SFZRegion> >(*region);
+        if (samplerLoader.shouldPredecodeSoundfonts())
+            samplerLoader.attachPlanarData(*sound, *sample, *region);
 
         // --- Define note and velocity ranges ---
         juce::BigInteger noteRange;
@@ -1351,10 +1882,10 @@ bool SampleLoadJob::loadSoundFont(juce::File sfzFile) {
 
     if (sound->num_subsounds() > 0 && preset.isEmpty()) {
         progress->presetName = sound->subsound_name(0);
-        samplerLoader.sfzBanks[makeSFZKey(progress->soundsetName,progress->presetName) ] = std::move(sound);
+        samplerLoader.storeSFZBank(makeSFZKey(progress->soundsetName,progress->presetName), std::move(sound));
     }
     else
-        samplerLoader.sfzBanks[progress->soundsetName] = std::move(sound);
+        samplerLoader.storeSFZBank(progress->soundsetName, std::move(sound));
     DBG("loadSoundFont: Finished loading " + sfzFile.getFileNameWithoutExtension());
     return true;
 }
@@ -14,9 +14,17 @@
 #include <juce_events/juce_events.h>
 #include "overlay.h"
 #include "SFZSound.h"
+#include "SoundsetCache.h"
+#include "SoundfontIndex.h"
 class BKSynthesiserSound;
 template <typename T>
 class BKSamplerSound;
+template <typename ReaderType>
+class Sample;
+struct PlanarSampleData;
+class BKSampleStreamer;
+class SampleBuffer;
+class SFZRegion;
 
 class AudioFormatReaderFactory
 {
@@ -31,6 +39,9 @@ public:
 
     virtual std::pair<std::unique_ptr<juce::AudioFormatReader>, juce::String> make (juce::AudioFormatManager&) const = 0;
     virtual std::unique_ptr<AudioFormatReaderFactory> clone() const = 0;
+
+    // The file behind the last reader make() returned, if it came from one (used for memory mapping).
+    virtual juce::File getLastFile() const { return {}; }
 };
 
 /**
@@ -42,6 +53,28 @@ struct PitchSamplesInfo
     int numLayers;
     juce::BigInteger newMidiRange;
     std::unique_ptr<AudioFormatReaderFactory> sampleReaderArray;
+    bool deferred = false; // lazily loaded: the sounds are made now, their samples once played (see DeferredPitch)
+};
+
+/**
+ * A pitch of a lazily loaded bK soundset (see SampleLoadManager::shouldLoadLazily()) whose sounds
+ * went into the soundset without their samples. The SampleLoadManager loads them in the background
+ * once one of them is played, or a key near one, and unloads them again if they go unplayed.
+ *
+ * All of a pitch's velocity layers load together, since each layer's gain range comes from the
+ * level of the layer below.
+ */
+struct DeferredPitch
+{
+    enum class State { unloaded, queued, loaded };
+
+    juce::String soundsetKey;                          // its samplerSoundset entry
+    juce::BigInteger keys;                             // the keys its sounds play on
+    bool layered = false;                              // main and release resonance samples: levels chain up the layers
+    std::unique_ptr<AudioFormatReaderFactory> files;   // one per sound, in the same order
+    juce::ReferenceCountedArray<BKSynthesiserSound> sounds;
+    std::atomic<State> state { State::unloaded };
+    std::atomic<juce::uint32> loadedAt { 0 };
 };
 struct SampleSetProgress
 {
@@ -58,6 +91,9 @@ struct SampleSetProgress
     juce::String soundsetName;        // actual sample set name to set into the tree
     juce::String presetName;
     juce::ReferenceCountedArray<BKSynthesiserSound>* soundset = nullptr;
+    juce::String cacheKey;            // bK soundsets: where to share it in the SoundsetCache once loaded
+    juce::File cacheFile;             // bK soundsets: the .bkcache file to write once loaded, if any
+    juce::int64 cacheFingerprint = 0; // ...and the fingerprint of the WAV files it's written from
 
     SampleLoadManager* load_manager = nullptr;
 
@@ -66,6 +102,27 @@ struct SampleSetProgress
 
 };
 
+/**
+ * Puts one sample type's soundset together from SampleLoadJobs that run in parallel.
+ *
+ * Each job loads its sounds into its own part; whichever job finishes last adds all the parts
+ * to the soundset in the order the jobs were queued, so the soundset comes out the same no
+ * matter which threads got there first.
+ */
+struct SoundsetAssembly
+{
+    SoundsetAssembly (juce::ReferenceCountedArray<BKSynthesiserSound>* soundset, const juce::String& soundsetKey, int numParts);
+    ~SoundsetAssembly();
+
+    /** Called by each job once its part is loaded. */
+    void partLoaded (juce::CriticalSection& soundsetLock);
+
+    juce::ReferenceCountedArray<BKSynthesiserSound>* const soundset;
+    const juce::String soundsetKey; // its samplerSoundset entry
+    std::vector<juce::ReferenceCountedArray<BKSynthesiserSound>> parts; // one per job, each written only by its job
+    std::atomic<int> partsRemaining;
+};
+
 inline std::unique_ptr<juce::AudioFormatReader> makeAudioFormatReader (juce::AudioFormatManager& manager,
     const void* sampleData,
     size_t dataSize)
@@ -103,6 +160,11 @@ public:
         return std::unique_ptr<AudioFormatReaderFactory> (new FileArrayAudioFormatReaderFactory (*this));
     }
 
+    juce::File getLastFile() const override
+    {
+        return currentFile > 0 ? files[currentFile - 1] : juce::File();
+    }
+
 private:
     juce::Array<juce::File> files;
     //mutable int so that const make can modify vairable
@@ -130,7 +192,8 @@ private:
 //    juce::File file;
 //};
 class SynthBase;
-class SampleLoadManager : public juce::AsyncUpdater
+class SampleLoadManager : public juce::AsyncUpdater,
+                          private juce::Timer
 {
 public:
     SampleLoadManager (SynthBase* parent, std::shared_ptr<UserPreferencesWrapper> preferences);
@@ -160,7 +223,13 @@ public:
     bool loadSamples (const juce::String& soundsetName,
                       const juce::ValueTree& targetTreee = juce::ValueTree{},
                       bool reportErrorsHere = true);
-    void loadSamples_sub (bitklavier::utils::BKPianoSampleType thisSampleType,std::string);
+    // which pitches of a lazily loaded soundset are loaded up front; the rest become DeferredPitches
+    struct LazyLoadPlan
+    {
+        juce::BigInteger keys;       // the gallery's keymap keys, widened by the prefetch radius
+        bool directSamples = false;  // hammers, release resonance and pedals, which only Direct plays
+    };
+    void loadSamples_sub (bitklavier::utils::BKPianoSampleType thisSampleType,std::string, const LazyLoadPlan* lazy = nullptr);
     juce::Array<juce::File> samplesByPitch (juce::String whichPitch, juce::Array<juce::File> inFiles);
     bool isSoundsetLoaded (const juce::String& baseName) const
     {
@@ -175,13 +244,17 @@ public:
     void handleAsyncUpdate() override;
     std::unique_ptr<juce::AudioFormatManager> audioFormatManager;
     std::unique_ptr<AudioFormatReaderFactory> readerFactory;
-    juce::ThreadPool sampleLoader;
+    juce::ThreadPool sampleLoader; // one thread per CPU (the ThreadPool default); bK soundsets queue a job per pitch
     std::atomic<bool> shuttingDown { false };
     juce::CriticalSection soundsetLock;
     std::map<juce::String, juce::ReferenceCountedArray<BKSynthesiserSound>*> samplerSoundset;
     std::map<std::string, std::shared_ptr<SampleSetProgress>> soundsetProgressMap;
     std::unordered_map<juce::String, std::unique_ptr<SFZSound>> sfzBanks; // key = sfzName.toStdString()
-    std::map<std::string, juce::StringArray> sfzPresetMetadataCache_; // base filename -> preset names
+    SoundfontIndex soundfontIndex; // presets of the files in the soundfonts folder, saved beside the settings file
+    // decoded PCM per SFZ/SF2 bank and SampleBuffer, guarded by soundsetLock; a bank's entries are dropped
+    // before it's replaced in sfzBanks, so a new buffer at a freed one's address never finds stale data
+    std::map<const SFZSound*, std::map<const SampleBuffer*, std::shared_ptr<const PlanarSampleData>>> sfzPlanarData;
+    void storeSFZBank (const juce::String& key, std::unique_ptr<SFZSound> bank);
     // perhaps these should be moved to utils or something
     juce::Array<juce::String> allPitches;
     juce::Array<juce::String> allPitchClasses = { "A", "A#", "Bb", "B", "C", "C#", "Db", "D", "D#", "Eb", "E", "F", "F#", "Gb", "G", "G#", "Ab" };
@@ -222,13 +295,56 @@ public:
     bool selectSFZPreset (const juce::String& sfzName,
                           const juce::String& presetName);
     // Returns preset names for a soundfont by base filename. Uses sfzBanks if
-    // already loaded, otherwise does a lightweight (no PCM) metadata scan.
-    // Results are cached, so repeated calls are cheap.
+    // already loaded, otherwise the soundfont index, which only scans the file
+    // (structure only, no PCM) if it has no up to date entry for it.
     juce::StringArray getOrLoadSFZPresetNamesLightweight (const juce::String& baseFilename);
     bool changeSFZPresetAndUpdateTree (const juce::String& currentSfzKey,
                                   int newPresetIndex,
                                  juce::ValueTree& targetTree);
 
+    // With the "sfz_predecode_float" preference on (off by default), SFZ/SF2 PCM is decoded once
+    // into planar float and attached to the sample, so voices skip sfzq's per-sample
+    // read_sample calls. Decoded data is shared by every region using the same SampleBuffer.
+    bool shouldPredecodeSoundfonts() const;
+
+    // Storage for bK format samples, from the "sample_storage" preference (see CompactSampleData).
+    SampleStorage getSampleStorage() const;
+
+    // With the "sample_streaming" preference on, bK format samples keep their first
+    // "sample_streaming_head_ms" in memory and the rest is streamed from disk as notes play.
+    // The streamer is (re)checked on the message thread each time a soundset load starts;
+    // load jobs pick it up through getSampleStreamer(), which is null when streaming is off.
+    std::shared_ptr<BKSampleStreamer> getSampleStreamer() const;
+    double getStreamingHeadSeconds() const;
+
+    // With the "sample_memory_map" preference on, 16/24-bit and float WAV samples (bK format and
+    // SFZ) and SF2 sample data are memory-mapped instead of copied into memory, so voices read the
+    // OS page cache directly and processes playing the same files share it (see MappedWaveFile).
+    // Files that can't be mapped are loaded the usual way. Takes priority over streaming.
+    bool shouldMemoryMapSamples() const;
+
+    // With the "soundset_cache_files" preference on, each bK soundset is saved decoded into a
+    // .bkcache file next to the preferences once it's loaded, and later loads map that instead
+    // of reading the WAV files (see SoundsetCacheFile). A load that has to write the file decodes
+    // every sample into memory, whatever the streaming and memory mapping preferences say.
+    bool shouldUseSoundsetCacheFiles() const;
+
+    // With the "sample_lazy_loading" preference on, a bK soundset only loads the pitches that the
+    // gallery's keymaps use, plus "sample_lazy_prefetch_keys" either side, and its hammer, release
+    // resonance and pedal samples only if the gallery has a Direct. The other pitches' sounds go into
+    // the soundset without samples (see DeferredPitch): the first note on one is silent and starts a
+    // background load of it and its neighbours, and it's unloaded again after going unplayed for
+    // "sample_lazy_evict_seconds". Lazily loaded soundsets aren't shared or saved to .bkcache files.
+    bool shouldLoadLazily() const;
+    int getLazyPrefetchKeys() const;
+    void addDeferredPitch (std::shared_ptr<DeferredPitch> pitch);
+
+    // Decodes, streams or maps a bK sample (see the preferences above); decodeAll overrides them.
+    std::shared_ptr<Sample<juce::AudioFormatReader>> makeSample (std::unique_ptr<juce::AudioFormatReader> reader,
+                                                                 const juce::File& file,
+                                                                 bool decodeAll) const;
+    void attachPlanarData (const SFZSound& bank, Sample<SFZRegion>& sample, SFZRegion& region);
+
     // Walks a ValueTree and replaces any soundset values that use the legacy
     // "#N" index notation (e.g. "filename.sf2||#7") with the actual preset name
     // by loading the soundfont metadata from disk.  Call this on the gallery
@@ -236,6 +352,39 @@ public:
     void resolveSubsoundIndicesInTree (juce::ValueTree& tree);
 
 private:
+    void updateSampleStreamer();
+    std::shared_ptr<BKSampleStreamer> sampleStreamer; // guarded by soundsetLock
+
+    // bK soundsets are shared with other instances in the process through the SoundsetCache:
+    // a set that's already loaded elsewhere (same directory, same load options) is attached
+    // instead of loaded, and sets this instance loads are offered to the others.
+    juce::String getSoundsetCacheKey (const juce::File& directory) const;
+    bool attachSharedSoundset (const juce::String& soundsetName, const juce::String& cacheKey);
+    void shareLoadedSoundset (const juce::String& soundsetName, const juce::String& cacheKey);
+    void useSoundset (const juce::String& soundsetName, const SharedSoundset& soundset);
+    std::shared_ptr<SharedSoundset> collectLoadedSoundset (const juce::String& soundsetName);
+
+    juce::File getSoundsetCacheFile (const juce::String& soundsetName) const;
+    juce::int64 getSoundsetFingerprint (const juce::File& directory) const;
+    bool restoreCachedSoundset (const juce::String& soundsetName, const juce::File& cacheFile, juce::int64 fingerprint);
+    void writeSoundsetCacheFile (const juce::String& soundsetName, const juce::File& cacheFile, juce::int64 fingerprint);
+    juce::ThreadPool cacheFileWriter { 1 }; // writes .bkcache files off the message thread, one at a time
+
+    // rescans new and changed soundfonts into the soundfont index on a thread of its own, so a long
+    // scan doesn't hold up .bkcache writes (or the other way round)
+    juce::Array<juce::File> getSoundfontFiles() const;
+    void refreshSoundfontIndex (const juce::Array<juce::File>& soundfonts);
+    juce::ThreadPool soundfontIndexer { 1 };
+    std::atomic<bool> soundfontIndexRefreshing { false };
+
+    LazyLoadPlan getLazyLoadPlan (const juce::ValueTree& gallery) const;
+    void timerCallback() override; // fetches requested DeferredPitches and unloads idle ones
+    void fetchDeferredPitch (DeferredPitch& pitch);
+    bool unloadDeferredPitch (DeferredPitch& pitch);
+    std::vector<std::shared_ptr<DeferredPitch>> deferredPitches; // guarded by soundsetLock
+    juce::ThreadPool sampleFetcher { 2 };                         // loads DeferredPitches while the sampleLoader may be busy
+    juce::SharedResourcePointer<SoundsetCache> soundsetCache;
+    std::map<juce::String, std::shared_ptr<const SharedSoundset>> sharedSoundsets; // keeps what we use alive
     SFZSound* findSFZSoundByName (const juce::String& sfzName) const;
     void postSoundsetLoadAlert (const juce::String& soundsetName,
                                 SoundsetLoadStatus status) const;
@@ -279,10 +428,12 @@ public:
     SampleLoadJob (
         juce::AudioFormatManager* manager,
         std::vector<PitchSamplesInfo>&& srvector,
-        juce::ReferenceCountedArray<BKSynthesiserSound>* soundset,
+        std::shared_ptr<SoundsetAssembly> assembly, int assemblyPart,
         juce::AsyncUpdater* loadManager,std::shared_ptr<SampleSetProgress> progress, int totalUnits, SampleLoadManager& sampleLoad) : juce::ThreadPoolJob ("sample_loader"),
                                            sampleReaderVector (std::move(srvector)),
-                                           soundset (soundset),
+                                           soundset (nullptr),
+                                           assembly (std::move (assembly)),
+                                           assemblyPart (assemblyPart),
                                            loadManager (loadManager),
                                            manager (manager),
     progress(progress),
@@ -311,19 +462,26 @@ public:
     }
 
     JobStatus runJob() override;
+    int attempts = 0; // interrupted runs; the job gives up on its part after maxAttempts
+    static constexpr int maxAttempts = 3;
     bool loadSoundFont(juce::File sfzFile);
     bool loadSamples(); // calls one of the following, depending on context
     bool loadMainSamplesByPitch();
     bool loadHammerSamples();
     bool loadReleaseResonanceSamples();
     bool loadPedalSamples();
+    std::shared_ptr<Sample<juce::AudioFormatReader>> makeSample (std::unique_ptr<juce::AudioFormatReader> reader);
+    bool deferringSamples = false; // this pitch is a DeferredPitch: sounds only, no samples
 
     int thisSampleType;
     int velocityLayers; // how many velocity layers for this particular string
     juce::BigInteger thisMidiRange;
     juce::Array<std::tuple<int, int>> getVelLayers (int howmany);
 
-    juce::ReferenceCountedArray<BKSynthesiserSound>* soundset;
+    juce::ReferenceCountedArray<BKSynthesiserSound>* soundset; // soundfont jobs
+    std::shared_ptr<SoundsetAssembly> assembly;                 // bK sample jobs: where this job's sounds go
+    int assemblyPart = 0;
+    juce::ReferenceCountedArray<BKSynthesiserSound>& loadedSounds() { return assembly->parts[(size_t) assemblyPart]; }
     std::unique_ptr<AudioFormatReaderFactory> sampleReader;
     juce::File sfzFile;
     juce::AudioFormatManager* manager;
@@ -344,7 +502,6 @@ public:
                           / (float)progress->totalJobs;
         progress->currentProgress.store(totalFrac);
     }
-     int continueValue = 0;
     int velLayerContinue = 0;
     float dbfsBelowContinue = 0.f;
     /**
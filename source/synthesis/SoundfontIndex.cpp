@@ -0,0 +1,229 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "SoundfontIndex.h"
+#include "SFZSound.h"
+#include "SF2Sound.h"
+
+/*
+ * Layout (little-endian):
+ *
+ *   magic[8], int32 version, int32 numFiles
+ *   numFiles entries:
+ *     string path, int64 size, int64 modified, int32 numPresets
+ *     numPresets presets: string name, int32 numRegions, int32 loKey, int32 hiKey
+ */
+namespace
+{
+    constexpr char kMagic[8] = { 'b', 'K', 's', 'f', 'i', 'd', 'x', '\0' };
+    constexpr int kVersion = 2;
+}
+
+void SoundfontIndex::load (const juce::File& file)
+{
+    const juce::ScopedLock sl (lock);
+    indexFile = file;
+    entries.clear();
+    changed = false;
+
+    juce::MemoryBlock block;
+    if (! file.existsAsFile() || ! file.loadFileAsData (block) || block.getSize() < sizeof (kMagic) + 8)
+        return;
+
+    juce::MemoryInputStream in (block, false);
+    char magic[sizeof (kMagic)];
+    in.read (magic, (int) sizeof (magic));
+    if (std::memcmp (magic, kMagic, sizeof (kMagic)) != 0 || in.readInt() != kVersion)
+        return;
+
+    // a damaged file is just dropped; everything gets scanned again
+    std::map<juce::String, Entry> read;
+    const auto numFiles = in.readInt();
+    if (numFiles < 0)
+        return;
+
+    for (int i = 0; i < numFiles; ++i)
+    {
+        const auto path = in.readString();
+        Entry entry;
+        entry.size = in.readInt64();
+        entry.modified = in.readInt64();
+
+        // each preset takes at least 13 bytes
+        const auto numPresets = in.readInt();
+        if (numPresets < 0 || (juce::int64) numPresets * 13 > in.getNumBytesRemaining())
+            return;
+
+        entry.presets.reserve ((size_t) numPresets);
+        for (int p = 0; p < numPresets; ++p)
+        {
+            Preset preset;
+            preset.name = in.readString();
+            preset.numRegions = in.readInt();
+            preset.loKey = in.readInt();
+            preset.hiKey = in.readInt();
+            entry.presets.push_back (std::move (preset));
+        }
+
+        read[path] = std::move (entry);
+    }
+
+    if (in.getPosition() == in.getTotalLength())
+        entries = std::move (read);
+}
+
+bool SoundfontIndex::save()
+{
+    juce::MemoryOutputStream out;
+    juce::File file;
+    {
+        const juce::ScopedLock sl (lock);
+        if (! changed || indexFile == juce::File())
+            return false;
+
+        out.write (kMagic, sizeof (kMagic));
+        out.writeInt (kVersion);
+        out.writeInt ((int) entries.size());
+
+        for (const auto& [path, entry] : entries)
+        {
+            out.writeString (path);
+            out.writeInt64 (entry.size);
+            out.writeInt64 (entry.modified);
+            out.writeInt ((int) entry.presets.size());
+
+            for (const auto& preset : entry.presets)
+            {
+                out.writeString (preset.name);
+                out.writeInt (preset.numRegions);
+                out.writeInt (preset.loKey);
+                out.writeInt (preset.hiKey);
+            }
+        }
+
+        changed = false;
+        file = indexFile;
+    }
+
+    // written next to the target and moved over it, so another instance never reads half of it
+    if (file.getParentDirectory().createDirectory().failed())
+        return false;
+
+    juce::TemporaryFile temp (file);
+    if (! temp.getFile().replaceWithData (out.getData(), out.getDataSize()))
+        return false;
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool SoundfontIndex::lookUp (const juce::File& soundfont, Entry& result) const
+{
+    const juce::ScopedLock sl (lock);
+    auto it = entries.find (soundfont.getFullPathName());
+    if (it == entries.end() || ! isUpToDate (it->second, soundfont))
+        return false;
+
+    result = it->second;
+    return true;
+}
+
+SoundfontIndex::Entry SoundfontIndex::getOrScan (const juce::File& soundfont)
+{
+    Entry entry;
+    if (lookUp (soundfont, entry))
+        return entry;
+
+    entry = scan (soundfont);
+    store (soundfont, entry);
+    return entry;
+}
+
+void SoundfontIndex::refresh (const juce::Array<juce::File>& soundfonts, const std::function<bool()>& shouldStop)
+{
+    for (const auto& soundfont : soundfonts)
+    {
+        if (shouldStop && shouldStop())
+            return;
+
+        Entry entry;
+        if (! lookUp (soundfont, entry))
+            store (soundfont, scan (soundfont));
+    }
+
+    {
+        const juce::ScopedLock sl (lock);
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (juce::File (it->first).existsAsFile())
+            {
+                ++it;
+                continue;
+            }
+
+            it = entries.erase (it);
+            changed = true;
+        }
+    }
+
+    save();
+}
+
+SoundfontIndex::Entry SoundfontIndex::scan (const juce::File& soundfont)
+{
+    Entry entry;
+    entry.size = soundfont.getSize();
+    entry.modified = soundfont.getLastModificationTime().toMilliseconds();
+
+    const auto ext = soundfont.getFileExtension().toLowerCase();
+    std::unique_ptr<SFZSound> sound;
+    if (ext == ".sf2")
+        sound = std::make_unique<SF2Sound> (soundfont.getFullPathName().toStdString());
+    else if (ext == ".sfz")
+        sound = std::make_unique<SFZSound> (soundfont.getFullPathName().toStdString());
+
+    if (sound == nullptr || ! soundfont.existsAsFile())
+        return entry;
+
+    sound->load_regions(); // structure only, no sample data
+
+    for (int i = 0; i < sound->num_subsounds(); ++i)
+    {
+        sound->use_subsound (i);
+
+        Preset preset;
+        preset.name = juce::String (sound->subsound_name (i));
+        preset.numRegions = sound->num_regions();
+        preset.loKey = 127;
+        preset.hiKey = 0;
+
+        for (int r = 0; r < sound->num_regions(); ++r)
+        {
+            const auto* region = sound->region_at (r);
+            if (region == nullptr)
+                continue;
+
+            preset.loKey = juce::jmin (preset.loKey, (int) region->lokey);
+            preset.hiKey = juce::jmax (preset.hiKey, (int) region->hikey);
+        }
+
+        if (preset.loKey > preset.hiKey)
+            preset.loKey = preset.hiKey = 0;
+
+        entry.presets.push_back (std::move (preset));
+    }
+
+    return entry;
+}
+
+bool SoundfontIndex::isUpToDate (const Entry& entry, const juce::File& soundfont)
+{
+    return entry.size == soundfont.getSize()
+        && entry.modified == soundfont.getLastModificationTime().toMilliseconds();
+}
+
+void SoundfontIndex::store (const juce::File& soundfont, Entry entry)
+{
+    const juce::ScopedLock sl (lock);
+    entries[soundfont.getFullPathName()] = std::move (entry);
+    changed = true;
+}
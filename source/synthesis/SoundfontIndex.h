@@ -0,0 +1,74 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// On-disk index of the presets in SF2 and SFZ files, so browsing them doesn't parse the files.
+//
+
+#pragma once
+#include <juce_core/juce_core.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+/**
+ * What's in each SF2/SFZ file in the soundfonts folder: its presets (subsounds) in sfzq's order,
+ * with each one's region count and key range. (Not a sample count: an SF2's regions all share the
+ * one SFZSample that holds the file's sample chunk.)
+ *
+ * Entries are keyed by the file's full path and record its size and modification time; one that
+ * no longer matches the file is stale, and lookUp() ignores it until the file has been scanned
+ * again. Scanning reads the file's structure (sfzq's load_regions()) but no sample data.
+ *
+ * The index is saved to a single file (see save()), and refresh() is meant to run on a
+ * background thread to rescan files that have changed. Every method is thread safe.
+ */
+class SoundfontIndex
+{
+public:
+    struct Preset
+    {
+        juce::String name; // as sfzq's subsound_name() gives it, so "#N" keys resolve the same way
+        int numRegions = 0;
+        int loKey = 0, hiKey = 0;
+    };
+
+    struct Entry
+    {
+        juce::int64 size = 0;
+        juce::int64 modified = 0; // ms since the epoch
+        std::vector<Preset> presets;
+    };
+
+    /** Reads the index saved in file, if there is one, and saves to it from then on. */
+    void load (const juce::File& file);
+
+    /** Writes the index back to its file if anything has changed since it was read. */
+    bool save();
+
+    /** Fills result and returns true if the index has an up to date entry for soundfont. */
+    bool lookUp (const juce::File& soundfont, Entry& result) const;
+
+    /** Like lookUp(), but scans soundfont (and remembers it) if the index has nothing up to date. */
+    Entry getOrScan (const juce::File& soundfont);
+
+    /**
+     * Scans whichever of soundfonts are missing or stale, forgets files that no longer exist, and
+     * saves the index if anything changed. Stops early if shouldStop() returns true.
+     */
+    void refresh (const juce::Array<juce::File>& soundfonts, const std::function<bool()>& shouldStop = {});
+
+    /** Parses soundfont's presets and regions; the entry has no presets if it can't be read. */
+    static Entry scan (const juce::File& soundfont);
+
+private:
+    static bool isUpToDate (const Entry& entry, const juce::File& soundfont);
+    void store (const juce::File& soundfont, Entry entry);
+
+    mutable juce::CriticalSection lock;
+    juce::File indexFile;
+    std::map<juce::String, Entry> entries;
+    bool changed = false;
+
+    JUCE_LEAK_DETECTOR (SoundfontIndex)
+};
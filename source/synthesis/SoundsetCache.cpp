@@ -0,0 +1,42 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "SoundsetCache.h"
+#include "Synthesiser/Sample.h"
+
+SharedSoundset::SharedSoundset() = default;
+SharedSoundset::~SharedSoundset() = default;
+
+std::shared_ptr<const SharedSoundset> SoundsetCache::find (const juce::String& key)
+{
+    const juce::ScopedLock sl (lock);
+    if (auto it = soundsets.find (key); it != soundsets.end())
+        return it->second.lock();
+    return nullptr;
+}
+
+std::shared_ptr<const SharedSoundset> SoundsetCache::add (const juce::String& key, std::shared_ptr<const SharedSoundset> soundset)
+{
+    const juce::ScopedLock sl (lock);
+    removeExpired();
+
+    auto& entry = soundsets[key];
+    if (auto existing = entry.lock())
+        return existing;
+
+    entry = soundset;
+    return soundset;
+}
+
+int SoundsetCache::getNumSoundsets()
+{
+    const juce::ScopedLock sl (lock);
+    removeExpired();
+    return (int) soundsets.size();
+}
+
+void SoundsetCache::removeExpired()
+{
+    for (auto it = soundsets.begin(); it != soundsets.end();)
+        it = it->second.expired() ? soundsets.erase (it) : std::next (it);
+}
@@ -0,0 +1,60 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Process-wide cache of loaded bK soundsets, shared between plugin instances.
+//
+
+#pragma once
+#include <juce_core/juce_core.h>
+#include <map>
+#include <memory>
+
+class BKSynthesiserSound;
+
+/**
+ * The sounds of one loaded bK soundset, keyed by the suffix SampleLoadManager appends to the
+ * soundset name for each sample type ("" for the main samples, "Hammers", "ReleaseResonance",
+ * "Pedals").
+ */
+struct SharedSoundset
+{
+    SharedSoundset();
+    ~SharedSoundset();
+
+    std::map<juce::String, juce::ReferenceCountedArray<BKSynthesiserSound>> sounds;
+
+    JUCE_DECLARE_NON_COPYABLE (SharedSoundset)
+};
+
+/**
+ * Soundsets loaded by any SampleLoadManager in the process, so tracks (plugin instances) using
+ * the same sample set share one copy of it instead of each loading their own.
+ *
+ * Use it through juce::SharedResourcePointer<SoundsetCache>. Entries are keyed by the soundset's
+ * directory and the options its samples were loaded with (see SampleLoadManager), and are held
+ * weakly: every manager using a soundset keeps a shared_ptr to it, and its sounds are freed once
+ * the last of them lets go.
+ */
+class SoundsetCache
+{
+public:
+    /** Returns the loaded soundset for key, or nullptr. */
+    std::shared_ptr<const SharedSoundset> find (const juce::String& key);
+
+    /**
+     * Offers a freshly loaded soundset to other instances. If one is already cached under key
+     * (another instance finished loading the same set first), that one is kept and returned.
+     */
+    std::shared_ptr<const SharedSoundset> add (const juce::String& key, std::shared_ptr<const SharedSoundset> soundset);
+
+    int getNumSoundsets();
+
+private:
+    void removeExpired();
+
+    juce::CriticalSection lock;
+    std::map<juce::String, std::weak_ptr<const SharedSoundset>> soundsets;
+
+    JUCE_LEAK_DETECTOR (SoundsetCache)
+};
@@ -0,0 +1,247 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "SoundsetCacheFile.h"
+#include "SoundsetCache.h"
+#include "Synthesiser/Sample.h"
+
+/*
+ * Layout (little-endian header, frames in native byte order):
+ *
+ *   magic[8], int32 version, int32 numSounds, int64 fingerprint, int64 dataStart
+ *   numSounds entries:
+ *     string suffix, bits midiNotes, bits midiVelocities,
+ *     int32 rootMidiNote, int32 transpose, int32 numLayers, float dBFSLevel, float dBFSBelow,
+ *     double loopStart, double loopEnd, int32 loopMode,
+ *     double sampleRate, int32 storage, int32 numChannels, int32 length, float scale,
+ *     int64 frameOffset (from dataStart), int64 frameBytes
+ *   zeros up to dataStart, then each sound's frames, every block starting on kAlignment
+ */
+namespace
+{
+    using BKSound = BKSamplerSound<juce::AudioFormatReader>;
+
+    constexpr char kMagic[8] = { 'b', 'K', 'c', 'a', 'c', 'h', 'e', '\0' };
+    constexpr int kVersion = 1;
+    constexpr juce::int64 kHeaderSize = 32;
+
+    // as aligned as a heap block, so voices read the mapped frames no slower than decoded ones
+    constexpr juce::int64 kAlignment = 16;
+
+    juce::int64 align (juce::int64 n) { return (n + kAlignment - 1) & ~(kAlignment - 1); }
+
+    void writeBits (juce::OutputStream& out, const juce::BigInteger& bits)
+    {
+        const auto block = bits.toMemoryBlock();
+        out.writeInt ((int) block.getSize());
+        out.write (block.getData(), block.getSize());
+    }
+
+    juce::BigInteger readBits (juce::MemoryInputStream& in)
+    {
+        juce::MemoryBlock block;
+        const auto size = in.readInt();
+        if (size > 0 && size <= 64)
+            in.readIntoMemoryBlock (block, size);
+
+        juce::BigInteger bits;
+        bits.loadFromMemoryBlock (block);
+        return bits;
+    }
+
+    bool isStorable (const BKSound* sound)
+    {
+        if (sound == nullptr || sound->getSample() == nullptr)
+            return false;
+
+        const auto* sample = sound->getSample();
+        return ! sample->isStreamed() && ! sample->getData().isMapped();
+    }
+}
+
+juce::int64 SoundsetCacheFile::fingerprint (const juce::Array<juce::File>& sources, const juce::String& options)
+{
+    juce::String description;
+    description << kVersion << (juce::ByteOrder::isBigEndian() ? " BE " : " LE ") << options;
+
+    for (const auto& source : sources)
+        description << "\n" << source.getFullPathName()
+                    << "|" << source.getSize()
+                    << "|" << source.getLastModificationTime().toMilliseconds();
+
+    return description.hashCode64();
+}
+
+bool SoundsetCacheFile::write (const juce::File& file,
+                               juce::int64 fingerprint,
+                               const SharedSoundset& soundset,
+                               const std::function<bool()>& shouldStop)
+{
+    struct Entry
+    {
+        juce::String suffix;
+        const BKSound* sound;
+        juce::int64 offset;
+    };
+
+    std::vector<Entry> entries;
+    juce::int64 dataSize = 0;
+
+    for (const auto& [suffix, sounds] : soundset.sounds)
+    {
+        for (auto* s : sounds)
+        {
+            const auto* sound = dynamic_cast<const BKSound*> (s);
+            if (! isStorable (sound))
+                return false;
+
+            entries.push_back ({ suffix, sound, dataSize });
+            dataSize = align (dataSize + (juce::int64) sound->getSample()->getData().getSizeInBytes());
+        }
+    }
+
+    if (entries.empty())
+        return false;
+
+    juce::MemoryOutputStream table;
+    for (const auto& entry : entries)
+    {
+        const auto* sound = entry.sound;
+        const auto* sample = sound->getSample();
+        const auto& data = sample->getData();
+        const auto loop = sound->getLoopPointsInSeconds();
+
+        table.writeString (entry.suffix);
+        writeBits (table, sound->getMidiNotes());
+        writeBits (table, sound->getMidiVelocities());
+        table.writeInt (sound->rootMidiNote);
+        table.writeInt (sound->transpose);
+        table.writeInt (sound->numLayers);
+        table.writeFloat (sound->dBFSLevel);
+        table.writeFloat (sound->dBFSBelow);
+        table.writeDouble (loop.getStart());
+        table.writeDouble (loop.getEnd());
+        table.writeInt ((int) sound->getLoopMode());
+        table.writeDouble (sample->getSampleRate());
+        table.writeInt ((int) data.getStorage());
+        table.writeInt (data.getNumChannels());
+        table.writeInt (data.getLength());
+        table.writeFloat (data.getScale());
+        table.writeInt64 (entry.offset);
+        table.writeInt64 ((juce::int64) data.getSizeInBytes());
+    }
+
+    const auto dataStart = align (kHeaderSize + (juce::int64) table.getDataSize());
+
+    if (file.getParentDirectory().createDirectory().failed())
+        return false;
+
+    // written next to the target and moved over it at the end, so nobody maps a half-written file
+    juce::TemporaryFile temp (file);
+    {
+        juce::FileOutputStream out (temp.getFile());
+        if (! out.openedOk())
+            return false;
+
+        out.write (kMagic, sizeof (kMagic));
+        out.writeInt (kVersion);
+        out.writeInt ((int) entries.size());
+        out.writeInt64 (fingerprint);
+        out.writeInt64 (dataStart);
+        out.write (table.getData(), table.getDataSize());
+        out.writeRepeatedByte (0, (size_t) (dataStart - out.getPosition()));
+
+        for (const auto& entry : entries)
+        {
+            if (shouldStop && shouldStop())
+                return false;
+
+            const auto& data = entry.sound->getSample()->getData();
+            const auto bytesPerChannel = data.getSizeInBytes() / (size_t) data.getNumChannels();
+
+            out.writeRepeatedByte (0, (size_t) (dataStart + entry.offset - out.getPosition()));
+            for (int ch = 0; ch < data.getNumChannels(); ++ch)
+                out.write (data.getPlanarChannel (ch), bytesPerChannel);
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+std::shared_ptr<SharedSoundset> SoundsetCacheFile::read (const juce::File& file, juce::int64 fingerprint)
+{
+    if (! file.existsAsFile())
+        return nullptr;
+
+    auto mapping = std::make_shared<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+    const auto* bytes = static_cast<const uint8_t*> (mapping->getData());
+    const auto fileSize = (juce::int64) mapping->getSize();
+
+    if (bytes == nullptr || fileSize < kHeaderSize || std::memcmp (bytes, kMagic, sizeof (kMagic)) != 0)
+        return nullptr;
+
+    juce::MemoryInputStream in (bytes, (size_t) fileSize, false);
+    in.skipNextBytes (sizeof (kMagic));
+
+    if (in.readInt() != kVersion)
+        return nullptr;
+
+    const auto numSounds = in.readInt();
+    if (in.readInt64() != fingerprint)
+        return nullptr;
+
+    const auto dataStart = in.readInt64();
+    if (numSounds <= 0 || dataStart < kHeaderSize || dataStart > fileSize || dataStart % kAlignment != 0)
+        return nullptr;
+
+    auto soundset = std::make_shared<SharedSoundset>();
+
+    for (int i = 0; i < numSounds; ++i)
+    {
+        const auto suffix = in.readString();
+        const auto midiNotes = readBits (in);
+        const auto midiVelocities = readBits (in);
+        const auto rootMidiNote = in.readInt();
+        const auto transpose = in.readInt();
+        const auto numLayers = in.readInt();
+        const auto dBFSLevel = in.readFloat();
+        const auto dBFSBelow = in.readFloat();
+        const auto loopStart = in.readDouble();
+        const auto loopEnd = in.readDouble();
+        const auto loopMode = in.readInt();
+        const auto sampleRate = in.readDouble();
+        const auto storage = in.readInt();
+        const auto numChannels = in.readInt();
+        const auto length = in.readInt();
+        const auto scale = in.readFloat();
+        const auto offset = in.readInt64();
+        const auto size = in.readInt64();
+
+        // anything that doesn't add up means the file is damaged; load from the WAV files instead
+        const bool validFormat = (storage == (int) SampleStorage::int16 || storage == (int) SampleStorage::int24 || storage == (int) SampleStorage::float32)
+                              && (numChannels == 1 || numChannels == 2)
+                              && length > 0 && sampleRate > 0.
+                              && juce::isPositiveAndNotGreaterThan (loopMode, (int) LoopMode::pingpong);
+        if (! validFormat || in.getPosition() > dataStart)
+            return nullptr;
+
+        const auto expectedSize = (juce::int64) (length + CompactSampleData::kPadding)
+                                * (juce::int64) CompactSampleData::bytesPerFrame ((SampleStorage) storage) * numChannels;
+        if (size != expectedSize || offset < 0 || offset % kAlignment != 0 || dataStart + offset + size > fileSize)
+            return nullptr;
+
+        const CompactSampleData::View view { mapping, bytes + dataStart + offset, (SampleStorage) storage, numChannels, length, scale };
+        auto sample = std::make_shared<Sample<juce::AudioFormatReader>> (view, sampleRate, dBFSLevel);
+
+        auto* sound = new BKSound ({}, std::move (sample), midiNotes, rootMidiNote, transpose, midiVelocities, numLayers, dBFSBelow);
+        sound->setLoopMode ((LoopMode) loopMode);
+        sound->setLoopPointsInSeconds ({ loopStart, loopEnd });
+        soundset->sounds[suffix].add (sound);
+    }
+
+    return soundset;
+}
@@ -0,0 +1,49 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// On-disk cache of decoded bK soundsets (.bkcache files), so later loads skip decoding.
+//
+
+#pragma once
+#include <juce_core/juce_core.h>
+#include <functional>
+#include <memory>
+
+struct SharedSoundset;
+
+/**
+ * A bK soundset saved as it ends up in memory after a load: every sound's key and velocity
+ * ranges, root note, dB levels and loop points, followed by its frames in CompactSampleData's
+ * planar layout.
+ *
+ * Reading one maps the file and builds the BKSamplerSounds straight on top of it: no file name
+ * parsing, no decoding and no level measurement, and the frames are shared through the page
+ * cache like memory-mapped WAV files are (see MappedWaveFile).
+ *
+ * A file records a fingerprint of the sources it was made from (see fingerprint()); read()
+ * ignores it if the fingerprint no longer matches, and the soundset is loaded from its WAV files
+ * and written again. Only fully decoded soundsets can be written, not streamed or mapped ones.
+ *
+ * Frames are written in the machine's own byte order; like the version number, the fingerprint
+ * covers that, so a file copied to another kind of machine is just ignored.
+ */
+class SoundsetCacheFile
+{
+public:
+    /** Hashes each source file's path, size and modification time, and the load options. */
+    static juce::int64 fingerprint (const juce::Array<juce::File>& sources, const juce::String& options);
+
+    /**
+     * Writes soundset to file, replacing it only once the new one is complete. Returns false,
+     * leaving any existing file alone, if the soundset has sounds that aren't fully decoded bK
+     * samples, if writing fails, or if shouldStop() returns true part way through.
+     */
+    static bool write (const juce::File& file,
+                       juce::int64 fingerprint,
+                       const SharedSoundset& soundset,
+                       const std::function<bool()>& shouldStop = {});
+
+    /** Maps file and builds its sounds, or returns nullptr if it's missing, stale or damaged. */
+    static std::shared_ptr<SharedSoundset> read (const juce::File& file, juce::int64 fingerprint);
+};
@@ -55,6 +55,29 @@ void BlendronicDelay::tick(float* inL, float* inR)
     delayLinear->tick(inL, inR);
 }
 
+/**
+ * Same as calling tick() on each frame. While the delay length is moving it has to be set per
+ * sample, so that part goes through tick(); once it settles the rest is one block.
+ */
+void BlendronicDelay::process(float* L, float* R, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        const bool lengthIsMoving = tempoIsChanging ? dSmooth_fromTempo.isSmoothing()
+                                                    : dSmooth_fromBlendronic->getState() != 0;
+        if (lengthIsMoving)
+        {
+            tick(L++, R++);
+            --numSamples;
+            continue;
+        }
+
+        setDelayLength(tempoIsChanging ? dSmooth_fromTempo.getNextValue() : dSmooth_fromBlendronic->tick());
+        delayLinear->process(L, R, numSamples);
+        return;
+    }
+}
+
 
 /*
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,8 +86,7 @@ void BlendronicDelay::tick(float* inL, float* inR)
 */
 BKDelayL::BKDelayL() :
        inPoint(0),
-       outPoint(0),
-       bufferSize(44100.),
+       readOffset(0),
        length(0.0),
        gain(1.0),
        lastFrameLeft(0),
@@ -74,26 +96,23 @@ BKDelayL::BKDelayL() :
 {
     smoothedFeedback.reset(sampleRate, 0.005);
     smoothedFeedback.setCurrentAndTargetValue(feedback);
-    inputs = juce::AudioBuffer<float>(2, bufferSize);
-    inputs.clear();
+    allocate(44100);
     setLength(0.0);
 }
 
 BKDelayL::BKDelayL(float delayLength, int bufferSize, float delayGain, double sr) :
      inPoint(0),
-     outPoint(0),
-     bufferSize(bufferSize),
+     readOffset(0),
      length(delayLength),
      gain(delayGain),
      lastFrameLeft(0),
      lastFrameRight(0),
-     sampleRate(sr),
-     feedback(0.9)
+     feedback(0.9),
+     sampleRate(sr)
 {
     smoothedFeedback.reset(sampleRate, 0.005);
     smoothedFeedback.setCurrentAndTargetValue(feedback);
-    inputs = juce::AudioBuffer<float>(2, bufferSize);
-    inputs.clear();
+    allocate(bufferSize);
     setLength(delayLength);
 }
 
@@ -101,68 +120,74 @@ BKDelayL::~BKDelayL()
 {
 }
 
-void BKDelayL::setLength(float delayLength)
+void BKDelayL::allocate(int size)
 {
-    length = delayLength;
-    float outPointer = inPoint - length;
-    if (inputs.getNumSamples() > 0)
-        while (outPointer < 0) outPointer += inputs.getNumSamples();
-    else outPointer = 0;
-
-    outPoint = outPointer; //integer part
-    alpha = outPointer - outPoint; //fractional part
-    omAlpha = (float)1.0 - alpha;
-    if (outPoint == inputs.getNumSamples()) outPoint = 0;
+    bufferSize = juce::jmax(2, size);
+    capacity = juce::nextPowerOfTwo(bufferSize);
+    mask = capacity - 1;
+    maxLength = bufferSize - 1;
+
+    inputs.setSize(2, capacity);
+    inputs.clear();
 }
 
-void BKDelayL::setBufferSize(int size)
+void BKDelayL::setLength(float delayLength)
 {
-    const juce::ScopedLock sl (lock);
-    loading = true;
-    inputs.setSize(2, bufferSize);
-    reset();
-    bufferSize = size;
-    inputs.clear();
-    loading = false;
+    length = juce::jlimit(0.0f, (float) maxLength.load(std::memory_order_relaxed), delayLength);
+
+    // reading at inPoint - length: readOffset samples back, plus alpha of the sample after that
+    const int whole = (int) length;
+    const float fraction = length - (float) whole;
+    readOffset = fraction > 0.0f ? whole + 1 : whole;
+    alpha = fraction > 0.0f ? 1.0f - fraction : 0.0f;
+    omAlpha = 1.0f - alpha;
 }
 
 /**
- * todo: combine these into one function with channel arg
- * @return
+ * Limits delays to size samples, and clears the line before the next tick() or process().
+ * The buffer was allocated at its largest in the constructor, so this never reallocates; sizes
+ * beyond that are clamped to it. Safe to call from any thread.
  */
-float BKDelayL::nextOutLeft()
+void BKDelayL::setBufferSize(int size)
 {
-    nextOutput = inputs.getSample(0, outPoint) * omAlpha;
-    if (outPoint + 1 < inputs.getNumSamples())
-        nextOutput += inputs.getSample(0, outPoint + 1) * alpha;
-    else
-        nextOutput += inputs.getSample(0, 0) * alpha;
-
-    return nextOutput;
+    maxLength.store(juce::jlimit(1, capacity - 1, size - 1), std::memory_order_relaxed);
+    clearRequested.store(true, std::memory_order_release);
 }
 
-float BKDelayL::nextOutRight()
+void BKDelayL::handlePendingResize()
 {
-    nextOutput = inputs.getSample(1, outPoint) * omAlpha;
-    if (outPoint + 1 < inputs.getNumSamples())
-        nextOutput += inputs.getSample(1, outPoint + 1) * alpha;
-    else
-        nextOutput += inputs.getSample(1, 0) * alpha;
-
-    return nextOutput;
+    if (clearRequested.load(std::memory_order_relaxed) && clearRequested.exchange(false, std::memory_order_acquire))
+    {
+        bufferSize = maxLength.load(std::memory_order_relaxed) + 1;
+        clear();
+        reset();
+    }
 }
 
 //allows addition of samples without incrementing delay position value
 void BKDelayL::addSample(float input, int offset, int channel)
 {
-    inputs.addSample(channel, (inPoint + offset) % inputs.getNumSamples(), input);
+    inputs.getWritePointer(channel)[(inPoint + offset) & mask] += input;
 }
 
 // used for clearing the oldest part of the buffer so that it doesn't linger
 void BKDelayL::scalePrevious(float coefficient, int offset, int channel)
 {
-    //    if (loading) return;
-    inputs.setSample(channel, (inPoint + offset) % inputs.getNumSamples(), inputs.getSample(channel, (inPoint + offset) % inputs.getNumSamples()) * coefficient);
+    inputs.getWritePointer(channel)[(inPoint + offset) & mask] *= coefficient;
+}
+
+// clears the numSamples the next tick()s or process() will write to
+void BKDelayL::clearAhead(int numSamples)
+{
+    numSamples = juce::jmin(numSamples, capacity);
+    const int firstRun = juce::jmin(numSamples, capacity - inPoint);
+
+    for (int c = 0; c < inputs.getNumChannels(); c++)
+    {
+        auto* channel = inputs.getWritePointer(c);
+        juce::FloatVectorOperations::clear(channel + inPoint, firstRun);
+        juce::FloatVectorOperations::clear(channel, numSamples - firstRun);
+    }
 }
 
 void BKDelayL::setFeedback(float fb)
@@ -173,8 +198,10 @@ void BKDelayL::setFeedback(float fb)
 
 void BKDelayL::tick(float* inL, float* inR)
 {
-    // check the inPoint boundary
-    if (inPoint >= inputs.getNumSamples()) inPoint = 0;
+    handlePendingResize();
+
+    auto* bufL = inputs.getWritePointer(0);
+    auto* bufR = inputs.getWritePointer(1);
 
     /*
      * if the input is not open, we don't add samples to the delay.
@@ -183,24 +210,23 @@ void BKDelayL::tick(float* inL, float* inR)
      */
     if(dInputOpen)
     {
-        inputs.addSample(0, inPoint, *inL);
-        inputs.addSample(1, inPoint, *inR);
+        bufL[inPoint] += *inL;
+        bufR[inPoint] += *inR;
     }
 
     // get our delayed outputs from both channels
-    lastFrameLeft = nextOutLeft();
-    lastFrameRight = nextOutRight();
-
-    // increment the position samples are read from and check its end boundary
-    if (++outPoint >= inputs.getNumSamples()) outPoint = 0;
+    const int readPoint = (inPoint - readOffset) & mask;
+    const int nextPoint = (readPoint + 1) & mask;
+    lastFrameLeft = bufL[readPoint] * omAlpha + bufL[nextPoint] * alpha;
+    lastFrameRight = bufR[readPoint] * omAlpha + bufR[nextPoint] * alpha;
 
     // feedback of last output is added here now
     float currentFeedback = smoothedFeedback.getNextValue();
-    inputs.addSample(0, inPoint, lastFrameLeft * currentFeedback);
-    inputs.addSample(1, inPoint, lastFrameRight * currentFeedback);
+    bufL[inPoint] += lastFrameLeft * currentFeedback;
+    bufR[inPoint] += lastFrameRight * currentFeedback;
 
     // increment the position samples are written to
-    inPoint++;
+    inPoint = (inPoint + 1) & mask;
 
     /*
      * if the output is not open, we leave the samples passing through untouched
@@ -214,6 +240,75 @@ void BKDelayL::tick(float* inL, float* inR)
     }
 }
 
+/**
+ * Same as calling tick() on each frame of L and R, at the current length.
+ *
+ * Each run stops short of the end of the ring for both the write and the read (which needs one
+ * sample past its start), and is shorter than readOffset, so nothing it reads is written by it;
+ * delays under two samples leave no room for that and go through tick().
+ */
+void BKDelayL::process(float* L, float* R, int numSamples)
+{
+    handlePendingResize();
+
+    auto* bufL = inputs.getWritePointer(0);
+    auto* bufR = inputs.getWritePointer(1);
+    float outL[maxRunLength], outR[maxRunLength];
+
+    while (numSamples > 0)
+    {
+        const int readPoint = (inPoint - readOffset) & mask;
+        const int run = juce::jmin(numSamples, maxRunLength, capacity - inPoint,
+                                   juce::jmin(capacity - 1 - readPoint, readOffset - 1));
+        if (run < 1)
+        {
+            tick(L++, R++);
+            --numSamples;
+            continue;
+        }
+
+        if (dInputOpen)
+        {
+            juce::FloatVectorOperations::add(bufL + inPoint, L, run);
+            juce::FloatVectorOperations::add(bufR + inPoint, R, run);
+        }
+
+        juce::FloatVectorOperations::copyWithMultiply(outL, bufL + readPoint, omAlpha, run);
+        juce::FloatVectorOperations::addWithMultiply(outL, bufL + readPoint + 1, alpha, run);
+        juce::FloatVectorOperations::copyWithMultiply(outR, bufR + readPoint, omAlpha, run);
+        juce::FloatVectorOperations::addWithMultiply(outR, bufR + readPoint + 1, alpha, run);
+
+        if (smoothedFeedback.isSmoothing())
+        {
+            for (int i = 0; i < run; i++)
+            {
+                const float currentFeedback = smoothedFeedback.getNextValue();
+                bufL[inPoint + i] += outL[i] * currentFeedback;
+                bufR[inPoint + i] += outR[i] * currentFeedback;
+            }
+        }
+        else
+        {
+            juce::FloatVectorOperations::addWithMultiply(bufL + inPoint, outL, smoothedFeedback.getTargetValue(), run);
+            juce::FloatVectorOperations::addWithMultiply(bufR + inPoint, outR, smoothedFeedback.getTargetValue(), run);
+        }
+
+        lastFrameLeft = outL[run - 1];
+        lastFrameRight = outR[run - 1];
+
+        if (dOutputOpen)
+        {
+            juce::FloatVectorOperations::copy(L, outL, run);
+            juce::FloatVectorOperations::copy(R, outR, run);
+        }
+
+        inPoint = (inPoint + run) & mask;
+        L += run;
+        R += run;
+        numSamples -= run;
+    }
+}
+
 void BKDelayL::clear()
 {
     inputs.clear();
@@ -222,14 +317,7 @@ void BKDelayL::clear()
 void BKDelayL::reset()
 {
     inPoint = 0;
-    outPoint = 0;
-    float outPointer = inPoint - length;
-    while (outPointer < 0) outPointer += inputs.getNumSamples();
-
-    outPoint = outPointer; //integer part
-    alpha = outPointer - outPoint; //fractional part
-    omAlpha = (float)1.0 - alpha;
-    if (outPoint == inputs.getNumSamples()) outPoint = 0;
+    setLength(length);
 }
 
 /*
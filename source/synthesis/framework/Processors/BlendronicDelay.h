@@ -17,6 +17,14 @@
 ////////////////////////////////////////////////////////////////////////////////
 */
 
+/**
+ * The delay line is a power-of-two ring buffer allocated once, at the largest size it will be
+ * asked for, so positions wrap with a mask and setBufferSize() never reallocates or locks.
+ *
+ * process() runs a block at a time: it splits the block into runs that neither wrap nor read
+ * back anything written in the same run, and does the input, the interpolated read and the
+ * feedback for each run with juce::FloatVectorOperations. tick() does the same for one frame.
+ */
 class BKDelayL
 {
 public:
@@ -34,8 +42,7 @@ public:
 
     inline const float getSample(int c, int i) const noexcept
     {
-        if (loading) return 0.0f;
-        return inputs.getSample(c, i);
+        return inputs.getSample(c, i & mask);
     }
 
     inline const juce::AudioBuffer<float>* getBuffer() const noexcept { return &inputs; }
@@ -46,13 +53,12 @@ public:
     inline void setGain(float delayGain) { gain = delayGain; }
     void setFeedback(float fb);
 //    inline int getInPoint() { return inPoint; }
-//    inline int getOutPoint() { return outPoint; }
 
-    float nextOutLeft();
-    float nextOutRight();
     void addSample(float input, int offset, int channel);
     void scalePrevious(float coefficient, int offset, int channel);
+    void clearAhead(int numSamples);
     void tick(float* inL, float* inR);
+    void process(float* L, float* R, int numSamples);
     void clear();
     void reset();
 
@@ -64,11 +70,19 @@ public:
     juce::AudioBuffer<float> inputs;
 
 private:
-    juce::CriticalSection lock;
+    void allocate(int size);
+    void handlePendingResize();
+
+    // longest run process() hands to FloatVectorOperations at once
+    static constexpr int maxRunLength = 256;
 
     int inPoint;
-    int outPoint;
+    int readOffset;     // whole samples the read point trails inPoint by; alpha weights the one after it
+    int capacity;       // allocated length of inputs, a power of two
+    int mask;
     int bufferSize;
+    std::atomic<int> maxLength { 0 };           // setBufferSize() may be called off the audio thread
+    std::atomic<bool> clearRequested { false };
     float length;
     float gain;
     float lastFrameLeft;
@@ -77,11 +91,7 @@ private:
     float omAlpha;
     float feedback;
     juce::SmoothedValue<float> smoothedFeedback;
-    float nextOutput;
-//    bool doNextOutLeft;
-//    bool doNextOutRight;
 
-    bool loading;
     double sampleRate;
 };
 
@@ -193,7 +203,9 @@ public:
     }
 
     void scalePrevious(float coefficient, int offset, int channel);
+    void clearAhead(int numSamples) { delayLinear->clearAhead(numSamples); }
     void tick(float* inL, float* inR);
+    void process(float* L, float* R, int numSamples);
 
 private:
     std::unique_ptr<BKDelayL> delayLinear;
@@ -229,15 +229,40 @@ void BlendronicProcessor::tick(float* inL, float* inR)
 
 }
 
-void BlendronicProcessor::clearNextDelayBlock(int numSamples)
+/**
+ * Runs tick() over a block, but hands the delay whole stretches at once: after a tick that
+ * isn't in a tempo ramp, nothing tick() does changes until the next beat, so the samples up
+ * to it go to the delay's block process().
+ */
+void BlendronicProcessor::process(float* outL, float* outR, int numSamples)
 {
-    for (int i = 0; i < numSamples; i++)
+    // used for pause/play
+    if (!blendronicActive) return;
+
+    while (numSamples > 0)
     {
-        delay->scalePrevious(0, i, 0);
-        delay->scalePrevious(0, i, 1);
+        tick(outL++, outR++);
+        --numSamples;
+
+        if (numSamples == 0 || pulseLength.isSmoothing()) continue;
+
+        const double samplesToNextBeat = (double) numSamplesBeat - (double) sampleTimer;
+        if (!(samplesToNextBeat > 0)) continue;
+
+        const int run = (int) juce::jmin((double) numSamples, std::ceil(samplesToNextBeat));
+        delay->process(outL, outR, run);
+        sampleTimer += run;
+        outL += run;
+        outR += run;
+        numSamples -= run;
     }
 }
 
+void BlendronicProcessor::clearNextDelayBlock(int numSamples)
+{
+    delay->clearAhead(numSamples);
+}
+
 /**
  * Blendrónic receives MIDI messages for various targeted behaviors:
  *      - sync
@@ -369,10 +394,7 @@ void BlendronicProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::
     clearNextDelayBlock(numSamples);
 
     // apply the delay
-    while (--numSamples >= 0)
-    {
-        tick(outL++, outR++);
-    }
+    process(outL, outR, numSamples);
 
     // update current slider val for UI
     state.params.beatLengths_current.store(beatIndex);
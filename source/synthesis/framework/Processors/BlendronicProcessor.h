@@ -333,6 +333,7 @@ private:
     void updateDelayParameters();
     void clearNextDelayBlock(int numSamples);
     void tick(float* inL, float* inR);
+    void process(float* outL, float* outR, int numSamples);
 
     juce::SmoothedValue<float> pulseLength;      // Length in seconds of a pulse (1.0 length beat)
     float numSamplesBeat;   // Length in samples of the current step in the beat pattern
@@ -30,6 +30,17 @@ DirectProcessor::DirectProcessor (SynthBase& parent, const juce::ValueTree& vt,
     releaseResonanceSynth->isKeyReleaseSynth (true);
     pedalSynth->isPedalSynth (true);
 
+    /*
+     * voices come from the engine-wide pool; the main synth gets first call on them
+     */
+    mainSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::foreground);
+    hammerSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::background);
+    releaseResonanceSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::background);
+    pedalSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::background);
+
+    // the main synth can have enough voices going to be worth spreading across cores
+    mainSynth->setParallelRendering (parent.getRenderWorkers());
+
     state.params.transpose.stateChanges.defaultState = v.getOrCreateChildWithName (IDs::PARAM_DEFAULT, nullptr);
     state.params.transpose.transpositionUsesTuning->stateChanges.defaultState = v.getOrCreateChildWithName (IDs::PARAM_DEFAULT, nullptr);
 
@@ -59,6 +70,7 @@ void DirectProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     const auto spec = juce::dsp::ProcessSpec { sampleRate, (uint32_t) samplesPerBlock, (uint32_t) getMainBusNumInputChannels() };
 
     mainSynth->setCurrentPlaybackSampleRate (sampleRate);
+    mainSynth->prepareParallelRendering (samplesPerBlock);
     //    gain.prepare (spec);
     //    gain.setRampDurationSeconds (0.05);
 
@@ -153,25 +165,39 @@ void DirectProcessor::tuningStateInvalidated() {
 
 void DirectProcessor::handleMidiTargetMessages(juce::MidiBuffer& midiMessages)
 {
-    juce::MidiBuffer tempBuffer;
+    bool hadTargetMessages = false;
+
+    // sized in bytes to the host's buffer, so long messages (SysEx...) are kept as well; this only
+    // allocates when a block carries more MIDI than any before it
+    untargetedMidi.clear();
+    untargetedMidi.ensureSize ((size_t) midiMessages.data.size());
 
     for (auto mi : midiMessages)
     {
-        auto message = mi.getMessage();
+        // the channel straight from the status byte, as MidiMessage::getChannel() would give it
+        // (0 for SysEx and other system messages), without copying long messages into a MidiMessage
+        const auto status = mi.data[0];
+        const int channel = (status & 0xf0) != 0xf0 ? (status & 0x0f) + 1 : 0;
 
-        switch(message.getChannel() + (DirectTargetFirst))
+        switch(channel + (DirectTargetFirst))
         {
             case DirectTargetModReset:
                 DBG("DirectTargetModReset called");
                 resetContinuousModulations();
+                hadTargetMessages = true;
                 break;
 
             default:
-                tempBuffer.addEvent(message, mi.samplePosition);
+                untargetedMidi.addEvent(mi.data, mi.numBytes, mi.samplePosition);
         }
     }
 
-    midiMessages.swapWith(tempBuffer);
+    // the rest go back in the same buffer, which already has room for them
+    if (hadTargetMessages)
+    {
+        midiMessages.clear();
+        midiMessages.addEvents(untargetedMidi, 0, -1, 0);
+    }
 }
 
 void DirectProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
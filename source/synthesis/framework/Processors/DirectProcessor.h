@@ -298,10 +298,10 @@ public:
 
     void allNotesOff()
     {
-        mainSynth->allNotesOff(1, false);
-        hammerSynth->allNotesOff(1, false);
-        releaseResonanceSynth->allNotesOff(1, false);
-        pedalSynth->allNotesOff(1, false);
+        mainSynth->requestAllNotesOff();
+        hammerSynth->requestAllNotesOff();
+        releaseResonanceSynth->requestAllNotesOff();
+        pedalSynth->requestAllNotesOff();
     }
 
     void loadSamples() override {
@@ -358,6 +358,7 @@ private:
     void updateMidiNoteTranspositions(int noteOnNumber);
     void updateAllMidiNoteTranspositions();
     void handleMidiTargetMessages(juce::MidiBuffer& midiMessages);
+    juce::MidiBuffer untargetedMidi; // scratch for handleMidiTargetMessages()
 
     /*
      * noteOnSpecMap
@@ -28,6 +28,9 @@ NostalgicProcessor::NostalgicProcessor (SynthBase& parent, const juce::ValueTree
     clusterNotes.ensureStorageAllocated(100);
     newpositions.ensureStorageAllocated(500);
 
+    nostalgicSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::normal);
+    nostalgicSynth->setParallelRendering (parent.getRenderWorkers());
+
     clusterTimer = 0;
     clusterCount = 0;
     velocities.insertMultiple(0,0,128);
@@ -75,6 +78,7 @@ void NostalgicProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     const auto spec = juce::dsp::ProcessSpec { sampleRate, (uint32_t) samplesPerBlock, (uint32_t) getMainBusNumInputChannels() };
     nostalgicSynth->setCurrentPlaybackSampleRate (sampleRate);
+    nostalgicSynth->prepareParallelRendering (samplesPerBlock);
 }
 
 bool NostalgicProcessor::isBusesLayoutSupported (const juce::AudioProcessor::BusesLayout& layouts) const
@@ -170,7 +174,7 @@ void NostalgicProcessor::updateAllMidiNoteTranspositions()
     }
 }
 
-void NostalgicProcessor::playReverseNote(NostalgicNoteData& noteData, juce::MidiBuffer& outMidiMessages)
+void NostalgicProcessor::playReverseNote(NostalgicNoteData& noteData, BKNoteEventQueue& outMidiMessages)
 {
     auto note = noteData.noteNumber;
     noteOnSpecMap[note].overrideDefaultEnvParams = true;
@@ -188,7 +192,7 @@ void NostalgicProcessor::playReverseNote(NostalgicNoteData& noteData, juce::Midi
 
     // play the reverse note
     auto reverseOnMsg = juce::MidiMessage::noteOn (1, note, velocities[note]);
-    outMidiMessages.addEvent(reverseOnMsg, 0);
+    outMidiMessages.add(reverseOnMsg, 0);
 
     // clean up
     noteLengthTimers.set(note, 0.0f);
@@ -216,7 +220,7 @@ void NostalgicProcessor::updateNoteVisualization()
     }
 }
 
-void NostalgicProcessor::handleNostalgicNote(int noteNumber, float clusterMin, juce::MidiBuffer& outMidiMessages)
+void NostalgicProcessor::handleNostalgicNote(int noteNumber, float clusterMin, BKNoteEventQueue& outMidiMessages)
 {
     // if key-on reset is selected, remove previous notes
     if (state.params.keyOnReset->get())
@@ -268,7 +272,7 @@ void NostalgicProcessor::handleNostalgicNote(int noteNumber, float clusterMin, j
     inCluster = true;
 }
 
-void NostalgicProcessor::handle_sustain_pedal (juce::MidiBuffer& outMidiMessages, float clusterMin, juce::MidiMessage message)
+void NostalgicProcessor::handle_sustain_pedal (BKNoteEventQueue& outMidiMessages, float clusterMin, juce::MidiMessage message)
 {
     // sustain pedal handling
     if (message.isController() && message.getControllerNumber() == 64)
@@ -304,7 +308,7 @@ void NostalgicProcessor::handle_sustain_pedal (juce::MidiBuffer& outMidiMessages
     }
 }
 
-void NostalgicProcessor::handle_sostenuto_pedal (juce::MidiBuffer& outMidiMessages, float clusterMin, juce::MidiMessage message)
+void NostalgicProcessor::handle_sostenuto_pedal (BKNoteEventQueue& outMidiMessages, float clusterMin, juce::MidiMessage message)
 {
     // sustain pedal handling
     if (message.isController() && message.getControllerNumber() == 66)
@@ -340,7 +344,7 @@ void NostalgicProcessor::handle_sostenuto_pedal (juce::MidiBuffer& outMidiMessag
     }
 }
 
-void NostalgicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce::MidiBuffer& outMidiMessages, int numSamples)
+void NostalgicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, BKNoteEventQueue& outMidiMessages, int numSamples)
 {
     // start with a clean slate of noteOn specifications; assuming normal noteOns without anything special
     for (auto& spec : noteOnSpecMap)
@@ -400,7 +404,7 @@ void NostalgicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce
 
                 DBG("forward Note On msg: " << note << ", velocity: " << velocities[note]);
                 auto forwardOnMsg = juce::MidiMessage::noteOn (1, note, velocities[note]);
-                outMidiMessages.addEvent(forwardOnMsg, 0);
+                outMidiMessages.add(forwardOnMsg, 0);
             }
 
             // once the undertow has completed, clean it up
@@ -466,7 +470,7 @@ void NostalgicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce
                 auto& note = reverseTimers.getReference(i);
                 // is there a better velocity to use for this midi message?
                 auto noteOffMsg = juce::MidiMessage::noteOff (1, note.noteNumber, 1.f);
-                outMidiMessages.addEvent(noteOffMsg, 0);
+                outMidiMessages.add(noteOffMsg, 0);
                 reverseTimers.remove(i);
             }
         }
@@ -487,7 +491,7 @@ void NostalgicProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
     buffer.clear();
 
     // do all the MIDI handling; this is where the main work happens
-    juce::MidiBuffer outMidi;
+    outMidi.reset();
     ProcessMIDIBlock(midiMessages, outMidi, numSamples);
 
     // send the MIDI messages to the synth
@@ -495,7 +499,7 @@ void NostalgicProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
     {
         //nostalgicSynth->setBypassed (false);
         nostalgicSynth->setNoteOnSpecMap(noteOnSpecMap);
-        nostalgicSynth->renderNextBlock (buffer, outMidi, 0, buffer.getNumSamples());
+        nostalgicSynth->renderNextBlock (buffer, outMidi.getEvents(), 0, buffer.getNumSamples());
     }
 
     const bool muted = state.params.muted_.load (std::memory_order_relaxed);
@@ -534,14 +538,14 @@ void NostalgicProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer,
     buffer.clear();
 
     // do all the MIDI handling; this is where the main work happens
-    juce::MidiBuffer outMidi;
+    outMidi.reset();
     ProcessMIDIBlock(midiMessages, outMidi, numSamples);
 
     // send the MIDI messages to the synth
     if (nostalgicSynth->hasSamples())
     {
         nostalgicSynth->setNoteOnSpecMap(noteOnSpecMap);
-        nostalgicSynth->renderNextBlock (buffer, outMidi, 0, buffer.getNumSamples());
+        nostalgicSynth->renderNextBlock (buffer, outMidi.getEvents(), 0, buffer.getNumSamples());
     }
 
     const bool muted = state.params.muted_.load (std::memory_order_relaxed);
@@ -13,6 +13,7 @@
 #include "IMuteSolable.h"
 #include "PluginBase.h"
 #include "Synthesiser/BKSynthesiser.h"
+#include "Synthesiser/BKNoteEventQueue.h"
 #include "TransposeParams.h"
 #include "WaveDistUndertowParams.h"
 #include "TuningProcessor.h"
@@ -369,7 +370,7 @@ public:
     void allNotesOff()
     {
         DBG("Nostalgic::allNotesOff called");
-        nostalgicSynth->allNotesOff(1, false);
+        nostalgicSynth->requestAllNotesOff();
 
         // velocities.clearQuick();
         // noteLengthTimers.clearQuick();
@@ -398,12 +399,12 @@ public:
     void processAudioBlock (juce::AudioBuffer<float>& buffer) override {};
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
     void processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
-    void ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce::MidiBuffer& outMidiMessages, int numSamples);
+    void ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, BKNoteEventQueue& outMidiMessages, int numSamples);
     void updateNoteVisualization();
-    void playReverseNote(NostalgicNoteData& noteData, juce::MidiBuffer& outMidiMessages);
-    void handleNostalgicNote(int noteNumber, float clusterMin, juce::MidiBuffer& outMidiMessages);
-    void handle_sustain_pedal(juce::MidiBuffer& outMidiMessages, float clusterMin, juce::MidiMessage message);
-    void handle_sostenuto_pedal(juce::MidiBuffer& outMidiMessages, float clusterMin, juce::MidiMessage message);
+    void playReverseNote(NostalgicNoteData& noteData, BKNoteEventQueue& outMidiMessages);
+    void handleNostalgicNote(int noteNumber, float clusterMin, BKNoteEventQueue& outMidiMessages);
+    void handle_sustain_pedal(BKNoteEventQueue& outMidiMessages, float clusterMin, juce::MidiMessage message);
+    void handle_sostenuto_pedal(BKNoteEventQueue& outMidiMessages, float clusterMin, juce::MidiMessage message);
     void updateMidiNoteTranspositions(int noteOnNumber);
     void updateAllMidiNoteTranspositions();
     void handleMidiTargetMessages(int channel);
@@ -545,6 +546,9 @@ private:
     bool sostenutoIsDown = false;
 
     std::unique_ptr<BKSynthesiser> nostalgicSynth;
+
+    // notes for nostalgicSynth, refilled each block
+    BKNoteEventQueue outMidi;
     BKSynthesizerState lastSynthState;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NostalgicProcessor)
 };
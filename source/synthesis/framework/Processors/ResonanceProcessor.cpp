@@ -211,16 +211,88 @@ void ResonanceParams::setSpectrumFromMenu(int menuChoice)
         IDs::keymapBits, getOnKeyString (fundamentalKeymap.keyStates.load()), nullptr);
 }
 
+/*
+ * ========================== ResonancePartialTable class ==========================
+ */
+
+void ResonancePartialTable::setPartials (const std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1>& partialStructure)
+{
+    std::array<Partial, TotalNumberOfPartialKeysInUI + 1> newPartials {};
+    int newNumPartials = 0;
+    for (const auto& partial : partialStructure)
+    {
+        if (! std::get<0> (partial)) continue;
+
+        // (10^(dB/20))^(1/4); ringString multiplies two of these for the overlap gain
+        newPartials[(size_t) newNumPartials++] = { std::get<1> (partial), std::pow (10.f, std::get<2> (partial) / 80.f) };
+    }
+
+    // called on the first note-on of every block, so only invalidate the keys if something moved
+    if (newNumPartials == numPartials
+        && std::equal (newPartials.begin(), newPartials.begin() + numPartials, partials.begin(), [] (const Partial& a, const Partial& b) {
+               return a.offset == b.offset && a.gainRoot == b.gainRoot;
+           }))
+        return;
+
+    partials = newPartials;
+    numPartials = newNumPartials;
+    ++partialGeneration;
+}
+
+const ResonancePartialTable::KeyEntry& ResonancePartialTable::getKey (int key, TuningState* tuning)
+{
+    jassert (key >= 0 && key < MaxMidiNotes);
+    auto& entry = keys[(size_t) key];
+
+    const auto tuningGeneration = tuning != nullptr ? tuning->getFrequencyTableGeneration() : 0;
+    if (entry.partialGeneration == partialGeneration && entry.tuning == tuning && entry.tuningGeneration == tuningGeneration)
+        return entry;
+
+    // same for every partial of this key, so looked up once
+    float tuningOffset = 0.f;
+    if (tuning != nullptr)
+        tuningOffset = ftom (tuning->getCachedTargetFrequency (key, 0, false), 440.) - static_cast<float> (key);
+
+    for (int i = 0; i < numPartials; ++i)
+    {
+        auto& partial = entry.partials[(size_t) i];
+        partial.position = static_cast<float> (key) + partials[(size_t) i].offset + tuningOffset;
+        partial.roundedKey = static_cast<int> (std::round (partial.position));
+        partial.transposition = partials[(size_t) i].offset + tuningOffset;
+        partial.gainRoot = partials[(size_t) i].gainRoot;
+        entry.byRoundedKey[(size_t) i] = static_cast<juce::uint8> (i);
+    }
+
+    // insertion sort: stable, so partials landing on the same key stay in partialStructure order, and
+    // unlike std::stable_sort it never allocates; the partials are close to sorted already
+    for (int i = 1; i < numPartials; ++i)
+    {
+        const auto index = entry.byRoundedKey[(size_t) i];
+        const auto roundedKey = entry.partials[index].roundedKey;
+
+        int j = i;
+        for (; j > 0 && entry.partials[entry.byRoundedKey[(size_t) j - 1]].roundedKey > roundedKey; --j)
+            entry.byRoundedKey[(size_t) j] = entry.byRoundedKey[(size_t) j - 1];
+        entry.byRoundedKey[(size_t) j] = index;
+    }
+
+    entry.numPartials = numPartials;
+    entry.partialGeneration = partialGeneration;
+    entry.tuning = tuning;
+    entry.tuningGeneration = tuningGeneration;
+    return entry;
+}
+
 /*
  * ========================== ResonantString class ==========================
  */
 
 ResonantString::ResonantString(
     ResonanceParams* inparams,
-    std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1>& inPartialStructure,
+    ResonancePartialTable& inPartialTable,
     std::array<NoteOnSpec, MaxMidiNotes>& inNoteOnSpecMap)
     : _rparams(inparams),
-      _partialStructure(inPartialStructure),
+      _partialTable(inPartialTable),
       _noteOnSpecMap(inNoteOnSpecMap)
 {
     heldKey = 0;
@@ -243,92 +315,65 @@ void ResonantString::addString (int midiNote)
  * when another note is played, call ringString(), which will look for overlapping
  * partials with this held string and send the appropriate noteOn messages
  */
-void ResonantString::ringString(int midiNote, int velocity, juce::MidiBuffer& outMidiMessages)
+void ResonantString::ringString(int midiNote, int velocity, BKNoteEventQueue& outMidiMessages)
 {
     if(!active || stringJustRemoved) return;
 
-    for (auto& heldPartialToCheck : _partialStructure)
-    {
-        // if not an active partial from UI, skip
-        if(!std::get<0>(heldPartialToCheck)) continue;
-
-        for (auto& struckPartialToCheck : _partialStructure)
-        {
-            // again, skip if partial is inactive
-            if(!std::get<0>(struckPartialToCheck)) continue;
-
-            /*
-             * take into account the attached Tuning system settings
-             */
-            float heldPartialTuningOffset = 0.;
-            float struckPartialTuningOffset = 0.;
-            if(attachedTuning != nullptr)
-            {
-                auto heldPartialOffset_freq = attachedTuning->getTargetFrequency(heldKey, 0, false);
-                auto struckPartialOffset_freq = attachedTuning->getTargetFrequency(midiNote, 0, false);
+    /*
+     * the partials of both strings, with the attached Tuning system settings already applied;
+     * only the pairs that land on the same key come back from forEachCoincidence
+     */
+    const auto& heldPartials = _partialTable.getKey(heldKey, attachedTuning);
+    const auto& struckPartials = _partialTable.getKey(midiNote, attachedTuning);
 
-                heldPartialTuningOffset = ftom(heldPartialOffset_freq,  440.) - static_cast<float>(heldKey);
-                struckPartialTuningOffset = ftom(struckPartialOffset_freq,  440.) - static_cast<float>(midiNote);
-            }
+    float varianceTemp = std::powf(*_rparams->variance, 5.);
+    float sensitivityCoeff = 1. / (varianceTemp * 100. + 1.);
 
-            // partial for the held key/string
-            float heldPartial       = static_cast<float>(heldKey) + std::get<1>(heldPartialToCheck) + heldPartialTuningOffset;
-            int   heldPartialKey    = std::round(heldPartial);
+    _partialTable.forEachCoincidence(heldPartials, struckPartials,
+        [this, velocity, sensitivityCoeff] (const ResonancePartialTable::KeyPartial& heldPartial,
+                                            const ResonancePartialTable::KeyPartial& struckPartial)
+    {
+        float heldPartialOffset = heldPartial.position - static_cast<float>(heldPartial.roundedKey);
+        float struckPartialOffset = struckPartial.position - static_cast<float>(struckPartial.roundedKey);
 
-            // partial for the struck key/string
-            float struckPartial       = static_cast<float>(midiNote) + std::get<1>(struckPartialToCheck) + struckPartialTuningOffset;
-            int   struckPartialKey    = std::round(struckPartial);
+        /*
+         * calculate how much we want to attenuate this particular partial because of the
+         * gains of the overlapping partials and how much tuning variance there is
+         * between the partials. this will all be scaled by the "variance" parameter
+         */
+        float offsetDifference = std::fabs(heldPartialOffset - struckPartialOffset);
+        if(offsetDifference > 1.) offsetDifference = 1.;
+        float partialOverlap = (1. - offsetDifference);
+        float varianceGainScale = std::powf(partialOverlap, sensitivityCoeff);
+        float gainOverlap = heldPartial.gainRoot * struckPartial.gainRoot;
+        varianceGainScale = gainOverlap * std::powf(varianceGainScale, 10.);
 
-            if (heldPartialKey == struckPartialKey)
-            {
-                float heldPartialOffset = heldPartial - static_cast<float>(heldPartialKey);
-                float heldPartialGain   = std::powf(10., std::get<2>(heldPartialToCheck) / 20.); // convert dBFS to gain multiplier
-                float struckPartialOffset = struckPartial - static_cast<float>(struckPartialKey);
-                float struckPartialGain   = std::powf(10., std::get<2>(struckPartialToCheck) / 20.);
-
-                /*
-                 * calculate how much we want to attenuate this particular partial because of the
-                 * gains of the overlapping partials and how much tuning variance there is
-                 * between the partials. this will all be scaled by the "variance" parameter
-                 */
-                float offsetDifference = std::fabs(heldPartialOffset - struckPartialOffset);
-                if(offsetDifference > 1.) offsetDifference = 1.;
-                float partialOverlap = (1. - offsetDifference);
-                float varianceTemp = std::powf(*_rparams->variance, 5.);
-                float sensitivityCoeff = 1. / (varianceTemp * 100. + 1.);
-                float varianceGainScale = std::powf(partialOverlap, sensitivityCoeff);
-                float gainOverlap = std::powf(heldPartialGain * struckPartialGain, 0.25);
-                varianceGainScale = gainOverlap * std::powf(varianceGainScale, 10.);
-
-                currentVelocity = static_cast<float>(velocity/128.);
-                _noteOnSpecMap[heldKey].channel = channel;
-
-                /*
-                 * add the held key offset for this partialKey to the transpositions
-                 *  - we may have more than one partial attached to this key, with different offsets
-                 *  - but we also don't want to add duplicates, so only add if not already there
-                 */
-                if (_noteOnSpecMap[heldKey].transpositions.addIfNotAlreadyThere(std::get<1>(heldPartialToCheck) + heldPartialTuningOffset))
-                {
-                    /*
-                    * then here, if addIfNotAlreadyThere returns true, add a gain value to transpositionGains
-                    */
-                    _noteOnSpecMap[heldKey].transpositionGains.add(varianceGainScale);
-                }
+        currentVelocity = static_cast<float>(velocity/128.);
+        _noteOnSpecMap[heldKey].channel = channel;
 
-                /*
-                 * start time should be into the sample, to play just its tail;
-                 * - closer to the beginning of the sample, the more "presence"
-                 */
-                _noteOnSpecMap[heldKey].startTime = 2000. * (1.0 - *_rparams->presence); // ms
-                _noteOnSpecMap[heldKey].sustainTime = 20000. * std::powf(*_rparams->sustain, 3.); // ms
-                if (_noteOnSpecMap[heldKey].sustainTime < 1) _noteOnSpecMap[heldKey].sustainTime = 1;
-                _noteOnSpecMap[heldKey].stopSameCurrentNote = false; // don't want to interrupt resonances already playing on this string
-                sendMIDImsg = true;
-                //DBG("playing partial associated with held key" + juce::String(heldPartialOffset) + " for " + juce::String(heldPartial));
-            }
+        /*
+         * add the held key offset for this partialKey to the transpositions
+         *  - we may have more than one partial attached to this key, with different offsets
+         *  - but we also don't want to add duplicates, so only add if not already there
+         */
+        if (_noteOnSpecMap[heldKey].transpositions.addIfNotAlreadyThere(heldPartial.transposition))
+        {
+            /*
+            * then here, if addIfNotAlreadyThere returns true, add a gain value to transpositionGains
+            */
+            _noteOnSpecMap[heldKey].transpositionGains.add(varianceGainScale);
         }
-    }
+
+        /*
+         * start time should be into the sample, to play just its tail;
+         * - closer to the beginning of the sample, the more "presence"
+         */
+        _noteOnSpecMap[heldKey].startTime = 2000. * (1.0 - *_rparams->presence); // ms
+        _noteOnSpecMap[heldKey].sustainTime = 20000. * std::powf(*_rparams->sustain, 3.); // ms
+        if (_noteOnSpecMap[heldKey].sustainTime < 1) _noteOnSpecMap[heldKey].sustainTime = 1;
+        _noteOnSpecMap[heldKey].stopSameCurrentNote = false; // don't want to interrupt resonances already playing on this string
+        sendMIDImsg = true;
+    });
 }
 
 /**
@@ -337,7 +382,7 @@ void ResonantString::ringString(int midiNote, int velocity, juce::MidiBuffer& ou
  * and wait for the release time to pass before making this string inactive (and available
  * for the next addString)
  */
-void ResonantString::removeString (int midiNote, juce::MidiBuffer& outMidiMessages)
+void ResonantString::removeString (int midiNote, BKNoteEventQueue& outMidiMessages)
 {
     //DBG("removed string " + juce::String(midiNote) + " on channel " + juce::String(channel));
 
@@ -358,7 +403,7 @@ void ResonantString::removeString (int midiNote, juce::MidiBuffer& outMidiMessag
     _noteOnSpecMap[midiNote].channel = channel;
 
     auto newmsg = juce::MidiMessage::noteOff (channel, midiNote, 0.0f);
-    outMidiMessages.addEvent(newmsg, 0);
+    outMidiMessages.add(newmsg, 0);
 }
 
 /**
@@ -403,13 +448,13 @@ void ResonantString::incrementTimer_seconds(float blockSize_seconds)
  * transpositions, both on and off, internally)
  * @param outMidiMessages
  */
-void ResonantString::finalizeNoteOnMessage(juce::MidiBuffer& outMidiMessages)
+void ResonantString::finalizeNoteOnMessage(BKNoteEventQueue& outMidiMessages)
 {
     if(active && sendMIDImsg)
     {
         // auto newmsg = juce::MidiMessage::noteOn (channel, heldKey, 1.f);
         auto newmsg = juce::MidiMessage::noteOn (channel, heldKey, currentVelocity);
-        outMidiMessages.addEvent (newmsg, 1);
+        outMidiMessages.add(newmsg, 1);
         sendMIDImsg = false;
     }
 }
@@ -424,6 +469,9 @@ ResonanceProcessor::ResonanceProcessor(SynthBase& parent, const juce::ValueTree&
         resonanceSynth = std::make_unique<ResonanceBKSynthesiser> (state.params.env, state.params.noteOnGain);
     else
         resonanceSynth = std::make_unique<BKSynthesiser> (state.params.env, state.params.noteOnGain);
+    resonanceSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::background);
+    if (useMultiThreadedSynth)
+        resonanceSynth->setParallelRendering (parent.getRenderWorkers());
     parent.getStateBank().addParam (std::make_pair<std::string, bitklavier::ParameterChangeBuffer*>
         (v.getProperty (IDs::uuid).toString().toStdString() + "_" + "gainsKeyboard", &(state.params.gainsKeyboardState.stateChanges)));
 
@@ -486,7 +534,7 @@ ResonanceProcessor::ResonanceProcessor(SynthBase& parent, const juce::ValueTree&
 
     for (size_t i = 0; i < resonantStringsArray.size(); ++i)
     {
-        resonantStringsArray[i] = std::make_unique<ResonantString>(&state.params, partialStructure, noteOnSpecMap);
+        resonantStringsArray[i] = std::make_unique<ResonantString>(&state.params, partialTable, noteOnSpecMap);
 
         // Set midi channel for each string
         resonantStringsArray[i]->channel = static_cast<int>(i + 1);
@@ -537,13 +585,13 @@ void ResonanceProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 
     if (useMultiThreadedSynth)
     {
-        if (auto* rSynth = dynamic_cast<ResonanceBKSynthesiser*> (resonanceSynth.get()))
-        {
-            juce::AudioWorkgroup workgroup;
-            if (parent.manager != nullptr)
-                workgroup = parent.manager->getDeviceAudioWorkgroup();
-            rSynth->prepareWorkgroup (workgroup, samplesPerBlock, sampleRate, getTotalNumOutputChannels());
-        }
+        // the worker pool is shared, but Resonance is what it was first written for,
+        // so it's where we pick up the device's workgroup (no-op if unchanged)
+        juce::AudioWorkgroup workgroup;
+        if (parent.manager != nullptr)
+            workgroup = parent.manager->getDeviceAudioWorkgroup();
+        parent.getRenderWorkers()->setAudioWorkgroup (workgroup);
+        resonanceSynth->prepareParallelRendering (samplesPerBlock);
     }
 }
 
@@ -605,7 +653,7 @@ void ResonanceProcessor::tuningStateInvalidated() {
     }
 }
 
-bool ResonanceProcessor::clear_resonant_strings (juce::MidiBuffer& outMidiMessages)
+bool ResonanceProcessor::clear_resonant_strings (BKNoteEventQueue& outMidiMessages)
 {
     if (removeAllResonantStrings)
     {
@@ -627,7 +675,7 @@ bool ResonanceProcessor::clear_resonant_strings (juce::MidiBuffer& outMidiMessag
     }
     return false;
 }
-void ResonanceProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce::MidiBuffer& outMidiMessages, int numSamples)
+void ResonanceProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, BKNoteEventQueue& outMidiMessages, int numSamples)
 {
     // if (clear_resonant_strings (outMidiMessages))
     //     return;
@@ -732,6 +780,8 @@ void ResonanceProcessor::resetPartialStructure()
          */
         partialStructure[i] = {false, 0.f, 1.f};
     }
+
+    partialTable.setPartials(partialStructure);
 }
 
 /**
@@ -776,6 +826,8 @@ void ResonanceProcessor::updatePartialStructure()
         }
         else partialStructure[i] = {false, 0.f, 1.f};
     }
+
+    partialTable.setPartials(partialStructure);
 }
 
 void ResonanceProcessor::printPartialStructure()
@@ -803,7 +855,7 @@ void ResonanceProcessor::printPartialStructure()
  * @param velocity
  * @param outMidiMessages
  */
-void ResonanceProcessor::ringSympStrings(int noteNumber, float velocity, juce::MidiBuffer& outMidiMessages)
+void ResonanceProcessor::ringSympStrings(int noteNumber, float velocity, BKNoteEventQueue& outMidiMessages)
 {
     for (auto& _string : resonantStringsArray)
     {
@@ -817,7 +869,7 @@ void ResonanceProcessor::ringSympStrings(int noteNumber, float velocity, juce::M
  * @param noteNumber
  * @param outMidiMessages
  */
-void ResonanceProcessor::toggleSympString(int noteNumber, juce::MidiBuffer& outMidiMessages)
+void ResonanceProcessor::toggleSympString(int noteNumber, BKNoteEventQueue& outMidiMessages)
 {
     for (auto& _string : resonantStringsArray)
     {
@@ -866,7 +918,7 @@ void ResonanceProcessor::addSympStrings(int noteNumber)
     DBG("no available string found!");
 }
 
-void ResonanceProcessor::keyPressed(int noteNumber, int velocity, int channel, juce::MidiBuffer& outMidiMessages)
+void ResonanceProcessor::keyPressed(int noteNumber, int velocity, int channel, BKNoteEventQueue& outMidiMessages)
 {
     //DBG("ResonanceProcessor: keyPressed called with noteNumber: " + juce::String(noteNumber) + ", velocity: " + juce::String(velocity) + ", channel: " + juce::String(channel));
     keysDepressed.set(noteNumber, velocity > 0);
@@ -897,7 +949,7 @@ void ResonanceProcessor::keyPressed(int noteNumber, int velocity, int channel, j
     }
 }
 
-void ResonanceProcessor::keyReleased(int noteNumber, int velocity, int channel, juce::MidiBuffer& outMidiMessages)
+void ResonanceProcessor::keyReleased(int noteNumber, int velocity, int channel, BKNoteEventQueue& outMidiMessages)
 {
     //DBG("ResonanceProcessor: keyReleased called with noteNumber: " + juce::String(noteNumber) + ", velocity: " + juce::String(velocity) + ", channel: " + juce::String(channel));
     keysDepressed.set(noteNumber, false);
@@ -919,7 +971,7 @@ void ResonanceProcessor::keyReleased(int noteNumber, int velocity, int channel,
     }
 }
 
-void ResonanceProcessor::handle_sustain_pedal (juce::MidiBuffer& outMidiMessages, juce::MidiMessage message)
+void ResonanceProcessor::handle_sustain_pedal (BKNoteEventQueue& outMidiMessages, juce::MidiMessage message)
 {
     // sustain pedal handling
     if (message.isController() && message.getControllerNumber() == 64)
@@ -960,7 +1012,7 @@ void ResonanceProcessor::handle_sustain_pedal (juce::MidiBuffer& outMidiMessages
     }
 }
 
-void ResonanceProcessor::handle_sostenuto_pedal (juce::MidiBuffer& outMidiMessages, juce::MidiMessage message)
+void ResonanceProcessor::handle_sostenuto_pedal (BKNoteEventQueue& outMidiMessages, juce::MidiMessage message)
 {
     // sostenuto pedal handling
     if (message.isController() && message.getControllerNumber() == 66)
@@ -1001,7 +1053,7 @@ void ResonanceProcessor::handle_sostenuto_pedal (juce::MidiBuffer& outMidiMessag
     }
 }
 
-void ResonanceProcessor::handleMidiTargetMessages(int noteNumber, int velocity, int channel, juce::MidiBuffer& outMidiMessages)
+void ResonanceProcessor::handleMidiTargetMessages(int noteNumber, int velocity, int channel, BKNoteEventQueue& outMidiMessages)
 {
     doRing = false;
     doAdd = false;
@@ -1063,7 +1115,7 @@ void ResonanceProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
      *  to send to BKSynth
      */
     int numSamples = buffer.getNumSamples();
-    juce::MidiBuffer outMidi;
+    outMidi.reset();
     ProcessMIDIBlock(midiMessages, outMidi, numSamples);
 
     /*
@@ -1073,7 +1125,7 @@ void ResonanceProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
     {
         // resonanceSynth->setBypassed (false);
         resonanceSynth->setNoteOnSpecMap(noteOnSpecMap);
-        resonanceSynth->renderNextBlock (buffer, outMidi, 0, buffer.getNumSamples());
+        resonanceSynth->renderNextBlock (buffer, outMidi.getEvents(), 0, buffer.getNumSamples());
     }
 
     const bool muted = state.params.muted_.load (std::memory_order_relaxed);
@@ -1117,7 +1169,7 @@ void ResonanceProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer,
      *  to send to BKSynth
      */
     int numSamples = buffer.getNumSamples();
-    juce::MidiBuffer outMidi;
+    outMidi.reset();
     ProcessMIDIBlock(midiMessages, outMidi, numSamples);
 
     /*
@@ -1127,7 +1179,7 @@ void ResonanceProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer,
     {
         // resonanceSynth->setBypassed (false);
         resonanceSynth->setNoteOnSpecMap(noteOnSpecMap);
-        resonanceSynth->renderNextBlock (buffer, outMidi, 0, buffer.getNumSamples());
+        resonanceSynth->renderNextBlock (buffer, outMidi.getEvents(), 0, buffer.getNumSamples());
     }
 
     const bool muted = state.params.muted_.load (std::memory_order_relaxed);
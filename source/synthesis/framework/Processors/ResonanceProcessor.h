@@ -37,6 +37,7 @@
 #include "IMuteSolable.h"
 #include "PluginBase.h"
 #include "Synthesiser/BKSynthesiser.h"
+#include "Synthesiser/BKNoteEventQueue.h"
 #include "Synthesiser/ResonanceBKSynthesiser.h"
 #include "target_types.h"
 #include "TuningUtils.h"
@@ -422,6 +423,92 @@ struct ResonanceNonParameterState : chowdsp::NonParamState
     chowdsp::StateValue<juce::Point<int>> prepPoint { "prep_point", { 300, 500 } };
 };
 
+/*
+ * ResonancePartialTable
+ *
+ * Where every partial of every key lands, worked out once instead of on every ringString().
+ *
+ * setPartials() keeps the active partials with their gains already in the form the overlap
+ * calculation uses; getKey() then places them above a key, with that key's tuning offset,
+ * and sorts them by the MIDI key they round to. Finding the partials two strings share is
+ * then a binary search per held partial (see forEachCoincidence()) rather than a pass over
+ * every pair, with no tuning lookups, ftom() or dB conversions along the way.
+ *
+ * A key's entry is rebuilt the first time it's needed after the partial structure changes,
+ * the string is attached to another tuning, or that tuning's frequency table moves on
+ * (TuningState bumps it whenever the tuning changes).
+ * Everything is preallocated, so none of this allocates on the audio thread.
+ */
+class ResonancePartialTable
+{
+public:
+    struct KeyPartial
+    {
+        int   roundedKey = 0;       // the MIDI key this partial sounds nearest to
+        float position = 0.f;       // fractional MIDI note of the partial, tuning included
+        float transposition = 0.f;  // from the key: partial offset + the key's tuning offset
+        float gainRoot = 1.f;       // the partial's gain, to the 1/4 power
+    };
+
+    struct KeyEntry
+    {
+        std::array<KeyPartial, TotalNumberOfPartialKeysInUI + 1> partials;  // in partialStructure order
+        std::array<juce::uint8, TotalNumberOfPartialKeysInUI + 1> byRoundedKey; // indices into partials, sorted by roundedKey then index
+        int numPartials = 0;
+
+        juce::uint32 partialGeneration = 0;
+        juce::uint32 tuningGeneration = 0;
+        const TuningState* tuning = nullptr;
+    };
+
+    /*
+     * call whenever the partial structure is rebuilt; the keys are only rebuilt if the active
+     * partials actually changed. Not thread safe with getKey(), so only from the thread that
+     * rings the strings
+     */
+    void setPartials (const std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1>& partialStructure);
+
+    /*
+     * the partials of key under tuning (nullptr => equal temperament), rebuilt if stale
+     */
+    const KeyEntry& getKey (int key, TuningState* tuning);
+
+    /*
+     * calls fn (heldPartial, struckPartial) for every pair of partials of the two keys that round
+     * to the same MIDI key, ordered by held partial and then struck partial
+     */
+    template <typename Fn>
+    void forEachCoincidence (const KeyEntry& held, const KeyEntry& struck, Fn&& fn) const
+    {
+        const auto* first = struck.byRoundedKey.data();
+        const auto* last = first + struck.numPartials;
+
+        for (int h = 0; h < held.numPartials; ++h)
+        {
+            const auto& heldPartial = held.partials[(size_t) h];
+            auto it = std::lower_bound (first, last, heldPartial.roundedKey, [&struck] (juce::uint8 s, int k) {
+                return struck.partials[s].roundedKey < k;
+            });
+
+            for (; it != last && struck.partials[*it].roundedKey == heldPartial.roundedKey; ++it)
+                fn (heldPartial, struck.partials[*it]);
+        }
+    }
+
+private:
+    struct Partial
+    {
+        float offset;
+        float gainRoot;
+    };
+
+    std::array<Partial, TotalNumberOfPartialKeysInUI + 1> partials {};
+    int numPartials = 0;
+    juce::uint32 partialGeneration = 1;
+
+    std::array<KeyEntry, MaxMidiNotes> keys {};
+};
+
 /*
  * ResonantString Class
  *
@@ -453,15 +540,15 @@ class ResonantString
 public:
     ResonantString(
         ResonanceParams* inparams,
-        std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1>& inPartialStructure,
+        ResonancePartialTable& inPartialTable,
         std::array<NoteOnSpec, MaxMidiNotes>& inNoteOnSpecMap);
 
     //~ResonantString() {}
     void addString (int midiNote);
-    void ringString(int midiNote, int velocity, juce::MidiBuffer& outMidiMessages);
-    void removeString (int midiNote, juce::MidiBuffer& outMidiMessages);
+    void ringString(int midiNote, int velocity, BKNoteEventQueue& outMidiMessages);
+    void removeString (int midiNote, BKNoteEventQueue& outMidiMessages);
     void incrementTimer_seconds(float blockSize_seconds);
-    void finalizeNoteOnMessage(juce::MidiBuffer& outMidiMessages);
+    void finalizeNoteOnMessage(BKNoteEventQueue& outMidiMessages);
     void setTuning(TuningState *tun) {attachedTuning = tun;}
 
     int heldKey = 0;                // MIDI note value for the key that is being held down
@@ -481,12 +568,9 @@ private:
     ResonanceParams* _rparams;
 
     /*
-     * partialStructure
-     * - active (bool; false => default)
-     * - offset from fundamental (fractional MIDI note val; 0. => default)
-     * - gains (floats; 1.0 => default)
+     * the partialStructure, placed over each key (shared by all the strings)
      */
-    std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1>& _partialStructure;
+    ResonancePartialTable& _partialTable;
     std::array<NoteOnSpec, MaxMidiNotes>& _noteOnSpecMap;
     float currentVelocity; // for noteOn message
 
@@ -519,24 +603,24 @@ public:
     void processAudioBlock (juce::AudioBuffer<float>& buffer) override {};
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
     void processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
-    void ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce::MidiBuffer& outMidiMessages, int numSamples);
+    void ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, BKNoteEventQueue& outMidiMessages, int numSamples);
 
     void setTuning(TuningProcessor *tun) override;
 
-    void keyPressed(int noteNumber, int velocity, int channel, juce::MidiBuffer& outMidiMessages);
-    void keyReleased(int noteNumber, int velocity, int channel, juce::MidiBuffer& outMidiMessages);
-    void handleMidiTargetMessages(int noteNumber, int velocity, int channel, juce::MidiBuffer& outMidiMessages);
-    void handle_sustain_pedal(juce::MidiBuffer& outMidiMessages, juce::MidiMessage message);
-    void handle_sostenuto_pedal(juce::MidiBuffer& outMidiMessages, juce::MidiMessage message);
-    void ringSympStrings(int noteNumber, float velocity, juce::MidiBuffer& outMidiMessages);
+    void keyPressed(int noteNumber, int velocity, int channel, BKNoteEventQueue& outMidiMessages);
+    void keyReleased(int noteNumber, int velocity, int channel, BKNoteEventQueue& outMidiMessages);
+    void handleMidiTargetMessages(int noteNumber, int velocity, int channel, BKNoteEventQueue& outMidiMessages);
+    void handle_sustain_pedal(BKNoteEventQueue& outMidiMessages, juce::MidiMessage message);
+    void handle_sostenuto_pedal(BKNoteEventQueue& outMidiMessages, juce::MidiMessage message);
+    void ringSympStrings(int noteNumber, float velocity, BKNoteEventQueue& outMidiMessages);
     void addSympStrings(int noteNumber);
-    void toggleSympString(int noteNumber, juce::MidiBuffer& outMidiMessages);
+    void toggleSympString(int noteNumber, BKNoteEventQueue& outMidiMessages);
 
     bool acceptsMidi() const override { return true; }
     bool hasEditor() const override { return false; }
     juce::AudioProcessorEditor* createEditor() override { return nullptr; }
     void tuningStateInvalidated() override;
-    bool clear_resonant_strings(juce::MidiBuffer& outMidiMessages);
+    bool clear_resonant_strings(BKNoteEventQueue& outMidiMessages);
     /*
      * this is where we define the buses for audio in/out, including the param modulation channels
      *      the "discreteChannels" number is currently just by hand set based on the max that this particularly preparation could have
@@ -584,8 +668,7 @@ public:
     void allNotesOff()
     {
         DBG("ResonanceProcessor::allNotesOff");
-        for (int i = 1; i <= 16; i++)
-            resonanceSynth->allNotesOff(i, false);
+        resonanceSynth->requestAllNotesOff();
 
         /*
          * we don't want to remove heldKeys, we just want to turn off playing notes
@@ -687,6 +770,9 @@ private:
 
     std::unique_ptr<BKSynthesiser> resonanceSynth;
 
+    // the strings rung and damped this block, for resonanceSynth
+    BKNoteEventQueue outMidi;
+
     /* the two primary modes, set by target msgs
      *  - channel 1 => both are true, default behavior
      *  - channel 2 => only ring the currently held strings
@@ -713,6 +799,12 @@ private:
      */
     std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1> partialStructure;
 
+    /*
+     * partialStructure laid out over every key, for the strings to look up coinciding partials;
+     * refreshed by updatePartialStructure() and resetPartialStructure()
+     */
+    ResonancePartialTable partialTable;
+
     /*
      * will update partialStructure based on parameter settings
      */
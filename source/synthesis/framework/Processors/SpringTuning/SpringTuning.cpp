@@ -21,124 +21,152 @@
 
 SpringTuning::SpringTuning(SpringTuningParams &params, std::array<std::atomic<float>, 12> &circularTuningCustom) : sparams(params), customTuning(circularTuningCustom)
 {
-    particleArray.ensureStorageAllocated(128);
-    tetherParticleArray.ensureStorageAllocated(128);
-
-    enabledSpringArray.ensureStorageAllocated(128);
-    enabledSpringArray.clear();
-
     tetherFundamental = PitchClass::C;
     useLowestNoteForFundamental = false;
     useHighestNoteForFundamental = false;
     useLastNoteForFundamental = false;
     usingFundamentalForIntervalSprings = true;
 
-    // Converting std::string to juce::String takes time so
-    // convert before the look
-    // (was happening implicitly at spring->setName() and costing a lot of time
-    juce::Array<juce::String> labels;
-    for (auto label : intervalLabels)
-        labels.add(juce::String(label));
-
-    for (int i = 0; i < 128; i++)
-    {
-        // Active particle
-        int pc = (i % 12);
-        int octave = (int)(i / 12);
-
-        Particle* p1 = new Particle(i * 100, i, notesInAnOctave[pc]);
-        p1->setOctave(octave);
-        p1->setEnabled(false);
-        p1->setLocked(false);
-        p1->setNote(i);
-        particleArray.add(p1);
+    intervalWeightParams = { nullptr,
+        sparams.intervalWeight_1.get(), sparams.intervalWeight_2.get(), sparams.intervalWeight_3.get(),
+        sparams.intervalWeight_4.get(), sparams.intervalWeight_5.get(), sparams.intervalWeight_6.get(),
+        sparams.intervalWeight_7.get(), sparams.intervalWeight_8.get(), sparams.intervalWeight_9.get(),
+        sparams.intervalWeight_10.get(), sparams.intervalWeight_11.get(), sparams.intervalWeight_12.get() };
 
-        // Tether particle
-        Particle* p2 = new Particle(i * 100, i, notesInAnOctave[pc]);
-        p2->setOctave(octave);
-        p2->setEnabled(false);
-        p2->setLocked(true);
-        p2->setNote(i);
-        tetherParticleArray.add(p2);
+    springModeParams = { nullptr,
+        sparams.useLocalOrFundamental_1.get(), sparams.useLocalOrFundamental_2.get(), sparams.useLocalOrFundamental_3.get(),
+        sparams.useLocalOrFundamental_4.get(), sparams.useLocalOrFundamental_5.get(), sparams.useLocalOrFundamental_6.get(),
+        sparams.useLocalOrFundamental_7.get(), sparams.useLocalOrFundamental_8.get(), sparams.useLocalOrFundamental_9.get(),
+        sparams.useLocalOrFundamental_10.get(), sparams.useLocalOrFundamental_11.get(), sparams.useLocalOrFundamental_12.get() };
 
-        Spring* s = new Spring(p1, p2, 0.0, 0.5, 0, labels.getUnchecked(0), false);
-        tetherSpringArray.add(s);
+    for (int i = 0; i < numNotes; i++)
+    {
+        x[i] = prevX[i] = restX[i] = tetherX[i] = i * 100.;
+        tetherStrength[i] = 0.5;
+        movable[i] = 1.;
     }
 
     /*
      * initialize primary user params to defaults
      */
-    dragChanged();
-    intervalFundamentalChanged();
-    intervalScaleChanged();
-    tetherScaleChanged();
-    tetherFundamentalChanged();
-    tetherStiffnessChanged();
-    intervalStiffnessChanged();
+    applyIntervalFundamental();
+    applyIntervalScale();
+    applyTetherScale();
+    applyTetherFundamental();
+    applyTetherStiffness();
+    applyIntervalStiffness();
+    dragLocal = 1. - sparams.drag->getCurrentValue();
+
+    publish();
 }
 
-SpringTuning::~SpringTuning()
+void SpringTuning::prepareToPlay(double newSampleRate)
 {
-    stopTimer();
-    // DBG("SpringTuning: stopping timer");
-};
+    sampleRate = newSampleRate;
 
-void SpringTuning::stop(void)
+    // start counting steps again at the new rate
+    sampleClockAtRateChange = sampleClock;
+    stepsAtRateChange = stepsTaken;
+}
+
+bool SpringTuning::advance(int numSamples)
 {
-    stopTimer();
-    // DBG("SpringTuning: stopping timer");
+    bool changed = applyPendingChanges();
+    if (numSamples <= 0 || sampleRate <= 0.)
+    {
+        if (changed) publish();
+        return changed;
+    }
+
+    const double rate = sparams.rate->getCurrentValue();
+    if (rate != stepRate)
+    {
+        sampleClockAtRateChange = sampleClock;
+        stepsAtRateChange = stepsTaken;
+        stepRate = rate;
+    }
+
+    sampleClock += numSamples;
+    const auto stepsDue = stepsAtRateChange
+                        + static_cast<juce::int64> (std::floor (static_cast<double> (sampleClock - sampleClockAtRateChange) * stepRate / sampleRate));
+
+    if (stepsTaken < stepsDue)
+    {
+        dragLocal = 1. - sparams.drag->getCurrentValue();
+        const bool active = sparams.active->get();
+
+        for (; stepsTaken < stepsDue; ++stepsTaken)
+            if (active) simulate();
+
+        changed = changed || active;
+    }
+
+    if (changed) publish();
+    return changed;
 }
 
-void SpringTuning::rateChanged() // called from UI
+bool SpringTuning::applyPendingChanges()
 {
-    setRate(sparams.rate->getCurrentValue(), true);
+    const auto changes = pendingChanges.exchange (0, std::memory_order_acq_rel);
+    if (changes == 0) return false;
+
+    if (changes & IntervalScaleChange)          applyIntervalScale();
+    if (changes & IntervalFundamentalChange)    applyIntervalFundamental();
+    if (changes & TetherScaleChange)            applyTetherScale();
+    if (changes & TetherFundamentalChange)      applyTetherFundamental();
+    if (changes & TetherStiffnessChange)        applyTetherStiffness();
+    if (changes & IntervalStiffnessChange)      applyIntervalStiffness();
+    if (changes & IntervalWeightsChange)        applyIntervalWeights();
+
+    return true;
 }
 
-void SpringTuning::dragChanged() // called from UI
+double SpringTuning::adjustStrength(double strength, double stiffness)
 {
-    dragLocal = 1. - sparams.drag->getCurrentValue();
+    double warpCoeff = 100.;
+    return 0.6 * stiffness * (pow(warpCoeff, strength) - 1.) / (warpCoeff - 1.); //replace with dt_asymwarp, for clarity
+    // > ~0.6 and the system can become unstable...
 }
 
-void SpringTuning::tetherStiffnessChanged()
+void SpringTuning::applyTetherStiffness()
 {
-    for (auto spring : tetherSpringArray)
-    {
-        spring->setStiffness(sparams.tetherStiffness->getCurrentValue());
-    }
+    tetherStiffness = sparams.tetherStiffness->getCurrentValue();
+    for (int i = 0; i < numNotes; i++)
+        setParticleLocked(i, locked[i]); // recomputes tetherGain
 }
 
-void SpringTuning::intervalStiffnessChanged()
+void SpringTuning::applyIntervalStiffness()
 {
-    for (auto spring : enabledSpringArray)
+    for (int s = 0; s < numSprings; s++)
     {
-        spring->setStiffness(sparams.intervalStiffness->getCurrentValue());
+        springStiffness[s] = sparams.intervalStiffness->getCurrentValue();
+        springAdjustedStrength[s] = adjustStrength(springStrength[s], springStiffness[s]);
     }
 }
 
-void SpringTuning::intervalWeightsChanged()
+void SpringTuning::applyIntervalWeights()
 {
-    for (auto spring : enabledSpringArray)
-        spring->setStrength(getSpringWeight(spring->getIntervalIndex()));
+    for (int s = 0; s < numSprings; s++)
+    {
+        springStrength[s] = getSpringWeight(springInterval[s]);
+        springAdjustedStrength[s] = adjustStrength(springStrength[s], springStiffness[s]);
+    }
 }
 
-void SpringTuning::intervalScaleChanged()
+void SpringTuning::applyIntervalScale()
 {
     if(sparams.scaleId->get() == TuningSystem::Custom)
     {
-        std::array<float, 12> newtuningv;
         int i=0;
-        for (auto& offs : customTuning) newtuningv[i++] = offs * .01;
-        copyStdArrayIntoJuceArray(newtuningv, intervalTuning);
+        for (auto& offs : customTuning) intervalTuning[i++] = offs * .01;
     }
     else
     {
-        auto newtuningv = getOffsetsFromTuningSystem(sparams.scaleId->get());
-        copyStdArrayIntoJuceArray(newtuningv, intervalTuning);
+        intervalTuning = getOffsetsFromTuningSystem(sparams.scaleId->get());
     }
-
 }
 
-void SpringTuning::intervalFundamentalChanged()
+void SpringTuning::applyIntervalFundamental()
 {
     auto newfundamental = sparams.intervalFundamental->get();
 
@@ -165,168 +193,152 @@ void SpringTuning::intervalFundamentalChanged()
     else useAutomaticFundamental = false;
 }
 
-void SpringTuning::tetherScaleChanged()
+void SpringTuning::applyTetherScale()
 {
-    auto newtuningv = getOffsetsFromTuningSystem(sparams.scaleId_tether->get());
-    copyStdArrayIntoJuceArray(newtuningv, tetherTuning); // so i don't have to rewrite all this with std:vectors right now...
-
+    tetherTuning = getOffsetsFromTuningSystem(sparams.scaleId_tether->get());
     updateTetherTuning();
 }
 
 void SpringTuning::updateTetherTuning()
 {
     // DBG("updateTetherTuning, fundamental = " << intFromPitchClass(tetherFundamental));
-    const juce::ScopedLock sl (lock);
-
-    for (int i = 0; i < 128; i++)
+    for (int i = 0; i < numNotes; i++)
     {
-        tetherParticleArray[i]->setX( (i * 100.0) + 100. * tetherTuning[(i - intFromPitchClass(tetherFundamental)) % 12] );
-        tetherParticleArray[i]->setRestX( (i * 100.0) + 100. * tetherTuning[(i - intFromPitchClass(tetherFundamental)) % 12] );
-
-        particleArray[i]->setRestX( (i * 100.0) + 100. * tetherTuning[(i - intFromPitchClass(tetherFundamental)) % 12] );
+        tetherX[i] = (i * 100.0) + 100. * offsetAt(tetherTuning, (i - intFromPitchClass(tetherFundamental)) % 12);
+        restX[i] = tetherX[i];
     }
 }
 
-void SpringTuning::tetherFundamentalChanged()
+void SpringTuning::applyTetherFundamental()
 {
     tetherFundamental = sparams.tetherFundamental->get();
     updateTetherTuning();
 }
 
-void SpringTuning::setRate(double r, bool start)
-{
-    if (start) {
-        startTimer(1000 / sparams.rate->getCurrentValue());
-        // DBG("SpringTuning: starting timer");
-    }
-    else {
-        stopTimer();
-        // DBG("SpringTuning: stopping timer");
-    }
-}
-
 bool SpringTuning::getSpringMode(int which)
 {
-    juce::String whichSpringId = "useLocalOrFundamental" + juce::String(which);
-    for ( auto &param_ : *sparams.getBoolParams())
-    {
-        // DBG("checking if " + param_->getParameterID() + " == " + whichSpringId);
-        if(param_->getParameterID() == whichSpringId)
-        {
-            return param_->get();
-        }
-    }
-    return false;
+    auto* param_ = which >= 0 && which < (int) springModeParams.size() ? springModeParams[(size_t) which] : nullptr;
+    return param_ != nullptr && param_->get();
 }
 
 /**
  * simulate() first moves through the entire particle array and "integrates" their position,
  * moving them based on their "velocities" and the drag values
  * it then moves through both spring arrays (the tether springs and interval springs) and
- * calls satisfyConstraints(), which updates the spring values based on the spring strengths,
- * stiffnesses, and offsets from their rest lengths. This in turn updates the target positions
- * for the two particles associated with each spring.
+ * "satisfies their constraints", updating the particle positions based on the spring strengths,
+ * stiffnesses, and offsets from their rest lengths.
+ *
+ * the first two loops treat every key the same way (the masks and gains are 0. for keys that
+ * shouldn't move), so they vectorize; the interval springs share particles, and each one
+ * sees the positions the ones before it left, so they stay a sequential pass.
 */
 void SpringTuning::simulate()
 {
-    const juce::ScopedLock sl (lock);
+    const double drag = dragLocal;
 
-    // update particle positions based on current velocities
-    for (auto particle : particleArray)
+    /*
+     * update particle positions based on current velocities
+     *
+     * newPosition = oldPosition + velocity * deltatime * inverseOfDragFactor
+     *                             velocity = newPosition - oldPosition
+     *                                        deltatime = 1 (iteration)
+     */
+    for (int i = 0; i < numNotes; i++)
     {
-		if (particle->getEnabled() && !particle->getLocked())
-        {
-            //particle->integrate(sparams.drag->getCurrentValue());
-            particle->integrate(dragLocal);
-        }
-	}
+        double newX = x[i] + (x[i] - prevX[i]) * drag;
 
-    // apply tether spring forces to all particles
-    for (auto spring : tetherSpringArray)
+        // boundary cases
+        newX = newX < 0.0 ? 0.0 : (newX > 13000.0 ? 13000.0 : newX);
+
+        const bool integrate = integrating[i] != 0.;
+        prevX[i] = integrate ? x[i] : prevX[i];
+        x[i] = integrate ? newX : x[i];
+    }
+
+    /*
+     * apply tether spring forces to all particles; the anchors never move, and the tethers
+     * have no rest length, so each just pulls its particle towards its anchor
+     */
+    for (int i = 0; i < numNotes; i++)
     {
-        if (spring->getEnabled())
-        {
-            //DBG("tetherSpringArray spring->getA()->getX() = " << spring->getA()->getX() << " spring->getB()->getX() = " << spring->getB()->getX());
-            spring->satisfyConstraints();
-        }
+        x[i] += (tetherX[i] - x[i]) * tetherGain[i];
     }
 
-    // apply interval spring forces to all particles
-	for (auto spring : enabledSpringArray)
-	{
-	    //DBG("enabledSpringArray spring->getA()->getX() = " << spring->getA()->getX() << " spring->getB()->getX() = " << spring->getB()->getX());
-        spring->satisfyConstraints();
-	}
+    /*
+     * apply interval spring forces to all particles:
+     * adjust each spring's length based on how far it is from the resting length, and how strong it is
+     */
+    for (int s = 0; s < numSprings; s++)
+    {
+        const int a = springA[s];
+        const int b = springB[s];
+
+        // difference of the particle positions; basically the current length of the spring, signed
+        double diff = x[b] - x[a];
+        if (diff == 0.0) continue;
+
+        double increment = (diff - springRestingLength[s]) * springAdjustedStrength[s];
+
+        // we are essentially applying a force to the particles here
+        x[a] += increment * movable[a];
+        x[b] -= increment * movable[b];
+    }
 }
 
-double SpringTuning::getSpringWeight(int which)
+void SpringTuning::publish()
 {
-    juce::String whichWeightId = "intervalWeight" + juce::String(which);
-    for ( auto &param_ : *sparams.getFloatParams())
+    const int next = 1 - published.load (std::memory_order_relaxed);
+    auto& snapshot = snapshots[(size_t) next];
+
+    for (int i = 0; i < numNotes; i++)
     {
-        if(param_->getParameterID() == whichWeightId)
-        {
-            return param_->getCurrentValue();
-        }
+        snapshot.x[i].store (x[i], std::memory_order_relaxed);
+        snapshot.tetherX[i].store (tetherX[i], std::memory_order_relaxed);
     }
 
-    return 0.5;
+    published.store (next, std::memory_order_release);
 }
 
-void SpringTuning::setTetherWeight(int which, double weight)
+double SpringTuning::getSpringWeight(int which)
 {
-    const juce::ScopedLock sl (lock);
-
-    // DBG("SpringTuning::setTetherWeight " + String(which) + " " + String(weight));
-    Spring* spring = tetherSpringArray[which];
-
-    spring->setStrength(weight);
+    auto* param_ = which >= 0 && which < (int) intervalWeightParams.size() ? intervalWeightParams[(size_t) which] : nullptr;
+    return param_ != nullptr ? param_->getCurrentValue() : 0.5;
+}
 
-    Particle* a = spring->getA();
-    Particle* b = spring->getB();
-    Particle* use = nullptr;
-    Particle* tethered = tetherParticleArray[which];
+void SpringTuning::setParticleLocked(int which, bool lock)
+{
+    locked[which] = lock;
+    movable[which] = lock ? 0. : 1.;
+    integrating[which] = enabled[which] && ! lock ? 1. : 0.;
+    tetherGain[which] = tetherEnabled[which] && ! lock ? adjustStrength(tetherStrength[which], tetherStiffness) : 0.;
+}
 
-    if (a != tethered)  use = a;
-    else                use = b;
+void SpringTuning::setTetherWeight(int which, double weight)
+{
+    // DBG("SpringTuning::setTetherWeight " + String(which) + " " + String(weight));
+    tetherStrength[which] = weight;
 
-    if (use != nullptr)
+    if (weight == 1.0)
     {
-        if (weight == 1.0)
-        {
-            use->setX(use->getRestX());
-            use->setLocked(true);
-        }
-        else
-        {
-            use->setLocked(false);
-            if (weight == 0.0)
-            {
-                tethered->setEnabled(false);
-            }
-        }
+        x[which] = restX[which];
+        setParticleLocked(which, true);
+    }
+    else
+    {
+        setParticleLocked(which, false);
     }
 }
 
 void SpringTuning::addParticle(int note)
 {
-    const juce::ScopedLock sl (lock);
-    particleArray[note]->setEnabled(true);
-    tetherParticleArray[note]->setEnabled(true);
-    // DBG("addParticle, restX = " << tetherParticleArray[note]->getRestX() << " X = " << tetherParticleArray[note]->getX());
+    enabled[note] = true;
+    setParticleLocked(note, locked[note]);
 }
 
 void SpringTuning::removeParticle(int note)
 {
-    const juce::ScopedLock sl (lock);
-    Particle* p = particleArray[note];
-    p->setEnabled(false);
-    tetherParticleArray[note]->setEnabled(false);
-}
-
-PitchClass SpringTuning::getTetherFundamental()
-{
-    return tetherFundamental;
+    enabled[note] = false;
+    setParticleLocked(note, locked[note]);
 }
 
 double SpringTuning::getTetherWeightGlobal()
@@ -341,6 +353,9 @@ double SpringTuning::getTetherWeightSecondaryGlobal()
 
 void SpringTuning::addNote(int note)
 {
+    if (note < 0 || note >= numNotes) return;
+
+    applyPendingChanges();
     addParticle(note);
 
     if(useLowestNoteForFundamental)
@@ -370,10 +385,15 @@ void SpringTuning::addNote(int note)
      * update this here for the UI
      */
     sparams.tCurrentSpringTuningFundamental->setParameterValue(intervalFundamentalActive);
+
+    publish();
 }
 
 void SpringTuning::removeNote(int note)
 {
+    if (note < 0 || note >= numNotes) return;
+
+    applyPendingChanges();
     removeParticle(note);
 
     if(useLowestNoteForFundamental)
@@ -395,19 +415,20 @@ void SpringTuning::removeNote(int note)
 
     if(useLowestNoteForFundamental || useHighestNoteForFundamental || useAutomaticFundamental)
         retuneAllActiveSprings();
+
+    publish();
 }
 
 void SpringTuning::findFundamental()
 {
-    const juce::ScopedLock sl (lock);
-
     //create sorted array of notes
-    juce::Array<int> enabledNotes;
-    for (int i=127; i>=0; i--)
+    std::array<int, numNotes> enabledNotes;
+    int numEnabledNotes = 0;
+    for (int i = 0; i < numNotes; i++)
     {
-        if(particleArray[i]->getEnabled())
+        if(enabled[i])
         {
-            enabledNotes.insert(0, i);
+            enabledNotes[numEnabledNotes++] = i;
         }
     }
 
@@ -417,7 +438,7 @@ void SpringTuning::findFundamental()
         int fundamental_48 = -1;
         int fundamental_39 = -1;
 
-        for(int i=enabledNotes.size() - 1; i>0; i--)
+        for(int i=numEnabledNotes - 1; i>0; i--)
         {
             for(int j=i-1; j>=0; j--)
             {
@@ -473,200 +494,157 @@ void SpringTuning::findFundamental()
 //    sparams.tCurrentSpringTuningFundamental->setParameterValue(intervalFundamentalActive);
 }
 
-void SpringTuning::addSpring(Spring* spring)
+void SpringTuning::addSpring(int lowerNote, int upperNote)
 {
-    const juce::ScopedLock sl (lock);
-    if (enabledSpringArray.contains(spring)) return;
+    if (connected[lowerNote][upperNote] || numSprings >= maxIntervalSprings) return;
+
+    int diff = upperNote - lowerNote;
+    int interval = diff % 12;
+    if (diff != 0 && interval == 0) interval = 12; // octaves
 
-    int interval = spring->getIntervalIndex();
-    spring->setEnabled(true);
-    spring->setStiffness(sparams.intervalStiffness->getCurrentValue());
-    //spring->setStrength(springWeights[interval]);
-    spring->setStrength(getSpringWeight(interval));
-    enabledSpringArray.add(spring);
+    const int s = numSprings++;
+    springA[s] = static_cast<juce::uint8>(lowerNote);
+    springB[s] = static_cast<juce::uint8>(upperNote);
+    springInterval[s] = static_cast<juce::uint8>(interval);
+    springStiffness[s] = sparams.intervalStiffness->getCurrentValue();
+    springStrength[s] = getSpringWeight(interval);
+    springAdjustedStrength[s] = adjustStrength(springStrength[s], springStiffness[s]);
+    connected[lowerNote][upperNote] = true;
 
-//    DBG("addSpring          = " + juce::String(spring->getIntervalIndex()) +
-//         "\nresting length   = " + juce::String(spring->getRestingLength()) +
-//         "\nstrength         = " + juce::String(spring->getStrength()) +
-//         "\nstiffness        = " + juce::String(spring->getStiffness()) +
-//         "\nenabled          = " + juce::String((int)spring->getEnabled()));
+//    DBG("addSpring          = " + juce::String(interval) +
+//         "\nstrength         = " + juce::String(springStrength[s]) +
+//         "\nstiffness        = " + juce::String(springStiffness[s]));
 
-    retuneIndividualSpring(spring);
+    retuneIndividualSpring(s);
 }
 
 void SpringTuning::addSpringsByNote(int note)
 {
-    const juce::ScopedLock sl (lock);
-
-    for (auto p : particleArray)
+    for (int otherNote = 0; otherNote < numNotes; otherNote++)
     {
-        int otherNote = p->getNote();
         if (otherNote == note) continue;
 
-        if (p->getEnabled())
+        if (enabled[otherNote])
         {
             int upperNote = note > otherNote ? note : otherNote;
             int lowerNote = note < otherNote ? note : otherNote;
-            int hash = (upperNote << 16 | lowerNote);
-
-            if (!springArray.contains(hash))
-            {
-                float diff = upperNote - lowerNote;
-
-                int interval = (int)diff % 12;
-                int octInterval = interval;
-
-                if (diff != 0 && interval == 0)
-                {
-                    octInterval = 12;
-                }
-
-                if (usingFundamentalForIntervalSprings)
-                {
-                    int scaleDegree1 = particleArray.getUnchecked(upperNote)->getNote();
-                    int scaleDegree2 = particleArray.getUnchecked(lowerNote)->getNote();;
-
-                    diff = fabs(100. *
-                    ((scaleDegree1 +
-                      intervalTuning.getUnchecked((scaleDegree1 - intFromPitchClass(intervalFundamentalActive)) % 12)) -
-                    (scaleDegree2 +
-                     intervalTuning.getUnchecked((scaleDegree2 - intFromPitchClass(intervalFundamentalActive)) % 12))));
-                }
-                else diff = diff * 100 + intervalTuning.getUnchecked(interval) * 100;
-
-                springArray.set(hash, new Spring(particleArray.getUnchecked(lowerNote),
-                                                 particleArray.getUnchecked(upperNote),
-                                                 diff, //rest length in cents
-                                                 0.5,
-                                                 octInterval,
-                                                 intervalLabels[octInterval],
-                                                 false));
-            }
-            addSpring(springArray[hash]);
+            addSpring(lowerNote, upperNote);
         }
     }
 
-    tetherSpringArray[note]->setEnabled(true);
+    tetherEnabled[note] = true;
+    setParticleLocked(note, locked[note]);
 
     if(sparams.fundamentalSetsTether->get() == true)
     {
-        for (auto tether : tetherSpringArray)
+        for (int tnote = 0; tnote < numNotes; tnote++)
         {
-            if(tether->getEnabled())
+            if(tetherEnabled[tnote])
             {
-                int tnoteA = tether->getA()->getNote();
-                int tnoteB = tether->getB()->getNote();
-
                 //intervalFundamentalActive
-                // if(tnoteA % 12 == intFromPitchClass(getTetherFundamental()) || tnoteB % 12 == intFromPitchClass(getTetherFundamental()))
-                if(tnoteA % 12 == intFromPitchClass(intervalFundamentalActive) || tnoteB % 12 == intFromPitchClass(intervalFundamentalActive))
+                // if(tnote % 12 == intFromPitchClass(getTetherFundamental()))
+                if(tnote % 12 == intFromPitchClass(intervalFundamentalActive))
                 {
-                    // DBG("setting tether weight = " << getTetherWeightGlobal() << " for tether note " << tnoteA);
-                    setTetherWeight(tnoteA, getTetherWeightGlobal());
+                    // DBG("setting tether weight = " << getTetherWeightGlobal() << " for tether note " << tnote);
+                    setTetherWeight(tnote, getTetherWeightGlobal());
                 }
                 else
                 {
-                    // DBG("setting secondary tether weight = " << getTetherWeightSecondaryGlobal() << " for tether note " << tnoteA);
-                    setTetherWeight(tnoteA, getTetherWeightSecondaryGlobal());
+                    // DBG("setting secondary tether weight = " << getTetherWeightSecondaryGlobal() << " for tether note " << tnote);
+                    setTetherWeight(tnote, getTetherWeightSecondaryGlobal());
                 }
             }
         }
     }
 }
 
-void SpringTuning::retuneIndividualSpring(Spring* spring)
+void SpringTuning::retuneIndividualSpring(int s)
 {
-    int interval = spring->getIntervalIndex();
+    int interval = springInterval[s];
     //DBG("retuneIndividualSpring, usingFundamentalForIntervalSprings = " << (int)usingFundamentalForIntervalSprings << ", interval = " << interval << " getSpringMode for this interval = " << (int)getSpringMode(interval));
 
     //set spring length locally, for all if !usingFundamentalForIntervalSprings, or for individual springs as set by L/F
     if(!usingFundamentalForIntervalSprings || !getSpringMode(interval))
     {
-        int diff = spring->getA()->getRestX() - spring->getB()->getRestX();
+        int diff = restX[springA[s]] - restX[springB[s]];
         //DBG("retuneIndividualSpring, resting length = " << fabs(diff) + 100. * (intervalTuning[interval] - tetherTuning[interval]));
-        spring->setRestingLength(fabs(diff) + 100. * (intervalTuning[interval] - tetherTuning[interval]));
-        //spring->setRestingLength(fabs(diff) + 100. * (intervalTuning[interval]));
+        springRestingLength[s] = fabs(diff) + 100. * (offsetAt(intervalTuning, interval) - offsetAt(tetherTuning, interval));
     }
 
     //otherwise, set resting length to interval scale relative to intervalFundamental (F)
     else
     {
-        int scaleDegree1 = spring->getA()->getNote();
-        int scaleDegree2 = spring->getB()->getNote();
+        int scaleDegree1 = springA[s];
+        int scaleDegree2 = springB[s];
 
         float diff =  100. *
-                         ((scaleDegree2 + intervalTuning[(scaleDegree2 - intFromPitchClass(intervalFundamentalActive)) % 12])
-                     -   (scaleDegree1 + intervalTuning[(scaleDegree1 - intFromPitchClass(intervalFundamentalActive)) % 12]));
+                         ((scaleDegree2 + offsetAt(intervalTuning, (scaleDegree2 - intFromPitchClass(intervalFundamentalActive)) % 12))
+                     -   (scaleDegree1 + offsetAt(intervalTuning, (scaleDegree1 - intFromPitchClass(intervalFundamentalActive)) % 12)));
 
-        spring->setRestingLength(fabs(diff));
+        springRestingLength[s] = fabs(diff);
     }
 }
 
 void SpringTuning::retuneAllActiveSprings(void)
 {
-    const juce::ScopedLock sl (lock);
-
-    for (auto spring : enabledSpringArray)
+    for (int s = 0; s < numSprings; s++)
     {
-        retuneIndividualSpring(spring);
+        retuneIndividualSpring(s);
     }
 }
 
 void SpringTuning::removeSpringsByNote(int note)
 {
-    const juce::ScopedLock sl (lock);
-
-	Particle* p = particleArray[note];
-
-    int size = enabledSpringArray.size();
-    for (int i = (size-1); i >= 0; i--)
-	{
-        Spring* spring = enabledSpringArray[i];
-        Particle* a = spring->getA();
-        Particle* b = spring->getB();
+    // compact the springs that don't touch this note, keeping their order
+    int kept = 0;
+    for (int s = 0; s < numSprings; s++)
+    {
+        if (springA[s] == note || springB[s] == note)
+        {
+            connected[springA[s]][springB[s]] = false;
+            continue;
+        }
 
-		if (spring->getEnabled() && ((a == p) || (b == p)))
+        if (kept != s)
         {
-            spring->setEnabled(false);
-            enabledSpringArray.remove(i);
+            springA[kept] = springA[s];
+            springB[kept] = springB[s];
+            springInterval[kept] = springInterval[s];
+            springRestingLength[kept] = springRestingLength[s];
+            springStrength[kept] = springStrength[s];
+            springStiffness[kept] = springStiffness[s];
+            springAdjustedStrength[kept] = springAdjustedStrength[s];
         }
-	}
+        kept++;
+    }
+    numSprings = kept;
 
-    tetherSpringArray[note]->setEnabled(false);
+    tetherEnabled[note] = false;
+    setParticleLocked(note, locked[note]);
 }
 
-double SpringTuning::getFrequency(int note, float globalRefA4)
+double SpringTuning::getFrequency(int note, float globalRefA4) const
 {
-    const juce::ScopedLock sl (lock);
+    if (note < 0 || note >= numNotes) return mtof(note, globalRefA4);
 
-    auto particles = getParticles();
-    double x = particles[note]->getX();
-//    int octave = particles[note]->getOctave();
-    double freq = mtof(x * .01, globalRefA4);
+    const auto& snapshot = snapshots[(size_t) published.load (std::memory_order_acquire)];
+    double x_ = snapshot.x[note].load (std::memory_order_relaxed);
+    double freq = mtof(x_ * .01, globalRefA4);
 
 //    DBG("SpringTuning::getFrequency for " + juce::String(note) +
-//        " x = " + juce::String(x) +
-//        " octave = " + juce::String(octave) +
-//        " output frequency = " + juce::String(midi));
+//        " x = " + juce::String(x_) +
+//        " output frequency = " + juce::String(freq));
 
     return freq;
 }
 
-double SpringTuning::getTetherFrequency(int note, float globalRefA4)
+double SpringTuning::getTetherFrequency(int note, float globalRefA4) const
 {
-    const juce::ScopedLock sl (lock);
-
-    auto& particles = tetherParticleArray;
-    double x = particles[note]->getX();
-    //    int octave = particles[note]->getOctave();
-    double freq = mtof(x * .01, globalRefA4);
+    if (note < 0 || note >= numNotes) return mtof(note, globalRefA4);
 
-    //    DBG("SpringTuning::getFrequency for " + juce::String(note) +
-    //        " x = " + juce::String(x) +
-    //        " octave = " + juce::String(octave) +
-    //        " output frequency = " + juce::String(midi));
-
-    return freq;
+    const auto& snapshot = snapshots[(size_t) published.load (std::memory_order_acquire)];
+    double x_ = snapshot.tetherX[note].load (std::memory_order_relaxed);
+    return mtof(x_ * .01, globalRefA4);
 }
 
 void SpringTuning::print()
@@ -682,26 +660,16 @@ void SpringTuning::print()
     DBG("tetherStiffness                = " + sparams.tetherStiffness->getCurrentValueAsText());
     DBG("tetherWeightGlobal             = " + sparams.tetherWeightGlobal->getCurrentValueAsText());
     DBG("tetherWeightSecondaryGlobal    = " + sparams.tetherWeightSecondaryGlobal->getCurrentValueAsText());
-
-//	for (int i = 0; i < 128; i++)
-//	{
-//        juce::String printStatus = "";
-//		if (particleArray[i]->getEnabled())
-//        {
-//            DBG("particle: " + juce::String(i) + " " + juce::String(particleArray[i]->getX()));
-//        }
-//	}
+    DBG("interval springs               = " + juce::String(numSprings));
 }
 
 int SpringTuning::getLowestActiveParticle()
 {
-    const juce::ScopedLock sl (lock);
-
     int lowest = 0;
 
-    while(lowest < particleArray.size())
+    while(lowest < numNotes)
     {
-        if(particleArray[lowest]->getEnabled()) return lowest;
+        if(enabled[lowest]) return lowest;
 
         lowest++;
     }
@@ -711,30 +679,14 @@ int SpringTuning::getLowestActiveParticle()
 
 int SpringTuning::getHighestActiveParticle()
 {
-    const juce::ScopedLock sl (lock);
-
-    int highest = particleArray.size() - 1;
+    int highest = numNotes - 1;
 
     while(highest >= 0)
     {
-        if(particleArray[highest]->getEnabled()) return highest;
+        if(enabled[highest]) return highest;
 
         highest--;
     }
 
     return highest;
 }
-
-juce::Array<Particle*> SpringTuning::getParticles(void)
-{
-    return particleArray;
-}
-
-void SpringTuning::hiResTimerCallback(void)
-{
-    // DBG("Spring Tuning timer callback");
-    if (sparams.active->get())
-    {
-        simulate();
-    }
-}
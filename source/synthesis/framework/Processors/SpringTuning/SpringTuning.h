@@ -27,96 +27,160 @@
         Trueman, Bhatia, Mulshine, Trevisan
         Computer Music Journal, 2020
 
-    The main method is simulate(), which is called repeatedly in a timer()
+    The main method is simulate(), which TuningProcessor drives from its sample clock
+    through advance(), so the system moves at the same rate (and to the same place)
+    whatever the block size, or when rendering offline.
 
   ==============================================================================
 */
 
-/**
- * todo: rewrite ALL the spring code to remove JUCE dependencies (other than the timer)
- *  so, no juce::Arrays, etc...
- *  would be nice for it to be more modular, and might have other benefits as well
- */
-
-/**
- * todo: have this run on its own thread, so that its timer is independent from the UI
- *       - would also be nice to find a way for it to work properly if rendering in non-real-time
- *       - could possibly have it simply count samples in the processBlock and run simulate() on its own thread
- */
-
 #pragma once
 #include "SpringTuningUtilities.h"
-#include "Particle.h"
-#include "Spring.h"
 #include "SpringTuningParams.h"
+#include <atomic>
+#include <bitset>
 
-class Particle;
-class Spring;
-class SpringTuning : public juce::HighResolutionTimer
+/**
+ * The particles and springs are kept as parallel arrays (structure-of-arrays) rather than
+ * as Particle/Spring objects, so integrating and applying the tethers are plain loops over
+ * contiguous doubles that the compiler can vectorize, and nothing is allocated after the
+ * constructor: every possible interval spring (one per pair of keys) has a slot reserved.
+ *
+ * Threads:
+ *  - the audio thread that runs TuningProcessor owns the simulation: advance(), addNote()
+ *    and removeNote() are only called from there, so none of them take a lock
+ *  - the ...Changed() callbacks can be called from any thread; they only flag the change,
+ *    and the audio thread picks it up at the start of its next advance()
+ *  - getFrequency() and getTetherFrequency() can be called from any thread (voices, the UI,
+ *    the MTS-ESP publisher); they read the last published snapshot of the particle positions,
+ *    one of two buffers the audio thread alternates between, and never the arrays being stepped
+ */
+class SpringTuning
 {
 public:
     SpringTuning(SpringTuningParams &params, std::array<std::atomic<float>, 12> &circularTuningCustom);
-    ~SpringTuning();
 
     /**
-     * todo: add a callback for drag, to do the 1 - drag conversion?
+     * these first functions are callbacks for the UI, to update values internally;
+     * they can be called from any thread, and take effect at the next advance()
+     * (rate and drag are read at every advance(), so have no callbacks)
+     */
+    void tetherStiffnessChanged()       { requestChange (TetherStiffnessChange); }
+    void intervalStiffnessChanged()     { requestChange (IntervalStiffnessChange); }
+    void intervalWeightsChanged()       { requestChange (IntervalWeightsChange); }
+    void intervalScaleChanged()         { requestChange (IntervalScaleChange); }
+    void intervalFundamentalChanged()   { requestChange (IntervalFundamentalChange); }
+    void tetherScaleChanged()           { requestChange (TetherScaleChange); }
+    void tetherFundamentalChanged()     { requestChange (TetherFundamentalChange); }
+
+    /**
+     * audio thread: sets the sample rate the sample clock counts in
      */
+    void prepareToPlay(double sampleRate);
 
     /**
-     * these first functions are callbacks for the UI, to update values internally
+     * audio thread: moves the sample clock on by numSamples, runs simulate() once for every
+     * step of the rate parameter (in Hz) that falls within them, and publishes the result.
+     * the steps are counted from the start of the sample clock (or the last rate change),
+     * so splitting the same stretch of samples into different blocks gives the same steps.
+     * returns true if the published frequencies may have changed
      */
-    void rateChanged();
-    void dragChanged();
-    void tetherStiffnessChanged();
-    void intervalStiffnessChanged();
-    void intervalWeightsChanged();
-    void intervalScaleChanged();
-    void intervalFundamentalChanged();
-    void tetherScaleChanged();
-    void tetherFundamentalChanged();
-
-    void setRate(double r, bool start = true);
-    void setActive(bool status);
+    bool advance(int numSamples);
+
+    /**
+     * audio thread
+     */
+	void addNote(int noteIndex);
+	void removeNote(int noteIndex);
+
+    /**
+     * any thread; from the last published snapshot
+     */
+    double getFrequency(int index, float globalRefA4) const;
+    double getTetherFrequency(int index, float globalRefA4) const;
+
+    PitchClass getTetherFundamental() const { return tetherFundamental; }
+
+    SpringTuningParams &sparams;
+    std::array<std::atomic<float>, 12> &customTuning;
+    void print();
+
+    static constexpr int numNotes = 128;
+    static constexpr int maxIntervalSprings = numNotes * (numNotes - 1) / 2;
 
+private:
+    enum Change : juce::uint32
+    {
+        TetherStiffnessChange       = 1 << 0,
+        IntervalStiffnessChange     = 1 << 1,
+        IntervalWeightsChange       = 1 << 2,
+        IntervalScaleChange         = 1 << 3,
+        IntervalFundamentalChange   = 1 << 4,
+        TetherScaleChange           = 1 << 5,
+        TetherFundamentalChange     = 1 << 6
+    };
+
+    void requestChange(Change change) { pendingChanges.fetch_or (change, std::memory_order_acq_rel); }
+    bool applyPendingChanges();
+
+    void applyTetherStiffness();
+    void applyIntervalStiffness();
+    void applyIntervalWeights();
+    void applyIntervalScale();
+    void applyIntervalFundamental();
+    void applyTetherScale();
+    void applyTetherFundamental();
+
+    /*
+     * one step of the system: integrate the particles, then the tether springs,
+     * then the interval springs, in the order they were added
+     */
     void simulate();
-    void stop(void);
+    void publish();
 
 	void addParticle(int pc);
 	void removeParticle(int pc);
 
-	void addNote(int noteIndex);
-	void removeNote(int noteIndex);
-    void addSpring(Spring* spring);
+    void addSpring(int lowerNote, int upperNote);
 	void addSpringsByNote(int pc);
 	void removeSpringsByNote(int removeIndex);
 
     void setTetherWeight(int which, double weight);
+    void setParticleLocked(int which, bool lock);
     double getTetherWeightGlobal();
     double getTetherWeightSecondaryGlobal();
-    double getTetherFrequency(int index, float globalRefA4);
     bool getSpringMode(int which);
-    double getFrequency(int index, float globalRefA4);
-    PitchClass getTetherFundamental();
+    double getSpringWeight(int which);
 
-    juce::Array<Particle*> getParticles(void);
     int getLowestActiveParticle();
     int getHighestActiveParticle();
-    double getSpringWeight(int which);
 
     void findFundamental();
     void updateTetherTuning();
-    void retuneIndividualSpring(Spring* spring);
+    void retuneIndividualSpring(int spring);
     void retuneAllActiveSprings(void);
 
-    juce::Array<Spring*>& getTetherSprings(void) { return tetherSpringArray; }
+    /*
+     * the spring strength as the simulation uses it, scaled non-linearly
+     * to make the exposed strength parameter more intuitive and usable
+     */
+    static double adjustStrength(double strength, double stiffness);
 
-    SpringTuningParams &sparams;
-    std::array<std::atomic<float>, 12> &customTuning;
-    void print();
+    /*
+     * the offset for scale degree i of a 12-note tuning; 0 for anything outside 0-11
+     * (as the juce::Arrays these used to be gave for out of range indices, which
+     * the octave spring and notes below the fundamental rely on)
+     */
+    static float offsetAt(const std::array<float, 12>& tuning, int i) { return i >= 0 && i < 12 ? tuning[(size_t) i] : 0.f; }
 
+    std::atomic<juce::uint32> pendingChanges { 0 };
 
-private:
-    juce::CriticalSection lock;
+    /*
+     * pointers to the per-interval parameters (index = interval in semitones, 1-12),
+     * so the audio thread doesn't look them up by ID
+     */
+    std::array<chowdsp::FloatParameter*, 13> intervalWeightParams {};
+    std::array<chowdsp::BoolParameter*, 13> springModeParams {};
 
     bool usingFundamentalForIntervalSprings; //only false when in "none" mode
     bool useLowestNoteForFundamental;
@@ -124,21 +188,71 @@ private:
     bool useLastNoteForFundamental;
     bool useAutomaticFundamental; //uses findFundamental() to set fundamental automatically, based on what is played
 
-    juce::Array<float> intervalTuning;
-    PitchClass intervalFundamentalActive; //the one actually used currently, changed by auto/last/highest/lowest modes
+    std::array<float, 12> intervalTuning {};
+    PitchClass intervalFundamentalActive = PitchClass::C; //the one actually used currently, changed by auto/last/highest/lowest modes
 
-    juce::Array<float> tetherTuning;
+    std::array<float, 12> tetherTuning {};
     PitchClass tetherFundamental;
 
-    juce::Array<Particle*> particleArray;
-    juce::HashMap<int, Spring*> springArray; // efficiency fix: make this ordered by spring interval
-
-    juce::Array<Particle*>  tetherParticleArray;
-    juce::Array<Spring*>    tetherSpringArray;
-    juce::Array<Spring*>    enabledSpringArray;
-    juce::Array<Spring*>    enabledParticleArray;
+    /*
+     * particles, one per key, positions in cents (note * 100 in ET)
+     *  - movable is 1. for particles the springs can push (not locked) and 0. otherwise
+     *  - integrating is 1. for particles simulate() integrates (enabled and not locked)
+     */
+    alignas(32) std::array<double, numNotes> x {};
+    alignas(32) std::array<double, numNotes> prevX {};
+    alignas(32) std::array<double, numNotes> restX {};
+    alignas(32) std::array<double, numNotes> movable {};
+    alignas(32) std::array<double, numNotes> integrating {};
+    std::array<bool, numNotes> enabled {};
+    std::array<bool, numNotes> locked {};
+
+    /*
+     * tether springs, one per key, from its particle to a fixed anchor at tetherX with no rest length
+     *  - tetherGain is the adjusted strength while the tether is enabled and its particle movable, 0. otherwise
+     */
+    alignas(32) std::array<double, numNotes> tetherX {};
+    alignas(32) std::array<double, numNotes> tetherGain {};
+    std::array<double, numNotes> tetherStrength {};
+    std::array<bool, numNotes> tetherEnabled {};
+    double tetherStiffness = 0.;
+
+    /*
+     * enabled interval springs, in the order they were added; springA is always the lower note
+     */
+    std::array<juce::uint8, maxIntervalSprings> springA {};
+    std::array<juce::uint8, maxIntervalSprings> springB {};
+    std::array<juce::uint8, maxIntervalSprings> springInterval {};
+    std::array<double, maxIntervalSprings> springRestingLength {};
+    std::array<double, maxIntervalSprings> springStrength {};
+    std::array<double, maxIntervalSprings> springStiffness {};
+    std::array<double, maxIntervalSprings> springAdjustedStrength {};
+    int numSprings = 0;
+    std::array<std::bitset<numNotes>, numNotes> connected {};     // connected[lower][upper] when that spring is enabled
+
+    /*
+     * the sample clock; simulate() has run stepsTaken times, and should have run
+     * stepsAtRateChange + floor ((sampleClock - sampleClockAtRateChange) * stepRate / sampleRate) times
+     */
+    double sampleRate = 44100.;
+    juce::int64 sampleClock = 0;
+    juce::int64 sampleClockAtRateChange = 0;
+    juce::int64 stepsAtRateChange = 0;
+    juce::int64 stepsTaken = 0;
+    double stepRate = 0.;
 
-    float dragLocal; //internally, work with 1. - drag as given in the UI
+    double dragLocal = 1.; //internally, work with 1. - drag as given in the UI
 
-    void hiResTimerCallback(void) override;
-};
\ No newline at end of file
+    /*
+     * the published positions; readers use snapshots[published], advance() fills the other one and flips
+     */
+    struct Snapshot
+    {
+        std::array<std::atomic<double>, numNotes> x {};
+        std::array<std::atomic<double>, numNotes> tetherX {};
+    };
+    std::array<Snapshot, 2> snapshots;
+    std::atomic<int> published { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpringTuning)
+};
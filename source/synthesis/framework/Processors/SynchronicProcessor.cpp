@@ -46,6 +46,9 @@ SynchronicProcessor::SynchronicProcessor(SynthBase& parent, const juce::ValueTre
     clusterKeysDepressed = juce::Array<int>();
     clusterKeysDepressed.ensureStorageAllocated(100);
 
+    synchronicSynth->setVoicePool (parent.getVoicePool(), BKVoicePool::Priority::normal);
+    synchronicSynth->setParallelRendering (parent.getRenderWorkers());
+
     /*
      * state-change parameter stuff (for multisliders)
      */
@@ -104,6 +107,7 @@ void SynchronicProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     const auto spec = juce::dsp::ProcessSpec { sampleRate, (uint32_t) samplesPerBlock, (uint32_t) getMainBusNumInputChannels() };
     synchronicSynth->setCurrentPlaybackSampleRate (sampleRate);
+    synchronicSynth->prepareParallelRendering (samplesPerBlock);
 }
 
 bool SynchronicProcessor::isBusesLayoutSupported (const juce::AudioProcessor::BusesLayout& layouts) const
@@ -327,13 +331,23 @@ void SynchronicProcessor::handle_sostenuto_pedal (juce::MidiMessage message)
     }
 }
 
-void SynchronicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce::MidiBuffer& outMidiMessages, int numSamples)
+void SynchronicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, int numSamples)
 {
+    // start with no pulse notes; each one gets a clean noteOnSpec in playPulse()
+    numPulseNotes = 0;
+
     /*
      * process incoming MIDI messages, including the target messages
+     *  - time is passed up to each message before it is handled, so pulses and the timers
+     *      around them (hold times, cluster threshold) land on the samples they belong to
      */
+    int blockPosition = 0;
     for (auto mi : inMidiMessages)
     {
+        const int messagePosition = juce::jlimit(blockPosition, numSamples, mi.samplePosition);
+        playPulses(blockPosition, messagePosition);
+        blockPosition = messagePosition;
+
         auto message = mi.getMessage();
 
         handle_sustain_pedal (message);
@@ -345,17 +359,31 @@ void SynchronicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juc
             keyReleased(message.getNoteNumber(), message.getChannel());
     }
 
-    if(doPausePlay) return;
+    playPulses(blockPosition, numSamples);
+}
 
-    // trigger type
-    auto sMode = state.params.pulseTriggeredBy->get();
+/*
+ * the length of the cluster's current beat, in samples
+ */
+juce::int64 SynchronicProcessor::getNumSamplesBeat(const SynchronicCluster& cluster)
+{
+    // if this is the first beat and we are not skipping the first beat, we need to set numSamplesBeat based on the LAST beatLengthMultiplier
+    if (!*state.params.skipFirst && cluster.beatCounter == 0 && state.params.beatLengthMultipliers.sliderVals_size > 1)
+        return beatThresholdSamples * state.params.beatLengthMultipliers.sliderVals[state.params.beatLengthMultipliers.sliderVals_size - 1].load();
 
-    // start with a clean slate of noteOn specifications; assuming normal noteOns without anything special
-    for (auto& spec : noteOnSpecMap)
-    {
-        spec.clear();
-        //spec.transpositions = {0.};
-    }
+    // otherwise, just multiplier the beatLength by this beat's multiplier
+    return beatThresholdSamples * state.params.beatLengthMultipliers.sliderVals[cluster.beatMultiplierCounter].load();
+}
+
+/*
+ * passes the time from startSample to endSample (within this block), playing every pulse that
+ * falls in it at the exact sample where its beat ends
+ */
+void SynchronicProcessor::playPulses(int startSample, int endSample)
+{
+    if(doPausePlay) return;
+
+    const int numSamples = endSample - startSample;
 
     // keep track of how long keys have been held down, for holdTime check
     for (auto key : keysDepressed)
@@ -384,231 +412,321 @@ void SynchronicProcessor::ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juc
     // update this every block, for adaptive tempo updates
     beatThresholdSamples = getBeatThresholdSeconds() * getSampleRate();
 
+    // trigger type
+    auto sMode = state.params.pulseTriggeredBy->get();
+
     // all noteOn messages for all the clusters
     for (auto& cluster : clusterLayers)
     {
+        int position = startSample;
         if (cluster->getShouldPlay())
         {
-            // if this is the first beat and we are not skipping the first beat, we need to set numSamplesBeat based on the LAST beatLengthMultiplier
-            if (!*state.params.skipFirst && cluster->beatCounter == 0 && state.params.beatLengthMultipliers.sliderVals_size > 1)
+            while (cluster->getShouldPlay())
             {
-                numSamplesBeat = beatThresholdSamples * state.params.beatLengthMultipliers.sliderVals[state.params.beatLengthMultipliers.sliderVals_size - 1].load();
+                numSamplesBeat = getNumSamplesBeat(*cluster);
+
+                // samples until the next beat; stop here if it's beyond this stretch of time
+                const juce::int64 samplesToBeat = juce::jmax((juce::int64) 0, numSamplesBeat - cluster->getPhasor());
+                if (samplesToBeat >= endSample - position)
+                    break;
+
+                position += (int) samplesToBeat;
+                cluster->incrementPhasor((int) samplesToBeat);
+
+                // DBG("phasor = " << cluster->getPhasor() << ", numSamplesBeat = " << numSamplesBeat);
+                const bool movedOn = playPulse(*cluster, position, sMode);
+
+                // a beat with no length would play forever; give it one pulse, as the block-timed scheduler did
+                if (numSamplesBeat <= 0)
+                    break;
+
+                // still more than a beat behind (after a beat sync to a longer beat, say)? pick the pulse up
+                // from here, rather than playing every beat we missed at once
+                const auto nextBeat = getNumSamplesBeat(*cluster);
+                if (movedOn && nextBeat > 0 && cluster->getPhasor() >= nextBeat)
+                    cluster->setBeatPhasor(cluster->getPhasor() % nextBeat);
             }
 
-            // otherwise, just multiplier the beatLength by this beat's multiplier
-            else
-                numSamplesBeat = beatThresholdSamples * state.params.beatLengthMultipliers.sliderVals[cluster->beatMultiplierCounter].load();
+            // update current slider val for UI
+            state.params.transpositionsCurrent.store(cluster->transpCounter);
+            state.params.accentsCurrent.store(cluster->accentMultiplierCounter);
+            state.params.sustainLengthMultipliersCurrent.store(cluster->lengthMultiplierCounter);
+            state.params.beatLengthMultipliersCurrent.store(cluster->beatMultiplierCounter);
+            state.params.envelopesCurrent.store(cluster->envelopeCounter);
+        }
+
+        //pass time until next beat, increment phasor/timers
+        cluster->incrementPhasor(endSample - position);
+    }
+}
 
-            //check to see if enough time has passed for next beat
-            if (cluster->getPhasor() >= numSamplesBeat)
+/*
+ * plays one beat of the cluster at samplePosition: steps its patterns and adds its notes to pulseNotes.
+ * returns false only for the silent first beat of the noteOn-triggered modes, which leaves the phasor
+ * where it is so the first played beat follows right on from it
+ */
+bool SynchronicProcessor::playPulse(SynchronicCluster& cluster, int samplePosition, SynchronicPulseTriggerType sMode)
+{
+    // if patternSync has been set by a target message, reset the phase of all the counters
+    if (cluster.doPatternSync)
+    {
+        cluster.resetPatternPhase();
+        cluster.doPatternSync = false;
+    }
+
+    /*
+     * the skipFirst option can make things complicated
+     *  - when skipFirst == true, we skip the first value in the various patterns
+     *      -- usually because we want the first note to be what we play (probably heard in Direct)
+     *          and not have Synchronic repeat it or play basically in sync with it
+     *      -- this is actually the easy case
+     *  - when skipFirst == false we start at the beginning of the pattern, which is oddly the more complicated case
+     *  - and we need the behavior to make sense in the various trigger modes (noteOn or noteOff triggers)
+     */
+
+    // we need this to deal with noteOn triggered cases where we don't want clusters to play immediately
+    bool playNow = true;
+
+    // easy case: if we are skipping the first pattern value, we always increment the pattern counters, in step()
+    if(*state.params.skipFirst)
+        cluster.step(numSamplesBeat);
+
+    // it gets messy when we are not skipping the first pattern value
+    else
+    {
+        // deal with the noteOn triggered cases
+        if(sMode == Any_NoteOn || sMode == First_NoteOn)
+        {
+            // we don't want to play a cluster immediately with the noteOn message
+            DBG("beatCounter == " << cluster.beatCounter);
+            if(cluster.beatCounter == 0)
             {
-                // DBG("phasor = " << cluster->getPhasor() << ", numSamplesBeat = " << numSamplesBeat);
-                // if patternSync has been set by a target message, reset the phase of all the counters
-                if (cluster->doPatternSync)
-                {
-                    cluster->resetPatternPhase();
-                    cluster->doPatternSync = false;
-                }
+                playNow = false;
+            }
 
-                /*
-                 * the skipFirst option can make things complicated
-                 *  - when skipFirst == true, we skip the first value in the various patterns
-                 *      -- usually because we want the first note to be what we play (probably heard in Direct)
-                 *          and not have Synchronic repeat it or play basically in sync with it
-                 *      -- this is actually the easy case
-                 *  - when skipFirst == false we start at the beginning of the pattern, which is oddly the more complicated case
-                 *  - and we need the behavior to make sense in the various trigger modes (noteOn or noteOff triggers)
-                 */
+            // we want the timing of the first played beat to align properly
+            // else if (cluster.beatCounter == 1) cluster.setBeatPhasor(0);
+            else if (cluster.beatCounter == 1)
+                cluster.setBeatPhasor(numSamplesBeat > 0 ? cluster.getPhasor() % numSamplesBeat : 0);
 
-                // we need this to deal with noteOn triggered cases where we don't want clusters to play immediately
-                bool playNow = true;
+            // otherwise, step the parameter values as usual
+            else cluster.step(numSamplesBeat);
 
-                // easy case: if we are skipping the first pattern value, we always increment the pattern counters, in step()
-                if(*state.params.skipFirst)
-                    cluster->step(numSamplesBeat);
+            DBG("numSamplesBeat = " << numSamplesBeat);
+        }
 
-                // it gets messy when we are not skipping the first pattern value
-                else
-                {
-                    // deal with the noteOn triggered cases
-                    if(sMode == Any_NoteOn || sMode == First_NoteOn)
-                    {
-                        // we don't want to play a cluster immediately with the noteOn message
-                        DBG("beatCounter == " << cluster->beatCounter);
-                        if(cluster->beatCounter == 0)
-                        {
-                            playNow = false;
-                        }
+        // then the noteOff triggered cases
+        else
+        {
+            // to get the timing of the next beat correct
+            //  - note that postStep() also takes care not to increment the beat multiplier counter
+            // if (cluster.beatCounter == 0) cluster.setBeatPhasor(0);
+            if (cluster.beatCounter == 0)
+                cluster.setBeatPhasor(numSamplesBeat > 0 ? cluster.getPhasor() % numSamplesBeat : 0);
 
-                        // we want the timing of the first played beat to align properly
-                        // else if (cluster->beatCounter == 1) cluster->setBeatPhasor(0);
-                        else if (cluster->beatCounter == 1)
-                            cluster->setBeatPhasor(numSamplesBeat > 0 ? cluster->getPhasor() % numSamplesBeat : 0);
 
-                        // otherwise, step the parameter values as usual
-                        else cluster->step(numSamplesBeat);
+            // otherwise step the parameter values as usual
+            else cluster.step(numSamplesBeat);
+        }
+    }
 
-                        DBG("numSamplesBeat = " << numSamplesBeat);
-                    }
+    // get the current cluster of notes, which we'll cook down to a slimCluster, with duplicate pitches removed
+    clusterNotes = cluster.getCluster();
 
-                    // then the noteOff triggered cases
-                    else
-                    {
-                        // to get the timing of the next beat correct
-                        //  - note that postStep() also takes care not to increment the beat multiplier counter
-                        // if (cluster->beatCounter == 0) cluster->setBeatPhasor(0);
-                        if (cluster->beatCounter == 0)
-                            cluster->setBeatPhasor(numSamplesBeat > 0 ? cluster->getPhasor() % numSamplesBeat : 0);
+    /*
+     * constrain thickness of cluster
+     *  why not use clusterMax for this? the intent is different:
+     *  - clusterMax: max number of keys pressed within clusterThresh, otherwise shut off pulses
+     *  - clusterCap: the most number of notes allowed in a cluster when playing pulses (clusterThickness in bK2)
+     *
+     *  an example: clusterMax=9, clusterCap=8; playing 9 notes simultaneously will result in cluster with 8 notes, but playing 10 notes will shut off pulse
+     *  another example: clusterMax=20, clusterCap=8; play a rapid ascending scale more than 8 and less than 20 notes, then stop; only last 8 notes will be in the cluster. If your scale exceeds 20 notes then it won't play.
+     */
+    slimCluster.clearQuick();
+    for(int i = 0; i < clusterNotes.size() && i <= (int)std::round(*state.params.clusterThickness); i++)
+    {
+        slimCluster.addIfNotAlreadyThere(clusterNotes.getUnchecked(i));
+    }
 
+    // publish the measured cluster size for the live display indicator on the
+    // Cluster Min/Max slider (polled by SynchronicParametersView's Timer); store
+    // regardless of in-range result so the user can see actual counts when tuning
+    state.params.clusterMinMaxParams.lastClusterParam.store(
+        static_cast<float>(clusterNotes.size()), std::memory_order_relaxed);
 
-                        // otherwise step the parameter values as usual
-                        else cluster->step(numSamplesBeat);
-                    }
-                }
+    // check to see whether number of notes played is within cluster min/max
+    // if so, play it, if playNow is true (set just above)
+    if (playNow && checkClusterMinMax (clusterNotes.size()))
+    {
+        // the slimCluster is the cluster of notes in the metronome pulse with duplicate notes removed
+        for (int n=0; n < slimCluster.size(); n++)
+        {
+            if (numPulseNotes >= (int) pulseNotes.size())
+            {
+                DBG("SynchronicProcessor::playPulse: too many pulse notes in one block, dropping the rest");
+                break;
+            }
 
-                // get the current cluster of notes, which we'll cook down to a slimCluster, with duplicate pitches removed
-                clusterNotes = cluster->getCluster();
+            // put together the midi message
+            int newNote = slimCluster[n];
+            float velocityMultiplier = state.params.accents.sliderVals[cluster.accentMultiplierCounter];
+            const auto velocity = static_cast<juce::uint8>(velocityMultiplier * clusterVelocities.getUnchecked(newNote));
+
+            // every pulse note carries its own noteOnSpec, swapped into noteOnSpecMap just before BKSynth plays it
+            auto& spec = pulseSpecs[(size_t) numPulseNotes];
+            spec.clear();
+
+            // Synchronic uses its own ADSRs for each cluster, so we need to add these to the noteOnSpec that gets passed to BKSynth
+            // - these apply regardless of playback direction
+            spec.overrideDefaultEnvParams = true;
+            spec.envParams.attack = state.params.envelopeSequence.envStates.attacks[cluster.envelopeCounter] * .001; // BKADSR expects seconds, not ms
+            spec.envParams.decay = state.params.envelopeSequence.envStates.decays[cluster.envelopeCounter] * .001;
+            spec.envParams.sustain = state.params.envelopeSequence.envStates.sustains[cluster.envelopeCounter];
+            spec.envParams.release = state.params.envelopeSequence.envStates.releases[cluster.envelopeCounter] * .001;
+            spec.envParams.attackPower = state.params.envelopeSequence.envStates.attackPowers[cluster.envelopeCounter];
+            spec.envParams.decayPower = state.params.envelopeSequence.envStates.decayPowers[cluster.envelopeCounter];
+            spec.envParams.releasePower = state.params.envelopeSequence.envStates.releasePowers[cluster.envelopeCounter];
+
+            spec.transpositions.clearQuick();
+            spec.transpositionGains.clearQuick();
+            //spec.transpositions.add(newTransp);
+
+            // need to make sure that slider has at least one transposition
+            if(state.params.transpositions.sliderDepths[cluster.transpCounter].load() == 0)
+            {
+                if (newNote <= 108)  // The Le Boeuf Constraint ;--}
+                {
+                    spec.transpositions.addIfNotAlreadyThere(0.);
+                    spec.transpositionGains.addIfNotAlreadyThere(1.);
+                }
+            }
 
-                /*
-                 * constrain thickness of cluster
-                 *  why not use clusterMax for this? the intent is different:
-                 *  - clusterMax: max number of keys pressed within clusterThresh, otherwise shut off pulses
-                 *  - clusterCap: the most number of notes allowed in a cluster when playing pulses (clusterThickness in bK2)
-                 *
-                 *  an example: clusterMax=9, clusterCap=8; playing 9 notes simultaneously will result in cluster with 8 notes, but playing 10 notes will shut off pulse
-                 *  another example: clusterMax=20, clusterCap=8; play a rapid ascending scale more than 8 and less than 20 notes, then stop; only last 8 notes will be in the cluster. If your scale exceeds 20 notes then it won't play.
-                 */
-                slimCluster.clearQuick();
-                for(int i = 0; i < clusterNotes.size() && i <= (int)std::round(*state.params.clusterThickness); i++)
+            // add the rest of the transpositions
+            for (int i = 0; i < state.params.transpositions.sliderDepths[cluster.transpCounter].load(); i++)
+            {
+                auto newTransp = state.params.transpositions.sliderVals[cluster.transpCounter][i].load();
+                if (newNote + newTransp <= 108) // The Le Boeuf Constraint ;--}
                 {
-                    slimCluster.addIfNotAlreadyThere(clusterNotes.getUnchecked(i));
+                    spec.transpositions.add(state.params.transpositions.sliderVals[cluster.transpCounter][i].load());
+                    spec.transpositionGains.add(1.);
                 }
+            }
 
-                // publish the measured cluster size for the live display indicator on the
-                // Cluster Min/Max slider (polled by SynchronicParametersView's Timer); store
-                // regardless of in-range result so the user can see actual counts when tuning
-                state.params.clusterMinMaxParams.lastClusterParam.store(
-                    static_cast<float>(clusterNotes.size()), std::memory_order_relaxed);
+            spec.useAttachedTuning = *state.params.transpositionUsesTuning;
 
-                // check to see whether number of notes played is within cluster min/max
-                // if so, play it, if playNow is true (set just above)
-                if (playNow && checkClusterMinMax (clusterNotes.size()))
-                {
-                    // the slimCluster is the cluster of notes in the metronome pulse with duplicate notes removed
-                    for (int n=0; n < slimCluster.size(); n++)
-                    {
-                        // put together the midi message
-                        int newNote = slimCluster[n];
-                        float velocityMultiplier = state.params.accents.sliderVals[cluster->accentMultiplierCounter];
-                        auto newmsg = juce::MidiMessage::noteOn (1, newNote, static_cast<juce::uint8>(velocityMultiplier * clusterVelocities.getUnchecked(newNote)));
-
-                        // Synchronic uses its own ADSRs for each cluster, so we need to add these to the noteOnSpecMap that gets passed to BKSynth
-                        // - these apply regardless of playback direction
-                        noteOnSpecMap[newNote].overrideDefaultEnvParams = true;
-                        noteOnSpecMap[newNote].envParams.attack = state.params.envelopeSequence.envStates.attacks[cluster->envelopeCounter] * .001; // BKADSR expects seconds, not ms
-                        noteOnSpecMap[newNote].envParams.decay = state.params.envelopeSequence.envStates.decays[cluster->envelopeCounter] * .001;
-                        noteOnSpecMap[newNote].envParams.sustain = state.params.envelopeSequence.envStates.sustains[cluster->envelopeCounter];
-                        noteOnSpecMap[newNote].envParams.release = state.params.envelopeSequence.envStates.releases[cluster->envelopeCounter] * .001;
-                        noteOnSpecMap[newNote].envParams.attackPower = state.params.envelopeSequence.envStates.attackPowers[cluster->envelopeCounter];
-                        noteOnSpecMap[newNote].envParams.decayPower = state.params.envelopeSequence.envStates.decayPowers[cluster->envelopeCounter];
-                        noteOnSpecMap[newNote].envParams.releasePower = state.params.envelopeSequence.envStates.releasePowers[cluster->envelopeCounter];
-
-                        noteOnSpecMap[newNote].transpositions.clearQuick();
-                        noteOnSpecMap[newNote].transpositionGains.clearQuick();
-                        //noteOnSpecMap[newNote].transpositions.add(newTransp);
-
-                        // need to make sure that slider has at least one transposition
-                        if(state.params.transpositions.sliderDepths[cluster->transpCounter].load() == 0)
-                        {
-                            if (newNote <= 108)  // The Le Boeuf Constraint ;--}
-                            {
-                                noteOnSpecMap[newNote].transpositions.addIfNotAlreadyThere(0.);
-                                noteOnSpecMap[newNote].transpositionGains.addIfNotAlreadyThere(1.);
-                            }
-                        }
+            // calculate total envelope time
+            float envLen = 1000. * (spec.envParams.attack + spec.envParams.decay + spec.envParams.release);
 
-                        // add the rest of the transpositions
-                        for (int i = 0; i < state.params.transpositions.sliderDepths[cluster->transpCounter].load(); i++)
-                        {
-                            auto newTransp = state.params.transpositions.sliderVals[cluster->transpCounter][i].load();
-                            if (newNote + newTransp <= 108) // The Le Boeuf Constraint ;--}
-                            {
-                                noteOnSpecMap[newNote].transpositions.add(state.params.transpositions.sliderVals[cluster->transpCounter][i].load());
-                                noteOnSpecMap[newNote].transpositionGains.add(1.);
-                            }
-                        }
+            // set the duration of this note, so BKSynth can handle the sustain time internally. ADSR time  (envLen) is included, to be consistent with old bK--makes a noticable sonic difference
+            spec.sustainTime = fabs(state.params.sustainLengthMultipliers.sliderVals[cluster.lengthMultiplierCounter])
+                                                 * (getBeatThresholdSeconds() * 1000.f + envLen);
 
-                        noteOnSpecMap[newNote].useAttachedTuning = *state.params.transpositionUsesTuning;
+            //constrain adsr times, if needed
+            if(envLen > spec.sustainTime) {
+                // reduce env time proportionally
+                spec.envParams.attack *= spec.sustainTime / envLen;
+                spec.envParams.decay *= spec.sustainTime / envLen;
+                spec.envParams.release *= spec.sustainTime / envLen;
+            }
 
-                        // calculate total envelope time
-                        float envLen = 1000. * (noteOnSpecMap[newNote].envParams.attack + noteOnSpecMap[newNote].envParams.decay + noteOnSpecMap[newNote].envParams.release);
+            // constrain mins on env params
+            if(spec.envParams.attack  < 0.001f) spec.envParams.attack = 0.001f;
+            if(spec.envParams.decay < 0.003f)  spec.envParams.decay = 0.003f;
+            if(spec.envParams.release < 0.003f) spec.envParams.release = 0.003f;
 
-                        // set the duration of this note, so BKSynth can handle the sustain time internally. ADSR time  (envLen) is included, to be consistent with old bK--makes a noticable sonic difference
-                        noteOnSpecMap[newNote].sustainTime = fabs(state.params.sustainLengthMultipliers.sliderVals[cluster->lengthMultiplierCounter])
-                                                             * (getBeatThresholdSeconds() * 1000.f + envLen);
+            // recalculate sustainTime based on adjusted env times, and adjust sustainTime accordingly
+            envLen = 1000. * (spec.envParams.attack + spec.envParams.decay + spec.envParams.release);
+            spec.sustainTime -= envLen;
+            if (spec.sustainTime < 1.f) spec.sustainTime = 1.f;
 
-                        //constrain adsr times, if needed
-                        if(envLen > noteOnSpecMap[newNote].sustainTime) {
-                            // reduce env time proportionally
-                            noteOnSpecMap[newNote].envParams.attack *= noteOnSpecMap[newNote].sustainTime / envLen;
-                            noteOnSpecMap[newNote].envParams.decay *= noteOnSpecMap[newNote].sustainTime / envLen;
-                            noteOnSpecMap[newNote].envParams.release *= noteOnSpecMap[newNote].sustainTime / envLen;
-                        }
+            // forward and backwards notes need to be handled differently, for BKSynth
+            //  - forward-playing notes need nothing more
+            if(state.params.sustainLengthMultipliers.sliderVals[cluster.lengthMultiplierCounter] <= 0.)
+            {
+                /*
+                 * backwards-playing note
+                 *
+                 *  - for these we need to set values in noteOnSpec, which goes into noteOnSpecMap for this midiNote
+                 *  - noteOnSpecMap will get passed on to BKSynth so it can do what it needs to do for a backward note
+                 */
+                float newNoteDuration = fabs(state.params.sustainLengthMultipliers.sliderVals[cluster.lengthMultiplierCounter] * getBeatThresholdSeconds() * 1000.);
+                spec.overrideDefaultEnvParams = true;
+                spec.startDirection = Direction::backward;
+                spec.startTime = newNoteDuration;
+                spec.stopSameCurrentNote = false;
+            }
 
-                        // constrain mins on env params
-                        if(noteOnSpecMap[newNote].envParams.attack  < 0.001f) noteOnSpecMap[newNote].envParams.attack = 0.001f;
-                        if(noteOnSpecMap[newNote].envParams.decay < 0.003f)  noteOnSpecMap[newNote].envParams.decay = 0.003f;
-                        if(noteOnSpecMap[newNote].envParams.release < 0.003f) noteOnSpecMap[newNote].envParams.release = 0.003f;
+            // add it to the notes for BKSynth to play; renderPulseNotes() puts them in a midiBuffer
+            pulseNotes[(size_t) numPulseNotes++] = { samplePosition, newNote, velocity };
+        }
+    }
 
-                        // recalculate sustainTime based on adjusted env times, and adjust sustainTime accordingly
-                        envLen = 1000. * (noteOnSpecMap[newNote].envParams.attack + noteOnSpecMap[newNote].envParams.decay + noteOnSpecMap[newNote].envParams.release);
-                        noteOnSpecMap[newNote].sustainTime -= envLen;
-                        if (noteOnSpecMap[newNote].sustainTime < 1.f) noteOnSpecMap[newNote].sustainTime = 1.f;
+    // increment the remaining counters, check if we should continue to play
+    cluster.postStep();
 
-                        // forward and backwards notes need to be handled differently, for BKSynth
-                        if(state.params.sustainLengthMultipliers.sliderVals[cluster->lengthMultiplierCounter] > 0.)
-                        {
-                            // forward-playing note: add to the midiBuffer that gets passed to BKSynth
-                            outMidiMessages.addEvent(newmsg, 0);
-                        }
-                        else
-                        {
-                            /*
-                             * backwards-playing note
-                             *
-                             *  - for these we need to set values in noteOnSpec and put that in noteOnSpecMap for this midiNote
-                             *  - noteOnSpecMap will get passed on to BKSynth so it can do what it needs to do for a backward note
-                             *
-                             * note that the noteOnSpecMap will apply to all other notes == newNote for this block!
-                             *  - shouldn't be an issue, unless note playback is very fast or block is very large
-                             *      AND we get multiple noteOn msgs in the same block that want different noteOnSpecs
-                             */
-                            float newNoteDuration = fabs(state.params.sustainLengthMultipliers.sliderVals[cluster->lengthMultiplierCounter] * getBeatThresholdSeconds() * 1000.);
-                            noteOnSpecMap[newNote].overrideDefaultEnvParams = true;
-                            noteOnSpecMap[newNote].startDirection = Direction::backward;
-                            noteOnSpecMap[newNote].startTime = newNoteDuration;
-                            noteOnSpecMap[newNote].stopSameCurrentNote = false;
-
-                            // add it to the midiBuffer for BKSynth to process
-                            outMidiMessages.addEvent(newmsg, 0);
-                        }
-                    }
-                }
+    return playNow;
+}
+
+/*
+ * renders this block's pulse notes, each with its own noteOnSpec
+ *  - BKSynth looks up one noteOnSpec per note number as it starts a note, so the block is rendered in stretches,
+ *      and a new stretch starts wherever a note comes round again after an earlier sample in the current one
+ *  - notes on the same sample always share a stretch; if one note is there twice, its last noteOnSpec wins
+ */
+void SynchronicProcessor::renderPulseNotes(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    // the clusters play their pulses one after another, so put the notes in time order, keeping the
+    // order of notes on the same sample; an insertion sort, as they're nearly in order already
+    for (int i = 0; i < numPulseNotes; ++i)
+    {
+        const int position = pulseNotes[(size_t) i].samplePosition;
+        int j = i;
+        for (; j > 0 && pulseNotes[(size_t) pulseOrder[(size_t) j - 1]].samplePosition > position; --j)
+            pulseOrder[(size_t) j] = pulseOrder[(size_t) j - 1];
+        pulseOrder[(size_t) j] = i;
+    }
 
-                // increment the remaining counters, check if we should continue to play
-                cluster->postStep();
+    synchronicSynth->setBypassed (false);
+    synchronicSynth->setNoteOnSpecMap(noteOnSpecMap);
+
+    int stretchStart = 0;
+    int next = 0;
+    while (stretchStart < numSamples)
+    {
+        outMidi.reset();
+        std::bitset<MaxMidiNotes> notesInStretch;
+        int stretchEnd = numSamples;
+
+        while (next < numPulseNotes)
+        {
+            // all the notes on the next sample that has any
+            const int position = pulseNotes[(size_t) pulseOrder[(size_t) next]].samplePosition;
+            int last = next;
+            bool comesRoundAgain = false;
+            for (; last < numPulseNotes && pulseNotes[(size_t) pulseOrder[(size_t) last]].samplePosition == position; ++last)
+                comesRoundAgain |= notesInStretch[(size_t) pulseNotes[(size_t) pulseOrder[(size_t) last]].noteNumber];
+
+            if (comesRoundAgain)
+            {
+                stretchEnd = position;
+                break;
             }
 
-            // update current slider val for UI
-            state.params.transpositionsCurrent.store(cluster->transpCounter);
-            state.params.accentsCurrent.store(cluster->accentMultiplierCounter);
-            state.params.sustainLengthMultipliersCurrent.store(cluster->lengthMultiplierCounter);
-            state.params.beatLengthMultipliersCurrent.store(cluster->beatMultiplierCounter);
-            state.params.envelopesCurrent.store(cluster->envelopeCounter);
+            for (; next < last; ++next)
+            {
+                const int index = pulseOrder[(size_t) next];
+                const auto& note = pulseNotes[(size_t) index];
+
+                // no copying: the spec left behind in pulseSpecs is cleared before that slot is used again
+                std::swap (noteOnSpecMap[(size_t) note.noteNumber], pulseSpecs[(size_t) index]);
+                outMidi.add (juce::MidiMessage::noteOn (1, note.noteNumber, note.velocity), note.samplePosition);
+                notesInStretch.set ((size_t) note.noteNumber);
+            }
         }
 
-        //pass time until next beat, increment phasor/timers
-        cluster->incrementPhasor(numSamples);
+        // only this stretch's notes are in outMidi, so BKSynth doesn't start any beyond stretchEnd early
+        synchronicSynth->renderNextBlock (buffer, outMidi.getEvents(), stretchStart, stretchEnd - stretchStart);
+        stretchStart = stretchEnd;
     }
 }
 
@@ -645,12 +763,11 @@ void SynchronicProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::
      */
 
     /*
-     * ProcessMIDIBlock takes all the input MIDI messages and writes to outMIDI buffer
+     * ProcessMIDIBlock takes all the input MIDI messages and fills pulseNotes
      *  to send to BKSynth
      */
     int numSamples = buffer.getNumSamples();
-    juce::MidiBuffer outMidi;
-    ProcessMIDIBlock(midiMessages, outMidi, numSamples);
+    ProcessMIDIBlock(midiMessages, numSamples);
 
     /*
      * Then the Audio Stuff
@@ -664,11 +781,7 @@ void SynchronicProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::
      * then the synthesizer process blocks
      */
     if (synchronicSynth->hasSamples())
-    {
-        synchronicSynth->setBypassed (false);
-        synchronicSynth->setNoteOnSpecMap(noteOnSpecMap);
-        synchronicSynth->renderNextBlock (buffer, outMidi, 0, numSamples);
-    }
+        renderPulseNotes (buffer, numSamples);
 
     const bool muted = state.params.muted_.load (std::memory_order_relaxed);
 
@@ -710,8 +823,8 @@ void SynchronicProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer
      *          since their durations are set at noteOn
      */
     int numSamples = buffer.getNumSamples();
-    juce::MidiBuffer outMidi;
-    //ProcessMIDIBlock(midiMessages, outMidi, numSamples);
+    outMidi.reset();
+    //ProcessMIDIBlock(midiMessages, numSamples);
 
     /*
      * then the synthesizer process blocks
@@ -719,7 +832,7 @@ void SynchronicProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer
     if (synchronicSynth->hasSamples())
     {
         //synchronicSynth->setNoteOnSpecMap(noteOnSpecMap);
-        synchronicSynth->renderNextBlock (buffer, outMidi, 0, numSamples);
+        synchronicSynth->renderNextBlock (buffer, outMidi.getEvents(), 0, numSamples);
     }
 
     const bool muted = state.params.muted_.load (std::memory_order_relaxed);
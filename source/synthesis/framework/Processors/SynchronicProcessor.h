@@ -35,6 +35,7 @@ Synchronic.h
 #include "MultiSlider2DState.h"
 #include "PluginBase.h"
 #include "Synthesiser/BKSynthesiser.h"
+#include "Synthesiser/BKNoteEventQueue.h"
 #include "TempoProcessor.h"
 #include "TransposeParams.h"
 #include "TuningProcessor.h"
@@ -367,7 +368,7 @@ class SynchronicCluster
 
     /*
      * increment the timing phasor
-     *  - called every block, so numSamples is always the blocksize
+     *  - called up to each beat and to the end of each block, so the phasor reaches a beat's length on the beat
      */
     inline void incrementPhasor(int numSamples)
     {
@@ -385,7 +386,7 @@ class SynchronicCluster
         phasor -= numSamplesBeat;
         //phasor = 0;
         // the decrement doesn't make sense to me, why not just set the phasor to 0?
-        // - because we get slop from the blocksize, and you'll end up running slow!
+        // - because a beat can be reached late (after a beat sync, say), and you'll end up running slow!
 
         // increment all the counters
         if (++lengthMultiplierCounter >= _sparams->sustainLengthMultipliers.sliderVals_size)
@@ -546,7 +547,11 @@ class SynchronicProcessor : public bitklavier::PluginBase<bitklavier::Preparatio
     void processAudioBlock(juce::AudioBuffer<float>& buffer) override {};
     void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
     void processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
-    void ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, juce::MidiBuffer& outMidiMessages, int numSamples);
+    void ProcessMIDIBlock(juce::MidiBuffer& inMidiMessages, int numSamples);
+    void playPulses(int startSample, int endSample);
+    bool playPulse(SynchronicCluster& cluster, int samplePosition, SynchronicPulseTriggerType sMode);
+    void renderPulseNotes(juce::AudioBuffer<float>& buffer, int numSamples);
+    juce::int64 getNumSamplesBeat(const SynchronicCluster& cluster);
     bool acceptsMidi() const override { return true; }
 
 //    void addSoundSet(juce::ReferenceCountedArray<BKSamplerSound<juce::AudioFormatReader>>* s)
@@ -566,7 +571,7 @@ class SynchronicProcessor : public bitklavier::PluginBase<bitklavier::Preparatio
 
     void allNotesOff()
     {
-        synchronicSynth->allNotesOff(1, false);
+        synchronicSynth->requestAllNotesOff();
         slimCluster.clearQuick();
         clusterNotes.clearQuick();
         keysDepressed.clearQuick();
@@ -782,6 +787,22 @@ class SynchronicProcessor : public bitklavier::PluginBase<bitklavier::Preparatio
      */
     std::array<NoteOnSpec, MaxMidiNotes> noteOnSpecMap;
 
+    /*
+     * a note played by a pulse in this block; its noteOnSpec is in pulseSpecs at the same index,
+     * since several pulses in one block can play the same note with different envelopes, lengths
+     * and transpositions
+     */
+    struct PulseNote
+    {
+        int samplePosition = 0;
+        int noteNumber = 0;
+        juce::uint8 velocity = 0;
+    };
+
+    // the notes the last ProcessMIDIBlock() played, in the order the pulses played them
+    int getNumPulseNotes() const noexcept { return numPulseNotes; }
+    const PulseNote& getPulseNote(int index) const noexcept { return pulseNotes[(size_t) index]; }
+
    private:
     juce::ScopedPointer<BufferDebugger> bufferDebugger;
 
@@ -796,6 +817,16 @@ class SynchronicProcessor : public bitklavier::PluginBase<bitklavier::Preparatio
 
     std::unique_ptr<BKSynthesiser> synchronicSynth;
 
+    // this block's pulse notes and their noteOnSpecs, preallocated; see renderPulseNotes()
+    static constexpr int kMaxPulseNotes = 128;
+    std::array<PulseNote, kMaxPulseNotes> pulseNotes;
+    std::array<NoteOnSpec, kMaxPulseNotes> pulseSpecs;
+    std::array<int, kMaxPulseNotes> pulseOrder;
+    int numPulseNotes = 0;
+
+    // the pulse notes for one stretch of the block, for synchronicSynth
+    BKNoteEventQueue outMidi { kMaxPulseNotes };
+
     juce::Array<int> slimCluster; // cluster without repetitions
     juce::Array<int> clusterNotes;
     bool checkClusterMinMax(int clusterNotesSize);
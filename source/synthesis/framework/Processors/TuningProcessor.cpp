@@ -97,6 +97,40 @@ void TuningState::processStateChanges()
     stateChanges.changeState.clear();
 }
 
+/**
+ * compares everything a static/adaptive note frequency depends on (other than the adaptive
+ * and spring state and the scala tables, which invalidate the frequency table themselves)
+ * with the values seen last block, so the table is only invalidated when the tuning changes
+ *      - the params can be changed from the UI, by modulation or by processStateChanges()
+ *
+ * @return true if any of them changed since the last call
+ */
+bool TuningState::updateFrequencyTableInputs()
+{
+    std::array<float, numFrequencyTableInputs> inputs;
+    size_t i = 0;
+
+    inputs[i++] = static_cast<float> (tuningType->getIndex());
+    inputs[i++] = static_cast<float> (tuningSystem->getIndex());
+    inputs[i++] = static_cast<float> (fundamental->getIndex());
+    inputs[i++] = offsetKnobParam.offSetSliderParam->getCurrentValue();
+    inputs[i++] = semitoneWidthParams.semitoneWidthSliderParam->getCurrentValue();
+    inputs[i++] = static_cast<float> (semitoneWidthParams.reffundamental->getIndex());
+    inputs[i++] = static_cast<float> (semitoneWidthParams.octave->getIndex());
+    inputs[i++] = static_cast<float> (adaptiveParams.tAdaptiveIntervalScale->getIndex());
+    inputs[i++] = adaptiveParams.tAdaptiveInversional->get() ? 1.f : 0.f;
+    for (const auto& offset : absoluteTuningOffset) inputs[i++] = offset.load (std::memory_order_relaxed);
+    for (const auto& offset : circularTuningOffset) inputs[i++] = offset.load (std::memory_order_relaxed);
+    for (const auto& offset : circularTuningOffset_custom) inputs[i++] = offset.load (std::memory_order_relaxed);
+    jassert (i == inputs.size());
+
+    if (inputs == lastFrequencyTableInputs)
+        return false;
+
+    lastFrequencyTableInputs = inputs;
+    return true;
+}
+
 void TuningState::setFundamental (int fund)
 {
     setOffsetsFromTuningSystem(tuningSystem->get(), fund, circularTuningOffset, circularTuningOffset_custom);
@@ -150,15 +184,24 @@ double TuningState::getSemitoneWidthOffsetForMidiNote(double midiNoteNumber)
  * @return
  */
 int TuningState::getClosestKey(int noteNum, float transp, bool tuneTranspositions)
+{
+    return getClosestKey (noteNum, transp, tuneTranspositions, getCachedTargetFrequency (noteNum, transp, tuneTranspositions));
+}
+
+/**
+ * as above, for a caller that already has the note's target frequency (from getCachedTargetFrequency)
+ */
+int TuningState::getClosestKey(int noteNum, float transp, bool tuneTranspositions, double targetFrequency)
 {
     // adaptive/spring tunings ignore semitone width...
     if(getTuningType() == TuningType::Spring_Tuning || getTuningType() == TuningType::Adaptive || getTuningType() == Adaptive_Anchored)
     {
         /**
+         * the key nearest this note's own frequency, so transposed and chord notes each find their own sample
          * todo: tuneTranspositions is currently ignored
          *          - either implement it in some way, or hide useTuning button for these types
          */
-        return static_cast<int>(ftom(lastFrequencyTarget, getGlobalTuningReference()));
+        return static_cast<int>(std::round(ftom(targetFrequency, getGlobalTuningReference())));
     }
 
     // first check for when there is no need to adjust for semitone width (which is 99.9% of the time!)
@@ -361,125 +404,109 @@ double TuningState::getScalaTargetFrequency (int currentlyPlayingNote, double cu
  */
 double TuningState::getTargetFrequency (int currentlyPlayingNote, double currentTransposition, bool tuneTranspositions)
 {
-    /*
-     * Spring Tuning, if active
+    const auto frequency = computeTargetFrequency (currentlyPlayingNote, currentTransposition, tuneTranspositions);
+
+    /**
+     * spiralNotes will hold the target frequency for all currently playing non-transposed notes
+     *      - spiralNotes is initialized to all -1, indicating that all notes are inactive
+     *      - in keyPressed, spiralNotes[noteNumber] is set to the target frequency, also indicating it is an active note
+     *      - in keyReleased, spiralNotes[noteNumber] is set to -1, so that it is considered inactive
+     *      - here, for untransposed notes that are active, the spiralNote value is updated
+     *      - in the drawSpiral function, all the active spiralNotes will be drawn
+     *      - we use a std::array<std::atomic<float>, 128> for thread safety, and index it by midinote number
      */
-    if(getTuningType() == TuningType::Spring_Tuning)
-    {
-        lastFrequencyTarget = springTuner->getFrequency(currentlyPlayingNote, getGlobalTuningReference()) * intervalToRatio(getOverallOffset());
+     if (currentTransposition == 0 && spiralNotes[currentlyPlayingNote].load() > 0)
+         spiralNotes[currentlyPlayingNote].store(frequency);
+    // NOTE: all of the above about spiralNotes has been moved to keyPressed and updateSpiralNotes, so that Tuning can work autonomously and not depend on being connected to Direct
 
+//     printSpiralNotes();
+     return frequency;
+}
+
+/**
+ * the per-type tuning math behind getTargetFrequency(), without touching
+ * spiralNotes or the adaptive state, so voices can call it from any render thread
+ *      - adaptiveCalculate() only reads adaptive state; the algorithm advances in keyPressed
+ */
+double TuningState::computeTargetFrequency (int currentlyPlayingNote, double currentTransposition, bool tuneTranspositions)
+{
+    double frequency;
+
+    switch (getTuningType())
+    {
         /*
-         * handle transpositions
+         * Spring Tuning
          *      - note that for spring tuning, the "useTuning" option is ignored, and the literal transp value indicated in the transposition slider is used
          *          - could be a project for the future to figure out how to incorporate that...
          */
-        if (currentTransposition != 0)
-            lastFrequencyTarget *= intervalToRatio(currentTransposition);
-
-        // DBG("getTargetFrequency for spring tuning, lastFrequencyTarget = " << lastFrequencyTarget << " currentTransposition = " << currentTransposition);
-    }
+        case TuningType::Spring_Tuning:
+            frequency = springTuner->getFrequency (currentlyPlayingNote, getGlobalTuningReference()) * intervalToRatio (getOverallOffset());
+            break;
 
-    /*
-     * or Adaptive Tunings, if active
-     */
-    else if(getTuningType() == TuningType::Adaptive || getTuningType() == Adaptive_Anchored)
-    {
-        // global tuning handled internally
-        lastFrequencyTarget = adaptiveCalculate(currentlyPlayingNote) * intervalToRatio(getOverallOffset());
+        /*
+         * Adaptive Tunings: global tuning handled internally
+         *      - as with spring tuning, the "useTuning" option is ignored and transpositions are literal
+         */
+        case TuningType::Adaptive:
+        case TuningType::Adaptive_Anchored:
+            frequency = adaptiveCalculate (currentlyPlayingNote) * intervalToRatio (getOverallOffset());
+            break;
 
         /*
-         * handle transpositions
-         *      - note that for adaptive tuning, the "useTuning" option is ignored, and the literal transp value indicted in the transposition slider is used
+         * MTS-ESP client (receive mode): the connected MTS-ESP master dictates the
+         * tuning. Querying the client is lock-free and audio-thread safe; it falls
+         * back to 12-TET when no master is connected. Transpositions are tuned literally.
          */
-        if (currentTransposition != 0)
-            lastFrequencyTarget *= intervalToRatio(currentTransposition);
-    }
+        case TuningType::MTS_Client:
+            frequency = mtsClient.noteToFrequency (currentlyPlayingNote) * intervalToRatio (getOverallOffset());
+            break;
 
-    /*
-     * or the regular Static Tuning
-     */
-    else if(getTuningType() == TuningType::Static)
-    {
-        // offset is handled internally here, as is A440 adjustment, and as are transpositions
-        lastFrequencyTarget = getStaticTargetFrequency(currentlyPlayingNote, currentTransposition, tuneTranspositions);
+        // offset, A440 adjustment and transpositions are all handled internally for these two
+        case TuningType::Scala_KBM:
+            return getScalaTargetFrequency (currentlyPlayingNote, currentTransposition, tuneTranspositions);
+
+        case TuningType::Static:
+        default:
+            return getStaticTargetFrequency (currentlyPlayingNote, currentTransposition, tuneTranspositions);
     }
 
-    else if(getTuningType() == TuningType::Scala_KBM)
+    if (currentTransposition != 0)
+        frequency *= intervalToRatio (currentTransposition);
+
+    return frequency;
+}
+
+double TuningState::getCachedTargetFrequency (int currentlyPlayingNote, double currentTransposition, bool tuneTranspositions)
+{
+    const auto type = getTuningType();
+    if (currentlyPlayingNote < 0 || currentlyPlayingNote >= (int) frequencyTable.size()
+        || (currentTransposition != 0 && (type == TuningType::Static || type == TuningType::Scala_KBM)))
+        return computeTargetFrequency (currentlyPlayingNote, currentTransposition, tuneTranspositions);
+
+    const auto n = (size_t) currentlyPlayingNote;
+    const auto generation = frequencyTableGeneration.load (std::memory_order_acquire);
+
+    double frequency;
+    if (frequencyTableStamp[n].load (std::memory_order_acquire) == generation)
     {
-        lastFrequencyTarget = getScalaTargetFrequency(currentlyPlayingNote, currentTransposition, tuneTranspositions);
+        frequency = frequencyTable[n].load (std::memory_order_relaxed);
     }
-
-    /*
-     * or MTS-ESP client (receive mode): the connected MTS-ESP master dictates the
-     * tuning. Querying the client is lock-free and audio-thread safe; it falls
-     * back to 12-TET when no master is connected.
-     */
-    else if(getTuningType() == TuningType::MTS_Client)
+    else
     {
-        lastFrequencyTarget = mtsClient.noteToFrequency(currentlyPlayingNote) * intervalToRatio(getOverallOffset());
-
-        // Transpositions are tuned literally (as for Spring/Adaptive).
-        if (currentTransposition != 0)
-            lastFrequencyTarget *= intervalToRatio(currentTransposition);
+        frequency = computeTargetFrequency (currentlyPlayingNote, 0, tuneTranspositions);
+        frequencyTable[n].store (frequency, std::memory_order_relaxed);
+        frequencyTableStamp[n].store (generation, std::memory_order_release);
     }
 
-    /**
-     * spiralNotes will hold the lastFrequencyTarget for all currently playing non-transposed notes
-     *      - spiralNotes is initialized to all -1, indicating that all notes are inactive
-     *      - in keyPressed, spiralNotes[noteNumber] is set to the lastFrequencyTarget, also indicating it is an active note
-     *      - in keyReleased, spiralNotes[noteNumber] is set to -1, so that it is considered inactive
-     *      - here, for untransposed notes that are active, the spiralNote value is updated
-     *      - in the drawSpiral function, all the active spiralNotes will be drawn
-     *      - we use a std::array<std::atomic<float>, 128> for thread safety, and index it by midinote number
-     */
-     if (currentTransposition == 0 && spiralNotes[currentlyPlayingNote].load() > 0)
-         spiralNotes[currentlyPlayingNote].store(lastFrequencyTarget);
-    // NOTE: all of the above about spiralNotes has been moved to keyPressed and updateSpiralNotes, so that Tuning can work autonomously and not depend on being connected to Direct
-
-//     printSpiralNotes();
-     return lastFrequencyTarget;
+    // Spring, Adaptive and MTS-ESP tunings (and untuned Scala transpositions) take transpositions literally
+    return currentTransposition != 0 ? frequency * intervalToRatio (currentTransposition) : frequency;
 }
 
 void TuningState::fillTuningTable (double out[128])
 {
-    // Mirror getTargetFrequency()'s per-type math with currentTransposition = 0,
-    // but WITHOUT the lastFrequencyTarget / spiralNotes writes, so this is safe
-    // to call off the audio thread. adaptiveCalculate() only reads adaptive state
-    // (it multiplies adaptiveFundamentalFreq by the const adaptiveCalculateRatio),
-    // so it does not advance the adaptive algorithm here.
-    const TuningType type = getTuningType();
-
+    // safe to call off the audio thread, see computeTargetFrequency()
     for (int n = 0; n < 128; ++n)
-    {
-        double freq;
-        switch (type)
-        {
-            case TuningType::Spring_Tuning:
-                freq = springTuner->getFrequency (n, getGlobalTuningReference())
-                     * intervalToRatio (getOverallOffset());
-                break;
-
-            case TuningType::Adaptive:
-            case TuningType::Adaptive_Anchored:
-                freq = adaptiveCalculate (n) * intervalToRatio (getOverallOffset());
-                break;
-
-            case TuningType::Scala_KBM:
-                freq = getScalaTargetFrequency (n, 0, false);
-                break;
-
-            case TuningType::MTS_Client:
-                freq = mtsClient.noteToFrequency (n) * intervalToRatio (getOverallOffset());
-                break;
-
-            case TuningType::Static:
-            default:
-                freq = getStaticTargetFrequency (n, 0, false);
-                break;
-        }
-
-        out[n] = freq;
-    }
+        out[n] = computeTargetFrequency (n, 0, false);
 }
 
 template <typename Serializer>
@@ -541,7 +568,6 @@ void TuningParams::deserialize (typename Serializer::DeserializedType deserial,
     paramHolder.tuningState.springTuner->intervalFundamentalChanged();
     paramHolder.tuningState.springTuner->tetherScaleChanged();
     paramHolder.tuningState.springTuner->tetherFundamentalChanged();
-    paramHolder.tuningState.springTuner->dragChanged();
     paramHolder.tuningState.springTuner->tetherStiffnessChanged();
     paramHolder.tuningState.springTuner->intervalStiffnessChanged();
 }
@@ -572,6 +598,11 @@ void TuningState::keyPressed(int noteNumber)
 {
     adaptiveHistoryCounter++;
 
+    /*
+     * only adaptive and spring tunings move when a key is pressed
+     */
+    bool retuned = false;
+
     TuningType type = getTuningType();
     if (type == Adaptive)
     {
@@ -580,6 +611,7 @@ void TuningState::keyPressed(int noteNumber)
             adaptiveHistoryCounter = 0;
             adaptiveFundamentalFreq = adaptiveFundamentalFreq * adaptiveCalculateRatio(noteNumber);
             updateAdaptiveFundamentalValue(noteNumber);
+            retuned = true;
         }
     }
     else if (type == Adaptive_Anchored)
@@ -594,13 +626,18 @@ void TuningState::keyPressed(int noteNumber)
                 getGlobalTuningReference()
             );
             updateAdaptiveFundamentalValue(noteNumber);
+            retuned = true;
         }
     }
     else if (type == Spring_Tuning)
     {
         springTuner->addNote(noteNumber);
+        retuned = true;
     }
 
+    if (retuned)
+        invalidateFrequencyTable();
+
     /*
      * reset cluster timer with each new note
      */
@@ -622,6 +659,7 @@ void TuningState::keyReleased(int noteNumber)
     TuningType type = getTuningType();
     if (type == Spring_Tuning) {
         springTuner->removeNote(noteNumber);
+        invalidateFrequencyTable();
     }
 
     /*
@@ -688,6 +726,7 @@ void TuningState::adaptiveReset()
     updateAdaptiveFundamentalValue(intFromPitchClass(adaptiveParams.tAdaptiveAnchorFundamental->get()));
     adaptiveFundamentalFreq = mtof(adaptiveFundamentalNote, getGlobalTuningReference());
     adaptiveHistoryCounter = 0;
+    invalidateFrequencyTable();
 }
 
 void TuningState::initializeSpiralNotes()
@@ -732,6 +771,7 @@ void TuningState::setScalaScaleFromString(std::string s)
         currentScalaScale = Tunings::parseSCLData (s);
         currentScalaTuning = Tunings::Tuning (currentScalaScale, currentKBM, true).withSkippedNotesInterpolated();
         currentScalaString = currentScalaTuning.scale.rawText;
+        invalidateFrequencyTable();
         //DBG ("Scala scale set from string: " << currentScalaString);
     }
     catch (const Tunings::TuningError& t)
@@ -750,6 +790,7 @@ void TuningState::setKBMFromString(std::string s)
         currentKBM = Tunings::parseKBMData (s);
         currentScalaTuning = Tunings::Tuning (currentScalaScale, currentKBM, true).withSkippedNotesInterpolated();
         currentKBMString = currentScalaTuning.keyboardMapping.rawText;
+        invalidateFrequencyTable();
         //DBG ("KBM set from string: " << currentKBMString);
     }
     catch (const Tunings::TuningError& t)
@@ -1087,6 +1128,8 @@ void TuningProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 
     gain.prepare (spec);
     gain.setRampDurationSeconds (0.05);
+
+    state.params.tuningState.springTuner->prepareToPlay (sampleRate);
 }
 
 void TuningProcessor::noteOn (int midiChannel,int midiNoteNumber,float velocity)
@@ -1143,6 +1186,20 @@ void TuningProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
     state.params.tuningState.processStateChanges();
     state.getParameterListeners().callAudioThreadBroadcasters();
 
+    /*
+     * attached synths recompute each note's frequency the first time they need it after a change
+     *      - an MTS-ESP master can retune at any time, so that table never stays valid between blocks
+     */
+    auto& tuningState = state.params.tuningState;
+    if (tuningState.updateFrequencyTableInputs() || tuningState.getTuningType() == TuningType::MTS_Client)
+    {
+        tuningState.invalidateFrequencyTable();
+
+        // keep the spiral display up with retunings that don't come from key presses
+        if (tuningState.getTuningType() != TuningType::Adaptive && tuningState.getTuningType() != TuningType::Adaptive_Anchored)
+            tuningState.updateSpiralNotes();
+    }
+
     /*
      * increment timer for tuningType tuning cluster measurements.
      *      - will get reset elsewhere
@@ -1153,27 +1210,36 @@ void TuningProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
      * iterate through each Midi message
      *      - I don't think we need all the timing stuff that's in BKSynth
      *          so leaving it out for now
+     *      - but spring tuning is stepped up to each message's sample position first, so
+     *          the springs move the same way whatever the block size
      */
-    auto midiIterator = midiMessages.findNextSamplePosition (0);
-    std::for_each(midiIterator,midiMessages.cend(),
-        [&] (const juce::MidiMessageMetadata& meta)
+    auto& springTuner = *state.params.tuningState.springTuner;
+    const bool springTuning = state.params.tuningState.tuningType->get() == TuningType::Spring_Tuning;
+    bool springsMoved = false;
+    int samplePosition = 0;
+
+    for (const auto meta : midiMessages)
+    {
+        if (springTuning)
         {
-            handleMidiEvent (meta.getMessage());
-        });
+            springsMoved |= springTuner.advance (meta.samplePosition - samplePosition);
+            samplePosition = meta.samplePosition;
+        }
 
-    /*
-     * start/stop spring tuning if necessary
-     */
-    if (state.params.tuningState.tuningType->get() == TuningType::Spring_Tuning)
+        handleMidiEvent (meta.getMessage());
+    }
+
+    if (springTuning)
     {
-        if (!state.params.tuningState.springTuner->isTimerRunning())
-            state.params.tuningState.springTuner->rateChanged();
+        springsMoved |= springTuner.advance (buffer.getNumSamples() - samplePosition);
+
+        // synths that haven't rendered this block yet should pick up where the springs are now
+        if (springsMoved)
+            state.params.tuningState.invalidateFrequencyTable();
 
         //update spiral here as well
         state.params.tuningState.updateSpiralNotes();
     }
-    else if (state.params.tuningState.springTuner->isTimerRunning())
-        state.params.tuningState.springTuner->stopTimer();
 
     // if (state.params.tuningState.tuningType->get() == TuningType::Adaptive || state.params.tuningState.tuningType->get() == TuningType::Adaptive_Anchored)
     //     state.params.tuningState.updateSpiralNotes();
@@ -1181,8 +1247,10 @@ void TuningProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
 
 void TuningProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    if (state.params.tuningState.tuningType->get() == TuningType::Spring_Tuning && state.params.tuningState.springTuner->isTimerRunning())
-        state.params.tuningState.springTuner->stop();
+    // spring tuning isn't advanced while bypassed, so it stays where it was
+    auto& tuningState = state.params.tuningState;
+    if (tuningState.updateFrequencyTableInputs() || tuningState.getTuningType() == TuningType::MTS_Client)
+        tuningState.invalidateFrequencyTable();
 }
 
 
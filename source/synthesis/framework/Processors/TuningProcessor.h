@@ -58,10 +58,39 @@ struct TuningState : bitklavier::StateChangeableParameter
     double getSemitoneWidth();
     double getSemitoneWidthOffsetForMidiNote(double midiNoteNumber);
     int getClosestKey(int noteNum, float transp, bool tuneTranspositions);
+    int getClosestKey(int noteNum, float transp, bool tuneTranspositions, double targetFrequency);
 
     double getOverallOffset();
     double getTargetFrequency (int currentlyPlayingNote, double currentTransposition, bool tuneTranspositions);
 
+    double computeTargetFrequency (int currentlyPlayingNote, double currentTransposition, bool tuneTranspositions);
+
+    /**
+     * Same result as getTargetFrequency(), but the untransposed frequency of each note is worked out
+     * at most once per tuning change (see frequencyTable) and shared by every voice playing that note,
+     * so the spring lookup / MTS-ESP query / mtof cost doesn't grow with the number of voices.
+     *
+     * Transpositions are applied as a ratio on top, except for Static and Scala tunings, where a
+     * transposition can change which note gets tuned; those go straight to computeTargetFrequency().
+     * Never writes spiralNotes, so voices can call it from render worker threads.
+     */
+    double getCachedTargetFrequency (int currentlyPlayingNote, double currentTransposition, bool tuneTranspositions);
+
+    /**
+     * Marks every frequencyTable entry stale. Called whenever the tuning actually changes: adaptive
+     * and spring key presses/releases, spring steps, resets, A4 and scala changes, and by
+     * TuningProcessor when updateFrequencyTableInputs() sees a parameter change (or every block
+     * for an MTS-ESP client, whose master can retune at any time).
+     */
+    void invalidateFrequencyTable() noexcept { frequencyTableGeneration.fetch_add (1, std::memory_order_release); }
+    bool updateFrequencyTableInputs();
+
+    /**
+     * Changes whenever invalidateFrequencyTable() is called, so anything else derived from this
+     * tuning's note frequencies (e.g. Resonance's partial table) can tell when to work them out again.
+     */
+    juce::uint32 getFrequencyTableGeneration() const noexcept { return frequencyTableGeneration.load (std::memory_order_acquire); }
+
     /**
      * Whether this tuning type changes continuously (Spring/Adaptive) and so must
      * be republished to MTS-ESP on a timer, vs. static types (Static/Scala) that
@@ -80,7 +109,7 @@ struct TuningState : bitklavier::StateChangeableParameter
      * the active tuning type, using the current global A4 reference.
      *
      * SIDE-EFFECT FREE: unlike getTargetFrequency(), this does NOT write
-     * lastFrequencyTarget / spiralNotes / adaptive state, so it is safe to call
+     * spiralNotes / adaptive state, so it is safe to call
      * from the message thread (e.g. the MTS-ESP publish timer) while the audio
      * thread calls getTargetFrequency(). It only reads atomic offset arrays,
      * parameters, the (lock-protected) spring tuner, and the scala tables — all
@@ -191,7 +220,7 @@ struct TuningState : bitklavier::StateChangeableParameter
     void adaptiveReset();
     void updateAdaptiveFundamentalValue(int newFund);
 
-    void setGlobalTuningReference(float newA4freq) { A4frequency = newA4freq; DBG("TuningState::setGlobalTuningReference"); };
+    void setGlobalTuningReference(float newA4freq) { A4frequency = newA4freq; invalidateFrequencyTable(); DBG("TuningState::setGlobalTuningReference"); };
     float getGlobalTuningReference() const { return A4frequency; };
     TuningType getTuningType() const { return tuningType->get(); }
 
@@ -230,9 +259,20 @@ struct TuningState : bitklavier::StateChangeableParameter
     float adaptiveFundamentalFreq = mtof(adaptiveFundamentalNote, getGlobalTuningReference());
     int adaptiveHistoryCounter = 0;
     float clusterTimeMS = 0.;
-    double lastFrequencyTarget = 440.;
     //std::atomic<bool> setFromAudioThread;
 
+    /*
+     * per-block note frequencies for getCachedTargetFrequency(); an entry is current when its stamp
+     * matches frequencyTableGeneration. Atomics because a synth's voices may render on worker threads.
+     */
+    std::array<std::atomic<double>, 128> frequencyTable {};
+    std::array<std::atomic<juce::uint32>, 128> frequencyTableStamp {};
+    std::atomic<juce::uint32> frequencyTableGeneration { 1 };
+
+    // type, system, fundamental, offset, 3 semitone width, 2 adaptive, then the 128 + 12 + 12 offsets
+    static constexpr size_t numFrequencyTableInputs = 9 + 128 + 12 + 12;
+    std::array<float, numFrequencyTableInputs> lastFrequencyTableInputs {};
+
 };
 
 struct TuningParams : chowdsp::ParamHolder
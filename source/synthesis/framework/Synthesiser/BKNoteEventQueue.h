@@ -0,0 +1,99 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Fixed-capacity buffer for the notes a preparation generates for its synth each block.
+//
+
+#ifndef BITKLAVIER2_BKNOTEEVENTQUEUE_H
+#define BITKLAVIER2_BKNOTEEVENTQUEUE_H
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    The MIDI a preparation (Synchronic, Nostalgic, Resonance...) generates during a block and
+    hands to its BKSynthesiser, kept in a juce::MidiBuffer whose storage is reserved up front.
+
+    reset() empties it without giving the storage back, and add() refuses events once the
+    queue holds its capacity, so filling it never allocates on the audio thread however many
+    notes a block generates. Refused events are dropped and counted; the counters, along with
+    the most events any block has needed, can be read from any thread to size the capacity.
+    The first drop is also logged (DBG) with the capacity and peak.
+
+    Only short messages (3 bytes or fewer) are accepted, which covers every note and
+    controller event the preparations generate. It's not meant for host MIDI, which can
+    carry SysEx and other long messages.
+*/
+class BKNoteEventQueue
+{
+public:
+    static constexpr int kDefaultCapacity = 1024;
+
+    explicit BKNoteEventQueue (int maxEvents = kDefaultCapacity) { setCapacity (maxEvents); }
+
+    /** Not for the audio thread: reserves room for maxEvents, empties the queue and clears the counters. */
+    void setCapacity (int maxEvents)
+    {
+        capacity = juce::jmax (1, maxEvents);
+        events.clear();
+        events.ensureSize ((size_t) capacity * kBytesPerEvent);
+        numEvents = 0;
+        numDropped = 0;
+        peakEvents = 0;
+    }
+
+    /** Audio thread. Empties the queue, keeping its storage. */
+    void reset() noexcept
+    {
+        events.clear();
+        numEvents = 0;
+    }
+
+    /** Audio thread. Adds message at samplePosition, or drops it (and returns false) if the queue is full. */
+    bool add (const juce::MidiMessage& message, int samplePosition) noexcept
+    {
+        if (numEvents >= capacity || message.getRawDataSize() > kMaxMessageBytes)
+        {
+            // only the first time, so a stuck preparation doesn't flood the log every block
+            if (numDropped.fetch_add (1, std::memory_order_relaxed) == 0)
+                DBG ("BKNoteEventQueue: dropping events; capacity " + juce::String (capacity)
+                     + ", peak " + juce::String (peakEvents.load (std::memory_order_relaxed))
+                     + ", message bytes " + juce::String (message.getRawDataSize()));
+            return false;
+        }
+
+        events.addEvent (message, samplePosition);
+        if (++numEvents > peakEvents.load (std::memory_order_relaxed))
+            peakEvents.store (numEvents, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    const juce::MidiBuffer& getEvents() const noexcept { return events; }
+    int size() const noexcept { return numEvents; }
+    int getCapacity() const noexcept { return capacity; }
+
+    /** Events dropped because the queue was full, since setCapacity(). */
+    juce::uint32 getNumDropped() const noexcept { return numDropped.load (std::memory_order_relaxed); }
+
+    /** The most events the queue has held at once, since setCapacity(). */
+    int getPeakSize() const noexcept { return peakEvents.load (std::memory_order_relaxed); }
+
+private:
+    // MidiBuffer stores each event as its sample position, its size and its bytes
+    static constexpr int kMaxMessageBytes = 3;
+    static constexpr size_t kBytesPerEvent = sizeof (juce::int32) + sizeof (juce::uint16) + kMaxMessageBytes;
+
+    juce::MidiBuffer events;
+    int capacity = 0;
+    int numEvents = 0;
+
+    std::atomic<juce::uint32> numDropped { 0 };
+    std::atomic<int> peakEvents { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BKNoteEventQueue)
+};
+
+#endif //BITKLAVIER2_BKNOTEEVENTQUEUE_H
@@ -0,0 +1,129 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+/**
+    Hands a state object that was built on the message thread to the audio thread without
+    either side ever waiting for the other.
+
+    The message thread publish()es a fully built T. At the start of a block the audio thread
+    calls adopt(), which swaps the published state into its own members; whatever it swapped
+    out is left in the same object, which is then queued up for the message thread to delete
+    the next time it calls collectGarbage() (publish() does this too). Publishing again before
+    the audio thread has adopted simply replaces (and deletes) the unadopted state.
+
+    A swapped-out state that's still being used after the swap (T has a
+    `bool isStillInUse() const` that returns true) is kept until a later collectGarbage()
+    finds it no longer is.
+
+    Single publisher (message thread), single adopter (audio thread).
+*/
+template <typename T>
+class BKRealtimeExchange
+{
+public:
+    BKRealtimeExchange() = default;
+
+    ~BKRealtimeExchange()
+    {
+        delete pending.exchange (nullptr);
+        takeRetired();
+
+        while (held != nullptr)
+            delete std::exchange (held, held->next);
+    }
+
+    /** Message thread. */
+    void publish (std::unique_ptr<T> next)
+    {
+        jassert (next != nullptr);
+        delete pending.exchange (new Node { std::move (next) }, std::memory_order_acq_rel);
+        collectGarbage();
+    }
+
+    /** Message thread. Deletes the states the audio thread has swapped out so far, apart from
+        any still in use. */
+    void collectGarbage()
+    {
+        takeRetired();
+
+        for (auto** link = &held; *link != nullptr;)
+        {
+            auto* node = *link;
+            if (isStillInUse (*node->value))
+            {
+                link = &node->next;
+                continue;
+            }
+
+            *link = node->next;
+            delete node;
+        }
+    }
+
+    /** Message thread. True while swapped-out states are waiting for collectGarbage(). */
+    bool hasGarbage() const noexcept { return held != nullptr || retired.load (std::memory_order_acquire) != nullptr; }
+
+    /** Any thread. True if something has been published that the audio thread hasn't adopted yet. */
+    bool hasPending() const noexcept { return pending.load (std::memory_order_acquire) != nullptr; }
+
+    /** Audio thread. If there is a published state, calls swapIn (T&) with it and returns true.
+
+        swapIn should swap (not copy) the published state into the caller's members, so the old
+        state ends up in the T and gets deleted later on the message thread.
+    */
+    template <typename Fn>
+    bool adopt (Fn&& swapIn) noexcept
+    {
+        auto* node = pending.exchange (nullptr, std::memory_order_acq_rel);
+        if (node == nullptr)
+            return false;
+
+        swapIn (*node->value);
+
+        node->next = retired.load (std::memory_order_relaxed);
+        while (! retired.compare_exchange_weak (node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::unique_ptr<T> value;
+        Node* next = nullptr;
+    };
+
+    static bool isStillInUse (const T& value)
+    {
+        if constexpr (requires { value.isStillInUse(); })
+            return value.isStillInUse();
+        else
+            return false;
+    }
+
+    // moves what the audio thread has swapped out onto the held list
+    void takeRetired()
+    {
+        auto* node = retired.exchange (nullptr, std::memory_order_acquire);
+        while (node != nullptr)
+        {
+            auto* next = std::exchange (node->next, held);
+            held = node;
+            node = next;
+        }
+    }
+
+    std::atomic<Node*> pending { nullptr };
+    std::atomic<Node*> retired { nullptr };
+    Node* held = nullptr; // message thread only
+
+    JUCE_DECLARE_NON_COPYABLE (BKRealtimeExchange)
+};
@@ -0,0 +1,257 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "BKRenderWorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    // how long to busy-wait before sleeping; roughly tens of microseconds
+    constexpr int kSpinIterations = 2048;
+
+    constexpr juce::uint64 makeTicket (juce::uint32 generation, int numTasks) noexcept
+    {
+        return ((juce::uint64) generation << 32) | (juce::uint64) numTasks;
+    }
+}
+
+void BKRenderWorkerPool::cpuRelax() noexcept
+{
+   #if JUCE_INTEL
+    _mm_pause();
+   #elif JUCE_ARM && (JUCE_CLANG || JUCE_GCC)
+    __asm__ __volatile__ ("yield");
+   #endif
+}
+
+//==============================================================================
+class BKRenderWorkerPool::WorkerThread final : private juce::Thread
+{
+public:
+    WorkerThread (BKRenderWorkerPool& p, int index) : juce::Thread ("BKRenderWorker" + juce::String (index)), pool (p) {}
+
+    ~WorkerThread() override
+    {
+        // the pool has already set shouldExit and woken everyone up
+        stopThread (-1);
+    }
+
+    void start (bool realtime, int samplesPerBlock, double sampleRate)
+    {
+        if (realtime
+            && startRealtimeThread (juce::Thread::RealtimeOptions {}.withApproximateAudioProcessingTime (samplesPerBlock, sampleRate)))
+            return;
+
+        // no real-time permission (e.g. Linux without rtprio), or not asked for
+        startThread (juce::Thread::Priority::highest);
+    }
+
+    using juce::Thread::signalThreadShouldExit;
+
+private:
+    void run() override
+    {
+        juce::WorkgroupToken token;
+        if (pool.audioWorkgroup)
+            pool.audioWorkgroup.join (token);
+
+        auto lastSeen = pool.generation.load (std::memory_order_acquire);
+
+        while (! threadShouldExit())
+        {
+            lastSeen = pool.waitForNextJob (lastSeen);
+
+            if (pool.shouldExit.load (std::memory_order_acquire))
+                break;
+
+            pool.runTasks (lastSeen);
+        }
+    }
+
+    BKRenderWorkerPool& pool;
+};
+
+//==============================================================================
+BKRenderWorkerPool::BKRenderWorkerPool() : numThreadsToUse (getDefaultNumThreads())
+{
+}
+
+BKRenderWorkerPool::~BKRenderWorkerPool()
+{
+    stopThreads();
+}
+
+int BKRenderWorkerPool::getDefaultNumThreads()
+{
+    return juce::jlimit (0, 7, juce::SystemStats::getNumPhysicalCpus() - 1);
+}
+
+void BKRenderWorkerPool::setNumThreads (int numThreads)
+{
+    numThreads = juce::jmax (0, numThreads);
+    if (numThreads == numThreadsToUse)
+        return;
+
+    numThreadsToUse = numThreads;
+    if (preparedBlockSize > 0)
+        startThreads();
+}
+
+void BKRenderWorkerPool::setUseRealtimePriority (bool shouldUseRealtimePriority)
+{
+    if (shouldUseRealtimePriority == useRealtimePriority)
+        return;
+
+    useRealtimePriority = shouldUseRealtimePriority;
+    if (preparedBlockSize > 0)
+        startThreads();
+}
+
+void BKRenderWorkerPool::setAudioWorkgroup (juce::AudioWorkgroup workgroup)
+{
+    if (workgroup == audioWorkgroup)
+        return;
+
+    audioWorkgroup = workgroup;
+    if (preparedBlockSize > 0)
+        startThreads();
+}
+
+void BKRenderWorkerPool::prepare (int samplesPerBlock, double sampleRate)
+{
+    if (samplesPerBlock == preparedBlockSize && juce::approximatelyEqual (sampleRate, preparedSampleRate)
+        && (int) workers.size() == numThreadsToUse)
+        return;
+
+    preparedBlockSize = samplesPerBlock;
+    preparedSampleRate = sampleRate;
+    startThreads();
+}
+
+void BKRenderWorkerPool::stop()
+{
+    stopThreads();
+    preparedBlockSize = 0;
+}
+
+void BKRenderWorkerPool::startThreads()
+{
+    stopThreads();
+
+    for (int i = 0; i < numThreadsToUse; ++i)
+    {
+        workers.push_back (std::make_unique<WorkerThread> (*this, i));
+        workers.back()->start (useRealtimePriority, preparedBlockSize, preparedSampleRate);
+    }
+
+    numRunningWorkers.store ((int) workers.size(), std::memory_order_release);
+}
+
+void BKRenderWorkerPool::stopThreads()
+{
+    if (workers.empty())
+        return;
+
+    // wait for any job in flight, and keep the audio thread on the serial path meanwhile
+    while (busy.test_and_set (std::memory_order_acquire))
+        juce::Thread::yield();
+
+    numRunningWorkers.store (0, std::memory_order_release);
+
+    for (auto& w : workers)
+        w->signalThreadShouldExit();
+
+    shouldExit.store (true, std::memory_order_release);
+    generation.fetch_add (1, std::memory_order_acq_rel);
+    generation.notify_all();
+
+    workers.clear();
+
+    shouldExit.store (false, std::memory_order_release);
+    busy.clear (std::memory_order_release);
+}
+
+//==============================================================================
+void BKRenderWorkerPool::run (int numTasks, TaskFunction function, void* context) noexcept
+{
+    jassert (numTasks <= maxTasksPerJob);
+
+    const bool useWorkers = numTasks > 1
+                            && numTasks <= maxTasksPerJob
+                            && numRunningWorkers.load (std::memory_order_acquire) > 0
+                            && ! busy.test_and_set (std::memory_order_acquire);
+
+    if (! useWorkers)
+    {
+        for (int i = 0; i < numTasks; ++i)
+            function (context, i);
+        return;
+    }
+
+    jobFunction = function;
+    jobContext = context;
+    tasksRemaining.store (numTasks, std::memory_order_relaxed);
+
+    const auto jobGeneration = generation.load (std::memory_order_relaxed) + 1;
+    ticket.store (makeTicket (jobGeneration, numTasks), std::memory_order_release);
+    generation.store (jobGeneration, std::memory_order_release);
+    generation.notify_all();
+
+    // the calling thread works too, rather than just waiting
+    runTasks (jobGeneration);
+
+    for (int spin = 0; spin < kSpinIterations && tasksRemaining.load (std::memory_order_acquire) != 0; ++spin)
+        cpuRelax();
+
+    for (auto remaining = tasksRemaining.load (std::memory_order_acquire); remaining != 0;
+         remaining = tasksRemaining.load (std::memory_order_acquire))
+        tasksRemaining.wait (remaining, std::memory_order_acquire);
+
+    busy.clear (std::memory_order_release);
+}
+
+void BKRenderWorkerPool::runTasks (juce::uint32 jobGeneration) noexcept
+{
+    auto t = ticket.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        if ((juce::uint32) (t >> 32) != jobGeneration)
+            return;
+
+        const auto taskIndex = (int) ((t >> 16) & 0xffff);
+        const auto numTasks = (int) (t & 0xffff);
+
+        if (taskIndex >= numTasks)
+            return;
+
+        if (! ticket.compare_exchange_weak (t, t + (1u << 16), std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        // claiming a task keeps the job (and so jobFunction/jobContext) alive until we finish it
+        jobFunction (jobContext, taskIndex);
+
+        if (tasksRemaining.fetch_sub (1, std::memory_order_acq_rel) == 1)
+            tasksRemaining.notify_one();
+
+        t = ticket.load (std::memory_order_acquire);
+    }
+}
+
+juce::uint32 BKRenderWorkerPool::waitForNextJob (juce::uint32 lastSeen) const noexcept
+{
+    for (int spin = 0; spin < kSpinIterations; ++spin)
+    {
+        const auto g = generation.load (std::memory_order_acquire);
+        if (g != lastSeen)
+            return g;
+
+        cpuRelax();
+    }
+
+    generation.wait (lastSeen, std::memory_order_acquire);
+    return generation.load (std::memory_order_acquire);
+}
@@ -0,0 +1,112 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Real-time worker threads for rendering synthesiser voices in parallel.
+//
+
+#ifndef BITKLAVIER2_BKRENDERWORKERPOOL_H
+#define BITKLAVIER2_BKRENDERWORKERPOOL_H
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+/**
+    A small set of worker threads that the audio thread can hand a batch of tasks to.
+
+    The audio thread publishes a job with run() (or parallelFor()), works on tasks itself
+    alongside the workers, and returns once every task has finished. Nothing on that path
+    takes a lock or allocates: tasks are claimed from a single atomic ticket, and both the
+    workers and the caller spin briefly before falling back to a futex-style wait
+    (std::atomic::wait) when there is nothing to do.
+
+    One pool is shared by the whole engine. If it is already busy with another caller's job,
+    run() just executes the tasks on the calling thread, so callers must not rely on which
+    thread runs a task, only that all of them have run when it returns.
+
+    Configuration (thread count, real-time priority, audio workgroup) is done from the
+    message thread, typically in prepareToPlay.
+*/
+class BKRenderWorkerPool
+{
+public:
+    using TaskFunction = void (*) (void* context, int taskIndex);
+
+    BKRenderWorkerPool();
+    ~BKRenderWorkerPool();
+
+    /** Physical cores minus the one the audio thread runs on, up to 7. */
+    static int getDefaultNumThreads();
+
+    /** Sets how many worker threads to run; 0 makes run() entirely serial. Restarts the threads if running. */
+    void setNumThreads (int numThreads);
+    int getNumThreads() const noexcept { return numThreadsToUse; }
+
+    /** Whether to ask for real-time scheduling (SCHED_RR on Linux, which needs rtprio permission;
+        we fall back to the highest normal priority if it's refused). Restarts the threads if running. */
+    void setUseRealtimePriority (bool shouldUseRealtimePriority);
+
+    /** Workers join this workgroup when they start (Apple platforms; ignored elsewhere). */
+    void setAudioWorkgroup (juce::AudioWorkgroup workgroup);
+
+    /** Starts (or restarts, if anything changed) the worker threads. */
+    void prepare (int samplesPerBlock, double sampleRate);
+
+    /** Stops the worker threads. Safe to call when not running. */
+    void stop();
+
+    /** Calls function (context, i) for every i in [0, numTasks), and returns when all are done. */
+    void run (int numTasks, TaskFunction function, void* context) noexcept;
+
+    template <typename Callable>
+    void parallelFor (int numTasks, Callable& callable) noexcept
+    {
+        run (numTasks, [] (void* context, int taskIndex) { (*static_cast<Callable*> (context)) (taskIndex); }, &callable);
+    }
+
+    /** The most tasks a single job can have. */
+    static constexpr int maxTasksPerJob = 0xffff;
+
+    /** A CPU pause/yield hint for tasks that busy-wait on each other inside a job. */
+    static void cpuRelax() noexcept;
+
+private:
+    class WorkerThread;
+
+    void startThreads();
+    void stopThreads();
+
+    /** Claims and runs tasks from the job with this generation until there are none left. */
+    void runTasks (juce::uint32 jobGeneration) noexcept;
+
+    /** Spins, then sleeps, until the job generation is no longer lastSeen. */
+    juce::uint32 waitForNextJob (juce::uint32 lastSeen) const noexcept;
+
+    std::vector<std::unique_ptr<WorkerThread>> workers;
+
+    int numThreadsToUse;
+    bool useRealtimePriority = true;
+    juce::AudioWorkgroup audioWorkgroup;
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.;
+
+    // the current job; written by the caller before the ticket is published
+    TaskFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+
+    // [ generation : 32 | next task index : 16 | number of tasks : 16 ]
+    std::atomic<juce::uint64> ticket { 0 };
+    std::atomic<juce::uint32> generation { 0 };
+    std::atomic<int> tasksRemaining { 0 };
+
+    std::atomic<int> numRunningWorkers { 0 };
+    std::atomic<bool> shouldExit { false };
+    std::atomic_flag busy = ATOMIC_FLAG_INIT;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BKRenderWorkerPool)
+};
+
+#endif //BITKLAVIER2_BKRENDERWORKERPOOL_H
@@ -0,0 +1,237 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "BKSampleStreamer.h"
+
+namespace
+{
+    // zeroed frames read past the end of the sample, so interpolation at the last frame has a neighbour
+    constexpr juce::int64 kPadding = 4;
+}
+
+BKSampleStreamer::BKSampleStreamer (int numSlots, int framesPerSlotToUse, int maxOpenReadersToUse)
+    : juce::Thread ("bK sample streamer"),
+      framesPerSlot ((juce::int64) juce::nextPowerOfTwo (juce::jmax (2 * kChunkFrames, framesPerSlotToUse))),
+      maxOpenReaders ((size_t) juce::jmax (1, maxOpenReadersToUse))
+{
+    openReaders.reserve (maxOpenReaders);
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto* slot = slots.add (new Slot());
+        slot->left.calloc ((size_t) framesPerSlot);
+        slot->right.calloc ((size_t) framesPerSlot);
+        slot->mask = framesPerSlot - 1;
+    }
+
+    startThread (juce::Thread::Priority::high);
+}
+
+BKSampleStreamer::~BKSampleStreamer()
+{
+    stopThread (-1);
+}
+
+BKSampleStreamer::Slot* BKSampleStreamer::acquire (Source& source, double position, bool forward) noexcept
+{
+    // voices in different synths can start notes on different threads
+    for (auto* slot : slots)
+    {
+        int expected = Slot::idle;
+        if (! slot->state.compare_exchange_strong (expected, Slot::claiming, std::memory_order_acquire))
+            continue;
+
+        slot->source.store (&source, std::memory_order_relaxed);
+        slot->setPosition (position, forward);
+        slot->underruns.store (0, std::memory_order_relaxed);
+        slot->readLo.store (0, std::memory_order_relaxed);
+        slot->readHi.store (0, std::memory_order_relaxed);
+        slot->state.store (Slot::requested, std::memory_order_release);
+        return slot;
+    }
+
+    return nullptr;
+}
+
+void BKSampleStreamer::detach (Source& source)
+{
+    const juce::ScopedLock sl (sourceLock);
+    for (auto* slot : slots)
+    {
+        auto* expected = &source;
+        slot->source.compare_exchange_strong (expected, nullptr);
+    }
+
+    std::erase_if (openReaders, [&] (const OpenReader& open) { return open.source == &source; });
+}
+
+int BKSampleStreamer::getNumActiveSlots() const noexcept
+{
+    int n = 0;
+    for (auto* slot : slots)
+        n += slot->state.load (std::memory_order_relaxed) != Slot::idle ? 1 : 0;
+    return n;
+}
+
+juce::uint32 BKSampleStreamer::getNumUnderruns() const noexcept
+{
+    juce::uint32 n = 0;
+    for (auto* slot : slots)
+        n += slot->underruns.load (std::memory_order_relaxed);
+    return n;
+}
+
+int BKSampleStreamer::getNumOpenReaders() const
+{
+    const juce::ScopedLock sl (sourceLock);
+    return (int) std::count_if (openReaders.begin(), openReaders.end(), [] (const OpenReader& open) { return open.reader != nullptr; });
+}
+
+juce::AudioFormatReader* BKSampleStreamer::getReader (Source& source)
+{
+    ++readerClock;
+
+    for (auto& open : openReaders)
+    {
+        if (open.source == &source)
+        {
+            open.lastUsed = readerClock;
+            return open.reader.get();
+        }
+    }
+
+    // close the least recently used file to make room; it's opened again if its voice still wants it
+    if (openReaders.size() >= maxOpenReaders)
+    {
+        auto oldest = std::min_element (openReaders.begin(), openReaders.end(),
+            [] (const OpenReader& a, const OpenReader& b) { return a.lastUsed < b.lastUsed; });
+        openReaders.erase (oldest);
+    }
+
+    // a file that won't open is remembered too, so it isn't retried on every pass
+    openReaders.push_back ({ &source, source.createStreamReader(), readerClock });
+    return openReaders.back().reader.get();
+}
+
+void BKSampleStreamer::run()
+{
+    while (! threadShouldExit())
+    {
+        // one chunk per slot per pass, so a voice far behind can't starve the others
+        bool didWork = false;
+        for (auto* slot : slots)
+            didWork |= service (*slot);
+
+        if (! didWork)
+            wait (1);
+    }
+}
+
+bool BKSampleStreamer::service (Slot& slot)
+{
+    const auto state = slot.state.load (std::memory_order_acquire);
+
+    if (state == Slot::releasing)
+    {
+        {
+            const juce::ScopedLock sl (sourceLock);
+            slot.source.store (nullptr, std::memory_order_relaxed);
+        }
+        slot.state.store (Slot::idle, std::memory_order_release);
+        return false;
+    }
+
+    if (state != Slot::requested && state != Slot::streaming)
+        return false;
+
+    const juce::ScopedLock sl (sourceLock);
+    auto* source = slot.source.load (std::memory_order_relaxed);
+    if (source == nullptr)
+        return false;
+
+    const auto headLength = (juce::int64) source->getResidentLength();
+    const auto end = juce::jmax (headLength, source->getStreamLength() + kPadding);
+    const auto position = slot.anchor.load (std::memory_order_acquire);
+    const bool forward = slot.playingForward.load (std::memory_order_relaxed);
+
+    // the frames the voice will want next, clipped to the part of the sample that isn't resident
+    constexpr juce::int64 margin = kMarginFrames;
+    const auto windowLo = juce::jlimit (headLength, end, forward ? position - margin : position + margin - framesPerSlot);
+    const auto windowHi = juce::jlimit (headLength, end, forward ? position - margin + framesPerSlot : position + margin);
+
+    auto lo = slot.lo.load (std::memory_order_relaxed);
+    auto hi = slot.hi.load (std::memory_order_relaxed);
+
+    // new note, or the voice has jumped somewhere we can't extend what we have to; the frames the
+    // voice holds for this block stay in the ring until it moves on (see canWrite())
+    const auto edge = forward ? windowLo : windowHi;
+    if (state == Slot::requested || edge < lo || edge > hi)
+    {
+        lo = hi = forward ? windowLo : windowHi;
+        slot.lo.store (lo);
+        slot.hi.store (hi);
+
+        int expected = Slot::requested;
+        slot.state.compare_exchange_strong (expected, Slot::streaming, std::memory_order_release);
+    }
+
+    auto readInto = [&] (juce::AudioFormatReader& reader, juce::int64 start, juce::int64 numFrames)
+    {
+        const auto offset = start & slot.mask;
+        const auto first = juce::jmin (numFrames, framesPerSlot - offset);
+        source->readStreamed (reader, start, (int) first, slot.left + offset, slot.right + offset);
+        if (numFrames > first)
+            source->readStreamed (reader, start + first, (int) (numFrames - first), slot.left.get(), slot.right.get());
+    };
+
+    if (forward && hi < windowHi)
+    {
+        const auto n = juce::jmin ((juce::int64) kChunkFrames, windowHi - hi);
+
+        // the frames about to be overwritten leave the valid range first
+        if (hi + n - lo > framesPerSlot)
+            slot.lo.store (hi + n - framesPerSlot);
+
+        if (! canWrite (slot, hi, hi + n))
+            return false;
+
+        auto* reader = getReader (*source);
+        if (reader == nullptr)
+            return false;
+
+        readInto (*reader, hi, n);
+        slot.hi.store (hi + n, std::memory_order_release);
+        return true;
+    }
+
+    if (! forward && lo > windowLo)
+    {
+        const auto n = juce::jmin ((juce::int64) kChunkFrames, lo - windowLo);
+
+        if (hi - (lo - n) > framesPerSlot)
+            slot.hi.store (lo - n + framesPerSlot);
+
+        if (! canWrite (slot, lo - n, lo))
+            return false;
+
+        auto* reader = getReader (*source);
+        if (reader == nullptr)
+            return false;
+
+        readInto (*reader, lo - n, n);
+        slot.lo.store (lo - n, std::memory_order_release);
+        return true;
+    }
+
+    return false;
+}
+
+bool BKSampleStreamer::canWrite (const Slot& slot, juce::int64 start, juce::int64 end) const noexcept
+{
+    // seq_cst, after dropping the frames from lo/hi: see Slot::getFrames()
+    const auto readLo = slot.readLo.load();
+    const auto readHi = slot.readHi.load();
+
+    // frames less than a ring apart never share an entry
+    return readLo >= readHi || juce::jmax (end, readHi) - juce::jmin (start, readLo) <= framesPerSlot;
+}
@@ -0,0 +1,225 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Background disk streaming for bK format samples that only keep their start in memory.
+//
+
+#ifndef BITKLAVIER2_BKSAMPLESTREAMER_H
+#define BITKLAVIER2_BKSAMPLESTREAMER_H
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    Streams the rest of a sample from disk while a voice plays through its resident head.
+
+    Voices acquire() a Slot when a streamed note starts and give it back with Slot::release().
+    Each slot is a ring buffer of frames, indexed by absolute frame number (frame & mask),
+    holding a window around the voice's play position: ahead of it when playing forward,
+    behind it when playing backward. The voice reports its position at the start of every
+    block; the streamer thread keeps the window filled and re-anchors it if the voice jumps
+    (loop points, direction changes).
+
+    Neither side waits for the other. The streamer publishes the range of valid frames after
+    writing them; a voice asking for frames outside that range gets silence and the slot
+    counts an underrun. At the start of each block the voice takes hold of the valid frames
+    from its position on (back from it, playing backward), and the streamer doesn't overwrite
+    those until the next block, so a loop or direction change inside the block reads either
+    the right frames or silence, never frames streamed in for somewhere else. If every slot is
+    in use, acquire() returns nullptr and the note plays its head only.
+
+    Sources don't keep their files open. The streamer opens a reader for a source when a slot
+    needs frames from it and keeps at most maxOpenReaders open, closing the least recently
+    used, so a soundset with thousands of streamed samples doesn't run out of file handles.
+
+    acquire() and the Slot methods are for the audio thread.
+*/
+class BKSampleStreamer : private juce::Thread
+{
+public:
+    static constexpr int kDefaultNumSlots = 128;
+    static constexpr int kDefaultFramesPerSlot = 1 << 15;
+    static constexpr int kDefaultMaxOpenReaders = 32;
+
+    /** Frames read from disk per step; Source implementations can size their scratch buffers with this. */
+    static constexpr int kChunkFrames = 4096;
+
+    /** Frames kept on the far side of the play position, for interpolation and sub-block jitter. */
+    static constexpr int kMarginFrames = 8;
+
+    /** Something with frames on disk, i.e. a streamed Sample. */
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+
+        /** Frames kept in memory; streaming starts here. */
+        virtual int getResidentLength() const = 0;
+
+        /** Frames in total, resident ones included. */
+        virtual juce::int64 getStreamLength() const = 0;
+
+        /** Streamer thread. Opens the file the streamed frames come from, or returns nullptr if it can't. */
+        virtual std::unique_ptr<juce::AudioFormatReader> createStreamReader() = 0;
+
+        /** Streamer thread. Reads up to kChunkFrames frames from a reader this source created,
+            in the same units as the resident data. */
+        virtual void readStreamed (juce::AudioFormatReader& reader, juce::int64 startFrame, int numFrames, float* left, float* right) = 0;
+    };
+
+    //==============================================================================
+    /** Resident head frames in front, streamed frames after; silence for frames not streamed in yet. */
+    template <typename HeadFrames>
+    struct Frames
+    {
+        HeadFrames head;
+        int headLength;
+        const float* l = nullptr;
+        const float* r = nullptr;
+        juce::int64 mask = 0, lo = 0, hi = 0;
+
+        float left (int i) const noexcept { return i < headLength ? head.left (i) : streamed (l, i); }
+        float right (int i) const noexcept { return i < headLength ? head.right (i) : streamed (r, i); }
+
+    private:
+        float streamed (const float* ring, juce::int64 i) const noexcept { return i >= lo && i < hi ? ring[i & mask] : 0.f; }
+    };
+
+    class Slot
+    {
+    public:
+        /** Audio thread, once per block before reading. */
+        void setPosition (double position, bool forward) noexcept
+        {
+            // release: reads from earlier blocks are finished before the streamer reuses their frames
+            playingForward.store (forward, std::memory_order_relaxed);
+            anchor.store ((juce::int64) position, std::memory_order_release);
+        }
+
+        /** Audio thread, after setPosition(). A view of what's readable for this block, with head
+            in front of it; the frames in it stay put until the next call, wherever the voice jumps to. */
+        template <typename HeadFrames>
+        Frames<HeadFrames> getFrames (const HeadFrames& head, int headLength) noexcept
+        {
+            Frames<HeadFrames> frames { head, headLength };
+            if (state.load (std::memory_order_acquire) != streaming)
+                return frames;
+
+            const auto position = anchor.load (std::memory_order_relaxed);
+            const bool forward = playingForward.load (std::memory_order_relaxed);
+
+            // only the frames ahead of the play position are held, so the streamer can go on
+            // refilling the ones behind it
+            const auto holdLo = forward ? juce::jmax (lo.load(), position - kMarginFrames) : lo.load();
+            const auto holdHi = forward ? hi.load() : juce::jmin (hi.load(), position + kMarginFrames);
+
+            // grow the held range to cover the new one before shrinking it, so the streamer never
+            // sees a range that covers neither this block's frames nor the last one's
+            const auto heldLo = readLo.load (std::memory_order_relaxed);
+            const auto heldHi = readHi.load (std::memory_order_relaxed);
+            readLo.store (heldLo < heldHi ? juce::jmin (heldLo, holdLo) : holdLo);
+            readHi.store (heldLo < heldHi ? juce::jmax (heldHi, holdHi) : holdHi);
+
+            // seq_cst with the streamer, which drops frames from lo/hi and then checks the held
+            // range before overwriting them: either it sees ours, or we see the frames go here
+            frames.lo = juce::jmax (holdLo, lo.load());
+            frames.hi = juce::jmin (holdHi, hi.load());
+            readLo.store (holdLo);
+            readHi.store (holdHi);
+
+            frames.l = left.get();
+            frames.r = right.get();
+            frames.mask = mask;
+
+            if (position >= headLength && (position < frames.lo || position + 1 >= frames.hi))
+                underruns.fetch_add (1, std::memory_order_relaxed);
+
+            return frames;
+        }
+
+        /** Audio thread. Hands the slot back; don't touch it afterwards. */
+        void release() noexcept { state.store (releasing, std::memory_order_release); }
+
+    private:
+        friend class BKSampleStreamer;
+
+        enum State
+        {
+            idle,
+            claiming,   // audio thread is filling in the request
+            requested,  // waiting for the streamer to set up the window
+            streaming,
+            releasing   // waiting for the streamer to let go of the source
+        };
+
+        std::atomic<int> state { idle };
+        std::atomic<Source*> source { nullptr }; // set while claiming, cleared while releasing or by detach()
+
+        std::atomic<juce::int64> anchor { 0 };
+        std::atomic<bool> playingForward { true };
+        std::atomic<juce::int64> lo { 0 }, hi { 0 };
+        std::atomic<juce::int64> readLo { 0 }, readHi { 0 }; // what the voice took for this block; empty if readLo >= readHi
+        std::atomic<juce::uint32> underruns { 0 };
+
+        juce::HeapBlock<float> left, right;
+        juce::int64 mask = 0;
+    };
+
+    //==============================================================================
+    explicit BKSampleStreamer (int numSlots = kDefaultNumSlots,
+                               int framesPerSlot = kDefaultFramesPerSlot,
+                               int maxOpenReaders = kDefaultMaxOpenReaders);
+    ~BKSampleStreamer() override;
+
+    /** Audio thread. Starts streaming source from position, or returns nullptr if all slots are busy. */
+    Slot* acquire (Source& source, double position, bool forward) noexcept;
+
+    /** Stops all streaming from source and closes its reader; called from its destructor, blocks while a read is in progress. */
+    void detach (Source& source);
+
+    int getNumSlots() const noexcept { return slots.size(); }
+    int getNumActiveSlots() const noexcept;
+
+    /** Blocks that needed frames which hadn't been streamed in yet, across all slots. */
+    juce::uint32 getNumUnderruns() const noexcept;
+
+    /** Files the streamer has open right now; never more than maxOpenReaders. */
+    int getNumOpenReaders() const;
+
+private:
+    void run() override;
+
+    /** Returns true if it read anything. */
+    bool service (Slot& slot);
+
+    /** Whether frames [start, end) can go in slot's ring without overwriting any the voice holds. */
+    bool canWrite (const Slot& slot, juce::int64 start, juce::int64 end) const noexcept;
+
+    /** Streamer thread, under sourceLock. source's reader, opened if it isn't already; nullptr if it can't be. */
+    juce::AudioFormatReader* getReader (Source& source);
+
+    juce::OwnedArray<Slot> slots;
+    const juce::int64 framesPerSlot;
+
+    // held by the streamer thread while it touches a Source
+    juce::CriticalSection sourceLock;
+
+    struct OpenReader
+    {
+        Source* source = nullptr;
+        std::unique_ptr<juce::AudioFormatReader> reader; // null if the file couldn't be opened
+        juce::uint32 lastUsed = 0;
+    };
+
+    // guarded by sourceLock
+    std::vector<OpenReader> openReaders;
+    const size_t maxOpenReaders;
+    juce::uint32 readerClock = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BKSampleStreamer)
+};
+
+#endif //BITKLAVIER2_BKSAMPLESTREAMER_H
@@ -7,6 +7,69 @@
 //
 
 #include "BKSynthesiser.h"
+
+//==============================================================================
+void BKSoundLookupTable::clear()
+{
+    cellToSet.fill (0);
+    setStart = { 0, 0 };
+    soundIndices.clear();
+    builtFor = nullptr;
+    builtForNumSounds = -1;
+}
+
+void BKSoundLookupTable::build (juce::ReferenceCountedArray<BKSynthesiserSound>& sounds)
+{
+    clear();
+
+    // which sounds cover each note; velocity is checked per note below,
+    // so this is O(notes * sounds + cells * sounds-per-note)
+    std::array<std::vector<int>, MaxMidiNotes> soundsForNote;
+    for (int i = 0; i < sounds.size(); ++i)
+    {
+        auto* sound = sounds.getObjectPointerUnchecked (i);
+        if (sound == nullptr)
+            continue;
+
+        for (int note = 0; note < MaxMidiNotes; ++note)
+            if (sound->appliesToNote (note))
+                soundsForNote[(size_t) note].push_back (i);
+    }
+
+    std::map<std::vector<int>, uint16_t> setIndices { { {}, 0 } };
+    std::vector<int> cell;
+
+    for (int note = 0; note < MaxMidiNotes; ++note)
+    {
+        for (int velocity = 0; velocity < 128; ++velocity)
+        {
+            cell.clear();
+            for (auto i : soundsForNote[(size_t) note])
+                if (sounds.getObjectPointerUnchecked (i)->appliesToVelocity (velocity))
+                    cell.push_back (i);
+
+            auto [it, isNew] = setIndices.try_emplace (cell, (uint16_t) (setStart.size() - 1));
+            if (isNew)
+            {
+                // too many distinct combinations to index; leave the table invalid so noteOn scans instead
+                if (setStart.size() > std::numeric_limits<uint16_t>::max())
+                {
+                    clear();
+                    return;
+                }
+
+                soundIndices.insert (soundIndices.end(), cell.begin(), cell.end());
+                setStart.push_back ((int) soundIndices.size());
+            }
+
+            cellToSet[(size_t) (note * 128 + velocity)] = it->second;
+        }
+    }
+
+    builtFor = &sounds;
+    builtForNumSounds = sounds.size();
+}
+
 //==============================================================================
 BKSynthesiser::BKSynthesiser (EnvParams& params, chowdsp::GainDBParameter& gain) : adsrParams (params), synthGain (gain)
 {
@@ -27,113 +90,463 @@ BKSynthesiser::BKSynthesiser (EnvParams& params, chowdsp::GainDBParameter& gain)
     activeNotes.reset();
     voices.ensureStorageAllocated (300);
     usableVoicesToStealArray.ensureStorageAllocated (301);
+    retiringVoices.ensureStorageAllocated (kMaxRetiringVoices);
 }
 
 BKSynthesiser::~BKSynthesiser()
 {
+    releaseBorrowedVoices();
     voices.clear();
+    graveyardVoices.clear();
 }
 
 //==============================================================================
 BKSynthesiserVoice* BKSynthesiser::getVoice (const int index) const
 {
-    const juce::ScopedLock sl (lock);
     return voices[index];
 }
 
 void BKSynthesiser::clearVoices()
 {
-    const juce::ScopedLock sl (lock);
+    releaseBorrowedVoices();
+    activeVoices.clearQuick();
     voices.clear();
+    ownedVoices.clear();
 }
 
 BKSynthesiserVoice* BKSynthesiser::addVoice (BKSynthesiserVoice* const newVoice)
 {
-    BKSynthesiserVoice* voice;
-
+    newVoice->setCurrentPlaybackSampleRate (requestedSampleRate.load (std::memory_order_relaxed));
+    if (auto* t = requestedTuning.load (std::memory_order_acquire))
     {
-        const juce::ScopedLock sl (lock);
-        newVoice->setCurrentPlaybackSampleRate (sampleRate);
-        if (tuning != nullptr)
-        {
-            newVoice->setTuning (tuning);
-            DBG ("BKSynthesiser::addVoice: Applied current tuning to new voice.");
-        }
-        voice = voices.add (newVoice);
+        newVoice->setTuning (t);
+        DBG ("BKSynthesiser::addVoice: Applied current tuning to new voice.");
     }
+    newVoice->owner = this;
+    auto* voice = ownedVoices.add (newVoice);
+    voices.add (voice);
+    activeVoices.ensureStorageAllocated (voices.size());
+    usableVoicesToStealArray.ensureStorageAllocated (voices.size() + 1);
+    return voice;
+}
+
+void BKSynthesiser::removeVoice (const int index)
+{
+    auto* voice = voices[index];
+    if (voice == nullptr)
+        return;
+
+    activeVoices.removeFirstMatchingValue (voice);
+    voice->isInActiveList = false;
+
+    if (voice->isVoiceActive())
+        voice->stopNote (0.0f, false);
+
+    returnVoice (voices, voice);
+    ownedVoices.removeObject (voice);
+}
+
+void BKSynthesiser::setVoicePool (std::shared_ptr<BKVoicePool> pool, BKVoicePool::Priority priority)
+{
+    releaseBorrowedVoices();
+    voicePool = std::move (pool);
+    voicePriority = priority;
+}
+
+void BKSynthesiser::setParallelRendering (std::shared_ptr<BKRenderWorkerPool> workers, int numPartitions)
+{
+    renderWorkers = std::move (workers);
+    numRenderPartitions = renderWorkers != nullptr ? juce::jlimit (0, BKRenderWorkerPool::maxTasksPerJob, numPartitions) : 0;
+
+    if (parallelBlockSize > 0)
+        prepareParallelRendering (parallelBlockSize);
+}
 
+void BKSynthesiser::prepareParallelRendering (int maxSamplesPerBlock)
+{
+    parallelBlockSize = maxSamplesPerBlock;
+
+    partitionBuffers.resize ((size_t) numRenderPartitions);
+    for (auto& buffer : partitionBuffers)
+        buffer.setSize (2, maxSamplesPerBlock, false, true, false); // voices render at most stereo
+}
+
+bool BKSynthesiser::renderActiveVoicesInParallel (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    const int numVoices = activeVoices.size();
+    const int numPartitions = juce::jmin ((int) partitionBuffers.size(), numVoices / kMinVoicesPerPartition);
+    const int numChannels = outputAudio.getNumChannels();
+
+    if (renderWorkers == nullptr || numPartitions < 2 || numChannels > 2
+        || startSample + numSamples > partitionBuffers.front().getNumSamples())
+        return false;
+
+    // contiguous groups of the active list, so the grouping only depends on the voices
+    auto renderPartition = [&] (int p)
     {
-        const juce::ScopedLock sl (stealLock);
-        usableVoicesToStealArray.ensureStorageAllocated (voices.size() + 1);
-    }
+        auto& scratch = partitionBuffers[(size_t) p];
+        juce::AudioBuffer<float> target (scratch.getArrayOfWritePointers(), numChannels, startSample + numSamples);
+        target.clear (startSample, numSamples);
+
+        const int end = (p + 1) * numVoices / numPartitions;
+        for (int i = p * numVoices / numPartitions; i < end; ++i)
+            activeVoices.getUnchecked (i)->renderNextBlock (target, startSample, numSamples);
+    };
+
+    renderWorkers->parallelFor (numPartitions, renderPartition);
+
+    // fixed summation order, whichever thread rendered each group
+    for (int p = 0; p < numPartitions; ++p)
+        for (int ch = 0; ch < numChannels; ++ch)
+            outputAudio.addFrom (ch, startSample, partitionBuffers[(size_t) p], ch, startSample, numSamples);
+
+    return true;
+}
+
+BKSynthesiserVoice* BKSynthesiser::borrowVoice (juce::Array<BKSynthesiserVoice*>& list) noexcept
+{
+    auto* voice = voicePool->acquire (voiceType, voicePriority);
+    if (voice == nullptr)
+        return nullptr;
+
+    // the last synth to use it may have had a different tuning, rate or A4
+    voice->owner = this;
+    voice->setTuning (tuning);
+    voice->setCurrentA4Frequency (a4Frequency);
+    if (! juce::approximatelyEqual (voice->getSampleRate(), sampleRate))
+        voice->setCurrentPlaybackSampleRate (sampleRate);
+
+    list.add (voice); // storage reserved in addSoundSet()
     return voice;
 }
 
-void BKSynthesiser::removeVoice (const int index)
+void BKSynthesiser::returnVoice (juce::Array<BKSynthesiserVoice*>& list, BKSynthesiserVoice* voice) noexcept
 {
-    const juce::ScopedLock sl (lock);
-    voices.remove (index);
+    list.removeFirstMatchingValue (voice);
+    finishCull (voice);
+
+    if (voicePool == nullptr || voice->isRetiring || ownedVoices.contains (voice) || ownedGraveyardVoices.contains (voice))
+        return;
+
+    voice->owner = nullptr;
+    voicePool->release (voice, voiceType);
 }
 
-void BKSynthesiser::addSoundSet (juce::ReferenceCountedArray<BKSynthesiserSound>* s, int numVoices)
+void BKSynthesiser::releaseBorrowedVoices()
 {
-    if(s == nullptr) {
-        sounds = nullptr;
+    // voices carried over from old sets are cleared out of the active lists below too
+    for (auto& retiring : retiringVoices)
+        if (retiring.voice->isVoiceActive())
+            retiring.voice->stopNote (0.0f, false);
+
+    pruneRetiringVoices();
+
+    if (voicePool == nullptr)
         return;
+
+    for (auto* list : { &voices, &graveyardVoices })
+    {
+        while (! list->isEmpty())
+        {
+            auto* voice = list->getLast();
+            if (voice->isVoiceActive())
+                voice->stopNote (0.0f, false);
+
+            voice->isInActiveList = false;
+            returnVoice (*list, voice);
+        }
     }
-    const juce::ScopedLock sl (lock);
 
-    voices.clearQuick (true);
-    graveyardVoices.clearQuick (true);
+    activeVoices.clearQuick();
+    activeGraveyardVoices.clearQuick();
+}
+
+void BKSynthesiser::addSoundSet (juce::ReferenceCountedArray<BKSynthesiserSound>* s, int numVoices)
+{
+    auto change = std::make_unique<SoundSetChange>();
+    change->sounds = s;
 
-    if (s->getFirst() != nullptr)
+    if (s != nullptr)
     {
-        const bool isSFZ = (s->getFirst()->getSoundSampleType() == SoundSampleType::SFZ);
+        change->heldSounds = *s;
+        change->soundLookup.build (*s);
 
-        for (int i = 0; i < numVoices; i++)
+        if (s->getFirst() != nullptr)
         {
-            if (isSFZ)
+            const bool isSFZ = (s->getFirst()->getSoundSampleType() == SoundSampleType::SFZ);
+
+            if (voicePool != nullptr)
             {
-                auto* v = new BKSamplerVoice<SFZRegion>();
-                v->setTuning (tuning);
-                v->setCurrentPlaybackSampleRate (sampleRate);
-                voices.add (v);
+                // voices are borrowed in noteOn; just make sure the pool has the right kind
+                change->voiceType = isSFZ ? SoundSampleType::SFZ : SoundSampleType::WAV;
+                voicePool->prepare (change->voiceType);
+                change->maxBorrowedVoices = numVoices;
             }
             else
             {
-                auto* v = new BKSamplerVoice<juce::AudioFormatReader>();
-                v->setTuning (tuning);
-                v->setCurrentPlaybackSampleRate (sampleRate);
-                voices.add (v);
+                const auto rate = requestedSampleRate.load (std::memory_order_relaxed);
+                auto* t = requestedTuning.load (std::memory_order_acquire);
+
+                auto makeVoice = [&]() -> BKSynthesiserVoice*
+                {
+                    BKSynthesiserVoice* v;
+                    if (isSFZ)
+                        v = new BKSamplerVoice<SFZRegion>();
+                    else
+                        v = new BKSamplerVoice<juce::AudioFormatReader>();
+
+                    v->setTuning (t);
+                    v->setCurrentPlaybackSampleRate (rate);
+                    v->owner = this;
+                    return v;
+                };
+
+                for (int i = 0; i < numVoices; i++)
+                    change->voices.add (change->ownedVoices.add (makeVoice()));
+
+                for (int i = 0; i < kGraveyardSize; i++)
+                    change->graveyardVoices.add (change->ownedGraveyardVoices.add (makeVoice()));
             }
+
+            // so adding to the voice and active lists never allocates on the audio thread,
+            // including the voices carried over from the current set
+            change->voices.ensureStorageAllocated (numVoices + kMaxRetiringVoices);
+            change->graveyardVoices.ensureStorageAllocated (kGraveyardSize + kMaxRetiringVoices);
+            change->activeVoices.ensureStorageAllocated (numVoices + kMaxRetiringVoices);
+            change->activeGraveyardVoices.ensureStorageAllocated (kGraveyardSize + kMaxRetiringVoices);
+            change->usableVoicesToStealArray.ensureStorageAllocated (numVoices + kMaxRetiringVoices + 1);
         }
+    }
+
+    pendingSoundSet.publish (std::move (change));
+
+    // the set this replaces is only swapped out at the next block, and kept until its voices finish
+    retiredSoundSetCollector.startTimer (250);
+}
+
+void BKSynthesiser::applyPendingChanges() noexcept
+{
+    const bool newVoices = pendingSoundSet.adopt ([this] (SoundSetChange& next)
+    {
+        carryOverSoundingVoices (next);
+
+        sounds = next.sounds;
+        heldSounds.swapWith (next.heldSounds);
+        std::swap (soundLookup, next.soundLookup);
+        ownedVoices.swapWith (next.ownedVoices);
+        ownedGraveyardVoices.swapWith (next.ownedGraveyardVoices);
+        voices.swapWith (next.voices);
+        graveyardVoices.swapWith (next.graveyardVoices);
+        activeVoices.swapWith (next.activeVoices);
+        activeGraveyardVoices.swapWith (next.activeGraveyardVoices);
+        usableVoicesToStealArray.swapWith (next.usableVoicesToStealArray);
+        voiceType = next.voiceType;
+        maxBorrowedVoices = next.maxBorrowedVoices;
+        someVoicesActive = ! (activeVoices.isEmpty() && activeGraveyardVoices.isEmpty());
+    });
+
+    const auto newRate = requestedSampleRate.load (std::memory_order_relaxed);
+    if (newRate > 0. && ! juce::approximatelyEqual (sampleRate, newRate))
+    {
+        allNotesOff (0, false);
+        sampleRate = newRate;
+
+        for (auto* voice : voices)
+            voice->setCurrentPlaybackSampleRate (newRate);
+
+        for (auto* voice : graveyardVoices)
+            voice->setCurrentPlaybackSampleRate (newRate);
+    }
+
+    if (auto* t = requestedTuning.load (std::memory_order_acquire); t != tuning || newVoices)
+    {
+        tuning = t;
+        for (auto* voice : voices)
+            voice->setTuning (tuning);
+    }
 
-        for (int i = 0; i < kGraveyardSize; i++)
+    if (allNotesOffRequested.exchange (false, std::memory_order_acquire))
+        allNotesOff (0, false);
+}
+
+void BKSynthesiser::carryOverSoundingVoices (SoundSetChange& next) noexcept
+{
+    // next is about to hold the current set; swapped out, it stays alive while this counts its voices
+    auto& stillSounding = next.voicesStillSounding;
+
+    // borrowed voices of the same kind just stay borrowed; the pool takes back the rest
+    const bool keepBorrowed = voicePool != nullptr && next.voiceType == voiceType;
+    int numCarried = 0;
+
+    auto carry = [&] (juce::Array<BKSynthesiserVoice*>& active, juce::Array<BKSynthesiserVoice*>& held,
+                      juce::Array<BKSynthesiserVoice*>& nextActive, juce::Array<BKSynthesiserVoice*>& nextHeld)
+    {
+        for (auto* voice : active)
         {
-            if (isSFZ)
+            const bool owned = voicePool == nullptr ? ! voice->isRetiring
+                                                    : ownedVoices.contains (voice) || ownedGraveyardVoices.contains (voice);
+            const bool borrowed = voicePool != nullptr && ! owned && ! voice->isRetiring;
+
+            // carried voices are counted against the old set (even borrowed ones, as they play its sounds)
+            const bool tracked = borrowed || owned;
+
+            bool keep = voice->isVoiceActive() && numCarried < kMaxRetiringVoices;
+            if (borrowed)
+                keep = keep && keepBorrowed;
+            if (tracked)
+                keep = keep && retiringVoices.size() < kMaxRetiringVoices;
+
+            if (! keep)
             {
-                auto* v = new BKSamplerVoice<SFZRegion>();
-                v->setTuning (tuning);
-                v->setCurrentPlaybackSampleRate (sampleRate);
-                graveyardVoices.add (v);
+                // cut off, as every voice was before sets could be swapped under them
+                if (voice->isVoiceActive())
+                    voice->stopNote (0.0f, false);
+
+                voice->isInActiveList = false;
+                continue;
             }
-            else
+
+            ++numCarried;
+            nextActive.add (voice);
+
+            if (borrowed)
+                nextHeld.add (voice);
+            else if (owned)
+                voice->isRetiring = true;
+
+            if (tracked)
             {
-                auto* v = new BKSamplerVoice<juce::AudioFormatReader>();
-                v->setTuning (tuning);
-                v->setCurrentPlaybackSampleRate (sampleRate);
-                graveyardVoices.add (v);
+                stillSounding.fetch_add (1, std::memory_order_relaxed); // published by adopt()
+                retiringVoices.add ({ voice, &stillSounding, voice->currentPlayingMidiChannel, voice->currentlyPlayingNote });
             }
         }
+
+        // borrowed voices not coming along go back to the pool
+        if (voicePool != nullptr)
+            for (int i = held.size(); --i >= 0;)
+                if (auto* voice = held.getUnchecked (i); ! voice->isInActiveList)
+                    returnVoice (held, voice);
+    };
+
+    carry (activeVoices, voices, next.activeVoices, next.voices);
+    carry (activeGraveyardVoices, graveyardVoices, next.activeGraveyardVoices, next.graveyardVoices);
+
+    // the voices left behind may be deleted soon, so don't let noteOff find them
+    for (auto& channel : playingVoicesByNote)
+        for (auto& note : channel)
+            note.removeIf ([] (BKSynthesiserVoice* voice) { return ! voice->isInActiveList; });
+
+    pruneRetiringVoices();
+}
+
+void BKSynthesiser::pruneRetiringVoices() noexcept
+{
+    for (int i = retiringVoices.size(); --i >= 0;)
+    {
+        const auto retiring = retiringVoices.getUnchecked (i);
+        if (retiring.voice->isVoiceActive())
+            continue;
+
+        // still listed under its note if the key hasn't come up yet
+        if (retiring.midiChannel >= 1 && retiring.midiChannel <= 16 && juce::isPositiveAndBelow (retiring.midiNote, 129))
+            playingVoicesByNote[(size_t) retiring.midiChannel - 1].getReference (retiring.midiNote).removeFirstMatchingValue (retiring.voice);
+
+        // only still listed when it was stopped off the audio thread
+        if (retiring.voice->isInActiveList)
+        {
+            activeVoices.removeFirstMatchingValue (retiring.voice);
+            activeGraveyardVoices.removeFirstMatchingValue (retiring.voice);
+            retiring.voice->isInActiveList = false;
+        }
+
+        retiring.voice->isRetiring = false;
+        retiringVoices.swap (i, retiringVoices.size() - 1);
+        retiringVoices.removeLast();
+
+        // the voice may be deleted on the message thread as soon as this is seen
+        retiring.stillSounding->fetch_sub (1, std::memory_order_release);
     }
-    sounds = s;
 }
 
-BKSynthesiserVoice* BKSynthesiser::findFreeGraveyardSlot() const noexcept
+void BKSynthesiser::finishCull (BKSynthesiserVoice* voice) noexcept
 {
-    if (graveyardVoices.isEmpty())
-        return nullptr;
+    if (std::exchange (voice->isBeingCulled, false) && voicePool != nullptr)
+        voicePool->cullFinished();
+}
+
+void BKSynthesiser::cullVoicesOverBudget() noexcept
+{
+    // only borrowed voices count against the pool's limit
+    if (voicePool == nullptr || ! ownedVoices.isEmpty() || activeVoices.isEmpty())
+        return;
+
+    const int numClaimed = voicePool->claimVoicesToCull (juce::jmin (kMaxCullsPerBlock, activeVoices.size()));
+    int numCulled = 0;
+
+    for (; numCulled < numClaimed; ++numCulled)
+    {
+        BKSynthesiserVoice* quietest = nullptr;
+        for (auto* voice : activeVoices)
+        {
+            if (voice->isBeingCulled || ! voice->isPlayingButReleased())
+                continue;
+
+            if (quietest == nullptr || voice->getAmpEnvValue() < quietest->getAmpEnvValue()
+                || (juce::exactlyEqual (voice->getAmpEnvValue(), quietest->getAmpEnvValue()) && voice->wasStartedBefore (*quietest)))
+                quietest = voice;
+        }
+
+        if (quietest == nullptr)
+            break;
+
+        // same short fade as a graveyard slot, in place
+        quietest->isBeingCulled = true;
+        quietest->forceAmpEnvRelease (0.003f);
+        quietest->stopNote (0.0f, true);
+    }
+
+    if (numClaimed > 0)
+        voicePool->voicesCulled (numCulled, numClaimed);
+}
+
+void BKSynthesiser::addToActiveList (juce::Array<BKSynthesiserVoice*>& list, BKSynthesiserVoice* voice) noexcept
+{
+    if (voice->isInActiveList)
+        return;
+
+    voice->isInActiveList = true;
+    list.add (voice);
+}
+
+void BKSynthesiser::pruneActiveVoices() noexcept
+{
+    auto prune = [this] (juce::Array<BKSynthesiserVoice*>& list, juce::Array<BKSynthesiserVoice*>& held)
+    {
+        // swap-remove, so this stays O(active voices)
+        for (int i = list.size(); --i >= 0;)
+        {
+            auto* voice = list.getUnchecked (i);
+            if (! voice->isVoiceActive())
+            {
+                voice->isInActiveList = false;
+                list.swap (i, list.size() - 1);
+                list.removeLast();
+
+                // borrowed voices go straight back to the pool once they're silent
+                if (voicePool != nullptr)
+                    returnVoice (held, voice);
+            }
+        }
+    };
 
+    prune (activeVoices, voices);
+    prune (activeGraveyardVoices, graveyardVoices);
+    pruneRetiringVoices();
+    someVoicesActive = ! (activeVoices.isEmpty() && activeGraveyardVoices.isEmpty());
+}
+
+BKSynthesiserVoice* BKSynthesiser::findFreeGraveyardSlot() noexcept
+{
     BKSynthesiserVoice* oldest = nullptr;
     for (auto* v : graveyardVoices)
     {
@@ -143,6 +556,11 @@ BKSynthesiserVoice* BKSynthesiser::findFreeGraveyardSlot() const noexcept
         if (oldest == nullptr || v->wasStartedBefore (*oldest))
             oldest = v;
     }
+
+    if (voicePool != nullptr && graveyardVoices.size() < kGraveyardSize)
+        if (auto* v = borrowVoice (graveyardVoices))
+            return v;
+
     // All slots busy — return the oldest (most-faded) one as a last resort.
     // The caller will overwrite it, causing a minor pop, but this is rare.
     return oldest;
@@ -183,18 +601,7 @@ void BKSynthesiser::setMinimumRenderingSubdivisionSize (int numSamples, bool sho
 void BKSynthesiser::setCurrentPlaybackSampleRate (const double newRate)
 {
     // DBG ("BKSynthesiser sample rate changed to " + juce::String (newRate));
-    if (!juce::approximatelyEqual (sampleRate, newRate))
-    {
-        const juce::ScopedLock sl (lock);
-        allNotesOff (0, false);
-        sampleRate = newRate;
-
-        for (auto* voice : voices)
-            voice->setCurrentPlaybackSampleRate (newRate);
-
-        for (auto* voice : graveyardVoices)
-            voice->setCurrentPlaybackSampleRate (newRate);
-    }
+    requestedSampleRate.store (newRate, std::memory_order_relaxed);
 }
 
 /*
@@ -212,6 +619,9 @@ void BKSynthesiser::processNextBlock (juce::AudioBuffer<floatType>& outputAudio,
     int startSample,
     int numSamples)
 {
+    applyPendingChanges();
+    cullVoicesOverBudget();
+
     // must set the sample rate before using this!
     jassert (!juce::exactlyEqual (sampleRate, 0.0));
     const int targetChannels = outputAudio.getNumChannels();
@@ -220,8 +630,6 @@ void BKSynthesiser::processNextBlock (juce::AudioBuffer<floatType>& outputAudio,
 
     bool firstEvent = true;
 
-    const juce::ScopedLock sl (lock);
-
     /*
      * if we are in a bypassed state, and have already handled all vestigial midinotes,
      * just render any remaining active voices and skip the rest
@@ -296,22 +704,14 @@ void BKSynthesiser::renderNextBlock (juce::AudioBuffer<float>& outputAudio, cons
 
 void BKSynthesiser::renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
 {
-    someVoicesActive = false;
-    for (auto* voice : voices)
-    {
+    if (! renderActiveVoicesInParallel (buffer, startSample, numSamples))
+        for (auto* voice : activeVoices)
+            voice->renderNextBlock (buffer, startSample, numSamples);
+
+    for (auto* voice : activeGraveyardVoices)
         voice->renderNextBlock (buffer, startSample, numSamples);
-        if (voice->isVoiceActive())
-            someVoicesActive = true;
-    }
 
-    for (auto* voice : graveyardVoices)
-    {
-        if (voice->isVoiceActive())
-        {
-            voice->renderNextBlock (buffer, startSample, numSamples);
-            someVoicesActive = true;
-        }
-    }
+    pruneActiveVoices();
 }
 
 void BKSynthesiser::handleMidiEvent (const juce::MidiMessage& m)
@@ -463,7 +863,8 @@ void BKSynthesiser::noteOn (const int midiChannel,
     const int midiNoteNumber,
     const float velocity)
 {
-    const juce::ScopedLock sl (lock);
+    if (sounds == nullptr)
+        return;
 
     DBG("BKSynthesiser::noteOn " << midiNoteNumber << " " << velocity);
 
@@ -524,7 +925,7 @@ void BKSynthesiser::noteOn (const int midiChannel,
         *  but in some situations (like Synchronic) this is undesirable
         *  so we set the noteOnSpec to false for this
         */
-        for (auto* voice : voices)
+        for (auto* voice : activeVoices)
             if (voice->getCurrentlyPlayingNote() == midiNoteNumber && voice->isPlayingChannel (midiChannel))
             {
                 // DBG("BKSynthesiser::noteOn, stopping voice " << voice->getCurrentlyPlayingNote() << " for midiNoteNumber " << midiNoteNumber);
@@ -555,32 +956,53 @@ void BKSynthesiser::noteOn (const int midiChannel,
 
         tuneTranspositions = (*noteOnSpecs)[midiNoteNumber].useAttachedTuning;
 
-        for (auto* sound : *sounds)
+        // none of this depends on the sound, so do it once per transposition
+        int closestKey;
+        if (tuning != nullptr)
         {
-            int closestKey;
-            if (tuning != nullptr)
-            {
-                closestKey = tuning->getClosestKey (midiNoteNumber, transp, tuneTranspositions);
-                lastSynthState.lastPitch = tuning->getTargetFrequency (midiNoteNumber, transp, tuneTranspositions);
-            }
-            else
-                closestKey = std::round (midiNoteNumber + transp);
+            lastSynthState.lastPitch = tuning->getCachedTargetFrequency (midiNoteNumber, transp, tuneTranspositions);
+            closestKey = tuning->getClosestKey (midiNoteNumber, transp, tuneTranspositions, lastSynthState.lastPitch);
+        }
+        else
+            closestKey = std::round (midiNoteNumber + transp);
 
-            /**
-             * set sound playback direction here, based on mode set for this BKSynth
-             */
-            if (sound->appliesToNote (closestKey) && sound->appliesToChannel (midiChannel) && sound->appliesToVelocity (velocity))
-            {
-                auto* newvoice = findFreeVoice (sound, midiChannel, midiNoteNumber, shouldStealNotes);
+        const float transpositionGain = (*noteOnSpecs)[midiNoteNumber].transpositionGains[(*noteOnSpecs)[midiNoteNumber].transpositions.indexOf (transp)];
+
+        auto playSound = [&] (BKSynthesiserSound* sound)
+        {
+            // a lazily loaded sound that isn't in memory yet is skipped, and fetched for next time;
+            // the pin stops it being unloaded before the voice takes over holding it
+            if (! sound->pinIfLoaded())
+                return;
+
+            if (auto* newvoice = obtainVoice (sound, midiChannel, midiNoteNumber))
                 startVoice (newvoice,
                     sound,
                     midiChannel,
                     midiNoteNumber,
                     velocityScaled,
                     transp,
-                    (*noteOnSpecs)[midiNoteNumber].transpositionGains[(*noteOnSpecs)[midiNoteNumber].transpositions.indexOf (transp)]);
+                    transpositionGain);
+
+            sound->unpin();
+        };
+
+        if (soundLookup.isValidFor (sounds))
+        {
+            for (auto index : soundLookup.getSounds (closestKey, (int) velocity))
+            {
+                auto* sound = sounds->getObjectPointerUnchecked (index);
+                if (sound->appliesToChannel (midiChannel))
+                    playSound (sound);
             }
         }
+        else
+        {
+            // soundset changed since addSoundSet (still loading?); check every sound
+            for (auto* sound : *sounds)
+                if (sound->appliesToNote (closestKey) && sound->appliesToChannel (midiChannel) && sound->appliesToVelocity (velocity))
+                    playSound (sound);
+        }
     }
 }
 
@@ -594,6 +1016,8 @@ void BKSynthesiser::startVoice (BKSynthesiserVoice* const voice,
 {
     // DBG("startVoice, transpositionGain = " << transpositionGain);
 
+    finishCull (voice);
+
     // If this voice was previously tracked under a different note, remove it from that
     // entry first. Without this, a noteOff for the old note would find the stolen voice
     // and stop it even though it is now playing the new note.
@@ -621,15 +1045,14 @@ void BKSynthesiser::startVoice (BKSynthesiserVoice* const voice,
     {
         if (voice->currentlyPlayingSound != nullptr)
         {
-            auto* graveyardSlot = findFreeGraveyardSlot();
-            DBG("accessing graveyard slot!");
-
-
             // Only use the graveyard if the voice has audible amplitude to fade out.
             // Voices stolen before their first render block (envelopeVal == 0) are
             // silent — just hard-stop them, no graveyard slot needed.
             const float sourceEnvVal = voice->getAmpEnvValue();
-            if (graveyardSlot != nullptr && sourceEnvVal > 0.001f)
+            auto* graveyardSlot = sourceEnvVal > 0.001f ? findFreeGraveyardSlot() : nullptr;
+            DBG("accessing graveyard slot!");
+
+            if (graveyardSlot != nullptr)
             {
                 // If the slot was still active (oldest-slot fallback), hard-stop it first
                 // so copyStateTo starts from a clean slate.
@@ -647,6 +1070,7 @@ void BKSynthesiser::startVoice (BKSynthesiserVoice* const voice,
                 // Then stopNote(true) sets tailOff without overwriting the rate.
                 graveyardSlot->forceAmpEnvRelease (0.003f);
                 graveyardSlot->stopNote (0.0f, true);
+                addToActiveList (activeGraveyardVoices, graveyardSlot);
 
                 // Hard-stop the original — the slot handles the fade.
                 voice->stopNote (0.0f, false);
@@ -702,6 +1126,9 @@ void BKSynthesiser::startVoice (BKSynthesiserVoice* const voice,
             lastPitchWheelValues[midiChannel - 1],
             (*noteOnSpecs)[midiNoteNumber].startTime,
             (*noteOnSpecs)[midiNoteNumber].startDirection);
+
+        addToActiveList (activeVoices, voice);
+        someVoicesActive = true;
     }
 }
 
@@ -722,8 +1149,6 @@ void BKSynthesiser::noteOff (const int midiChannel,
 {
     DBG("BKSynthesiser::noteOff " << midiNoteNumber << " " << velocity);
 
-    const juce::ScopedLock sl (lock);
-
     if (noteOnSpecs == nullptr)
         return;
 
@@ -742,6 +1167,10 @@ void BKSynthesiser::noteOff (const int midiChannel,
      */
     for (auto* voice : playingVoicesByNote[midiChannel - 1][midiNoteNumber])
     {
+        // skip voices that have been given back to the pool since (and maybe lent to another synth)
+        if (voice->owner != this)
+            continue;
+
         // skip voices not on this midi channel
         if (voice->currentPlayingMidiChannel != midiChannel)
             continue;
@@ -771,9 +1200,7 @@ void BKSynthesiser::noteOff (const int midiChannel,
 
 void BKSynthesiser::allNotesOff (const int midiChannel, const bool allowTailOff)
 {
-    const juce::ScopedLock sl (lock);
-
-    for (auto* voice : voices)
+    for (auto* voice : activeVoices)
         if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
             voice->stopNote (1.0f, allowTailOff);
 
@@ -783,9 +1210,7 @@ void BKSynthesiser::allNotesOff (const int midiChannel, const bool allowTailOff)
 
 void BKSynthesiser::handlePitchWheel (const int midiChannel, const int wheelValue)
 {
-    const juce::ScopedLock sl (lock);
-
-    for (auto* voice : voices)
+    for (auto* voice : activeVoices)
         if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
             voice->pitchWheelMoved (wheelValue);
 }
@@ -809,18 +1234,14 @@ void BKSynthesiser::handleController (const int midiChannel,
             break;
     }
 
-    const juce::ScopedLock sl (lock);
-
-    for (auto* voice : voices)
+    for (auto* voice : activeVoices)
         if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
             voice->controllerMoved (controllerNumber, controllerValue);
 }
 
 void BKSynthesiser::handleAftertouch (int midiChannel, int midiNoteNumber, int aftertouchValue)
 {
-    const juce::ScopedLock sl (lock);
-
-    for (auto* voice : voices)
+    for (auto* voice : activeVoices)
         if (voice->getCurrentlyPlayingNote() == midiNoteNumber
             && (midiChannel <= 0 || voice->isPlayingChannel (midiChannel)))
             voice->aftertouchChanged (aftertouchValue);
@@ -828,9 +1249,7 @@ void BKSynthesiser::handleAftertouch (int midiChannel, int midiNoteNumber, int a
 
 void BKSynthesiser::handleChannelPressure (int midiChannel, int channelPressureValue)
 {
-    const juce::ScopedLock sl (lock);
-
-    for (auto* voice : voices)
+    for (auto* voice : activeVoices)
         if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
             voice->channelPressureChanged (channelPressureValue);
 }
@@ -839,7 +1258,6 @@ void BKSynthesiser::handleSustainPedal (int midiChannel, bool isDown)
 {
     DBG ("BKSynthesiser::handleSustainPedal");
     jassert (midiChannel > 0 && midiChannel <= 16);
-    const juce::ScopedLock sl (lock);
 
     if (isDown)
     {
@@ -858,7 +1276,7 @@ void BKSynthesiser::handleSustainPedal (int midiChannel, bool isDown)
         { // regular synth
             sustainPedalsDown.setBit (midiChannel);
 
-            for (auto* voice : voices)
+            for (auto* voice : activeVoices)
                 if (voice->isPlayingChannel (midiChannel) && voice->isKeyDown())
                     voice->setSustainPedalDown (true);
         }
@@ -879,7 +1297,7 @@ void BKSynthesiser::handleSustainPedal (int midiChannel, bool isDown)
 
         else
         {
-            for (auto* voice : voices)
+            for (auto* voice : activeVoices)
             {
                 if (voice->isPlayingChannel (midiChannel))
                 {
@@ -897,9 +1315,8 @@ void BKSynthesiser::handleSustainPedal (int midiChannel, bool isDown)
 void BKSynthesiser::handleSostenutoPedal (int midiChannel, bool isDown)
 {
     jassert (midiChannel > 0 && midiChannel <= 16);
-    const juce::ScopedLock sl (lock);
 
-    for (auto* voice : voices)
+    for (auto* voice : activeVoices)
     {
         if (voice->isPlayingChannel (midiChannel))
         {
@@ -927,13 +1344,33 @@ void BKSynthesiser::handleProgramChange ([[maybe_unused]] int midiChannel,
 }
 
 //==============================================================================
+BKSynthesiserVoice* BKSynthesiser::obtainVoice (BKSynthesiserSound* soundToPlay,
+    int midiChannel,
+    int midiNoteNumber)
+{
+    if (voicePool == nullptr)
+        return findFreeVoice (soundToPlay, midiChannel, midiNoteNumber, shouldStealNotes);
+
+    // a voice we hold may have finished since the last prune
+    if (auto* voice = findFreeVoice (soundToPlay, midiChannel, midiNoteNumber, false))
+        return voice;
+
+    if (voices.size() < maxBorrowedVoices)
+        if (auto* voice = borrowVoice (voices))
+            return voice;
+
+    // over this synth's own limit, or the pool said no: steal from ourselves
+    if (shouldStealNotes && ! voices.isEmpty())
+        return findVoiceToSteal (soundToPlay, midiChannel, midiNoteNumber);
+
+    return nullptr;
+}
+
 BKSynthesiserVoice* BKSynthesiser::findFreeVoice (BKSynthesiserSound* soundToPlay,
     int midiChannel,
     int midiNoteNumber,
     const bool stealIfNoneAvailable) const
 {
-    const juce::ScopedLock sl (lock);
-
     for (auto* voice : voices)
         if ((!voice->isVoiceActive()) && voice->canPlaySound (soundToPlay))
             return voice;
@@ -961,13 +1398,8 @@ BKSynthesiserVoice* BKSynthesiser::findVoiceToSteal (BKSynthesiserSound* soundTo
     BKSynthesiserVoice* low = nullptr; // Lowest sounding note, might be sustained, but NOT in release phase
     BKSynthesiserVoice* top = nullptr; // Highest sounding note, might be sustained, but NOT in release phase
 
-    // All major OSes use double-locking so this will be lock- and wait-free as long as the lock is not
-    // contended. This is always the case if you do not call findVoiceToSteal on multiple threads at
-    // the same time.
-    const juce::ScopedLock sl (stealLock);
-
     // this is a list of voices we can steal, sorted by how long they've been running
-    usableVoicesToStealArray.clear();
+    usableVoicesToStealArray.clearQuick(); // keep the storage reserved in addSoundSet()
 
     for (auto* voice : voices)
     {
@@ -8,11 +8,55 @@
 #ifndef BITKLAVIER2_BKBKSynthesiser_H
 #define BITKLAVIER2_BKBKSynthesiser_H
 #include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <span>
 #include "Sample.h"
+#include "BKVoicePool.h"
+#include "BKRenderWorkerPool.h"
+#include "BKRealtimeExchange.h"
 #include "EnvParams.h"
 #include "TuningProcessor.h"
 #include "utils.h"
 
+//==============================================================================
+/**
+    Dense (midi note x velocity) -> sounds table, so noteOn doesn't have to test every sound's
+    BigInteger note/velocity ranges for every transposition.
+
+    Most cells share the same handful of sound lists (one per velocity layer per key range),
+    so cells store an index into a deduplicated set of lists rather than a list each.
+    Set 0 is always the empty list.
+*/
+struct BKSoundLookupTable
+{
+    void build (juce::ReferenceCountedArray<BKSynthesiserSound>& sounds);
+    void clear();
+
+    /** true if the table was built for exactly this soundset, in its current state */
+    bool isValidFor (const juce::ReferenceCountedArray<BKSynthesiserSound>* s) const noexcept
+    {
+        return s != nullptr && s == builtFor && s->size() == builtForNumSounds;
+    }
+
+    /** indices into the soundset of the sounds that apply to this note and velocity, in soundset order */
+    std::span<const int> getSounds (int midiNoteNumber, int velocity) const noexcept
+    {
+        if (midiNoteNumber < 0 || midiNoteNumber >= MaxMidiNotes)
+            return {};
+
+        const auto set = cellToSet[(size_t) (midiNoteNumber * 128 + juce::jlimit (0, 127, velocity))];
+        return { soundIndices.data() + setStart[set], (size_t) (setStart[set + 1] - setStart[set]) };
+    }
+
+private:
+    std::array<uint16_t, MaxMidiNotes * 128> cellToSet {};
+    std::vector<int> setStart { 0, 0 };
+    std::vector<int> soundIndices;
+
+    const juce::ReferenceCountedArray<BKSynthesiserSound>* builtFor = nullptr;
+    int builtForNumSounds = -1;
+};
+
 //==============================================================================
 /**
     Base class for a musical device that can play sounds.
@@ -52,12 +96,27 @@ class BKSynthesiser
                 virtual ~BKSynthesiser();
 
                 //==============================================================================
-                /** Deletes all voices. */
+                /** Deletes all voices.
+
+                    clearVoices(), addVoice() and removeVoice() change the voice lists directly, so
+                    only call them while the synth isn't rendering (e.g. before it's been added to
+                    the graph). A running synth gets its voices through addSoundSet().
+                */
                 void clearVoices();
 
                 /** Returns the number of voices that have been added. */
                 int getNumVoices() const noexcept { return voices.size(); }
 
+                /** Voices sounding as of the last block, including ones carried over from a replaced soundset.
+                    Audio thread, or while the synth isn't rendering. */
+                int getNumActiveVoices() const noexcept { return activeVoices.size() + activeGraveyardVoices.size(); }
+
+                /** How many of those are still sounding from a replaced soundset (see carryOverSoundingVoices()). */
+                int getNumRetiringVoices() const noexcept { return retiringVoices.size(); }
+
+                /** Most voices carried over from old soundsets at once; any more are cut off as before. */
+                static constexpr int kMaxRetiringVoices = 256;
+
                 /** Returns one of the voices that have been added. */
                  BKSynthesiserVoice* getVoice (int index) const;
 
@@ -77,7 +136,8 @@ class BKSynthesiser
                 //==============================================================================
                 /** Deletes all sounds. */
                 //void clearSounds();
-                bool hasSamples() {return sounds != nullptr;}
+                /** True if there is a soundset to play, or one waiting to be picked up by the next block. */
+                bool hasSamples() const noexcept { return sounds != nullptr || pendingSoundSet.hasPending(); }
 
                 /** Returns the number of sounds that have been added to the mainSynth. */
                 int getNumSounds() const noexcept { return sounds->size(); }
@@ -94,7 +154,54 @@ class BKSynthesiser
                 /** Removes and deletes one of the sounds. */
 //                void removeSound (int index);
 
+                /** Sets the sounds to play, and the polyphony to play them with.
+
+                    Without a voice pool this allocates numVoices voices (plus graveyard slots) of
+                    the right type for the soundset. With one (see setVoicePool()) nothing is
+                    allocated here; numVoices is the most voices this synth will borrow at once.
+
+                    Message thread. Everything is built here and handed over without locking; the
+                    audio thread swaps it in at the start of its next block. Notes still sounding
+                    from the old set carry on until they finish (see carryOverSoundingVoices()),
+                    and the old voices are deleted back on the message thread once they have.
+                */
                 void addSoundSet(juce::ReferenceCountedArray<BKSynthesiserSound>*, int numVoices = 300);
+
+                /** Message thread. Deletes replaced soundsets whose carried-over voices have all finished.
+                    A timer started by addSoundSet() calls this until there are none left. */
+                void collectRetiredSoundSets() { pendingSoundSet.collectGarbage(); }
+
+                /** Makes this synth borrow its voices and graveyard slots from an engine-wide pool
+                    as it starts notes, rather than owning a full set of its own.
+
+                    Call this before addSoundSet(), while the synth isn't rendering. When the pool refuses a voice (the global budget
+                    is used up at this priority) the synth steals from the voices it already holds,
+                    using findVoiceToSteal() as usual.
+                */
+                void setVoicePool (std::shared_ptr<BKVoicePool> pool, BKVoicePool::Priority priority);
+
+                bool usesVoicePool() const noexcept { return voicePool != nullptr; }
+
+                /** Lets this synth split its active voices into numPartitions groups and render
+                    them on the given worker pool.
+
+                    Each group renders into its own scratch buffer, and the scratch buffers are
+                    always summed into the output in group order, so the output doesn't depend
+                    on how many worker threads there are or which of them rendered what.
+                    Pass nullptr to go back to rendering everything on the calling thread.
+
+                    Call prepareParallelRendering() from prepareToPlay as well, so the scratch
+                    buffers are big enough; blocks larger than that are rendered serially.
+                */
+                void setParallelRendering (std::shared_ptr<BKRenderWorkerPool> workers,
+                                           int numPartitions = kDefaultRenderPartitions);
+
+                /** Sizes the scratch buffers used by parallel rendering. Message thread only. */
+                void prepareParallelRendering (int maxSamplesPerBlock);
+
+                bool isParallelRenderingEnabled() const noexcept { return renderWorkers != nullptr && ! partitionBuffers.empty(); }
+
+                static constexpr int kDefaultRenderPartitions = 8;
                 //==============================================================================
                 /** If set to true, then the mainSynth will try to take over an existing voice if
                     it runs out and needs to play another note.
@@ -240,7 +347,7 @@ class BKSynthesiser
                 /** Tells the BKSynthesiser what the sample rate is for the audio it's being used to render.
             
                     This value is propagated to the voices so that they can use it to render the correct
-                    pitches.
+                    pitches. Any thread; the voices are updated at the start of the next block.
                 */
                 virtual void setCurrentPlaybackSampleRate (double sampleRate);
 
@@ -313,14 +420,16 @@ class BKSynthesiser
 //                    synthGain.setParameterValue(g);
 //                }
 
+                /** Any thread; the voices pick up the new tuning at the start of the next block. */
                 void setTuning(TuningState* attachedTuning)
                 {
-                    tuning = attachedTuning;
-                    for (auto voice : voices) {
-                        voice->setTuning(tuning);
-                    }
+                    requestedTuning.store (attachedTuning, std::memory_order_release);
                 }
 
+                /** Stops every voice (no tail-off) at the start of the next block. Any thread;
+                    use this rather than allNotesOff() from outside the audio callback. */
+                void requestAllNotesOff() noexcept { allNotesOffRequested.store (true, std::memory_order_release); }
+
 //                void setPlaybackDirection(Direction newdir)
 //                {
 //                    playbackDirection = newdir;
@@ -360,34 +469,83 @@ class BKSynthesiser
 
                 void setA4Frequency(double newA4)
                 {
+                    a4Frequency = newA4;
                     for (auto& sv : voices)
                     {
                         sv->setCurrentA4Frequency (newA4);
                     }
                 }
 
-                mutable juce::CriticalSection stealLock;
-
 protected:
                 //==============================================================================
-                /** This is used to control access to the rendering callback and the note trigger methods. */
-                juce::CriticalSection lock;
+                /** Picks up whatever the message thread has handed over since the last block:
+                    a new soundset, sample rate or tuning, or an allNotesOff request.
+                    Called at the start of every render callback, before any voice is touched.
+                */
+                void applyPendingChanges() noexcept;
 
-                juce::OwnedArray< BKSynthesiserVoice> voices;
+                /** The voices this synth can play with: all of ownedVoices, or, when using a
+                    voice pool, the voices currently borrowed from it. */
+                juce::Array<BKSynthesiserVoice*> voices;
 
                 /** Pre-allocated pool of voices used to fade out stolen notes click-free.
-                    Populated in addSoundSet() with the same voice type as the main pool.
+                    Populated in addSoundSet() with the same voice type as the main pool
+                    (or borrowed from the voice pool as needed, up to kGraveyardSize).
                     Never steal-targeted; rendered alongside regular voices.
                 */
                 static constexpr int kGraveyardSize = 128;
-                juce::OwnedArray<BKSynthesiserVoice> graveyardVoices;
+                juce::Array<BKSynthesiserVoice*> graveyardVoices;
 
-                /** Returns the first graveyard slot that is not currently active,
-                    or nullptr if all 32 slots are busy (extremely rare).
+                /** Storage for voices this synth allocated itself (addSoundSet() without a pool, addVoice()). */
+                juce::OwnedArray<BKSynthesiserVoice> ownedVoices;
+                juce::OwnedArray<BKSynthesiserVoice> ownedGraveyardVoices;
+
+                /** Voices that might be sounding, from the main pool and the graveyard respectively.
+
+                    A voice is added in startVoice() when it starts a note (or, for graveyard slots,
+                    when it takes over a stolen voice's state) and is pruned once it is no longer
+                    active. Voices clear themselves from their own render call, possibly on a worker
+                    thread (see ResonanceBKSynthesiser), so pruning happens on the audio thread after
+                    each render pass rather than inside clearCurrentNote(). Rendering and pedal,
+                    controller and allNotesOff handling only walk these lists, so they cost
+                    O(active voices) instead of O(allocated voices).
+
+                    Stopping a voice never removes it from these lists, so it is safe to stop voices
+                    while iterating; only startVoice() (appends) and pruneActiveVoices() modify them.
+                */
+                juce::Array<BKSynthesiserVoice*> activeVoices;
+                juce::Array<BKSynthesiserVoice*> activeGraveyardVoices;
+
+                static void addToActiveList (juce::Array<BKSynthesiserVoice*>& list, BKSynthesiserVoice* voice) noexcept;
+
+                /** Removes voices that have finished from both active lists and updates someVoicesActive. */
+                void pruneActiveVoices() noexcept;
+
+                /** Fades out this synth's share of the voices the voice pool is over its limit by
+                    (see BKVoicePool::setVoiceLimit()): the quietest released voices first, oldest
+                    first among equals. Voices still held by a key or pedal are never culled.
+                */
+                void cullVoicesOverBudget() noexcept;
+
+                /** Most voices one synth will cull in a block, to bound the cost of the search. */
+                static constexpr int kMaxCullsPerBlock = 16;
+
+                /** Returns the first graveyard slot that is not currently active (borrowing one
+                    from the voice pool if need be), or the oldest busy slot if there are none.
+                    Returns nullptr only if there are no slots at all.
                 */
-                BKSynthesiserVoice* findFreeGraveyardSlot() const noexcept;
+                BKSynthesiserVoice* findFreeGraveyardSlot() noexcept;
+
+                /** Finds a voice for noteOn(): an idle voice, a newly borrowed one when using a
+                    voice pool, or (if note stealing is enabled) one to steal. May return nullptr. */
+                BKSynthesiserVoice* obtainVoice (BKSynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber);
+
+                juce::ReferenceCountedArray<BKSynthesiserSound>* sounds = nullptr;
+                juce::ReferenceCountedArray<BKSynthesiserSound> heldSounds; // see SoundSetChange
 
-                juce::ReferenceCountedArray<BKSynthesiserSound>* sounds;
+                /** rebuilt in addSoundSet(); noteOn falls back to scanning every sound if the
+                    soundset has changed size since (e.g. it was still loading) */
+                BKSoundLookupTable soundLookup;
 
                 // juce::ReferenceCountedArray<BKSamplerSound<SFZRegion>>* soundfont_sounds;
                 /** The last pitch-wheel values for each midi channel. */
@@ -400,6 +558,13 @@ protected:
                 virtual void renderVoices (juce::AudioBuffer<float>& outputAudio,
                 int startSample, int numSamples);
 
+                /** Renders activeVoices through the worker pool (see setParallelRendering()).
+                    Returns false without rendering anything if parallel rendering isn't enabled or
+                    isn't worth it for this block, in which case the caller should render them itself.
+                */
+                bool renderActiveVoicesInParallel (juce::AudioBuffer<float>& outputAudio,
+                                                   int startSample, int numSamples);
+
                 // becomes false when there are no voices active; protected so subclasses can update it
                 bool someVoicesActive = true;
 
@@ -462,8 +627,91 @@ private:
                 bool subBlockSubdivisionIsStrict = false;
                 bool shouldStealNotes = true;
                 juce::BigInteger sustainPedalsDown;
+
+                std::shared_ptr<BKRenderWorkerPool> renderWorkers;
+                int numRenderPartitions = 0;
+                int parallelBlockSize = 0;
+                std::vector<juce::AudioBuffer<float>> partitionBuffers;
+
+                // fewer voices than this per group aren't worth handing to another thread
+                static constexpr int kMinVoicesPerPartition = 4;
+
+                std::shared_ptr<BKVoicePool> voicePool;
+                BKVoicePool::Priority voicePriority = BKVoicePool::Priority::normal;
+                SoundSampleType voiceType = SoundSampleType::Unknown;
+                int maxBorrowedVoices = 0;
+                double a4Frequency = 440.;
+
+                /** Borrows a voice from the pool, sets it up for this synth and adds it to list. */
+                BKSynthesiserVoice* borrowVoice (juce::Array<BKSynthesiserVoice*>& list) noexcept;
+
+                /** Takes a finished voice off list and gives it back to the pool (unless this synth owns it). */
+                void returnVoice (juce::Array<BKSynthesiserVoice*>& list, BKSynthesiserVoice* voice) noexcept;
+
+                /** Tells the pool a culled voice has stopped counting as fading (see cullVoicesOverBudget()). */
+                void finishCull (BKSynthesiserVoice* voice) noexcept;
+
+                /** Stops and returns every borrowed voice, and clears the voice and active lists. */
+                void releaseBorrowedVoices();
                 mutable juce::Array<BKSynthesiserVoice*> usableVoicesToStealArray;
 
+                /** Everything addSoundSet() builds on the message thread for applyPendingChanges() to swap in.
+                    Once swapped out, it holds the old set until its last carried-over voice finishes. */
+                struct SoundSetChange
+                {
+                    juce::ReferenceCountedArray<BKSynthesiserSound>* sounds = nullptr;
+                    juce::ReferenceCountedArray<BKSynthesiserSound> heldSounds; // so the last reference to a sound is never dropped on the audio thread
+                    BKSoundLookupTable soundLookup;
+                    juce::OwnedArray<BKSynthesiserVoice> ownedVoices, ownedGraveyardVoices;
+                    juce::Array<BKSynthesiserVoice*> voices, graveyardVoices, activeVoices, activeGraveyardVoices;
+                    juce::Array<BKSynthesiserVoice*> usableVoicesToStealArray;
+                    SoundSampleType voiceType = SoundSampleType::Unknown;
+                    int maxBorrowedVoices = 0;
+
+                    std::atomic<int> voicesStillSounding { 0 }; // this set's voices carried over into the next one
+                    bool isStillInUse() const noexcept { return voicesStillSounding.load (std::memory_order_acquire) > 0; }
+                };
+
+                BKRealtimeExchange<SoundSetChange> pendingSoundSet;
+
+                /** Deletes swapped-out soundsets on the message thread once their last voice has finished. */
+                struct RetiredSoundSetCollector : juce::Timer
+                {
+                    explicit RetiredSoundSetCollector (BKRealtimeExchange<SoundSetChange>& e) : exchange (e) {}
+
+                    void timerCallback() override
+                    {
+                        exchange.collectGarbage();
+                        if (! exchange.hasPending() && ! exchange.hasGarbage())
+                            stopTimer();
+                    }
+
+                    BKRealtimeExchange<SoundSetChange>& exchange;
+                };
+
+                RetiredSoundSetCollector retiredSoundSetCollector { pendingSoundSet };
+
+                /** A voice still sounding from a swapped-out soundset: it stays in the active lists
+                    (so noteOff and the pedals still reach it), but an owned one is never given a new note. */
+                struct RetiringVoice
+                {
+                    BKSynthesiserVoice* voice;
+                    std::atomic<int>* stillSounding; // its old SoundSetChange's count
+                    int midiChannel, midiNote;        // where playingVoicesByNote may still list it
+                };
+
+                juce::Array<RetiringVoice> retiringVoices; // storage reserved in the constructor
+
+                /** Called from applyPendingChanges() with the set about to be swapped in: moves the
+                    voices still sounding into its lists, and stops and returns the rest. */
+                void carryOverSoundingVoices (SoundSetChange& next) noexcept;
+
+                /** Lets go of carried-over voices that have finished (see pruneActiveVoices()). */
+                void pruneRetiringVoices() noexcept;
+                std::atomic<double> requestedSampleRate { 0. };
+                std::atomic<TuningState*> requestedTuning { nullptr };
+                std::atomic<bool> allNotesOffRequested { false };
+
                 bool keyReleaseSynth = false;           // by default, synths play on keyPress (noteOn), not the opposite!
                 bool pedalSynth = false;                // for sustain pedal sounds; will ignore noteOn messages
                 bool sustainPedalAlreadyDown = false;   // to avoid re-triggering of pedalDown sounds
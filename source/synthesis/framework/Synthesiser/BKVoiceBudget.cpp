@@ -0,0 +1,71 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "BKVoiceBudget.h"
+
+BKVoiceBudget::BKVoiceBudget (int maxPolyphonyToUse)
+    : maxPolyphony (juce::jmax (kMinPolyphony, maxPolyphonyToUse)),
+      limit ((float) maxPolyphony),
+      currentLimit (maxPolyphony)
+{
+}
+
+void BKVoiceBudget::prepare (double newSampleRate, int samplesPerBlock)
+{
+    sampleRate = newSampleRate > 0. ? newSampleRate : 44100.;
+
+    // with big buffers a single slow block is a bigger share of the window, so smooth over a few of them
+    const auto blockSeconds = (double) juce::jmax (1, samplesPerBlock) / sampleRate;
+    attackTimeSeconds = (float) juce::jmax (0.02, 2. * blockSeconds);
+    holdTimeSeconds = juce::jmax (0.05, 4. * blockSeconds);
+
+    smoothedLoad = 0.f;
+    limit = (float) maxPolyphony;
+    holdRemaining = 0.;
+    currentLimit.store (maxPolyphony, std::memory_order_relaxed);
+    currentLoad.store (0.f, std::memory_order_relaxed);
+    numOverruns.store (0, std::memory_order_relaxed);
+}
+
+void BKVoiceBudget::setHeadroom (float fractionOfDeadline) noexcept
+{
+    headroom.store (juce::jlimit (0.f, 0.9f, fractionOfDeadline), std::memory_order_relaxed);
+}
+
+int BKVoiceBudget::update (double secondsElapsed, int numSamples, int numVoicesInUse) noexcept
+{
+    if (numSamples <= 0)
+        return currentLimit.load (std::memory_order_relaxed);
+
+    const auto blockSeconds = (double) numSamples / sampleRate;
+    const auto load = (float) (secondsElapsed / blockSeconds);
+
+    if (load > 1.f)
+        numOverruns.fetch_add (1, std::memory_order_relaxed);
+
+    // one-pole smoothing, quicker going up than coming down
+    const auto timeConstant = load > smoothedLoad ? attackTimeSeconds : releaseTimeSeconds;
+    smoothedLoad += (load - smoothedLoad) * (float) (1. - std::exp (-blockSeconds / timeConstant));
+
+    const auto target = 1.f - getHeadroom();
+    holdRemaining -= blockSeconds;
+
+    if (smoothedLoad > target)
+    {
+        if (holdRemaining <= 0. && numVoicesInUse > 0)
+        {
+            const auto affordable = (float) numVoicesInUse * target / smoothedLoad;
+            limit = juce::jmax ((float) kMinPolyphony, juce::jmin (limit, affordable));
+            holdRemaining = holdTimeSeconds;
+        }
+    }
+    else if (smoothedLoad < 0.8f * target)
+    {
+        limit = juce::jmin ((float) maxPolyphony, limit + (float) (maxPolyphony * blockSeconds / recoveryTimeSeconds));
+    }
+
+    const auto newLimit = (int) limit;
+    currentLimit.store (newLimit, std::memory_order_relaxed);
+    currentLoad.store (smoothedLoad, std::memory_order_relaxed);
+    return newLimit;
+}
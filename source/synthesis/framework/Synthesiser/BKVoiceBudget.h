@@ -0,0 +1,80 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Adjusts the engine's polyphony to how long the audio callback is taking.
+//
+
+#ifndef BITKLAVIER2_BKVOICEBUDGET_H
+#define BITKLAVIER2_BKVOICEBUDGET_H
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+//==============================================================================
+/**
+    Works out how many voices the engine can afford to have sounding, by timing each
+    audio callback against its deadline (the block's duration at the host's sample rate).
+
+    The limit only comes down when the smoothed load goes above the target, 1 - headroom.
+    It then drops to the number of voices in use, scaled by target / load, on the assumption
+    that voices are what costs the time. After each cut it waits a short hold time so the
+    smoothed load can catch up. Once the load is comfortably back under the target, the
+    limit climbs back to the full polyphony over a couple of seconds.
+
+    BKVoicePool enforces the limit: it refuses new voices above it, and asks the synths to
+    cull whatever is sounding beyond it (see BKVoicePool::setVoiceLimit()).
+
+    prepare() and setHeadroom() are for the message thread; update() is called once per
+    callback on the audio thread; the getters can be called from anywhere.
+*/
+class BKVoiceBudget
+{
+public:
+    static constexpr float kDefaultHeadroom = 0.25f;
+
+    /** The limit never goes below this, however heavy the load. */
+    static constexpr int kMinPolyphony = 16;
+
+    explicit BKVoiceBudget (int maxPolyphony);
+
+    /** Sets the deadline and smoothing times for this sample rate and block size, and resets the limit. */
+    void prepare (double sampleRate, int samplesPerBlock);
+
+    /** Fraction of each block's deadline to keep free, 0 to 0.9. */
+    void setHeadroom (float fractionOfDeadline) noexcept;
+    float getHeadroom() const noexcept { return headroom.load (std::memory_order_relaxed); }
+
+    /** Audio thread. Takes the time spent on this callback and returns the new voice limit. */
+    int update (double secondsElapsed, int numSamples, int numVoicesInUse) noexcept;
+
+    int getMaxPolyphony() const noexcept { return maxPolyphony; }
+    int getVoiceLimit() const noexcept { return currentLimit.load (std::memory_order_relaxed); }
+
+    /** Smoothed callback time as a fraction of the deadline. */
+    float getLoad() const noexcept { return currentLoad.load (std::memory_order_relaxed); }
+
+    /** Callbacks that took longer than their deadline since prepare(). */
+    juce::uint32 getNumOverruns() const noexcept { return numOverruns.load (std::memory_order_relaxed); }
+
+private:
+    const int maxPolyphony;
+
+    double sampleRate = 44100.;
+    float attackTimeSeconds = 0.02f, releaseTimeSeconds = 0.5f;
+    double holdTimeSeconds = 0.05, recoveryTimeSeconds = 2.;
+
+    // audio thread only
+    float smoothedLoad = 0.f;
+    float limit;
+    double holdRemaining = 0.;
+
+    std::atomic<float> headroom { kDefaultHeadroom };
+    std::atomic<int> currentLimit;
+    std::atomic<float> currentLoad { 0.f };
+    std::atomic<juce::uint32> numOverruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BKVoiceBudget)
+};
+
+#endif //BITKLAVIER2_BKVOICEBUDGET_H
@@ -0,0 +1,118 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "BKVoicePool.h"
+
+BKVoicePool::BKVoicePool (int maxPolyphonyToUse) : maxPolyphony (juce::jmax (1, maxPolyphonyToUse)),
+                                                    voiceLimit (maxPolyphony)
+{
+}
+
+BKVoicePool::~BKVoicePool()
+{
+    // synths hold a shared_ptr to the pool, so nothing should still be borrowing voices
+    jassert (numVoicesInUse.load() == 0);
+}
+
+void BKVoicePool::prepare (SoundSampleType type)
+{
+    auto& set = getSetFor (type);
+    if (! set.voices.isEmpty())
+        return;
+
+    // build them outside the lock; the audio thread can't see this set until it's published below
+    juce::OwnedArray<BKSynthesiserVoice> newVoices;
+    newVoices.ensureStorageAllocated (maxPolyphony);
+    for (int i = 0; i < maxPolyphony; ++i)
+    {
+        if (isSoundfontType (type))
+            newVoices.add (new BKSamplerVoice<SFZRegion>());
+        else
+            newVoices.add (new BKSamplerVoice<juce::AudioFormatReader>());
+    }
+
+    const juce::SpinLock::ScopedLockType sl (lock);
+    set.idle.ensureStorageAllocated (maxPolyphony);
+    for (auto* v : newVoices)
+        set.idle.add (v);
+    set.voices.swapWith (newVoices);
+}
+
+int BKVoicePool::getReserveFor (Priority priority, int limit) noexcept
+{
+    switch (priority)
+    {
+        case Priority::background:
+            return limit / 4;
+        case Priority::normal:
+            return limit / 16;
+        case Priority::foreground:
+        default:
+            return 0;
+    }
+}
+
+BKSynthesiserVoice* BKVoicePool::acquire (SoundSampleType type, Priority priority) noexcept
+{
+    auto& set = getSetFor (type);
+
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    const auto limit = voiceLimit.load (std::memory_order_relaxed);
+    if (set.idle.isEmpty() || numVoicesInUse.load (std::memory_order_relaxed) + getReserveFor (priority, limit) >= limit)
+    {
+        numRefusals.fetch_add (1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    numVoicesInUse.fetch_add (1, std::memory_order_relaxed);
+    return set.idle.removeAndReturn (set.idle.size() - 1);
+}
+
+void BKVoicePool::release (BKSynthesiserVoice* voice, SoundSampleType type) noexcept
+{
+    jassert (voice != nullptr && ! voice->isVoiceActive());
+
+    auto& set = getSetFor (type);
+
+    const juce::SpinLock::ScopedLockType sl (lock);
+
+    // storage for every voice was reserved in prepare(), so this never allocates
+    jassert (set.idle.size() < set.voices.size());
+    set.idle.add (voice);
+    numVoicesInUse.fetch_sub (1, std::memory_order_relaxed);
+}
+
+void BKVoicePool::setVoiceLimit (int newLimit) noexcept
+{
+    newLimit = juce::jlimit (1, maxPolyphony, newLimit);
+    voiceLimit.store (newLimit, std::memory_order_relaxed);
+
+    const auto numSounding = numVoicesInUse.load (std::memory_order_relaxed) - numFading.load (std::memory_order_relaxed);
+    cullQuota.store (juce::jmax (0, numSounding - newLimit), std::memory_order_relaxed);
+}
+
+int BKVoicePool::claimVoicesToCull (int maxVoices) noexcept
+{
+    auto available = cullQuota.load (std::memory_order_relaxed);
+    int claimed;
+    do
+    {
+        claimed = juce::jmin (available, maxVoices);
+        if (claimed <= 0)
+            return 0;
+    } while (! cullQuota.compare_exchange_weak (available, available - claimed, std::memory_order_relaxed));
+
+    return claimed;
+}
+
+void BKVoicePool::voicesCulled (int numVoicesCulled, int numClaimed) noexcept
+{
+    jassert (numVoicesCulled <= numClaimed);
+    numCulled.fetch_add ((juce::uint32) numVoicesCulled, std::memory_order_relaxed);
+    numFading.fetch_add (numVoicesCulled, std::memory_order_relaxed);
+
+    // another synth may have released voices it can cull
+    if (numClaimed > numVoicesCulled)
+        cullQuota.fetch_add (numClaimed - numVoicesCulled, std::memory_order_relaxed);
+}
@@ -0,0 +1,123 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Engine-wide pool of sampler voices shared by every BKSynthesiser.
+//
+
+#ifndef BITKLAVIER2_BKVOICEPOOL_H
+#define BITKLAVIER2_BKVOICEPOOL_H
+
+#include <juce_core/juce_core.h>
+#include "Sample.h"
+
+//==============================================================================
+/**
+    A pool of BKSamplerVoices, owned by the SoundEngine and lent out to synthesisers
+    as they start notes.
+
+    Without it, every BKSynthesiser preallocates its full polyphony (plus graveyard
+    slots) up front, so memory grows with the number of preparations in the gallery
+    rather than with how many notes are actually sounding. With it, synths hold only
+    the voices they are currently playing and give them back once they go silent.
+
+    There is one set of voices per voice type (wav samples and soundfonts need different
+    BKSamplerVoice instantiations), each allocated the first time a synth of that type
+    asks for it. A global polyphony budget limits how many voices can be out at once
+    across all types; lower-priority synths are refused before the budget is reached,
+    so that there is always some headroom left for the foreground (Direct) synths.
+    The budget can be lowered below the pool's size while the engine is short of CPU
+    (see BKVoiceBudget and setVoiceLimit()).
+
+    prepare() allocates and must be called from the message thread. acquire() and
+    release() are called from the audio thread(s) and never allocate.
+*/
+class BKVoicePool
+{
+public:
+    /** How important a synth's notes are when voices are scarce. */
+    enum class Priority
+    {
+        background = 0, // hammers, release resonance, pedal, Resonance
+        normal,         // Synchronic, Nostalgic
+        foreground      // Direct
+    };
+
+    static constexpr int kDefaultPolyphony = 1024;
+
+    explicit BKVoicePool (int maxPolyphony = kDefaultPolyphony);
+    ~BKVoicePool();
+
+    /** Allocates the voices for this type of sound, if that hasn't been done already. */
+    void prepare (SoundSampleType type);
+
+    /** Lends out an idle voice that can play this type of sound.
+        Returns nullptr if the pool hasn't been prepared for this type, or if lending
+        another voice at this priority would eat into the headroom kept for higher priorities.
+    */
+    BKSynthesiserVoice* acquire (SoundSampleType type, Priority priority) noexcept;
+
+    /** Gives back a voice obtained from acquire() with the same type. The voice must not be playing. */
+    void release (BKSynthesiserVoice* voice, SoundSampleType type) noexcept;
+
+    int getMaxPolyphony() const noexcept { return maxPolyphony; }
+
+    /** Sets how many voices may be out at once, up to getMaxPolyphony(). Audio thread, once per block.
+
+        If more voices than that are sounding (not counting ones already fading out after
+        being culled), the excess becomes this block's cull quota, which the synths take
+        from with claimVoicesToCull() as they render.
+    */
+    void setVoiceLimit (int newLimit) noexcept;
+    int getVoiceLimit() const noexcept { return voiceLimit.load (std::memory_order_relaxed); }
+
+    /** Takes up to maxVoices from this block's cull quota and returns how many the caller should cull. */
+    int claimVoicesToCull (int maxVoices) noexcept;
+
+    /** Reports how many of the claimed voices were culled; the rest go back into the quota. */
+    void voicesCulled (int numCulled, int numClaimed) noexcept;
+
+    /** Called once a culled voice has finished fading out (or been reused for another note). */
+    void cullFinished() noexcept { numFading.fetch_sub (1, std::memory_order_relaxed); }
+
+    /** Number of voices culled to stay within the voice limit since construction. */
+    juce::uint32 getNumCulledVoices() const noexcept { return numCulled.load (std::memory_order_relaxed); }
+
+    /** Number of voices currently lent out, across all types. */
+    int getNumVoicesInUse() const noexcept { return numVoicesInUse.load (std::memory_order_relaxed); }
+
+    /** Number of acquire() calls that were refused since construction. */
+    juce::uint32 getNumRefusals() const noexcept { return numRefusals.load (std::memory_order_relaxed); }
+
+private:
+    struct VoiceSet
+    {
+        juce::OwnedArray<BKSynthesiserVoice> voices;
+        juce::Array<BKSynthesiserVoice*> idle;
+    };
+
+    static bool isSoundfontType (SoundSampleType type) noexcept { return type == SoundSampleType::SFZ; }
+    VoiceSet& getSetFor (SoundSampleType type) noexcept { return isSoundfontType (type) ? soundfontVoices : sampleVoices; }
+
+    /** Number of voices (out of limit) that must stay free for higher priorities before a request at this priority is refused. */
+    static int getReserveFor (Priority priority, int limit) noexcept;
+
+    const int maxPolyphony;
+
+    VoiceSet sampleVoices;
+    VoiceSet soundfontVoices;
+
+    // guards the idle lists; only ever held for a push or pop
+    juce::SpinLock lock;
+
+    std::atomic<int> numVoicesInUse { 0 };
+    std::atomic<int> voiceLimit;
+    std::atomic<int> cullQuota { 0 };
+    std::atomic<int> numFading { 0 };
+    std::atomic<juce::uint32> numRefusals { 0 };
+    std::atomic<juce::uint32> numCulled { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BKVoicePool)
+};
+
+#endif //BITKLAVIER2_BKVOICEPOOL_H
@@ -0,0 +1,233 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "CompactSampleData.h"
+
+namespace
+{
+    // frames decoded per read() call, so a 90 s file never needs a full float copy alongside the compact one
+    constexpr int kChunkFrames = 1 << 15;
+
+    void writeInt24 (uint8_t* dest, int32_t value) noexcept
+    {
+        dest[0] = (uint8_t) (value & 0xff);
+        dest[1] = (uint8_t) ((value >> 8) & 0xff);
+        dest[2] = (uint8_t) ((value >> 16) & 0xff);
+    }
+}
+
+namespace bitklavier::samplestorage
+{
+    SampleStorage fromString (const juce::String& name)
+    {
+        if (name == "int16")
+            return SampleStorage::int16;
+        if (name == "int24")
+            return SampleStorage::int24;
+        if (name == "float")
+            return SampleStorage::float32;
+        return SampleStorage::native;
+    }
+
+    juce::String toString (SampleStorage storage)
+    {
+        switch (storage)
+        {
+            case SampleStorage::int16:   return "int16";
+            case SampleStorage::int24:   return "int24";
+            case SampleStorage::float32: return "float";
+            case SampleStorage::native:
+            default:                     return "native";
+        }
+    }
+}
+
+CompactSampleData::CompactSampleData (juce::AudioFormatReader& source, int numFrames, SampleStorage requested)
+    : storage (resolve (source, requested)),
+      numChannels (juce::jlimit (1, 2, (int) source.numChannels)),
+      length (juce::jmax (0, numFrames)),
+      bytesPerChannel ((size_t) (length + kPadding) * bytesPerFrame (storage)),
+      data (bytesPerChannel * (size_t) numChannels, true),
+      base (data.get()),
+      channelOffset (bytesPerChannel)
+{
+    if (length == 0)
+        return;
+
+    if (storage != SampleStorage::float32 && ! source.usesFloatingPointData)
+        readIntegers (source);
+    else
+        readFloats (source);
+}
+
+CompactSampleData::CompactSampleData (std::shared_ptr<const MappedWaveFile> file, int numFrames)
+    : storage (file->isFloatingPoint() ? SampleStorage::float32
+               : file->getBitsPerSample() == 16 ? SampleStorage::int16 : SampleStorage::int24),
+      numChannels (file->getNumChannels()),
+      length ((int) juce::jmax ((juce::int64) 0, juce::jmin ((juce::int64) numFrames, file->getNumFrames() - kPadding))),
+      bytesPerChannel ((size_t) length * bytesPerFrame (storage)),
+      mapping (file),
+      base (file->getFrames()),
+      channelOffset (bytesPerFrame (storage)),
+      stride (numChannels)
+{
+    // the file's own samples, so the scale is its LSB, as for decoded integer files
+    if (storage == SampleStorage::int16)
+        scale = 1.f / 32768.f;
+    else if (storage == SampleStorage::int24)
+        scale = 1.f / 2147483648.f;
+
+    file->prefetch (length + kPadding);
+}
+
+CompactSampleData::CompactSampleData (const View& view)
+    : storage (view.storage),
+      numChannels (view.numChannels),
+      length (view.length),
+      scale (view.scale),
+      bytesPerChannel ((size_t) (length + kPadding) * bytesPerFrame (storage)),
+      mapping (view.owner),
+      base (view.frames),
+      channelOffset (bytesPerChannel)
+{
+    jassert (storage != SampleStorage::native);
+    prefetchMappedPages (base, getSizeInBytes());
+}
+
+SampleStorage CompactSampleData::resolve (const juce::AudioFormatReader& source, SampleStorage requested)
+{
+    if (requested != SampleStorage::native)
+        return requested;
+
+    if (source.usesFloatingPointData || source.bitsPerSample > 24)
+        return SampleStorage::float32;
+
+    return source.bitsPerSample <= 16 ? SampleStorage::int16 : SampleStorage::int24;
+}
+
+size_t CompactSampleData::bytesPerFrame (SampleStorage storage)
+{
+    switch (storage)
+    {
+        case SampleStorage::int16: return sizeof (int16_t);
+        case SampleStorage::int24: return 3;
+        case SampleStorage::native:
+        case SampleStorage::float32:
+        default:                   return sizeof (float);
+    }
+}
+
+/*
+ * Integer files: read() hands back left-justified int32s, so the stored values are the file's
+ * own samples (rounded if we're storing at a lower depth than the file).
+ */
+void CompactSampleData::readIntegers (juce::AudioFormatReader& source)
+{
+    scale = storage == SampleStorage::int16 ? 1.f / 32768.f : 1.f / 2147483648.f;
+
+    juce::HeapBlock<int> left (kChunkFrames), right (kChunkFrames);
+    int* dest[] = { left.get(), right.get() };
+
+    const int total = length + kPadding;
+    for (int start = 0; start < total; start += kChunkFrames)
+    {
+        const int n = juce::jmin (kChunkFrames, total - start);
+        source.read (dest, 2, start, n, true);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const int* in = dest[ch];
+
+            if (storage == SampleStorage::int16)
+            {
+                auto* out = reinterpret_cast<int16_t*> (channel (ch)) + start;
+                for (int i = 0; i < n; ++i)
+                    out[i] = (int16_t) juce::jlimit<int64_t> (-32768, 32767, ((int64_t) in[i] + 0x8000) >> 16);
+            }
+            else
+            {
+                auto* out = channel (ch) + 3 * (size_t) start;
+                for (int i = 0; i < n; ++i)
+                    writeInt24 (out + 3 * i, (int32_t) juce::jlimit<int64_t> (-8388608, 8388607, ((int64_t) in[i] + 0x80) >> 8));
+            }
+        }
+    }
+}
+
+/*
+ * Float files, and anything being stored as float. When quantising a float file, the peak
+ * maps to full scale and the scale factor undoes it.
+ */
+void CompactSampleData::readFloats (juce::AudioFormatReader& source)
+{
+    float fullScale = 1.f;
+    if (storage != SampleStorage::float32)
+    {
+        juce::Range<float> levels[2];
+        source.readMaxLevels (0, length, levels, numChannels);
+
+        float peak = 0.f;
+        for (int ch = 0; ch < numChannels; ++ch)
+            peak = juce::jmax (peak, std::abs (levels[ch].getStart()), std::abs (levels[ch].getEnd()));
+        if (peak <= 0.f)
+            peak = 1.f;
+
+        fullScale = storage == SampleStorage::int16 ? 32767.f : 8388607.f;
+        scale = storage == SampleStorage::int16 ? peak / fullScale : peak / (fullScale * 256.f);
+        fullScale /= peak;
+    }
+
+    juce::AudioBuffer<float> chunk (2, kChunkFrames);
+
+    const int total = length + kPadding;
+    for (int start = 0; start < total; start += kChunkFrames)
+    {
+        const int n = juce::jmin (kChunkFrames, total - start);
+        source.read (&chunk, 0, n, start, true, true);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* in = chunk.getReadPointer (ch);
+
+            switch (storage)
+            {
+                case SampleStorage::int16:
+                {
+                    auto* out = reinterpret_cast<int16_t*> (channel (ch)) + start;
+                    for (int i = 0; i < n; ++i)
+                        out[i] = (int16_t) juce::jlimit (-32768, 32767, juce::roundToInt (in[i] * fullScale));
+                    break;
+                }
+                case SampleStorage::int24:
+                {
+                    auto* out = channel (ch) + 3 * (size_t) start;
+                    for (int i = 0; i < n; ++i)
+                        writeInt24 (out + 3 * i, juce::jlimit (-8388608, 8388607, juce::roundToInt (in[i] * fullScale)));
+                    break;
+                }
+                case SampleStorage::native:
+                case SampleStorage::float32:
+                default:
+                    std::memcpy (reinterpret_cast<float*> (channel (ch)) + start, in, sizeof (float) * (size_t) n);
+                    break;
+            }
+        }
+    }
+}
+
+float CompactSampleData::getRMSLevel (int ch, int startFrame, int numFrames) const
+{
+    numFrames = juce::jmin (numFrames, length - startFrame);
+    if (numFrames <= 0 || ! juce::isPositiveAndBelow (ch, numChannels))
+        return 0.f;
+
+    return forEachFormat ([&] (const auto& frames, float frameScale) {
+        double sum = 0.;
+        for (int i = startFrame; i < startFrame + numFrames; ++i)
+        {
+            const auto s = (double) (ch == 0 ? frames.left (i) : frames.right (i)) * frameScale;
+            sum += s * s;
+        }
+        return (float) std::sqrt (sum / numFrames);
+    });
+}
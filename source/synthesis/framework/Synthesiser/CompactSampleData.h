@@ -0,0 +1,185 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// In-memory storage for decoded bK format samples.
+//
+
+#pragma once
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <cstdint>
+#include "MappedWaveFile.h"
+
+/**
+ * How Sample<juce::AudioFormatReader> keeps its audio in memory.
+ *
+ * native keeps integer files at their own bit depth (int16 for 16-bit and below, packed
+ * int24 for 17-24 bit), which is lossless and a half or three quarters the size of float;
+ * float and 32-bit files stay float.
+ */
+enum class SampleStorage
+{
+    native,
+    int16,
+    int24,
+    float32
+};
+
+namespace bitklavier::samplestorage
+{
+    SampleStorage fromString (const juce::String& name);
+    juce::String toString (SampleStorage storage);
+
+    /*
+     * Read-only views of one sample's frames, one per storage format. left()/right() return
+     * the raw stored value as a float; multiply by CompactSampleData::getScale() to get audio.
+     * Mono samples point both channels at the same data. stride is the number of values from one
+     * frame to the next: 1 for planar data, the channel count for interleaved (mapped) data.
+     */
+    struct Float32Frames
+    {
+        const float* l;
+        const float* r;
+        int stride = 1;
+
+        float left (int i) const noexcept { return l[i * stride]; }
+        float right (int i) const noexcept { return r[i * stride]; }
+    };
+
+    struct Int16Frames
+    {
+        const int16_t* l;
+        const int16_t* r;
+        int stride = 1;
+
+        float left (int i) const noexcept { return (float) l[i * stride]; }
+        float right (int i) const noexcept { return (float) r[i * stride]; }
+    };
+
+    struct Int24Frames
+    {
+        const uint8_t* l;
+        const uint8_t* r;
+        int stride = 1;
+
+        // 3 bytes, little endian, decoded into the top of an int32 (so the scale is 2^-31)
+        static float decode (const uint8_t* p, int i) noexcept
+        {
+            p += 3 * i;
+            return (float) (int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24);
+        }
+
+        float left (int i) const noexcept { return decode (l, i * stride); }
+        float right (int i) const noexcept { return decode (r, i * stride); }
+    };
+}
+
+/**
+ * Planar sample data in float, int16 or packed int24, with one scale factor for the whole sample.
+ *
+ * Integer files are stored exactly as they are on disk, with the format's LSB as the scale.
+ * Float files asked to be stored as integers are normalised to their peak first, so quiet
+ * samples keep all of the available resolution.
+ *
+ * Voices read it through forEachFormat(), which hands the matching *Frames view and the scale to
+ * the render code; the scale gets folded into the voice gain, so conversion costs one int to
+ * float per read.
+ *
+ * It can also be a view of a memory-mapped WAV file (see MappedWaveFile), in which case nothing
+ * is decoded or copied: the frames are the file's own interleaved ones, in the file's format.
+ * Or a view of planar frames decoded on an earlier run and mapped back in from a soundset cache
+ * file (see SoundsetCacheFile).
+ */
+class CompactSampleData
+{
+public:
+    // zeroed frames past the end, so interpolation can read pos + 1 without checking
+    static constexpr int kPadding = 4;
+
+    /** Decodes the first numFrames frames (up to two channels) of source. */
+    CompactSampleData (juce::AudioFormatReader& source, int numFrames, SampleStorage requested);
+
+    /**
+     * Reads the first numFrames frames straight from a mapped file, which this keeps open.
+     * There's no zeroed padding in a file, so the last kPadding frames of it are left out
+     * of the length instead.
+     */
+    CompactSampleData (std::shared_ptr<const MappedWaveFile> file, int numFrames);
+
+    /** Planar frames laid out the way the decoding constructor lays them out, in memory owned elsewhere. */
+    struct View
+    {
+        std::shared_ptr<const void> owner; // kept alive as long as the view is
+        const uint8_t* frames;             // channel 0, then channel 1, each with its kPadding zeroed frames
+        SampleStorage storage;             // never native
+        int numChannels;
+        int length;
+        float scale;
+    };
+
+    explicit CompactSampleData (const View& view);
+
+    /** The storage actually used, never native. */
+    SampleStorage getStorage() const noexcept { return storage; }
+    int getNumChannels() const noexcept { return numChannels; }
+    int getLength() const noexcept { return length; }
+    float getScale() const noexcept { return scale; }
+
+    /** Memory used by the frames; for mapped data that's page cache, not heap. */
+    size_t getSizeInBytes() const noexcept { return bytesPerChannel * (size_t) numChannels; }
+    bool isMapped() const noexcept { return mapping != nullptr; }
+
+    /** Decoded (not mapped) data only: channel ch's frames, kPadding included, getSizeInBytes() / getNumChannels() long. */
+    const uint8_t* getPlanarChannel (int ch) const noexcept { jassert (! isMapped()); return channel (ch); }
+
+    static size_t bytesPerFrame (SampleStorage storage);
+
+    /** Calls fn (frames, scale) with the view that matches the storage format. */
+    template <typename Fn>
+    decltype (auto) forEachFormat (Fn&& fn) const
+    {
+        using namespace bitklavier::samplestorage;
+
+        const auto* l = channel (0);
+        const auto* r = channel (numChannels > 1 ? 1 : 0);
+
+        switch (storage)
+        {
+            case SampleStorage::int16:
+                return fn (Int16Frames { reinterpret_cast<const int16_t*> (l), reinterpret_cast<const int16_t*> (r), stride }, scale);
+            case SampleStorage::int24:
+                return fn (Int24Frames { l, r, stride }, scale);
+            case SampleStorage::native:
+            case SampleStorage::float32:
+            default:
+                return fn (Float32Frames { reinterpret_cast<const float*> (l), reinterpret_cast<const float*> (r), stride }, scale);
+        }
+    }
+
+    /** Same as juce::AudioBuffer::getRMSLevel() on the decoded float data. */
+    float getRMSLevel (int channel, int startFrame, int numFrames) const;
+
+private:
+    static SampleStorage resolve (const juce::AudioFormatReader& source, SampleStorage requested);
+
+    // planar: one block per channel; mapped: interleaved, so channels are one value apart
+    const uint8_t* channel (int ch) const noexcept { return base + channelOffset * (size_t) ch; }
+    uint8_t* channel (int ch) noexcept { return data.get() + channelOffset * (size_t) ch; }
+
+    void readIntegers (juce::AudioFormatReader& source);
+    void readFloats (juce::AudioFormatReader& source);
+
+    SampleStorage storage;
+    int numChannels;
+    int length;
+    float scale = 1.f;
+    size_t bytesPerChannel;
+    juce::HeapBlock<uint8_t> data;
+
+    std::shared_ptr<const void> mapping; // the MappedWaveFile or cache file the frames live in
+    const uint8_t* base = nullptr;
+    size_t channelOffset = 0;
+    int stride = 1;
+
+    JUCE_DECLARE_NON_COPYABLE (CompactSampleData)
+};
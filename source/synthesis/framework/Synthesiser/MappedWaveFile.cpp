@@ -0,0 +1,191 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "MappedWaveFile.h"
+
+#if ! JUCE_WINDOWS
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr int kFormatPCM = 1;
+    constexpr int kFormatFloat = 3;
+    constexpr int kFormatExtensible = 0xfffe;
+
+    uint32_t readLE32 (const uint8_t* p) noexcept
+    {
+        return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+    }
+
+    uint16_t readLE16 (const uint8_t* p) noexcept
+    {
+        return (uint16_t) (p[0] | p[1] << 8);
+    }
+}
+
+/**
+ * A whole file mapped read-only. juce::MemoryMappedFile keeps its file descriptor open for as long
+ * as the mapping lives, which for thousands of samples runs into the open file limit (256 by
+ * default on macOS); on POSIX systems this closes it straight after mmap() instead.
+ */
+class MappedWaveFile::Mapping
+{
+public:
+    explicit Mapping (const juce::File& file)
+    {
+       #if JUCE_WINDOWS
+        // handles aren't in short supply on Windows
+        mapped = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+        data = mapped->getData();
+        size = mapped->getSize();
+       #else
+        const int fd = ::open (file.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (fstat (fd, &info) == 0 && info.st_size > 0)
+        {
+            auto* m = mmap (nullptr, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (m != MAP_FAILED)
+            {
+                data = m;
+                size = (size_t) info.st_size;
+            }
+        }
+
+        ::close (fd);
+       #endif
+    }
+
+    ~Mapping()
+    {
+       #if ! JUCE_WINDOWS
+        if (data != nullptr)
+            munmap (data, size);
+       #endif
+    }
+
+    const void* getData() const noexcept { return data; }
+    size_t getSize() const noexcept { return size; }
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+
+   #if JUCE_WINDOWS
+    std::unique_ptr<juce::MemoryMappedFile> mapped;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (Mapping)
+};
+
+std::shared_ptr<const MappedWaveFile> MappedWaveFile::open (const juce::File& file)
+{
+    if (! file.existsAsFile())
+        return nullptr;
+
+    auto mapping = std::make_unique<Mapping> (file);
+    if (mapping->getData() == nullptr)
+        return nullptr;
+
+    std::shared_ptr<MappedWaveFile> wave (new MappedWaveFile (std::move (mapping)));
+    if (! wave->parse())
+        return nullptr;
+
+    return wave;
+}
+
+MappedWaveFile::MappedWaveFile (std::unique_ptr<Mapping> mapping)
+    : map (std::move (mapping))
+{
+}
+
+MappedWaveFile::~MappedWaveFile() = default;
+
+bool MappedWaveFile::parse()
+{
+    const auto* data = static_cast<const uint8_t*> (map->getData());
+    const auto size = map->getSize();
+
+    if (size < 12 || std::memcmp (data, "RIFF", 4) != 0 || std::memcmp (data + 8, "WAVE", 4) != 0)
+        return false;
+
+    int format = 0;
+    int blockAlign = 0;
+    size_t dataStart = 0, dataSize = 0;
+
+    // chunks are word aligned; a truncated file just ends the walk
+    for (size_t pos = 12; pos + 8 <= size;)
+    {
+        const auto* chunk = data + pos;
+        const auto chunkSize = (size_t) readLE32 (chunk + 4);
+        const auto* body = chunk + 8;
+        const auto available = size - (pos + 8);
+
+        if (std::memcmp (chunk, "fmt ", 4) == 0 && chunkSize >= 16 && available >= 16)
+        {
+            format = readLE16 (body);
+            numChannels = readLE16 (body + 2);
+            sampleRate = (double) readLE32 (body + 4);
+            blockAlign = readLE16 (body + 12);
+            bitsPerSample = readLE16 (body + 14);
+
+            // the sub-format GUID starts with the plain format tag
+            if (format == kFormatExtensible && chunkSize >= 40 && available >= 40)
+                format = readLE16 (body + 24);
+        }
+        else if (std::memcmp (chunk, "data", 4) == 0)
+        {
+            dataStart = pos + 8;
+            dataSize = juce::jmin (chunkSize, available);
+            break;
+        }
+
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    floatingPoint = format == kFormatFloat;
+
+    const bool readable = (format == kFormatPCM && (bitsPerSample == 16 || bitsPerSample == 24))
+                       || (format == kFormatFloat && bitsPerSample == 32);
+
+    if (! readable || dataStart == 0 || sampleRate <= 0. || (numChannels != 1 && numChannels != 2)
+        || blockAlign != numChannels * bitsPerSample / 8)
+        return false;
+
+    // voices read 16-bit and float samples in place, so they have to be aligned for it; chunks are
+    // only word aligned, so float data after an odd-sized fmt chunk (e.g. 18 bytes) often isn't
+    const auto alignment = (uintptr_t) (floatingPoint ? alignof (float) : bitsPerSample == 16 ? alignof (int16_t) : 1);
+    if (((uintptr_t) (data + dataStart) & (alignment - 1)) != 0)
+        return false;
+
+    frames = data + dataStart;
+    bytesPerFrame = (size_t) blockAlign;
+    numFrames = (juce::int64) (dataSize / bytesPerFrame);
+    return numFrames > 0;
+}
+
+void MappedWaveFile::prefetch (juce::int64 numFramesToFetch) const
+{
+    prefetchMappedPages (frames, (size_t) juce::jlimit ((juce::int64) 0, numFrames, numFramesToFetch) * bytesPerFrame);
+}
+
+void prefetchMappedPages (const void* start, size_t numBytes)
+{
+   #if ! JUCE_WINDOWS
+    const auto pageSize = (uintptr_t) sysconf (_SC_PAGESIZE);
+    const auto first = (uintptr_t) start & ~(pageSize - 1);
+    const auto end = (uintptr_t) start + numBytes;
+
+    if (end > first)
+        posix_madvise ((void*) first, end - first, POSIX_MADV_WILLNEED);
+   #else
+    // no portable equivalent before Windows 8; pages fault in as they're first read
+    juce::ignoreUnused (start, numBytes);
+   #endif
+}
@@ -0,0 +1,67 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Read-only memory mapping of a WAV file, for bK format samples played straight from the page cache.
+//
+
+#pragma once
+#include <juce_core/juce_core.h>
+#include <cstdint>
+
+/** Asks the OS to start reading a range of a memory-mapped file into the page cache, without waiting for it. */
+void prefetchMappedPages (const void* start, size_t numBytes);
+
+/**
+ * A WAV file mapped read-only, with its data chunk located.
+ *
+ * Only formats voices can read in place are mapped: 16- and 24-bit PCM and 32-bit float, mono
+ * or stereo (WAVE_FORMAT_EXTENSIBLE included), with 16-bit and float data aligned for reading as
+ * int16_t and float. open() returns nullptr for anything else, or if the file can't be mapped,
+ * and the caller decodes the file as usual.
+ *
+ * The pages belong to the OS page cache, so every process and plugin instance playing the same
+ * file shares one physical copy, and opening costs a header parse rather than a decode. The
+ * catch is that pages not read yet, or evicted under memory pressure, fault in on whichever
+ * thread touches them; prefetch() asks the OS to read them in ahead of time.
+ *
+ * The file is closed as soon as it's mapped (the mapping keeps its pages reachable), so a
+ * soundset of mapped samples doesn't hold one file handle per sample.
+ */
+class MappedWaveFile
+{
+public:
+    static std::shared_ptr<const MappedWaveFile> open (const juce::File& file);
+
+    int getNumChannels() const noexcept { return numChannels; }
+    int getBitsPerSample() const noexcept { return bitsPerSample; }
+    bool isFloatingPoint() const noexcept { return floatingPoint; }
+    double getSampleRate() const noexcept { return sampleRate; }
+    juce::int64 getNumFrames() const noexcept { return numFrames; }
+    size_t getBytesPerFrame() const noexcept { return bytesPerFrame; }
+
+    /** The first frame of the data chunk; frames are interleaved. */
+    const uint8_t* getFrames() const noexcept { return frames; }
+
+    /** Starts reading the first numFramesToFetch frames into the page cache without waiting for them. */
+    void prefetch (juce::int64 numFramesToFetch) const;
+
+    ~MappedWaveFile();
+
+private:
+    class Mapping;
+
+    explicit MappedWaveFile (std::unique_ptr<Mapping> mapping);
+    bool parse();
+
+    std::unique_ptr<Mapping> map;
+    const uint8_t* frames = nullptr;
+    juce::int64 numFrames = 0;
+    size_t bytesPerFrame = 0;
+    int numChannels = 0;
+    int bitsPerSample = 0;
+    bool floatingPoint = false;
+    double sampleRate = 0.;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MappedWaveFile)
+};
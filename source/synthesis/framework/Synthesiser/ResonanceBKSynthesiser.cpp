@@ -8,110 +8,6 @@
 
 #include "ResonanceBKSynthesiser.h"
 
-//==============================================================================
-// WorkerThread: wakes on a WaitableEvent (auto-reset, acts as binary semaphore),
-// renders its assigned voices into its scratch buffer, then participates in the
-// completion barrier. Called exactly once per audio block — no re-entrancy.
-//==============================================================================
-class ResonanceBKSynthesiser::WorkerThread final : private juce::Thread
-{
-public:
-    using Thread::isThreadRunning;
-
-    explicit WorkerThread (const WorkerThreadOptions& opts)
-        : juce::Thread ("ResonanceBKSynthWorker"),
-          options (opts)
-    {
-        startRealtimeThread (
-            juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime (
-                options.samplesPerBlock, options.sampleRate));
-    }
-
-    ~WorkerThread() override
-    {
-        signalThreadShouldExit();
-        startEvent.signal();   // unblock the thread so it can see threadShouldExit()
-        stopThread (-1);
-    }
-
-    //==========================================================================
-    // Called from the audio thread before signalStart().
-    // Sets the per-block context and queues voice pointers.
-    int prepareAndQueueVoices (juce::Span<BKSynthesiserVoice* const> voiceSpan,
-                               juce::AudioBuffer<float>* scratchBuf,
-                               int startSample,
-                               int numSamples)
-    {
-        pendingScratchBuffer.store (scratchBuf, std::memory_order_relaxed);
-        pendingStartSample.store   (startSample, std::memory_order_relaxed);
-        pendingNumSamples.store    (numSamples,  std::memory_order_relaxed);
-
-        size_t spanIndex = 0;
-        const auto write = voiceFifo.write ((int) voiceSpan.size());
-        write.forEach ([&] (int dstIdx)
-        {
-            voiceQueue[(size_t) dstIdx] = voiceSpan[spanIndex++];
-        });
-
-        return write.blockSize1 + write.blockSize2;
-    }
-
-    // Called once per block after all voices have been queued.
-    // Auto-reset WaitableEvent: at most one pending wakeup, cannot accumulate.
-    void signalStart()
-    {
-        startEvent.signal();
-    }
-
-private:
-    void run() override
-    {
-        juce::WorkgroupToken token;
-        if (options.workgroup)
-            options.workgroup.join (token);
-
-        while (! threadShouldExit())
-        {
-            // Block until the audio thread signals one block of work
-            startEvent.wait();
-
-            if (threadShouldExit())
-                break;
-
-            auto* scratchBuf   = pendingScratchBuffer.load (std::memory_order_acquire);
-            const int start    = pendingStartSample.load   (std::memory_order_acquire);
-            const int nSamples = pendingNumSamples.load    (std::memory_order_acquire);
-
-            if (scratchBuf != nullptr)
-            {
-                voiceFifo.read (voiceFifo.getNumReady()).forEach ([&] (int srcIdx)
-                {
-                    voiceQueue[(size_t) srcIdx]->renderNextBlock (*scratchBuf, start, nSamples);
-                });
-            }
-
-            options.barrier->arriveAndWait();
-        }
-    }
-
-    static constexpr int maxVoicesPerWorker = 512;
-
-    WorkerThreadOptions options;
-
-    // Auto-reset: signal() stores at most one pending wakeup
-    juce::WaitableEvent startEvent { false };
-
-    std::array<BKSynthesiserVoice*, maxVoicesPerWorker> voiceQueue {};
-    juce::AbstractFifo voiceFifo { maxVoicesPerWorker };
-
-    std::atomic<juce::AudioBuffer<float>*> pendingScratchBuffer { nullptr };
-    std::atomic<int> pendingStartSample { 0 };
-    std::atomic<int> pendingNumSamples  { 0 };
-
-    JUCE_DECLARE_NON_COPYABLE (WorkerThread)
-    JUCE_DECLARE_NON_MOVEABLE (WorkerThread)
-};
-
 //==============================================================================
 BKSynthesiserVoice* ResonanceBKSynthesiser::findVoiceToSteal (BKSynthesiserSound* soundToPlay,
                                                                int /*midiChannel*/,
@@ -119,8 +15,6 @@ BKSynthesiserVoice* ResonanceBKSynthesiser::findVoiceToSteal (BKSynthesiserSound
 {
     jassert (!voices.isEmpty());
 
-    const juce::ScopedLock sl (stealLock);
-
     // Identify the lowest and highest non-released notes to protect them.
     BKSynthesiserVoice* low = nullptr;
     BKSynthesiserVoice* top = nullptr;
@@ -210,34 +104,7 @@ ResonanceBKSynthesiser::ResonanceBKSynthesiser (EnvParams& envParams,
 {
 }
 
-ResonanceBKSynthesiser::~ResonanceBKSynthesiser()
-{
-    for (auto& wt : workerThreads)
-        wt.reset();
-}
-
-//==============================================================================
-void ResonanceBKSynthesiser::prepareWorkgroup (juce::AudioWorkgroup workgroup,
-                                               int samplesPerBlock,
-                                               double sampleRate,
-                                               int /*numChannels*/)
-{
-    currentSamplesPerBlock = samplesPerBlock;
-    currentNumChannels     = 2;  // voices render stereo only
-
-    for (auto& wt : workerThreads)
-        wt.reset();
-
-    for (auto& buf : scratchBuffers)
-        buf.setSize (currentNumChannels, currentSamplesPerBlock,
-                     false, true, false);
-
-    completionBarrier = ResonanceThreadBarrier::make (ResonanceNumWorkerThreads + 1);
-
-    const WorkerThreadOptions opts { workgroup, completionBarrier, samplesPerBlock, sampleRate };
-    for (int i = 0; i < ResonanceNumWorkerThreads; ++i)
-        workerThreads[i] = std::make_unique<WorkerThread> (opts);
-}
+ResonanceBKSynthesiser::~ResonanceBKSynthesiser() = default;
 
 //==============================================================================
 void ResonanceBKSynthesiser::renderNextBlock (juce::AudioBuffer<float>& outputAudio,
@@ -246,15 +113,15 @@ void ResonanceBKSynthesiser::renderNextBlock (juce::AudioBuffer<float>& outputAu
                                                int numSamples)
 {
     // Fall back to sequential if not yet prepared
-    if (completionBarrier == nullptr)
+    if (! isParallelRenderingEnabled())
     {
         BKSynthesiser::renderNextBlock (outputAudio, inputMidi, startSample, numSamples);
         return;
     }
 
-    // Hold the lock for the entire block, matching the base class behaviour.
-    // MIDI events update voice state; voice rendering happens in parallel below.
-    const juce::ScopedLock sl (lock);
+    // new soundset, sample rate or tuning from the message thread
+    applyPendingChanges();
+    cullVoicesOverBudget();
 
     //--------------------------------------------------------------------------
     // Step 1: Render all currently-active voices in parallel.
@@ -264,41 +131,14 @@ void ResonanceBKSynthesiser::renderNextBlock (juce::AudioBuffer<float>& outputAu
     // latency is acceptable for sympathetic resonance.
     //--------------------------------------------------------------------------
 
-    // Render active graveyard slots on the main thread.
-    for (auto* v : graveyardVoices)
-        if (v->isVoiceActive())
-            v->renderNextBlock (outputAudio, startSample, numSamples);
-
-    const int totalVoices = voices.size();
-
-    // Clear scratch buffers (no allocation)
-    for (int w = 0; w < ResonanceNumWorkerThreads; ++w)
-        scratchBuffers[w].clear (startSample, numSamples);
-
-    // Distribute voices round-robin across workers
-    for (int i = 0; i < totalVoices; ++i)
-    {
-        const int w = i % ResonanceNumWorkerThreads;
-        BKSynthesiserVoice* const vp = voices[i];
-        workerThreads[w]->prepareAndQueueVoices (
-            juce::Span<BKSynthesiserVoice* const> (&vp, 1),
-            &scratchBuffers[w],
-            startSample,
-            numSamples);
-    }
-
-    // Signal workers — one signal per block, cannot accumulate
-    for (auto& wt : workerThreads)
-        wt->signalStart();
+    // Render active graveyard slots on the calling thread.
+    for (auto* v : activeGraveyardVoices)
+        v->renderNextBlock (outputAudio, startSample, numSamples);
 
-    // Main thread waits at barrier until all workers finish
-    completionBarrier->arriveAndWait();
-
-    // Mix scratch buffers into output (voices render stereo only)
-    const int channelsToSum = juce::jmin (currentNumChannels, outputAudio.getNumChannels());
-    for (int w = 0; w < ResonanceNumWorkerThreads; ++w)
-        for (int ch = 0; ch < channelsToSum; ++ch)
-            outputAudio.addFrom (ch, startSample, scratchBuffers[w], ch, startSample, numSamples);
+    // Too few voices to be worth splitting up (or the block is bigger than prepared for)
+    if (! renderActiveVoicesInParallel (outputAudio, startSample, numSamples))
+        for (auto* v : activeVoices)
+            v->renderNextBlock (outputAudio, startSample, numSamples);
 
     //--------------------------------------------------------------------------
     // Step 2: Process all MIDI events. Voices started here render next block.
@@ -315,18 +155,8 @@ void ResonanceBKSynthesiser::renderNextBlock (juce::AudioBuffer<float>& outputAu
     }
 
     //--------------------------------------------------------------------------
-    // Step 3: Update someVoicesActive
+    // Step 3: Drop voices that finished during step 1 (workers never touch the
+    // active lists) and update someVoicesActive
     //--------------------------------------------------------------------------
-    someVoicesActive = false;
-    for (auto* v : voices)
-    {
-        if (v->isVoiceActive())
-            someVoicesActive = true;
-    }
-
-    for (auto* v : graveyardVoices)
-    {
-        if (v->isVoiceActive())
-            someVoicesActive = true;
-    }
+    pruneActiveVoices();
 }
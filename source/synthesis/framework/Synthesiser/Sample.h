@@ -26,7 +26,10 @@
 #include "SFZEG.h"
 #include "TuningProcessor.h"
 #include "SampleBuffer.h"
+#include "CompactSampleData.h"
+#include "BKSampleStreamer.h"
 #include "SFZSample.h"
+#include "VoiceRenderKernels.h"
 /**
  * todo: cleanup Sample.h!
  * @tparam T
@@ -60,164 +63,191 @@ struct IsReaderType<T, std::void_t<
 
 // concept
 template<class T>
-concept LoadImmediate = not (std::is_base_of_v<juce::MemoryMappedAudioFormatReader, T> || std::is_base_of_v<juce::BufferingAudioReader, T>);
-template<class T>
-concept NonLoadImmediate = (std::is_base_of_v<juce::MemoryMappedAudioFormatReader, T> || std::is_base_of_v<juce::BufferingAudioReader, T>);
-template<class T>
 concept SFZLoadType = std::is_same_v<T, SFZRegion>;
+
+/**
+ * A bK format sample, decoded into CompactSampleData.
+ *
+ * Either fully resident, or streamed: only the first part (the head) is decoded, and the
+ * BKSampleStreamer reopens the file to read the rest while notes play.
+ * Or memory-mapped: nothing is decoded and voices read the WAV file's frames in place.
+ * Or restored from a soundset cache file (see SoundsetCacheFile), which is mapped as well.
+ */
 template<typename ReaderType>
-class Sample
+class Sample : public BKSampleStreamer::Source
 {
 public:
-    Sample(ReaderType& source, double maxSampleLengthSecs) :  m_sourceSampleRate(source.sampleRate),
-                                                              m_length(juce::jmin(int(source.lengthInSamples), int(maxSampleLengthSecs* m_sourceSampleRate))),
-                                                              m_data(juce::jmin(2, int(source.numChannels)), m_length + 4), m_source(source)
+    Sample(ReaderType& source, double maxSampleLengthSecs, SampleStorage storage = SampleStorage::native)
+        : m_sourceSampleRate(source.sampleRate),
+          m_length(juce::jmin(int(source.lengthInSamples), int(maxSampleLengthSecs* m_sourceSampleRate))),
+          m_data(source, m_length, storage)
     {
         if (m_length == 0)
             throw std::runtime_error("Unable to load sample");
 
-        source.read(&m_data, 0, m_length + 4, 0, true, true);
+        m_dBFSLevel = measureLevel(m_data);
+    }
 
-        //upsample(8);
+    /**
+     * Streamed: keeps residentSecs of source in memory; streamer reads the rest through readers
+     * from openStreamReader, which it opens (on its own thread) and closes as it needs them.
+     */
+    Sample(ReaderType& source,
+           double maxSampleLengthSecs,
+           SampleStorage storage,
+           std::shared_ptr<BKSampleStreamer> streamer,
+           double residentSecs,
+           std::function<std::unique_ptr<juce::AudioFormatReader>()> openStreamReader)
+        : m_sourceSampleRate(source.sampleRate),
+          m_length(juce::jmin(int(source.lengthInSamples), int(maxSampleLengthSecs* m_sourceSampleRate))),
+          m_data(source, juce::jmin(m_length, int(residentSecs * m_sourceSampleRate)), storage),
+          m_openStreamReader(std::move(openStreamReader)),
+          m_streamer(std::move(streamer)),
+          m_streamScratch(2, BKSampleStreamer::kChunkFrames)
+    {
+        if (m_length == 0)
+            throw std::runtime_error("Unable to load sample");
+
+        // velocity layers are matched on the first 0.4 s, which may be more than we keep
+        if (m_data.getLength() >= levelWindow())
+            m_dBFSLevel = measureLevel(m_data);
+        else
+            m_dBFSLevel = measureLevel(CompactSampleData(source, levelWindow(), SampleStorage::float32));
     }
 
-//    Sample(std::vector<std::vector<float>> soundData, double sr) : m_sourceSampleRate{ sr },
-//        m_length((int)soundData.at(0).size()) {
-//
-//        int numChans = (int) soundData.size();
-//        int numSamples = m_length;
-//
-//        m_temp_data.setSize(numChans, numSamples, false, true, false);
-//
-//        for (int chan = 0; chan < numChans; chan++) {
-//            m_temp_data.copyFrom(chan, 0, soundData.at(chan).data(), m_length);
-//        }
-//
-//        upsample(8);
-//    }
+    /** Memory-mapped: plays straight from file (see MappedWaveFile). */
+    Sample(std::shared_ptr<const MappedWaveFile> file, double maxSampleLengthSecs)
+        : m_sourceSampleRate(file->getSampleRate()),
+          m_length(0),
+          m_data(file, int(juce::jmin(file->getNumFrames(), juce::int64(maxSampleLengthSecs * m_sourceSampleRate))))
+    {
+        m_length = m_data.getLength();
+        if (m_length == 0)
+            throw std::runtime_error("Unable to load sample");
 
-    double getSampleRate() const { return m_sourceSampleRate; }
-    int getLength() const { return m_length; }
+        m_dBFSLevel = measureLevel(m_data);
+    }
 
-    float getRMS()
+    /** Restored from a soundset cache file: frames decoded on an earlier run, with the level measured then. */
+    Sample(const CompactSampleData::View& decoded, double sampleRate, float dBFSLevel)
+        : m_sourceSampleRate(sampleRate),
+          m_length(decoded.length),
+          m_dBFSLevel(dBFSLevel),
+          m_data(decoded)
     {
-        float dBFSLevel = 0.0f;
-         for (int i = 0; i < m_data.getNumChannels(); ++i)
-         {
-             dBFSLevel = m_data.getRMSLevel(i, 0, juce::jmin(int(m_sourceSampleRate*0.4f),m_data.getNumSamples()));
-         }
-         dBFSLevel *= 1.f/m_data.getNumChannels();
-         dBFSLevel = juce::Decibels::gainToDecibels(dBFSLevel);
-         return dBFSLevel;
+        if (m_length == 0)
+            throw std::runtime_error("Unable to load sample");
     }
 
-    void setStartSample(int startSample){m_startSample = startSample;}
-    void setNumSamps(int numSamps) {m_numSamps = numSamps;}
-    const std::tuple<const float*, const float*> getBuffer() const  {
-        return std::make_tuple(m_data.getReadPointer(0,m_startSample),
-                               m_data.getNumChannels() > 1 ? m_data.getReadPointer(1,m_startSample)
-                               : m_data.getReadPointer(0,m_startSample));
+    ~Sample() override
+    {
+        if (m_streamer != nullptr)
+            m_streamer->detach(*this);
     }
 
-private:
-    double m_sourceSampleRate;
-    int m_length;
-    int m_startSample;
-    int m_numSamps;
-    juce::AudioBuffer<float> m_temp_data;
-    juce::AudioBuffer<float> m_data;
-    ReaderType& m_source;
-    juce::LagrangeInterpolator m_interpolator;
+    double getSampleRate() const { return m_sourceSampleRate; }
+    int getLength() const { return m_length; }
 
-    // Whenever sample data is given to the Sample class, a Lagrange interpolator upsamples it in order
-    // to be able to play it back at at different speeds with low aliasing artifacts. Therefore, upsample()
-    // must be called in each constructor to Sample().
-    void upsample(int upSampleRatio) {
+    float getRMS() const { return m_dBFSLevel; }
 
-        int numInputSamples = m_temp_data.getNumSamples();
-        int numOutputSamples = upSampleRatio * numInputSamples;
+    void setStartSample(int startSample){m_startSample = startSample;}
+    void setNumSamps(int numSamps) {m_numSamps = numSamps;}
 
-        m_data.setSize(2, numOutputSamples, false, true, false);
+    /**
+     * Calls fn (frames, scale) with a view of the resident sample data in whatever format it's stored in
+     * (see CompactSampleData); frames.left(i) * scale is the audio at frame i.
+     */
+    template <typename Fn>
+    decltype(auto) forEachFormat(Fn&& fn) const { return m_data.forEachFormat(std::forward<Fn>(fn)); }
 
-        for (int outChan = 0; outChan < 2; outChan++) {
-            int inChan = m_temp_data.getNumChannels() > 1 ? outChan : 0;
-            m_interpolator.process(1./(double)(upSampleRatio), m_temp_data.getReadPointer(inChan), m_data.getWritePointer(outChan), numOutputSamples, numInputSamples, 0);
-        }
+    const CompactSampleData& getData() const { return m_data; }
+
+    bool isStreamed() const { return m_streamer != nullptr; }
+    BKSampleStreamer* getStreamer() const { return m_streamer.get(); }
 
-        m_length *= upSampleRatio;
-        m_sourceSampleRate *= upSampleRatio;
+    // BKSampleStreamer::Source
+    int getResidentLength() const override { return m_data.getLength(); }
+    juce::int64 getStreamLength() const override { return m_length; }
 
-        m_temp_data.clear();
+    std::unique_ptr<juce::AudioFormatReader> createStreamReader() override
+    {
+        return m_openStreamReader != nullptr ? m_openStreamReader() : nullptr;
     }
-};
 
-template <NonLoadImmediate ReaderType>
-class Sample<ReaderType>
-{
-    Sample(ReaderType& source, double maxSampleLengthSecs)
-            : m_sourceSampleRate(source.sampleRate),
-              m_length(juce::jmin(int(source.lengthInSamples),
-                                  int(maxSampleLengthSecs* m_sourceSampleRate))),
-              m_temp_data(juce::jmin(2, int(source->numChannels)), m_length + 4), m_source(source)
+    void readStreamed(juce::AudioFormatReader& reader, juce::int64 startFrame, int numFrames, float* left, float* right) override
     {
-        if (m_length == 0)
-            throw std::runtime_error("Unable to load sample");
-        source.mapEntireFile();
-        //source->read(&m_data, 0, m_length + 4, 0, true, true);
+        jassert(numFrames <= m_streamScratch.getNumSamples());
+        reader.read(&m_streamScratch, 0, numFrames, startFrame, true, true);
 
-        //upsample(8);
+        // streamed frames are handed to voices in the same units as the resident ones
+        const auto toResident = 1.f / m_data.getScale();
+        juce::FloatVectorOperations::multiply(left, m_streamScratch.getReadPointer(0), toResident, numFrames);
+        juce::FloatVectorOperations::multiply(right, m_streamScratch.getReadPointer(1), toResident, numFrames);
     }
 
-//    double getSampleRate() const { return m_sourceSampleRate; }
-//    int getLength() const { return m_length; }
+private:
+    int levelWindow() const { return juce::jmin(int(m_sourceSampleRate*0.4f), m_length); }
 
-    void setStartSample(int startSample){m_startSample = startSample;}
-    void setNumSamps(int numSamps) {m_numSamps = numSamps;}
-    //const juce::AudioBuffer<float>& getBuffer() { return m_data; }
-    const juce::AudioBuffer<float>& getBuffer(int startSamp, int numSamples)
+    float measureLevel(const CompactSampleData& data) const
     {
-        m_source.read(&m_data, startSamp, numSamples + 4, 0, true, true);
-        return m_data;
-    }
-
-    const std::tuple<const float*, const float*> getBuffer() const  {
-        m_source.read(&m_data, m_startSample, m_numSamps + 4, 0, true, true);
-        return std::make_tuple(m_data.getReadPointer(0,m_startSample),
-                               m_data.getNumChannels() > 1 ? m_data.getReadPointer(1,m_startSample) : m_data.getReadPointer(0,m_startSample));
+        float dBFSLevel = 0.0f;
+         for (int i = 0; i < data.getNumChannels(); ++i)
+         {
+             dBFSLevel = data.getRMSLevel(i, 0, juce::jmin(levelWindow(), data.getLength()));
+         }
+         dBFSLevel *= 1.f/data.getNumChannels();
+         dBFSLevel = juce::Decibels::gainToDecibels(dBFSLevel);
+         return dBFSLevel;
     }
 
-private:
-    int m_startSample;
-    int m_numSamps;
     double m_sourceSampleRate;
     int m_length;
-    juce::AudioBuffer<float> m_temp_data;
-    juce::AudioBuffer<float> m_data;
-    ReaderType& m_source;
-    juce::LagrangeInterpolator m_interpolator;
-
-//    // Whenever sample data is given to the Sample class, a Lagrange interpolator upsamples it in order
-//    // to be able to play it back at at different speeds with low aliasing artifacts. Therefore, upsample()
-//    // must be called in each constructor to Sample().
-//    void upsample(int upSampleRatio) {
-//
-//        int numInputSamples = m_temp_data.getNumSamples();
-//        int numOutputSamples = upSampleRatio * numInputSamples;
-//
-//        m_data.setSize(2, numOutputSamples, false, true, false);
-//
-//        for (int outChan = 0; outChan < 2; outChan++) {
-//            int inChan = m_temp_data.getNumChannels() > 1 ? outChan : 0;
-//            m_interpolator.process(1./(double)(upSampleRatio), m_temp_data.getReadPointer(inChan), m_data.getWritePointer(outChan), numOutputSamples, numInputSamples, 0);
-//        }
-//
-//        m_length *= upSampleRatio;
-//        m_sourceSampleRate *= upSampleRatio;
-//
-//        m_temp_data.clear();
-//    }
+    int m_startSample = 0;
+    int m_numSamps = 0;
+    float m_dBFSLevel = 0.f;
+    CompactSampleData m_data;
+
+    // streamed samples only
+    std::function<std::unique_ptr<juce::AudioFormatReader>()> m_openStreamReader;
+    std::shared_ptr<BKSampleStreamer> m_streamer;
+    juce::AudioBuffer<float> m_streamScratch; // streamer thread only
+};
+
+/**
+ * SFZ/SF2 PCM decoded once at load time into planar float.
+ *
+ * sfzq keeps sample data as interleaved integer PCM behind a read_sample function pointer;
+ * decoding up front trades memory (float is 2x the size of 16-bit PCM) for voices that can
+ * read raw pointers the same way the bK WAV path does. One of these is made per SampleBuffer,
+ * so with SF2 files (where every region shares the smpl chunk) it's decoded exactly once.
+ */
+struct PlanarSampleData
+{
+    // zeroed frames past the end, so interpolation can read pos + 1 without checking
+    static constexpr int kPadding = 4;
 
+    explicit PlanarSampleData (SampleBuffer& source)
+        : length (source.num_samples),
+          data (juce::jmax (1, source.num_channels), source.num_samples + kPadding)
+    {
+        data.clear();
+        if (! source.valid())
+            return;
+
+        const auto read = source.read_sample;
+        for (int ch = 0; ch < source.num_channels; ++ch)
+        {
+            auto* out = data.getWritePointer (ch);
+            const uint8_t* in = source.channel_start (ch);
+            for (int i = 0; i < length; ++i, in += source.stride)
+                out[i] = (float) read (in);
+        }
+    }
+
+    int length;
+    juce::AudioBuffer<float> data;
 };
+
 template <>
 class Sample<SFZRegion>
 {
@@ -280,6 +310,11 @@ public:
 
     std::tuple<const float*, const float*> getBuffer() const
     {
+        if (m_planar != nullptr)
+        {
+            const float* left = m_planar->data.getReadPointer (0);
+            return { left, m_planar->data.getNumChannels() > 1 ? m_planar->data.getReadPointer (1) : left };
+        }
         // const float* left  = m_data.getReadPointer(0, m_startSample);
         // const float* right = (m_data.getNumChannels() > 1)
         //                        ? m_data.getReadPointer(1, m_startSample)
@@ -317,8 +352,8 @@ public:
 
         int startSample = 0;
         int length = 0;
-        uint8_t* ch0 = nullptr;
-        uint8_t* ch1 = nullptr;
+        const uint8_t* ch0 = nullptr;
+        const uint8_t* ch1 = nullptr;
 
         inline float readAt (int channel, int index) const noexcept
         {
@@ -347,6 +382,41 @@ public:
         // }
     };
 
+    /**
+     * same interface as Reader, but over pre-decoded planar floats: no function pointer,
+     * and the padded tail means the only check is a clamp for out-of-range positions
+     */
+    struct PlanarReader
+    {
+        const float* ch0 = nullptr;
+        const float* ch1 = nullptr;
+        int num_channels = 0;
+        int length = 0;
+
+        inline float readAt (int channel, int index) const noexcept
+        {
+            const float* base = (channel == 0 ? ch0 : ch1);
+            return base[(unsigned) index <= (unsigned) length ? index : length];
+        }
+    };
+
+    /** attach PCM decoded at load time; voices will use getPlanarReader() from then on */
+    void setPlanarData (std::shared_ptr<const PlanarSampleData> planar) { m_planar = std::move (planar); }
+    bool hasPlanarData() const noexcept { return m_planar != nullptr; }
+
+    inline PlanarReader getPlanarReader() const noexcept
+    {
+        PlanarReader r{};
+        if (m_planar == nullptr)
+            return r;
+
+        r.num_channels = m_planar->data.getNumChannels();
+        r.length = m_planar->length;
+        r.ch0 = m_planar->data.getReadPointer (0);
+        r.ch1 = r.num_channels > 1 ? m_planar->data.getReadPointer (1) : nullptr;
+        return r;
+    }
+
     // Construct Reader by value (stack), no heap allocations.
     inline Reader getReader() const noexcept
     {
@@ -381,6 +451,7 @@ private:
     int m_numSamps   = 0;
 
     juce::AudioBuffer<float> m_data;
+    std::shared_ptr<const PlanarSampleData> m_planar;
 };
 
 enum class SoundSampleType {
@@ -426,10 +497,102 @@ public:
     virtual SoundSampleType getSoundSampleType() const {return SoundSampleType::Unknown;};
     virtual BKSamplerSoundBase* getSamplerSoundBase() noexcept { return nullptr; }
 
+    //==============================================================================
+    // A lazily loaded sound (see SampleLoadManager::shouldLoadLazily()) is in its soundset
+    // before its sample is, and its sample can be unloaded again once nothing plays it.
+    // Voices are only started on a sound that's pinned and loaded, and every voice playing
+    // it keeps it pinned (see BKPlayingSoundPtr), so it's never unloaded under them.
+    //
+    // The sample and levels of such a sound are only written while it's unloaded, and
+    // setLoaded (true) publishes them, so the audio thread reads them only once pinIfLoaded()
+    // has seen it loaded: the store releases those writes and that load acquires them.
+
+    /** Audio thread: pins the sound and returns true if it's loaded. If it isn't, unpins it,
+        asks for it to be loaded (see takeLoadRequest()) and returns false. */
+    bool pinIfLoaded() noexcept
+    {
+        pin();
+        if (loaded.load())
+            return true;
+
+        unpin();
+        loadRequested.store (true, std::memory_order_relaxed);
+        return false;
+    }
+
+    void pin() noexcept
+    {
+        pins.fetch_add (1);
+        lastUsed.store (juce::Time::getMillisecondCounter(), std::memory_order_relaxed);
+    }
+
+    void unpin() noexcept { pins.fetch_sub (1); }
+
+    bool isLoaded() const noexcept { return loaded.load(); }
+    bool takeLoadRequest() noexcept { return loadRequested.exchange (false, std::memory_order_relaxed); }
+    juce::uint32 getLastUsedTime() const noexcept { return lastUsed.load (std::memory_order_relaxed); }
+
+    /** Marks the sound unloaded, unless it's pinned; then it stays loaded and this returns false.
+        Once it returns true no new voice can start the sound, so its sample can be freed. */
+    bool beginUnload() noexcept
+    {
+        loaded.store (false);
+        if (pins.load() == 0)
+            return true;
+
+        loaded.store (true);
+        return false;
+    }
+
+    /** Undoes a beginUnload() before the sample was freed. */
+    void cancelUnload() noexcept { loaded.store (true); }
+
+protected:
+    void setLoaded (bool isNowLoaded) noexcept { loaded.store (isNowLoaded); }
+
 private:
+    // seq_cst between pinIfLoaded() and beginUnload(): at least one of them sees the other
+    std::atomic<bool> loaded { true };
+    std::atomic<int> pins { 0 };
+    std::atomic<bool> loadRequested { false };
+    std::atomic<juce::uint32> lastUsed { 0 };
+
     JUCE_LEAK_DETECTOR (BKSynthesiserSound)
 };
 
+/** The sound a voice is playing; keeps it pinned (see BKSynthesiserSound::pinIfLoaded()). */
+class BKPlayingSoundPtr
+{
+public:
+    BKPlayingSoundPtr() = default;
+    explicit BKPlayingSoundPtr (BKSynthesiserSound* s) noexcept { *this = s; }
+    BKPlayingSoundPtr (const BKPlayingSoundPtr& other) noexcept { *this = other.get(); }
+    ~BKPlayingSoundPtr() { *this = nullptr; }
+
+    BKPlayingSoundPtr& operator= (const BKPlayingSoundPtr& other) noexcept { return *this = other.get(); }
+
+    BKPlayingSoundPtr& operator= (BKSynthesiserSound* s) noexcept
+    {
+        if (s == sound.get())
+            return *this;
+
+        if (s != nullptr)
+            s->pin();
+        if (sound != nullptr)
+            sound->unpin();
+
+        sound = s;
+        return *this;
+    }
+
+    BKSynthesiserSound* get() const noexcept { return sound.get(); }
+    operator BKSynthesiserSound::Ptr() const noexcept { return sound; }
+    bool operator== (std::nullptr_t) const noexcept { return sound == nullptr; }
+
+private:
+    BKSynthesiserSound::Ptr sound;
+};
+
 class BKSamplerSoundBase : public BKSynthesiserSound
 {
 public:
@@ -445,6 +608,7 @@ class BKSamplerSound :  public BKSamplerSoundBase
 public:
     /*
      * for regular bK-style sample libraries
+     *  - samp is null for a lazily loaded sound, which gets its sample later through setLoadedSample()
      */
     BKSamplerSound( const juce::String& soundName,
                     std::shared_ptr<Sample<T>> samp,
@@ -467,7 +631,8 @@ public:
     {
         dBFSBelow = dBFSBelo;
         setCentreFrequencyInHz(mtof(rootMidiNote));
-        dBFSLevel = sample->getRMS();
+        dBFSLevel = sample != nullptr ? sample->getRMS() : dBFSBelo;
+        setLoaded (sample != nullptr);
     }
 
     /*
@@ -559,6 +724,29 @@ public:
         return sample.get();
     }
 
+    /** Gives a lazily loaded sound its sample, and the level of the velocity layer below it
+        (which comes from that layer's sample), then lets voices start it. Fetcher thread, and
+        only while the sound is unloaded: nothing on the audio thread reads these until the
+        setLoaded (true) at the end. A null sample leaves the sound unloaded. */
+    void setLoadedSample (std::shared_ptr<Sample<T>> value, float dBFSBelo) requires (!std::is_same_v<T, SFZRegion>)
+    {
+        jassert (! isLoaded());
+        if (value == nullptr)
+            return;
+
+        sample = std::move (value);
+        dBFSLevel = sample->getRMS();
+        dBFSBelow = dBFSBelo;
+        setLoaded (true); // last: publishes the three writes above
+    }
+
+    /** Frees the sample once beginUnload() has succeeded. */
+    void releaseSample()
+    {
+        jassert (! isLoaded());
+        sample.reset();
+    }
+
     /**
      * this actually sets a range for the full sample, from the beginning of the sample to the end
      * - it does NOT set the loop points for the loop markers in a sustaining SFZ sample
@@ -594,6 +782,9 @@ public:
         return loopMode;
     }
 
+    const juce::BigInteger& getMidiNotes() const { return midiNotes; }
+    const juce::BigInteger& getMidiVelocities() const { return midiVelocities; }
+
     // find the bounding velocities for this sound
     int minVelocity (void) { return midiVelocities.findNextSetBit(0); }
     int maxVelocity (void) { return midiVelocities.findNextClearBit(midiVelocities.findNextSetBit(0)); }
@@ -831,7 +1022,7 @@ public:
     double currentA4Freq = 440.0;
 
     juce::uint32 noteOnTime = 0; int currentlyPlayingNote = -1, currentPlayingMidiChannel = 0;
-    BKSynthesiserSound::Ptr currentlyPlayingSound;
+    BKPlayingSoundPtr currentlyPlayingSound;
 
     bool keyIsDown = false, sustainPedalDown = false, sostenutoPedalDown = false;
 
@@ -909,6 +1100,17 @@ private:
     //==============================================================================
     friend class BKSynthesiser;
 
+    // true while this voice is in its synth's active voice list (see BKSynthesiser::activeVoices)
+    bool isInActiveList = false;
+
+    // true from when the voice budget culls this voice until it is released or restarted
+    bool isBeingCulled = false;
+
+    // true while this voice plays on from a soundset its synth has swapped out (see BKSynthesiser::retiringVoices)
+    bool isRetiring = false;
+
+    // the synth currently using this voice; voices from a BKVoicePool move between synths
+    const BKSynthesiser* owner = nullptr;
 
     juce::AudioBuffer<float> tempBuffer;
 
@@ -943,6 +1145,11 @@ public:
         // call the smooth.reset() here if we want smoothing for various smoothingFloat vars
     }
 
+    ~BKSamplerVoice() override
+    {
+        releaseStreamSlot();
+    }
+
     void setCurrentPlaybackSampleRate(double newRate) override {
 
         //DBG("BKSamplerVoice::setCurrentPlaybackSampleRate " << newRate);
@@ -1035,6 +1242,14 @@ public:
         currentSustainTime_samples = 0;
         ampEnv.noteOn();
 
+        if constexpr (! std::is_same_v<T, SFZRegion>)
+        {
+            // streamed samples: ask for the rest of the sample now, while the head plays
+            releaseStreamSlot();
+            if (auto* streamer = samplerSound->getSample()->getStreamer())
+                streamSlot = streamer->acquire (*samplerSound->getSample(), currentSamplePos, currentDirection == Direction::forward);
+        }
+
         if constexpr (std::is_same_v<T, SFZRegion>)
         {
             auto& region = samplerSound->getSample()->getSourceRegion();
@@ -1121,7 +1336,7 @@ public:
 
         // otherwise, get the target frequency from the attached Tuning pre
         //DBG("tuner connected in setTargetFrequency");
-        return tuning->getTargetFrequency(currentlyPlayingNote, currentTransposition, tuneTranspositions);
+        return tuning->getCachedTargetFrequency(currentlyPlayingNote, currentTransposition, tuneTranspositions);
     }
 
     void setDirection(Direction newdir)
@@ -1205,6 +1420,10 @@ public:
 
         if constexpr (std::is_same_v<T, SFZRegion>)
             t->ampeg = ampeg;
+
+        // the graveyard voice carries on streaming where this one left off
+        t->releaseStreamSlot();
+        t->streamSlot = std::exchange (streamSlot, nullptr);
     }
 
     double getCurrentSamplePosition() const
@@ -1216,6 +1435,13 @@ public:
         //updateAmpEnv();
     }
 
+    /**
+     * bK format samples render through renderBlock() by default; turning this off
+     * falls back to the per-sample reference path in renderNextSample()
+     */
+    void setBlockRenderingEnabled (bool shouldUseBlocks) { useBlockRendering = shouldUseBlocks; }
+    bool isBlockRenderingEnabled() const { return useBlockRendering; }
+
 private:
     template <typename Element>
     void render(juce::AudioBuffer<Element>& outputBuffer, int startSample, int numSamples)
@@ -1234,6 +1460,7 @@ private:
                 //  - Spring_Tuning: the spring sim evolves the pitch during sustain
                 //  - MTS_Client: the external MTS-ESP master may retune during sustain
                 // (re-querying MTS_NoteToFrequency every block is lock-free / audio-safe)
+                // TuningState caches each note's frequency for the block, so voices on the same note share one lookup
                 sampleIncrement.setTargetValue (
                     getTargetFrequency() / samplerSound->getCentreFrequencyInHz() *
                     samplerSound->getSample()->getSampleRate() / this->currentSampleRate);
@@ -1290,29 +1517,161 @@ private:
         size_t writePos = 0;
         if constexpr (std::is_same_v<T, SFZRegion>) {
             // Construct ONCE (POD, no allocations)
-            const auto reader = samplerSound->getSample()->getReader();
-
-            while (--numSamples >= 0 && renderNextSample (reader, outL, outR, writePos))
-                ++writePos;
+            if (samplerSound->getSample()->hasPlanarData())
+            {
+                const auto reader = samplerSound->getSample()->getPlanarReader();
+                while (--numSamples >= 0 && renderNextSample (reader, outL, outR, writePos))
+                    ++writePos;
+            }
+            else
+            {
+                const auto reader = samplerSound->getSample()->getReader();
+                while (--numSamples >= 0 && renderNextSample (reader, outL, outR, writePos))
+                    ++writePos;
+            }
         }
         else {
-            auto [inL, inR] = samplerSound->getSample()->getBuffer();
-            while (--numSamples >= 0 && renderNextSample(inL, inR, outL, outR, writePos))
-                writePos += 1;
+            auto renderFrames = [&] (const auto& frames, float sampleScale) {
+                if (useBlockRendering)
+                {
+                    renderBlock (frames, sampleScale, outL, outR, numSamples);
+                    return;
+                }
+
+                // per-sample reference path
+                while (--numSamples >= 0 && renderNextSample(frames, sampleScale, outL, outR, writePos))
+                    writePos += 1;
+            };
+
+            auto* sample = samplerSound->getSample();
+            sample->forEachFormat ([&] (const auto& head, float sampleScale) {
+                if (! sample->isStreamed())
+                    return renderFrames (head, sampleScale);
+
+                // past the head, read whatever the streamer has got to; silence if it hasn't (or there's no slot)
+                using Frames = BKSampleStreamer::Frames<std::decay_t<decltype (head)>>;
+                if (streamSlot == nullptr)
+                    return renderFrames (Frames { head, sample->getResidentLength() }, sampleScale);
+
+                streamSlot->setPosition (currentSamplePos, currentDirection == Direction::forward);
+                renderFrames (streamSlot->getFrames (head, sample->getResidentLength()), sampleScale);
+            });
+        }
+    }
+
+    /**
+     * Block version of renderNextSample(inL, inR, ...) for regular bK format samples.
+     *
+     * The position/direction/envelope bookkeeping is sequential, so it runs in a scalar pass
+     * that gathers the interpolation endpoints, fractional positions and envelope values for
+     * a sub-block into contiguous arrays. Interpolation, gain and accumulation into the output
+     * are then done for the whole sub-block with the xsimd kernels in VoiceRenderKernels.h.
+     *
+     * Int16/int24 storage is converted to float as it's gathered, and the sample's scale
+     * factor rides along with the level gain, so compact samples cost no extra pass.
+     *
+     * Output matches the per-sample path within float rounding.
+     */
+    template <typename Frames>
+    void renderBlock (const Frames& in,
+                      float sampleScale,
+                      float* outL,
+                      float* outR,
+                      int numSamples)
+    {
+        using namespace bitklavier::render;
+
+        const int sampleLength = samplerSound->getSample()->getLength();
+        const float levelGain = (float) level.getTargetValue() * sampleScale;
+
+        VoiceRenderBlock block; // ~1.5k on the stack, so voices don't each carry scratch space
+        int offset = 0;
+
+        while (numSamples > 0)
+        {
+            const int chunk = juce::jmin (numSamples, kVoiceBlockSize);
+            bool stillActive = true;
+            int n = 0;
+
+            for (; n < chunk; ++n)
+            {
+                auto currentSampleBegin = sampleBegin.getNextValue();
+                auto currentSampleEnd = sampleEnd.getNextValue();
+                auto currentIncrement = sampleIncrement.getNextValue();
+
+                // playing backwards from beyond the end of the sample: silent frame, see renderNextSample
+                if (currentDirection == Direction::backward && currentSamplePos > sampleLength)
+                {
+                    std::tie (currentSamplePos, currentDirection) = getNextState (currentIncrement, currentSampleBegin, currentSampleEnd);
+                    block.l0[n] = block.l1[n] = block.r0[n] = block.r1[n] = 0.f;
+                    block.alpha[n] = 0.f;
+                    block.gain[n] = 0.f;
+                    currentSustainTime_samples++;
+                    continue;
+                }
+
+                float ampEnvLast = ampEnv.getNextSample();
+                if ((isTailingOff() && (!ampEnv.isActive() || ampEnvLast < 0.001)) || !ampEnv.isActive())
+                {
+                    stopNote();
+                    stillActive = false;
+                    break;
+                }
+
+                const auto pos = (int) currentSamplePos;
+                block.alpha[n] = (float) (currentSamplePos - pos);
+                block.l0[n] = in.left (pos);
+                block.l1[n] = in.left (pos + 1);
+                block.r0[n] = in.right (pos);
+                block.r1[n] = in.right (pos + 1);
+                block.gain[n] = ampEnvLast;
+
+                std::tie (currentSamplePos, currentDirection) = getNextState (currentIncrement, currentSampleBegin, currentSampleEnd);
+
+                if (currentSamplePos > sampleLength)
+                {
+                    // this frame was still rendered
+                    ++n;
+                    stopNote();
+                    stillActive = false;
+                    break;
+                }
+
+                currentSustainTime_samples++;
+                if (targetSustainTime_samples > 0 && currentSustainTime_samples > targetSustainTime_samples)
+                    stopNote (64, true);
+            }
+
+            if (outR != nullptr)
+            {
+                interpolateGainAccumulate (outL + offset, block.l0, block.l1, block.alpha, block.gain, levelGain, n);
+                interpolateGainAccumulate (outR + offset, block.r0, block.r1, block.alpha, block.gain, levelGain, n);
+            }
+            else
+            {
+                interpolateGainAccumulateMono (outL + offset, block, levelGain, n);
+            }
+
+            if (! stillActive)
+                return;
+
+            offset += chunk;
+            numSamples -= chunk;
         }
     }
 
     /**
      * SoundFont sample render (one-shot and sustained with looping)
      * @tparam Element
+     * @tparam SFZReader Sample<SFZRegion>::Reader or Sample<SFZRegion>::PlanarReader
      * @param reader
      * @param outL
      * @param outR
      * @param writePos
      * @return
      */
-    template <typename Element>
-    bool renderNextSample (const typename Sample<SFZRegion>::Reader& reader,
+    template <typename Element, typename SFZReader>
+    bool renderNextSample (const SFZReader& reader,
                            Element* outL,
                            Element* outR,
                            size_t writePos)
@@ -1444,16 +1803,17 @@ private:
     /**
      * Regular bK Format sample render (one-shot only)
      * @tparam Element
-     * @param inL
-     * @param inR
+     * @tparam Frames one of the bitklavier::samplestorage views
+     * @param in
+     * @param sampleScale
      * @param outL
      * @param outR
      * @param writePos
      * @return
      */
-    template <typename Element>
-    bool renderNextSample(const float* inL,
-                          const float* inR,
+    template <typename Element, typename Frames>
+    bool renderNextSample(const Frames& in,
+                          float sampleScale,
                           Element* outL,
                           Element* outR,
                           size_t writePos)
@@ -1506,8 +1866,8 @@ private:
         float l,r;
 
         // Very simple linear interpolation here because the Sampler class should have already upsampled.
-        l = static_cast<Element> ((inL[pos] * invAlpha + inL[nextPos] * alpha));
-        r = static_cast<Element> ((inR != nullptr) ? (inR[pos] * invAlpha + inR[nextPos] * alpha) : l);
+        l = static_cast<Element> ((in.left (pos) * invAlpha + in.left (nextPos) * alpha) * sampleScale);
+        r = static_cast<Element> ((in.right (pos) * invAlpha + in.right (nextPos) * alpha) * sampleScale);
 
         m_Buffer.setSample(0, 0, l);
         m_Buffer.setSample(1, 0, r);
@@ -1563,6 +1923,13 @@ private:
         ampEnv.reset();
         clearCurrentNote();
         currentSamplePos = 0.0;
+        releaseStreamSlot();
+    }
+
+    void releaseStreamSlot()
+    {
+        if (streamSlot != nullptr)
+            std::exchange (streamSlot, nullptr)->release();
     }
 
     [[nodiscard]] std::tuple<double, Direction> getNextState
@@ -1643,5 +2010,9 @@ private:
     double currentSustainTime_samples = 0;
 
     juce::AudioBuffer<float> m_Buffer;
+    bool useBlockRendering = true;
+
+    // ring buffer the streamer fills for this note, if the sample is streamed (mutable so copyStateTo() can hand it over)
+    mutable BKSampleStreamer::Slot* streamSlot = nullptr;
 };
 
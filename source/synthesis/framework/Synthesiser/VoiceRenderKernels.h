@@ -0,0 +1,100 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+//
+// Vectorized inner loops for BKSamplerVoice block rendering.
+//
+
+#pragma once
+#include <chowdsp_simd/chowdsp_simd.h>
+
+/**
+ * The per-voice "control" work (sample position, direction changes, loop maintenance,
+ * envelope, stop conditions) is inherently sequential, so BKSamplerVoice does it in a
+ * scalar pass that fills a VoiceRenderBlock with contiguous per-frame data. The
+ * functions in here then do the actual interpolation/gain/accumulate work for the
+ * whole sub-block with xsimd.
+ */
+namespace bitklavier::render
+{
+    // sub-block length used by the block render path; also the size of the scratch arrays
+    static constexpr int kVoiceBlockSize = 64;
+
+    struct VoiceRenderBlock
+    {
+        // interpolation endpoints, gathered from the sample data in the control pass
+        alignas (32) float l0[kVoiceBlockSize];
+        alignas (32) float l1[kVoiceBlockSize];
+        alignas (32) float r0[kVoiceBlockSize];
+        alignas (32) float r1[kVoiceBlockSize];
+
+        // fractional read position and per-frame gain (envelope; 0 for silent frames)
+        alignas (32) float alpha[kVoiceBlockSize];
+        alignas (32) float gain[kVoiceBlockSize];
+    };
+
+    /**
+     * out[i] += (x0[i] * (1 - a[i]) + x1[i] * a[i]) * g[i] * scale
+     */
+    inline void interpolateGainAccumulate (float* out,
+                                           const float* x0,
+                                           const float* x1,
+                                           const float* a,
+                                           const float* g,
+                                           float scale,
+                                           int numSamples) noexcept
+    {
+        using Vec = xsimd::batch<float>;
+        constexpr int vecSize = (int) Vec::size;
+
+        const Vec vScale (scale);
+        const Vec vOne (1.0f);
+
+        int i = 0;
+        for (; i + vecSize <= numSamples; i += vecSize)
+        {
+            const auto va  = Vec::load_aligned (a + i);
+            const auto s   = Vec::load_aligned (x0 + i) * (vOne - va) + Vec::load_aligned (x1 + i) * va;
+            const auto acc = Vec::load_unaligned (out + i) + s * Vec::load_aligned (g + i) * vScale;
+            acc.store_unaligned (out + i);
+        }
+
+        for (; i < numSamples; ++i)
+            out[i] += (x0[i] * (1.0f - a[i]) + x1[i] * a[i]) * g[i] * scale;
+    }
+
+    /**
+     * out[i] += ((l0/l1 interpolated) + (r0/r1 interpolated)) * 0.5 * g[i] * scale
+     * used when rendering into a mono buffer
+     */
+    inline void interpolateGainAccumulateMono (float* out,
+                                               const VoiceRenderBlock& block,
+                                               float scale,
+                                               int numSamples) noexcept
+    {
+        using Vec = xsimd::batch<float>;
+        constexpr int vecSize = (int) Vec::size;
+
+        const Vec vScale (scale * 0.5f);
+        const Vec vOne (1.0f);
+
+        int i = 0;
+        for (; i + vecSize <= numSamples; i += vecSize)
+        {
+            const auto va  = Vec::load_aligned (block.alpha + i);
+            const auto via = vOne - va;
+            const auto l   = Vec::load_aligned (block.l0 + i) * via + Vec::load_aligned (block.l1 + i) * va;
+            const auto r   = Vec::load_aligned (block.r0 + i) * via + Vec::load_aligned (block.r1 + i) * va;
+            const auto acc = Vec::load_unaligned (out + i) + (l + r) * Vec::load_aligned (block.gain + i) * vScale;
+            acc.store_unaligned (out + i);
+        }
+
+        for (; i < numSamples; ++i)
+        {
+            const float ia = 1.0f - block.alpha[i];
+            const float l  = block.l0[i] * ia + block.l1[i] * block.alpha[i];
+            const float r  = block.r0[i] * ia + block.r1[i] * block.alpha[i];
+            out[i] += (l + r) * block.gain[i] * scale * 0.5f;
+        }
+    }
+}
@@ -0,0 +1,471 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "graph_scheduler.h"
+#include "ModulationProcessor.h"
+#include "PianoSwitchProcessor.h"
+#include "SynchronicProcessor.h"
+#include "TempoProcessor.h"
+#include "TuningProcessor.h"
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+namespace bitklavier
+{
+    namespace
+    {
+        using IOProcessor = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+
+        // enough for a dense block of note and controller events without reallocating
+        constexpr int kMidiBufferBytes = 4096;
+
+        // more runners than this don't help: galleries are rarely wider than a handful of chains
+        constexpr int kMaxRunners = 16;
+
+        // how long a runner busy-waits for the next ready node before sleeping, as BKRenderWorkerPool does
+        constexpr int kSpinIterations = 2048;
+
+        bool providesSharedState (juce::AudioProcessor* p)
+        {
+            return dynamic_cast<TuningProcessor*> (p) != nullptr
+                   || dynamic_cast<TempoProcessor*> (p) != nullptr
+                   || dynamic_cast<SynchronicProcessor*> (p) != nullptr;
+        }
+    }
+
+    //==============================================================================
+    struct GraphScheduler::Schedule
+    {
+        struct AudioInput
+        {
+            int source, sourceChannel, destChannel;
+
+            bool operator< (const AudioInput& other) const noexcept
+            {
+                return std::tie (destChannel, source, sourceChannel) < std::tie (other.destChannel, other.source, other.sourceChannel);
+            }
+        };
+
+        struct Entry
+        {
+            juce::AudioProcessorGraph::Node::Ptr node;
+            int ioType = -1; // an IOProcessor::IODeviceType, or -1 for a normal node
+            int numChannels = 0;
+            juce::AudioBuffer<float> buffer;
+            juce::MidiBuffer midi;
+            std::vector<AudioInput> audioInputs;
+            std::vector<int> midiInputs;
+            std::vector<int> successors;
+            int numPredecessors = 0;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<int> serialOrder;
+        int maxBlockSize = 0;
+        int numRunners = 1;
+        int audioOutputIndex = -1;
+        int midiOutputIndex = -1;
+        bool canRunInParallel = false;
+
+        // per-block state; reset on the audio thread before the job is published
+        std::unique_ptr<std::atomic<int>[]> pending;
+        std::unique_ptr<std::atomic<int>[]> readySlots;
+        std::atomic<int> writePos { 0 };
+        std::atomic<int> readPos { 0 };
+
+        int numSamples = 0;
+        const juce::AudioBuffer<float>* graphAudioIn = nullptr;
+        const juce::MidiBuffer* graphMidiIn = nullptr;
+        juce::AudioPlayHead* playHead = nullptr;
+
+        void process (juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi, juce::AudioPlayHead* ph, BKRenderWorkerPool& pool) noexcept
+        {
+            const auto numEntries = (int) entries.size();
+
+            numSamples = audio.getNumSamples();
+            graphAudioIn = &audio;
+            graphMidiIn = &midi;
+            playHead = ph;
+
+            for (int i = 0; i < numEntries; ++i)
+            {
+                pending[(size_t) i].store (entries[(size_t) i].numPredecessors, std::memory_order_relaxed);
+                readySlots[(size_t) i].store (-1, std::memory_order_relaxed);
+            }
+            writePos.store (0, std::memory_order_relaxed);
+            readPos.store (0, std::memory_order_relaxed);
+
+            for (auto i : serialOrder)
+                if (entries[(size_t) i].numPredecessors == 0)
+                    pushReady (i);
+
+            // each runner takes ready nodes until every node has been claimed; if the pool is
+            // busy or has no workers, the first runner ends up doing all of them in order
+            auto runner = [this] (int) { runReadyNodes(); };
+            pool.parallelFor (numRunners, runner);
+
+            // the graph's inputs have been read by now, so the outputs can go in the same buffers
+            for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+            {
+                if (audioOutputIndex >= 0 && ch < entries[(size_t) audioOutputIndex].numChannels)
+                    audio.copyFrom (ch, 0, entries[(size_t) audioOutputIndex].buffer, ch, 0, numSamples);
+                else
+                    audio.clear (ch, 0, numSamples);
+            }
+
+            midi.clear();
+            if (midiOutputIndex >= 0)
+                midi.addEvents (entries[(size_t) midiOutputIndex].midi, 0, numSamples, 0);
+        }
+
+        void pushReady (int index) noexcept
+        {
+            const auto slot = writePos.fetch_add (1, std::memory_order_relaxed);
+            readySlots[(size_t) slot].store (index, std::memory_order_release);
+            readySlots[(size_t) slot].notify_all();
+        }
+
+        /**
+         * Claims the next ready node, waiting while its predecessors finish; -1 once everything is
+         * claimed. The wait spins briefly, then sleeps until the slot is filled (every slot below
+         * the node count is, eventually), so a runner stuck behind a long chain doesn't burn a core.
+         */
+        int popReady() noexcept
+        {
+            const auto numEntries = (int) entries.size();
+            int spin = 0;
+
+            for (;;)
+            {
+                auto r = readPos.load (std::memory_order_acquire);
+                if (r >= numEntries)
+                    return -1;
+
+                const auto index = readySlots[(size_t) r].load (std::memory_order_acquire);
+                if (index < 0)
+                {
+                    if (++spin < kSpinIterations)
+                        BKRenderWorkerPool::cpuRelax();
+                    else
+                        readySlots[(size_t) r].wait (-1, std::memory_order_acquire);
+                    continue;
+                }
+
+                if (readPos.compare_exchange_weak (r, r + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return index;
+            }
+        }
+
+        void runReadyNodes() noexcept
+        {
+            for (auto index = popReady(); index >= 0; index = popReady())
+            {
+                processNode (entries[(size_t) index]);
+
+                for (auto s : entries[(size_t) index].successors)
+                    if (pending[(size_t) s].fetch_sub (1, std::memory_order_acq_rel) == 1)
+                        pushReady (s);
+            }
+        }
+
+        void processNode (Entry& e) noexcept
+        {
+            // a view of exactly this block, as the graph would pass it
+            juce::AudioBuffer<float> buffer (e.buffer.getArrayOfWritePointers(), e.numChannels, numSamples);
+            buffer.clear();
+
+            for (const auto& in : e.audioInputs)
+                buffer.addFrom (in.destChannel, 0, entries[(size_t) in.source].buffer, in.sourceChannel, 0, numSamples);
+
+            e.midi.clear();
+            for (auto source : e.midiInputs)
+                e.midi.addEvents (entries[(size_t) source].midi, 0, numSamples, 0);
+
+            switch (e.ioType)
+            {
+                case IOProcessor::audioInputNode:
+                    for (int ch = 0; ch < juce::jmin (e.numChannels, graphAudioIn->getNumChannels()); ++ch)
+                        buffer.copyFrom (ch, 0, *graphAudioIn, ch, 0, numSamples);
+                    return;
+
+                case IOProcessor::midiInputNode:
+                    e.midi.addEvents (*graphMidiIn, 0, numSamples, 0);
+                    return;
+
+                case IOProcessor::audioOutputNode:
+                case IOProcessor::midiOutputNode:
+                    return; // collected by process() once everything has run
+
+                default:
+                    break;
+            }
+
+            auto* processor = e.node->getProcessor();
+            const juce::ScopedLock callbackLock (processor->getCallbackLock());
+            processor->setPlayHead (playHead);
+
+            if (processor->isSuspended())
+                buffer.clear();
+            else if (e.node->isBypassed() && processor->getBypassParameter() == nullptr)
+                processor->processBlockBypassed (buffer, e.midi);
+            else
+                processor->processBlock (buffer, e.midi);
+        }
+    };
+
+    //==============================================================================
+    GraphScheduler::GraphScheduler (juce::AudioProcessorGraph& g, std::shared_ptr<BKRenderWorkerPool> w)
+        : graph (g), workers (std::move (w))
+    {
+        graph.addChangeListener (this);
+    }
+
+    GraphScheduler::~GraphScheduler()
+    {
+        graph.removeChangeListener (this);
+        invalidate();
+    }
+
+    void GraphScheduler::prepare (int maxBlockSize)
+    {
+        preparedBlockSize = maxBlockSize;
+        invalidate();
+
+        auto newSchedule = buildSchedule();
+        const juce::SpinLock::ScopedLockType sl (scheduleLock);
+        std::swap (schedule, newSchedule);
+    }
+
+    void GraphScheduler::invalidate()
+    {
+        std::unique_ptr<Schedule> old;
+        {
+            const juce::SpinLock::ScopedLockType sl (scheduleLock);
+            std::swap (schedule, old);
+        }
+        // old (and any node references it held) goes here, off the audio thread
+    }
+
+    void GraphScheduler::changeListenerCallback (juce::ChangeBroadcaster*)
+    {
+        rebuild();
+    }
+
+    void GraphScheduler::rebuild()
+    {
+        if (preparedBlockSize <= 0)
+            return;
+
+        // make sure any newly added nodes have been prepared before we schedule them
+        graph.rebuild();
+
+        auto newSchedule = buildSchedule();
+        {
+            const juce::SpinLock::ScopedLockType sl (scheduleLock);
+            std::swap (schedule, newSchedule);
+        }
+    }
+
+    bool GraphScheduler::process (juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi) noexcept
+    {
+        if (! parallelEnabled.load (std::memory_order_relaxed))
+            return false;
+
+        const juce::SpinLock::ScopedTryLockType sl (scheduleLock);
+        if (! sl.isLocked() || schedule == nullptr || ! schedule->canRunInParallel
+            || audio.getNumSamples() > schedule->maxBlockSize)
+            return false;
+
+        schedule->process (audio, midi, graph.getPlayHead(), *workers);
+        return true;
+    }
+
+    //==============================================================================
+    std::unique_ptr<GraphScheduler::Schedule> GraphScheduler::buildSchedule() const
+    {
+        auto s = std::make_unique<Schedule>();
+        s->maxBlockSize = preparedBlockSize;
+
+        const auto nodes = graph.getNodes();
+        const auto numNodes = nodes.size();
+        if (numNodes == 0 || preparedBlockSize <= 0)
+            return s;
+
+        std::unordered_map<juce::uint32, int> indexForId;
+        s->entries.resize ((size_t) numNodes);
+
+        bool needsLatencyCompensation = false;
+
+        for (int i = 0; i < numNodes; ++i)
+        {
+            auto& e = s->entries[(size_t) i];
+            e.node = nodes[i];
+            indexForId[e.node->nodeID.uid] = i;
+
+            auto* processor = e.node->getProcessor();
+            e.numChannels = juce::jmax (processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels());
+            e.buffer.setSize (e.numChannels, preparedBlockSize);
+            e.midi.ensureSize (kMidiBufferBytes);
+
+            if (auto* io = dynamic_cast<IOProcessor*> (processor))
+            {
+                e.ioType = (int) io->getType();
+                if (e.ioType == IOProcessor::audioOutputNode)
+                    s->audioOutputIndex = i;
+                else if (e.ioType == IOProcessor::midiOutputNode)
+                    s->midiOutputIndex = i;
+            }
+
+            needsLatencyCompensation |= processor->getLatencySamples() > 0;
+        }
+
+        // connection edges
+        std::set<std::pair<int, int>> edges;
+        for (const auto& c : graph.getConnections())
+        {
+            const auto src = indexForId.find (c.source.nodeID.uid);
+            const auto dst = indexForId.find (c.destination.nodeID.uid);
+            if (src == indexForId.end() || dst == indexForId.end())
+                continue;
+
+            auto& dest = s->entries[(size_t) dst->second];
+
+            if (c.source.isMIDI())
+            {
+                dest.midiInputs.push_back (src->second);
+            }
+            else
+            {
+                if (c.source.channelIndex >= s->entries[(size_t) src->second].numChannels || c.destination.channelIndex >= dest.numChannels)
+                    continue;
+
+                dest.audioInputs.push_back ({ src->second, c.source.channelIndex, c.destination.channelIndex });
+            }
+
+            edges.insert ({ src->second, dst->second });
+        }
+
+        // serial order: topological, lowest node ID first among the ready ones
+        {
+            std::vector<int> inDegree ((size_t) numNodes, 0);
+            std::vector<std::vector<int>> outgoing ((size_t) numNodes);
+            for (const auto& [from, to] : edges)
+            {
+                outgoing[(size_t) from].push_back (to);
+                ++inDegree[(size_t) to];
+            }
+
+            std::set<int> ready;
+            for (int i = 0; i < numNodes; ++i)
+                if (inDegree[(size_t) i] == 0)
+                    ready.insert (i);
+
+            while (! ready.empty())
+            {
+                const auto i = *ready.begin();
+                ready.erase (ready.begin());
+                s->serialOrder.push_back (i);
+
+                for (auto to : outgoing[(size_t) i])
+                    if (--inDegree[(size_t) to] == 0)
+                        ready.insert (to);
+            }
+
+            if ((int) s->serialOrder.size() != numNodes)
+            {
+                jassertfalse; // the graph refuses cycles, so this shouldn't happen
+                return s;
+            }
+        }
+
+        std::vector<int> position ((size_t) numNodes);
+        for (int p = 0; p < numNodes; ++p)
+            position[(size_t) s->serialOrder[(size_t) p]] = p;
+
+        auto byPosition = [&position] (int a, int b) { return position[(size_t) a] < position[(size_t) b]; };
+
+        // state shared outside the graph: extra edges, all pointing forwards in the serial order,
+        // so they can't make a cycle
+        std::vector<std::pair<int, int>> orderingEdges;
+
+        auto chain = [&] (std::vector<int> group)
+        {
+            std::sort (group.begin(), group.end(), byPosition);
+            for (size_t k = 1; k < group.size(); ++k)
+                orderingEdges.emplace_back (group[k - 1], group[k]);
+        };
+
+        std::vector<int> modulationNodes;
+        for (int i = 0; i < numNodes; ++i)
+        {
+            auto* processor = s->entries[(size_t) i].node->getProcessor();
+
+            if (providesSharedState (processor))
+            {
+                std::vector<int> consumers;
+                for (auto it = edges.lower_bound ({ i, 0 }); it != edges.end() && it->first == i; ++it)
+                    consumers.push_back (it->second);
+                chain (std::move (consumers));
+            }
+
+            if (dynamic_cast<ModulationProcessor*> (processor) != nullptr)
+                modulationNodes.push_back (i);
+        }
+        chain (std::move (modulationNodes));
+
+        for (int b = 0; b < numNodes; ++b)
+        {
+            if (dynamic_cast<PianoSwitchProcessor*> (s->entries[(size_t) b].node->getProcessor()) == nullptr)
+                continue;
+
+            for (int j = 0; j < numNodes; ++j)
+            {
+                if (j == b)
+                    continue;
+
+                if (position[(size_t) j] < position[(size_t) b])
+                    orderingEdges.emplace_back (j, b);
+                else
+                    orderingEdges.emplace_back (b, j);
+            }
+        }
+
+        edges.insert (orderingEdges.begin(), orderingEdges.end());
+
+        for (auto& e : s->entries)
+        {
+            std::sort (e.audioInputs.begin(), e.audioInputs.end());
+            std::sort (e.midiInputs.begin(), e.midiInputs.end());
+            e.midiInputs.erase (std::unique (e.midiInputs.begin(), e.midiInputs.end()), e.midiInputs.end());
+        }
+
+        for (const auto& [from, to] : edges)
+        {
+            s->entries[(size_t) from].successors.push_back (to);
+            ++s->entries[(size_t) to].numPredecessors;
+        }
+
+        // how many preparations could run side by side: the widest level of the DAG
+        std::vector<int> level ((size_t) numNodes, 0);
+        std::vector<int> levelWidth ((size_t) numNodes + 1, 0);
+        int width = 0;
+        for (auto i : s->serialOrder)
+        {
+            for (auto to : s->entries[(size_t) i].successors)
+                level[(size_t) to] = juce::jmax (level[(size_t) to], level[(size_t) i] + 1);
+
+            if (s->entries[(size_t) i].ioType < 0)
+                width = juce::jmax (width, ++levelWidth[(size_t) level[(size_t) i]]);
+        }
+
+        s->numRunners = juce::jlimit (1, kMaxRunners, width);
+        s->pending = std::make_unique<std::atomic<int>[]> ((size_t) numNodes);
+        s->readySlots = std::make_unique<std::atomic<int>[]> ((size_t) numNodes);
+
+        // a single chain gains nothing here, and leaves the workers free for voice rendering
+        s->canRunInParallel = width > 1 && ! needsLatencyCompensation;
+        return s;
+    }
+} // namespace bitklavier
@@ -0,0 +1,74 @@
+// Copyright (C) 2022-2025 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "Synthesiser/BKRenderWorkerPool.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace bitklavier
+{
+    /**
+     * Renders the gallery's AudioProcessorGraph with independent preparations running
+     * at the same time on the engine's BKRenderWorkerPool.
+     *
+     * The dependency DAG comes from the graph's connection list, which already holds every
+     * link we care about: audio, MIDI, modulation, reset, and the tuning/tempo/synchronic
+     * links (SynthBase adds those as modulation-bus connections so that providers run first).
+     * On top of that, a few things share state outside the graph and are kept in serial order:
+     *  - preparations attached to the same Tuning, Tempo or Synchronic (e.g. adaptive tuning
+     *    state is updated by whichever Direct plays first),
+     *  - all ModulationProcessors (they share the engine's ParamOffsetBank),
+     *  - PianoSwitch, which re-bypasses the whole graph, runs on its own between everything
+     *    before it and everything after it.
+     *
+     * A node runs once all of its predecessors have, and gathers its inputs in a fixed order,
+     * so the output is the same as running the nodes one by one in the schedule's serial order,
+     * whatever the thread count.
+     *
+     * process() returns false whenever the caller should just use processorGraph->processBlock:
+     * when parallel processing is switched off for the gallery, the schedule is being rebuilt,
+     * the graph has no independent branches, or it needs something we don't do here
+     * (latency compensation, blocks larger than prepared).
+     */
+    class GraphScheduler : private juce::ChangeListener
+    {
+    public:
+        GraphScheduler (juce::AudioProcessorGraph& graph, std::shared_ptr<BKRenderWorkerPool> workers);
+        ~GraphScheduler() override;
+
+        /** The per-gallery switch; when off, the graph is always processed serially. Any thread. */
+        void setParallelEnabled (bool shouldBeEnabled) noexcept { parallelEnabled.store (shouldBeEnabled, std::memory_order_relaxed); }
+        bool isParallelEnabled() const noexcept { return parallelEnabled.load (std::memory_order_relaxed); }
+
+        /** Allocates the per-node buffers for this block size and rebuilds the schedule. Call after the graph is prepared. */
+        void prepare (int maxBlockSize);
+
+        /** Drops the current schedule. Call on the message thread before removing nodes or clearing the graph. */
+        void invalidate();
+
+        /** Audio thread. Renders the graph into audio/midi and returns true, or returns false and leaves them untouched. */
+        bool process (juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi) noexcept;
+
+    private:
+        struct Schedule;
+
+        void changeListenerCallback (juce::ChangeBroadcaster*) override;
+        void rebuild();
+        std::unique_ptr<Schedule> buildSchedule() const;
+
+        juce::AudioProcessorGraph& graph;
+        std::shared_ptr<BKRenderWorkerPool> workers;
+
+        int preparedBlockSize = 0;
+        std::atomic<bool> parallelEnabled { true };
+
+        // held by the audio thread for a whole block; the message thread swaps schedules under it
+        juce::SpinLock scheduleLock;
+        std::unique_ptr<Schedule> schedule;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphScheduler)
+    };
+} // namespace bitklavier
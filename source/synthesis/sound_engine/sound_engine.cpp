@@ -30,7 +30,8 @@ namespace bitklavier {
     /*voice_handler_(nullptr),*/
     /*voice_handler_(nullptr),*/
             last_oversampling_amount_(-1), last_sample_rate_(-1),
-            processorGraph(std::make_unique<juce::AudioProcessorGraph>())
+            processorGraph(std::make_unique<juce::AudioProcessorGraph>()),
+            graphScheduler(std::make_unique<GraphScheduler>(*processorGraph, renderWorkers))
         {
         initialiseGraph();
         processorGraph->enableAllBuses();
@@ -39,9 +40,11 @@ namespace bitklavier {
     SoundEngine::~SoundEngine() {}
     void  SoundEngine::shutdown() {
         allNotesOff();
+        graphScheduler.reset();
         processorGraph->clear();
         processorGraph->rebuild();
         processorGraph.reset();
+        renderWorkers->stop();
     }
 
     void SoundEngine::setOversamplingAmount(int oversampling_amount, int sample_rate) {
@@ -34,6 +34,10 @@
 #include "midi_manager.h"
 #include "synth_base.h"
 #include "KeymapProcessor.h"
+#include "Synthesiser/BKVoicePool.h"
+#include "Synthesiser/BKVoiceBudget.h"
+#include "Synthesiser/BKRenderWorkerPool.h"
+#include "graph_scheduler.h"
 #include <vector>
 
 namespace bitklavier
@@ -53,13 +57,20 @@ namespace bitklavier
 
         //      void process(int num_samples, juce::AudioSampleBuffer& buffer);
 
-        void releaseResources() { processorGraph->releaseResources(); }
+        void releaseResources()
+        {
+            processorGraph->releaseResources();
+            renderWorkers->stop();
+        }
         void resetEngine() { prepareToPlay (curr_sample_rate, buffer_size); }
         void prepareToPlay (double sampleRate, int samplesPerBlock)
         {
             setSampleRate (sampleRate);
             setBufferSize (samplesPerBlock);
+            renderWorkers->prepare (samplesPerBlock, sampleRate);
+            voiceBudget.prepare (sampleRate, samplesPerBlock);
             processorGraph->prepareToPlay (sampleRate, samplesPerBlock);
+            graphScheduler->prepare (samplesPerBlock);
             gainProcessor->prepareToPlay (sampleRate, samplesPerBlock);
             eqProcessor->prepareToPlay (sampleRate, samplesPerBlock);
             compressorProcessor->prepareToPlay (sampleRate, samplesPerBlock);
@@ -148,6 +159,7 @@ namespace bitklavier
 
         void initialiseGraph()
         {
+            graphScheduler->invalidate();
             processorGraph->clear();
             lastUID = juce::AudioProcessorGraph::NodeID (0);
             audioOutputNode = processorGraph->addNode (std::make_unique<AudioGraphIOProcessor> (AudioGraphIOProcessor::audioOutputNode), getNextUID());
@@ -284,7 +296,11 @@ namespace bitklavier
         juce::AudioProcessorGraph::Node::Ptr removeNode (juce::AudioProcessorGraph::NodeID id)
         {
             if(processorGraph)
+            {
+                // the parallel schedule may still be using this node; the graph rebuilds ours afterwards
+                graphScheduler->invalidate();
                 return processorGraph->removeNode (id);
+            }
             else
                 return nullptr;
         }
@@ -297,6 +313,32 @@ namespace bitklavier
         StateConnectionBank& getStateBank() { return state_bank_; }
         ParamOffsetBank& getParamOffsetBank() {return param_offset_bank_; }
 
+        /**
+         * Voices for every synth in the gallery. Synths keep a reference, so the pool
+         * lives as long as the last preparation that might still be holding voices.
+         */
+        std::shared_ptr<BKVoicePool> getVoicePool() { return voicePool; }
+
+        /**
+         * Lowers the voice pool's limit when callbacks get close to their deadline.
+         * Called at the end of every audio callback with the time it took.
+         */
+        void updateVoiceBudget (double secondsElapsed, int numSamples) noexcept
+        {
+            voicePool->setVoiceLimit (voiceBudget.update (secondsElapsed, numSamples, voicePool->getNumVoicesInUse()));
+        }
+
+        /** Fraction of each callback's deadline the voice budget tries to keep free. */
+        void setVoiceBudgetHeadroom (float fractionOfDeadline) { voiceBudget.setHeadroom (fractionOfDeadline); }
+
+        /** Load, voice limit and overrun counters; voices culled are counted by the pool. */
+        const BKVoiceBudget& getVoiceBudget() const noexcept { return voiceBudget; }
+
+        /**
+         * Worker threads for synths that render their voices in parallel; started in prepareToPlay.
+         */
+        std::shared_ptr<BKRenderWorkerPool> getRenderWorkers() { return renderWorkers; }
+
         /**
          * Updates the processors of all relevant nodes in the graph when
          * parameters in the Gallery Settings have been changed (marked "dirty")
@@ -355,7 +397,8 @@ namespace bitklavier
             updateChangedGalleryState ();
 
             //DBG ("------------------BEGIN BLOCK-------------------");
-            processorGraph->processBlock (audio_buffer, midi_buffer);
+            if (! graphScheduler->process (audio_buffer, midi_buffer))
+                processorGraph->processBlock (audio_buffer, midi_buffer);
         }
 
         void setInputsOutputs (int newNumIns, int newNumOuts)
@@ -700,6 +743,15 @@ namespace bitklavier
             tempoMultiplierDirty.store (true, std::memory_order_release);
         }
 
+        /**
+         * Per-gallery switch between running independent preparations in parallel
+         * and processing the whole graph serially. Safe to call from any thread.
+         */
+        void setParallelGraphProcessing (bool shouldBeParallel) noexcept
+        {
+            graphScheduler->setParallelEnabled (shouldBeParallel);
+        }
+
         void setBatchLoading (bool isBatch) noexcept
         {
             const bool wasBatch = isBatchLoading.exchange (isBatch, std::memory_order_relaxed);
@@ -736,7 +788,13 @@ namespace bitklavier
         float externalInputDisplayPeak_ = 0.0f;   // smoothed peak, audio-thread only
         float externalInputDecayFactor_  = 0.965f; // per-block decay, recomputed in prepareToPlay
 
+        std::shared_ptr<BKVoicePool> voicePool = std::make_shared<BKVoicePool>();
+        BKVoiceBudget voiceBudget { voicePool->getMaxPolyphony() };
+        std::shared_ptr<BKRenderWorkerPool> renderWorkers = std::make_shared<BKRenderWorkerPool>();
+
         std::unique_ptr<juce::AudioProcessorGraph> processorGraph;
+        // declared after the graph so it is destroyed first
+        std::unique_ptr<GraphScheduler> graphScheduler;
 
         Node::Ptr audioOutputNode;
         Node::Ptr midiInputNode;
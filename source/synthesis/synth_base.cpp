@@ -337,6 +337,12 @@ void SynthBase::valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasC
         if (auto* eng = getEngine())
             eng->requestTempoMultiplierUpdate (gTM); // thread-safe: sets atomics only
     }
+    else if (property == IDs::global_parallel_graph)
+    {
+        const bool parallel = (bool) treeWhosePropertyHasChanged.getProperty (IDs::global_parallel_graph, true);
+        if (auto* eng = getEngine())
+            eng->setParallelGraphProcessing (parallel); // thread-safe: sets an atomic only
+    }
 }
 
 juce::ValueTree SynthBase::getActivePreparationListValueTree()
@@ -1104,6 +1110,8 @@ void SynthBase::processAudioAndMidi (juce::AudioBuffer<float>& audio_buffer, juc
 {
     if (expired_)
         return;
+    const auto callbackStart = juce::Time::getHighResolutionTicks();
+
     AudioThreadAction action;
     while (processorInitQueue.try_dequeue (action))
         action();
@@ -1115,6 +1123,9 @@ void SynthBase::processAudioAndMidi (juce::AudioBuffer<float>& audio_buffer, juc
     engine_->getReverbProcessor()->processBlock (audio_buffer, midi_buffer);
     engine_->getMainVolumeProcessor()->processBlock (audio_buffer, midi_buffer);
 
+    engine_->updateVoiceBudget (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - callbackStart),
+                                audio_buffer.getNumSamples());
+
     total_samples_passed += audio_buffer.getNumSamples();
 
     // sample_index_of_switch = std::numeric_limits<int>::min();
@@ -1384,6 +1395,20 @@ bitklavier::ParamOffsetBank& SynthBase::getParamOffsetBank()
     return engine_->getParamOffsetBank();
 }
 
+std::shared_ptr<BKVoicePool> SynthBase::getVoicePool()
+{
+    jassert(engine_ != nullptr); // will fire during construction if you hit it too early
+
+    return engine_->getVoicePool();
+}
+
+std::shared_ptr<BKRenderWorkerPool> SynthBase::getRenderWorkers()
+{
+    jassert(engine_ != nullptr); // will fire during construction if you hit it too early
+
+    return engine_->getRenderWorkers();
+}
+
 bool SynthBase::isSourceConnected (const std::string& source)
 {
     for (auto* connection : mod_connections_)
@@ -34,6 +34,8 @@ class BKSamplerSound;
 class PreparationList;
 class SampleLoadManager;
 class MTSESPMasterCoordinator;
+class BKVoicePool;
+class BKRenderWorkerPool;
 
 class BKSynthesiserSound;
 namespace bitklavier {
@@ -76,6 +78,8 @@ public:
 
     bitklavier::StateConnectionBank &getStateBank();
     bitklavier::ParamOffsetBank &getParamOffsetBank();
+    std::shared_ptr<BKVoicePool> getVoicePool();
+    std::shared_ptr<BKRenderWorkerPool> getRenderWorkers();
 
     bool loadFromFile(juce::File preset, std::string &error);
     bool loadGalleryFromValueTree(const juce::ValueTree &state);
@@ -0,0 +1,40 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that BKNoteEventQueue fills to its capacity without reallocating, drops and
+// counts what doesn't fit, and keeps its storage across reset().
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKNoteEventQueue.h"
+
+TEST_CASE ("BKNoteEventQueue holds its capacity without reallocating", "[voices]")
+{
+    BKNoteEventQueue queue (64);
+    const auto* storage = queue.getEvents().data.begin();
+
+    for (int block = 0; block < 3; ++block)
+    {
+        queue.reset();
+
+        // in reverse order, so every add inserts at the front
+        for (int i = 63; i >= 0; --i)
+            REQUIRE (queue.add (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), i));
+
+        REQUIRE_FALSE (queue.add (juce::MidiMessage::noteOff (1, 60), 0));
+        REQUIRE (queue.size() == 64);
+        REQUIRE (queue.getEvents().getNumEvents() == 64);
+        REQUIRE (queue.getEvents().data.begin() == storage);
+    }
+
+    REQUIRE (queue.getNumDropped() == 3);
+    REQUIRE (queue.getPeakSize() == 64);
+
+    int lastPosition = -1;
+    for (const auto metadata : queue.getEvents())
+    {
+        REQUIRE (metadata.samplePosition > lastPosition);
+        lastPosition = metadata.samplePosition;
+    }
+}
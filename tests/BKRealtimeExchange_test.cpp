@@ -0,0 +1,55 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that BKRealtimeExchange deletes swapped-out states on collectGarbage(), but keeps
+// one that is still in use (as a soundset with voices still sounding is) until it isn't.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKRealtimeExchange.h"
+
+namespace
+{
+    struct State
+    {
+        explicit State (int& deletions) : numDeleted (deletions) {}
+        ~State() { ++numDeleted; }
+
+        bool isStillInUse() const noexcept { return inUse.load(); }
+
+        int& numDeleted;
+        std::atomic<bool> inUse { false };
+    };
+}
+
+TEST_CASE ("BKRealtimeExchange deletes swapped-out states once they're no longer in use", "[voices]")
+{
+    int numDeleted = 0;
+    BKRealtimeExchange<State> exchange;
+
+    // adopt() leaves the old state in the published object, which is what gets retired
+    auto first = std::make_unique<State> (numDeleted);
+    auto* retired = first.get();
+    exchange.publish (std::move (first));
+    REQUIRE (exchange.hasPending());
+
+    REQUIRE (exchange.adopt ([] (State& old) { old.inUse = true; }));
+    REQUIRE_FALSE (exchange.hasPending());
+
+    exchange.collectGarbage();
+    REQUIRE (numDeleted == 0);
+    REQUIRE (exchange.hasGarbage());
+
+    // one that isn't in use goes straight away, even while an older one is held
+    exchange.publish (std::make_unique<State> (numDeleted));
+    REQUIRE (exchange.adopt ([] (State&) {}));
+    exchange.collectGarbage();
+    REQUIRE (numDeleted == 1);
+    REQUIRE (exchange.hasGarbage());
+
+    retired->inUse = false;
+    exchange.collectGarbage();
+    REQUIRE (numDeleted == 2);
+    REQUIRE_FALSE (exchange.hasGarbage());
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that BKRenderWorkerPool runs every task of every job exactly once,
+// with and without worker threads.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKRenderWorkerPool.h"
+
+namespace
+{
+    void runJobs (BKRenderWorkerPool& pool)
+    {
+        constexpr int numTasks = 37;
+        std::array<std::atomic<int>, numTasks> counts {};
+
+        for (int job = 0; job < 500; ++job)
+        {
+            for (auto& c : counts)
+                c.store (0);
+
+            auto task = [&] (int i) { counts[(size_t) i].fetch_add (1); };
+            pool.parallelFor (numTasks, task);
+
+            for (auto& c : counts)
+                REQUIRE (c.load() == 1);
+        }
+    }
+}
+
+TEST_CASE ("BKRenderWorkerPool runs each task exactly once", "[render]")
+{
+    BKRenderWorkerPool pool;
+
+    SECTION ("with workers")
+    {
+        pool.setNumThreads (3);
+        pool.setUseRealtimePriority (false);
+        pool.prepare (256, 48000.);
+        runJobs (pool);
+    }
+
+    SECTION ("serial")
+    {
+        pool.setNumThreads (0);
+        pool.prepare (256, 48000.);
+        runJobs (pool);
+    }
+
+    SECTION ("after a restart")
+    {
+        pool.setNumThreads (2);
+        pool.prepare (256, 48000.);
+        runJobs (pool);
+        pool.prepare (512, 44100.);
+        runJobs (pool);
+        pool.stop();
+        runJobs (pool);
+    }
+}
@@ -0,0 +1,152 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that the frames a voice takes from a streamer slot at the start of a block stay put
+// for the whole block, even once the streamer would like to move on past them, and that the
+// streamer keeps only a bounded number of files open however many sources it streams.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKSampleStreamer.h"
+
+namespace
+{
+    // stands in for an open file; counts how many are open at once
+    struct CountedReader : juce::AudioFormatReader
+    {
+        explicit CountedReader (std::atomic<int>& openToUse)
+            : juce::AudioFormatReader (nullptr, "counted"), open (openToUse)
+        {
+            open.fetch_add (1);
+        }
+
+        ~CountedReader() override { open.fetch_sub (1); }
+
+        bool readSamples (int* const*, int, int, juce::int64, int) override { return true; }
+
+        std::atomic<int>& open;
+    };
+
+    // every streamed frame holds its own frame number, so a frame from the wrong place shows
+    struct CountingSource : BKSampleStreamer::Source
+    {
+        int getResidentLength() const override { return 0; }
+        juce::int64 getStreamLength() const override { return 100000; }
+
+        std::unique_ptr<juce::AudioFormatReader> createStreamReader() override
+        {
+            return std::make_unique<CountedReader> (open);
+        }
+
+        void readStreamed (juce::AudioFormatReader&, juce::int64 startFrame, int numFrames, float* left, float* right) override
+        {
+            for (int i = 0; i < numFrames; ++i)
+            {
+                left[i] = (float) (startFrame + i);
+                right[i] = -(float) (startFrame + i);
+            }
+        }
+
+        std::atomic<int> open { 0 };
+    };
+
+    struct NoHead
+    {
+        float left (int) const noexcept { return 0.f; }
+        float right (int) const noexcept { return 0.f; }
+    };
+
+    /** Runs blocks at position until the slot holds frames up to hi. */
+    BKSampleStreamer::Frames<NoHead> waitForFrames (BKSampleStreamer::Slot& slot, double position, juce::int64 hi)
+    {
+        for (int wait = 0; wait < 2000; ++wait)
+        {
+            slot.setPosition (position, true);
+            auto frames = slot.getFrames (NoHead {}, 0);
+            if (frames.hi >= hi)
+                return frames;
+            juce::Thread::sleep (1);
+        }
+
+        return {};
+    }
+}
+
+TEST_CASE ("A streamer slot's frames stay put for the block that took them", "[sampler]")
+{
+    CountingSource source;
+    BKSampleStreamer streamer (1, 2 * BKSampleStreamer::kChunkFrames);
+    constexpr juce::int64 ringFrames = 2 * BKSampleStreamer::kChunkFrames;
+    constexpr juce::int64 margin = BKSampleStreamer::kMarginFrames;
+
+    auto* slot = streamer.acquire (source, 0., true);
+    REQUIRE (slot != nullptr);
+    REQUIRE (waitForFrames (*slot, 0., ringFrames - margin).hi == ringFrames - margin);
+
+    // a block that starts at 100 and loops back to somewhere near it...
+    const auto frames = waitForFrames (*slot, 100., ringFrames - margin);
+    REQUIRE (frames.lo == 100 - margin);
+
+    // ...while the streamer is told the voice is already much further on
+    slot->setPosition (4000., true);
+    juce::Thread::sleep (100);
+
+    for (int i = (int) frames.lo; i < (int) frames.hi; ++i)
+    {
+        REQUIRE (frames.left (i) == (float) i);
+        REQUIRE (frames.right (i) == -(float) i);
+    }
+
+    // the next block lets go of them, and the streamer carries on
+    REQUIRE (waitForFrames (*slot, 4000., 4000 - margin + ringFrames).lo == 4000 - margin);
+
+    slot->release();
+}
+
+TEST_CASE ("The streamer keeps a bounded number of files open", "[sampler]")
+{
+    constexpr int numSources = 12;
+    constexpr int maxOpenReaders = 4;
+    std::array<CountingSource, numSources> sources;
+
+    {
+        BKSampleStreamer streamer (numSources, 2 * BKSampleStreamer::kChunkFrames, maxOpenReaders);
+        constexpr juce::int64 ringFrames = 2 * BKSampleStreamer::kChunkFrames;
+        constexpr juce::int64 margin = BKSampleStreamer::kMarginFrames;
+
+        // nothing is opened until a slot wants frames
+        juce::Thread::sleep (20);
+        REQUIRE (streamer.getNumOpenReaders() == 0);
+
+        std::array<BKSampleStreamer::Slot*, numSources> slots {};
+        for (int i = 0; i < numSources; ++i)
+        {
+            slots[(size_t) i] = streamer.acquire (sources[(size_t) i], 0., true);
+            REQUIRE (slots[(size_t) i] != nullptr);
+        }
+
+        // every slot still fills, with files closed and reopened as the streamer moves between them
+        for (auto* slot : slots)
+            REQUIRE (waitForFrames (*slot, 0., ringFrames - margin).hi == ringFrames - margin);
+
+        REQUIRE (streamer.getNumOpenReaders() <= maxOpenReaders);
+        int open = 0;
+        for (auto& source : sources)
+            open += source.open.load();
+        REQUIRE (open <= maxOpenReaders);
+
+        // a source going away closes its file straight away
+        for (auto& source : sources)
+        {
+            streamer.detach (source);
+            REQUIRE (source.open.load() == 0);
+        }
+
+        for (auto* slot : slots)
+            slot->release();
+    }
+
+    for (auto& source : sources)
+        REQUIRE (source.open.load() == 0);
+}
@@ -0,0 +1,183 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that the block (xsimd) render path in BKSamplerVoice matches the
+// per-sample reference path, and that compact, streamed and memory-mapped samples
+// sound the same as fully resident float ones, on a synthetic WAV.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "Sample.h"
+
+namespace
+{
+    juce::AudioBuffer<float> renderVoice (BKSamplerSound<juce::AudioFormatReader>& sound,
+                                          bool useBlocks,
+                                          int numChannels,
+                                          Direction direction,
+                                          int msToWaitAfterStart = 0)
+    {
+        constexpr int totalSamples = 6000;
+        constexpr int blockSize = 100; // deliberately not a multiple of the SIMD sub-block size
+
+        BKSamplerVoice<juce::AudioFormatReader> voice;
+        voice.setCurrentPlaybackSampleRate (44100.);
+        voice.setBlockRenderingEnabled (useBlocks);
+        voice.copyAmpEnv ({ 0.002f, 0.05f, 0.7f, 0.02f, 0.f, 0.f, 0.f });
+        voice.startNote (63, 100.f, 0.3f, false, &sound, 8192, direction == Direction::backward ? 40.f : 0.f, direction);
+        if (msToWaitAfterStart > 0)
+            juce::Thread::sleep (msToWaitAfterStart);
+
+        juce::AudioBuffer<float> out (numChannels, totalSamples);
+        out.clear();
+
+        for (int start = 0; start < totalSamples; start += blockSize)
+        {
+            if (start == 3000)
+                voice.stopNote (0.f, true);
+            voice.renderNextBlock (out, start, juce::jmin (blockSize, totalSamples - start));
+        }
+
+        return out;
+    }
+}
+
+TEST_CASE ("BKSamplerVoice block render matches per-sample render", "[sampler]")
+{
+    auto reader = makeTestWavReader (2, 8000);
+    REQUIRE (reader != nullptr);
+
+    juce::BigInteger notes, velocities;
+    notes.setRange (0, 128, true);
+    velocities.setRange (0, 128, true);
+
+    auto sample = std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90);
+    BKSamplerSound<juce::AudioFormatReader> sound ("test", sample, notes, 60, 0, velocities, 1, -50.f);
+
+    using Catch::Matchers::WithinAbs;
+
+    for (int numChannels : { 1, 2 })
+    {
+        for (auto direction : { Direction::forward, Direction::backward })
+        {
+            const auto reference = renderVoice (sound, false, numChannels, direction);
+            const auto block = renderVoice (sound, true, numChannels, direction);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < reference.getNumSamples(); ++i)
+                    REQUIRE_THAT (block.getSample (ch, i), WithinAbs (reference.getSample (ch, i), 1.0e-5));
+        }
+    }
+}
+
+TEST_CASE ("BKSamplerVoice renders compact sample storage like float storage", "[sampler]")
+{
+    auto reader = makeTestWavReader (2, 8000);
+    REQUIRE (reader != nullptr);
+
+    juce::BigInteger notes, velocities;
+    notes.setRange (0, 128, true);
+    velocities.setRange (0, 128, true);
+
+    auto floatSample = std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, SampleStorage::float32);
+    BKSamplerSound<juce::AudioFormatReader> floatSound ("float", floatSample, notes, 60, 0, velocities, 1, -50.f);
+
+    using Catch::Matchers::WithinAbs;
+
+    // the test file is 24-bit, so native storage is packed int24 and lossless; int16 is within its LSB
+    for (auto [storage, tolerance] : { std::pair { SampleStorage::native, 1.0e-5 }, std::pair { SampleStorage::int16, 1.0e-4 } })
+    {
+        auto sample = std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, storage);
+        REQUIRE (sample->getData().getSizeInBytes() < floatSample->getData().getSizeInBytes());
+
+        BKSamplerSound<juce::AudioFormatReader> sound ("compact", sample, notes, 60, 0, velocities, 1, -50.f);
+
+        for (bool useBlocks : { false, true })
+        {
+            const auto reference = renderVoice (floatSound, useBlocks, 2, Direction::forward);
+            const auto compact = renderVoice (sound, useBlocks, 2, Direction::forward);
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < reference.getNumSamples(); ++i)
+                    REQUIRE_THAT (compact.getSample (ch, i), WithinAbs (reference.getSample (ch, i), tolerance));
+        }
+    }
+}
+
+TEST_CASE ("BKSamplerVoice renders streamed samples like resident ones", "[sampler]")
+{
+    juce::BigInteger notes, velocities;
+    notes.setRange (0, 128, true);
+    velocities.setRange (0, 128, true);
+
+    auto residentReader = makeTestWavReader (2, 8000);
+    auto resident = std::make_shared<Sample<juce::AudioFormatReader>> (*residentReader, 90);
+    BKSamplerSound<juce::AudioFormatReader> residentSound ("resident", resident, notes, 60, 0, velocities, 1, -50.f);
+
+    // 50 ms head, so most of the note comes off the streamer
+    auto streamer = std::make_shared<BKSampleStreamer> (4);
+    auto streamedReader = makeTestWavReader (2, 8000);
+    auto streamed = std::make_shared<Sample<juce::AudioFormatReader>> (*streamedReader, 90, SampleStorage::native, streamer, 0.05,
+        [] { return makeTestWavReader (2, 8000); });
+    REQUIRE (streamed->isStreamed());
+    REQUIRE (streamed->getResidentLength() < streamed->getLength());
+
+    using Catch::Matchers::WithinAbs;
+
+    // velocity layering measures the first 0.4 s, head or not
+    REQUIRE_THAT (streamed->getRMS(), WithinAbs (resident->getRMS(), 1.0e-4));
+
+    BKSamplerSound<juce::AudioFormatReader> streamedSound ("streamed", streamed, notes, 60, 0, velocities, 1, -50.f);
+
+    // give the streamer time to fill the slot before the voice gets past the head
+    const auto reference = renderVoice (residentSound, true, 2, Direction::forward);
+    const auto actual = renderVoice (streamedSound, true, 2, Direction::forward, 200);
+
+    for (int ch = 0; ch < 2; ++ch)
+        for (int i = 0; i < reference.getNumSamples(); ++i)
+            REQUIRE_THAT (actual.getSample (ch, i), WithinAbs (reference.getSample (ch, i), 1.0e-5));
+
+    REQUIRE (streamer->getNumUnderruns() == 0);
+}
+
+TEST_CASE ("BKSamplerVoice renders memory-mapped samples like resident ones", "[sampler]")
+{
+    juce::BigInteger notes, velocities;
+    notes.setRange (0, 128, true);
+    velocities.setRange (0, 128, true);
+
+    auto residentReader = makeTestWavReader (2, 8000);
+    auto resident = std::make_shared<Sample<juce::AudioFormatReader>> (*residentReader, 90);
+    BKSamplerSound<juce::AudioFormatReader> residentSound ("resident", resident, notes, 60, 0, velocities, 1, -50.f);
+
+    juce::TemporaryFile file (".wav");
+    const auto wav = makeTestWav (2, 8000);
+    REQUIRE (file.getFile().replaceWithData (wav.getData(), wav.getSize()));
+
+    auto mappedFile = MappedWaveFile::open (file.getFile());
+    REQUIRE (mappedFile != nullptr);
+
+    auto mapped = std::make_shared<Sample<juce::AudioFormatReader>> (mappedFile, 90);
+    REQUIRE (mapped->getData().isMapped());
+    REQUIRE (mapped->getData().getStorage() == SampleStorage::int24);
+
+    // no zero padding in a file, so the last few frames are held back for interpolation
+    REQUIRE (mapped->getLength() == 8000 - CompactSampleData::kPadding);
+
+    using Catch::Matchers::WithinAbs;
+    REQUIRE_THAT (mapped->getRMS(), WithinAbs (resident->getRMS(), 1.0e-4));
+
+    BKSamplerSound<juce::AudioFormatReader> mappedSound ("mapped", mapped, notes, 60, 0, velocities, 1, -50.f);
+
+    for (bool useBlocks : { false, true })
+    {
+        const auto reference = renderVoice (residentSound, useBlocks, 2, Direction::forward);
+        const auto actual = renderVoice (mappedSound, useBlocks, 2, Direction::forward);
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < reference.getNumSamples(); ++i)
+                REQUIRE_THAT (actual.getSample (ch, i), WithinAbs (reference.getSample (ch, i), 1.0e-5));
+    }
+}
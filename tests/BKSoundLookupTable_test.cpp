@@ -0,0 +1,83 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that the noteOn lookup table finds the same sounds, in the same order, as testing
+// every sound's note and velocity ranges.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKSynthesiser.h"
+
+namespace
+{
+    using BKSound = BKSamplerSound<juce::AudioFormatReader>;
+
+    BKSynthesiserSound::Ptr makeSound (int loKey, int hiKey, int loVel, int hiVel)
+    {
+        juce::BigInteger keys, velocities;
+        keys.setRange (loKey, hiKey - loKey + 1, true);
+        velocities.setRange (loVel, hiVel - loVel + 1, true);
+        return new BKSound ("sound", nullptr, keys, loKey, 0, velocities, 1, -50.f);
+    }
+
+    void requireSameAsScan (const BKSoundLookupTable& table, juce::ReferenceCountedArray<BKSynthesiserSound>& sounds)
+    {
+        REQUIRE (table.isValidFor (&sounds));
+
+        for (int note = -1; note <= MaxMidiNotes; ++note)
+        {
+            for (int velocity = 0; velocity < 128; ++velocity)
+            {
+                std::vector<int> scanned;
+                if (note >= 0 && note < MaxMidiNotes)
+                    for (int i = 0; i < sounds.size(); ++i)
+                        if (sounds[i]->appliesToNote (note) && sounds[i]->appliesToVelocity (velocity))
+                            scanned.push_back (i);
+
+                const auto found = table.getSounds (note, velocity);
+                REQUIRE (std::vector<int> (found.begin(), found.end()) == scanned);
+            }
+        }
+    }
+}
+
+TEST_CASE ("BKSoundLookupTable matches a layered sample set", "[synth]")
+{
+    // a sample every minor third across the piano, in four velocity layers
+    juce::ReferenceCountedArray<BKSynthesiserSound> sounds;
+    const int layers[][2] = { { 0, 40 }, { 41, 80 }, { 81, 110 }, { 111, 127 } };
+    for (auto [loVel, hiVel] : layers)
+        for (int key = 21; key <= 108; key += 3)
+            sounds.add (makeSound (key, juce::jmin (key + 2, 108), loVel, hiVel));
+
+    BKSoundLookupTable table;
+    table.build (sounds);
+    requireSameAsScan (table, sounds);
+
+    // a soundset that has changed since the table was built isn't looked up
+    sounds.add (makeSound (60, 60, 0, 127));
+    REQUIRE_FALSE (table.isValidFor (&sounds));
+}
+
+TEST_CASE ("BKSoundLookupTable matches an overlapping SF2-style set", "[synth]")
+{
+    // soundfont regions overlap freely, so one cell can play several sounds
+    juce::ReferenceCountedArray<BKSynthesiserSound> sounds;
+    juce::Random random (5);
+    for (int i = 0; i < 60; ++i)
+    {
+        const auto loKey = random.nextInt (MaxMidiNotes);
+        const auto hiKey = loKey + random.nextInt (MaxMidiNotes - loKey);
+        const auto loVel = random.nextInt (128);
+        const auto hiVel = loVel + random.nextInt (128 - loVel);
+        sounds.add (makeSound (loKey, hiKey, loVel, hiVel));
+    }
+
+    // and one covering everything, as a soundfont's fallback region often does
+    sounds.add (makeSound (0, MaxMidiNotes - 1, 0, 127));
+
+    BKSoundLookupTable table;
+    table.build (sounds);
+    requireSameAsScan (table, sounds);
+}
@@ -0,0 +1,166 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that notes still sounding when a synth's soundset is replaced carry on until they're
+// released, that the old set is only freed once they've finished, and that no more than
+// kMaxRetiringVoices of them are carried over.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKSynthesiser.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.;
+    constexpr int blockSize = 512;
+
+    /** One sound on every key and velocity, two seconds of steady tone. */
+    BKSynthesiserSound::Ptr makeSound()
+    {
+        auto reader = makeTestWavReader (1, 2 * (int) sampleRate, 16, sampleRate);
+        auto sample = std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90);
+
+        juce::BigInteger keys, velocities;
+        keys.setRange (0, 128, true);
+        velocities.setRange (0, 128, true);
+        return new BKSamplerSound<juce::AudioFormatReader> ("tone", sample, keys, 60, 0, velocities, 1, -50.f);
+    }
+
+    struct TestSynth
+    {
+        TestSynth()
+        {
+            synth.setCurrentPlaybackSampleRate (sampleRate);
+            synth.setNoteOnSpecMap (specs);
+        }
+
+        /** Renders a block with midi at its start; returns its peak level. */
+        float render (const juce::MidiBuffer& midi = {})
+        {
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            buffer.clear();
+            synth.renderNextBlock (buffer, midi, 0, blockSize);
+            return buffer.getMagnitude (0, blockSize);
+        }
+
+        /** Renders until nothing is sounding; false if that takes more than seconds. */
+        bool renderUntilSilent (double seconds = 5.)
+        {
+            for (int i = 0; i < (int) (seconds * sampleRate / blockSize); ++i)
+                if (render() == 0.f && synth.getNumActiveVoices() == 0)
+                    return true;
+            return false;
+        }
+
+        static juce::MidiBuffer notes (std::initializer_list<int> keys, bool on)
+        {
+            juce::MidiBuffer midi;
+            for (auto key : keys)
+                midi.addEvent (on ? juce::MidiMessage::noteOn (1, key, (juce::uint8) 100)
+                                  : juce::MidiMessage::noteOff (1, key), 0);
+            return midi;
+        }
+
+        EnvParams env;
+        chowdsp::GainDBParameter::Ptr gain {
+            juce::ParameterID { "gain", 100 },
+            "Gain",
+            juce::NormalisableRange { -80.f, 6.f },
+            0.0f,
+            true
+        };
+        BKSynthesiser synth { env, *gain };
+        std::array<NoteOnSpec, MaxMidiNotes> specs;
+    };
+}
+
+TEST_CASE ("A note keeps sounding through a soundset change until it's released", "[voices]")
+{
+    TestSynth test;
+
+    auto oldSound = makeSound();
+    juce::ReferenceCountedArray<BKSynthesiserSound> oldSet, newSet;
+    oldSet.add (oldSound);
+    newSet.add (makeSound());
+
+    test.synth.addSoundSet (&oldSet, 8);
+    test.render (TestSynth::notes ({ 60 }, true));
+    for (int i = 0; i < 4; ++i)
+        REQUIRE (test.render() > 0.f);
+
+    const auto unusedReferences = 2; // oldSound, oldSet
+    REQUIRE (oldSound->getReferenceCount() > unusedReferences);
+
+    // the new set is swapped in at the next block, and the old note carries on in it
+    test.synth.addSoundSet (&newSet, 8);
+    for (int i = 0; i < 20; ++i)
+        REQUIRE (test.render() > 0.f);
+
+    REQUIRE (test.synth.getNumActiveVoices() == 1);
+    REQUIRE (test.synth.getNumRetiringVoices() == 1);
+
+    // the old set outlives its last note
+    test.synth.collectRetiredSoundSets();
+    REQUIRE (oldSound->getReferenceCount() > unusedReferences);
+
+    // the key coming up still reaches the carried-over voice
+    test.render (TestSynth::notes ({ 60 }, false));
+    REQUIRE (test.renderUntilSilent());
+    REQUIRE (test.synth.getNumRetiringVoices() == 0);
+
+    test.synth.collectRetiredSoundSets();
+    REQUIRE (oldSound->getReferenceCount() == unusedReferences);
+
+    // and the new set plays as usual
+    test.render (TestSynth::notes ({ 64 }, true));
+    REQUIRE (test.render() > 0.f);
+    REQUIRE (test.synth.getNumActiveVoices() == 1);
+    REQUIRE (test.synth.getNumRetiringVoices() == 0);
+}
+
+TEST_CASE ("At most kMaxRetiringVoices are carried over into a new soundset", "[voices]")
+{
+    TestSynth test;
+
+    // three keys of a hundred slightly detuned voices each
+    constexpr int voicesPerKey = 100;
+    const auto keys = { 48, 60, 72 };
+    for (auto key : keys)
+    {
+        auto& spec = test.specs[(size_t) key];
+        spec.transpositions.clear();
+        spec.transpositionGains.clear();
+        for (int i = 0; i < voicesPerKey; ++i)
+        {
+            spec.transpositions.add (0.005f * (float) i);
+            spec.transpositionGains.add (1.f);
+        }
+    }
+
+    const int numNotes = voicesPerKey * (int) keys.size();
+    static_assert (BKSynthesiser::kMaxRetiringVoices < voicesPerKey * 3);
+
+    auto oldSound = makeSound();
+    juce::ReferenceCountedArray<BKSynthesiserSound> oldSet, newSet;
+    oldSet.add (oldSound);
+    newSet.add (makeSound());
+
+    test.synth.addSoundSet (&oldSet, numNotes + 20);
+    test.render (TestSynth::notes (keys, true));
+    REQUIRE (test.render() > 0.f);
+    REQUIRE (test.synth.getNumActiveVoices() == numNotes);
+
+    // the ones over the limit are cut off, as every voice was before sets could be swapped under them
+    test.synth.addSoundSet (&newSet, 8);
+    REQUIRE (test.render() > 0.f);
+    REQUIRE (test.synth.getNumActiveVoices() == BKSynthesiser::kMaxRetiringVoices);
+    REQUIRE (test.synth.getNumRetiringVoices() == BKSynthesiser::kMaxRetiringVoices);
+
+    test.render (TestSynth::notes (keys, false));
+    REQUIRE (test.renderUntilSilent());
+    REQUIRE (test.synth.getNumRetiringVoices() == 0);
+
+    test.synth.collectRetiredSoundSets();
+    REQUIRE (oldSound->getReferenceCount() == 2);
+}
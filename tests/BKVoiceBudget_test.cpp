@@ -0,0 +1,64 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that BKVoiceBudget lowers the voice limit when callbacks run close to
+// their deadline, and gives the voices back once the load goes away.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BKVoiceBudget.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.;
+    constexpr int blockSize = 256;
+    constexpr double deadline = blockSize / sampleRate;
+
+    int runBlocks (BKVoiceBudget& budget, int numBlocks, double load, int numVoicesInUse)
+    {
+        int limit = budget.getVoiceLimit();
+        for (int i = 0; i < numBlocks; ++i)
+            limit = budget.update (load * deadline, blockSize, juce::jmin (limit, numVoicesInUse));
+        return limit;
+    }
+}
+
+TEST_CASE ("BKVoiceBudget keeps the full polyphony under light load", "[voices]")
+{
+    BKVoiceBudget budget (1024);
+    budget.prepare (sampleRate, blockSize);
+
+    REQUIRE (runBlocks (budget, 1000, 0.3, 500) == 1024);
+    REQUIRE (budget.getNumOverruns() == 0);
+}
+
+TEST_CASE ("BKVoiceBudget lowers the limit under load and recovers", "[voices]")
+{
+    BKVoiceBudget budget (1024);
+    budget.prepare (sampleRate, blockSize);
+    budget.setHeadroom (0.25f);
+
+    // callbacks taking 120% of the deadline with 600 voices sounding
+    const auto limitUnderLoad = runBlocks (budget, 200, 1.2, 600);
+    REQUIRE (limitUnderLoad < 600);
+    REQUIRE (limitUnderLoad >= BKVoiceBudget::kMinPolyphony);
+    REQUIRE (budget.getNumOverruns() == 200);
+
+    // never lower than the floor, however long the overload lasts
+    REQUIRE (runBlocks (budget, 2000, 5.0, 600) == BKVoiceBudget::kMinPolyphony);
+
+    // back to full polyphony a few seconds after the load goes away
+    REQUIRE (runBlocks (budget, (int) (5. / deadline), 0.1, 600) == 1024);
+}
+
+TEST_CASE ("BKVoiceBudget only cuts once the smoothed load is over the target", "[voices]")
+{
+    BKVoiceBudget budget (512);
+    budget.prepare (sampleRate, blockSize);
+
+    // one slow callback among fast ones is smoothed away
+    runBlocks (budget, 100, 0.2, 300);
+    runBlocks (budget, 1, 1.5, 300);
+    REQUIRE (runBlocks (budget, 100, 0.2, 300) == 512);
+}
@@ -0,0 +1,80 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that BlendronicDelay's block process() sounds the same as ticking it a frame at a
+// time, across ring wraps, short delays, feedback changes and delay-length ramps.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "BlendronicDelay.h"
+
+namespace
+{
+    constexpr double sampleRate = 44100.;
+    constexpr int bufferSize = 5000; // not a power of two, so the ring is bigger than asked for
+
+    void setLength (BlendronicDelay& delay, float length, float smoothRate)
+    {
+        delay.setDelayLengthFromBlendronic (length);
+        delay.setSmoothRate (smoothRate);
+    }
+}
+
+TEST_CASE ("BlendronicDelay process() matches tick()", "[blendronic]")
+{
+    BlendronicDelay block (300.f, 0.f, 1.f, bufferSize, sampleRate);
+    BlendronicDelay reference (300.f, 0.f, 1.f, bufferSize, sampleRate);
+    block.setSampleRate (sampleRate);
+    reference.setSampleRate (sampleRate);
+
+    juce::Random random (42);
+    const float lengths[] = { 0.f, 0.5f, 1.5f, 300.f, 300.25f, 2048.f, 4321.7f, 17.f };
+    const int blockSizes[] = { 1, 31, 64, 256, 700 };
+
+    float maxDifference = 0.f;
+    for (int step = 0; step < 400; ++step)
+    {
+        // every few blocks change the length, half the time jumping and half ramping to it
+        if (step % 10 == 0)
+        {
+            const auto length = lengths[random.nextInt ((int) std::size (lengths))];
+            const auto smoothRate = random.nextBool() ? 1.0e9f : 4.f;
+            setLength (block, length, smoothRate);
+            setLength (reference, length, smoothRate);
+        }
+
+        if (step % 7 == 0)
+        {
+            const auto feedback = random.nextFloat() * 0.9f;
+            block.setFeedback (feedback);
+            reference.setFeedback (feedback);
+        }
+
+        const auto numSamples = blockSizes[random.nextInt ((int) std::size (blockSizes))];
+        juce::AudioBuffer<float> blockAudio (2, numSamples);
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < numSamples; ++i)
+                blockAudio.setSample (c, i, random.nextFloat() * 2.f - 1.f);
+
+        juce::AudioBuffer<float> referenceAudio (blockAudio);
+
+        // as BlendronicProcessor does before each block
+        block.clearAhead (numSamples);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            reference.scalePrevious (0.f, i, 0);
+            reference.scalePrevious (0.f, i, 1);
+        }
+
+        block.process (blockAudio.getWritePointer (0), blockAudio.getWritePointer (1), numSamples);
+        for (int i = 0; i < numSamples; ++i)
+            reference.tick (referenceAudio.getWritePointer (0, i), referenceAudio.getWritePointer (1, i));
+
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < numSamples; ++i)
+                maxDifference = juce::jmax (maxDifference, std::abs (blockAudio.getSample (c, i) - referenceAudio.getSample (c, i)));
+    }
+
+    REQUIRE (maxDifference < 1.0e-4f);
+}
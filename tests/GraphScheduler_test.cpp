@@ -0,0 +1,163 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that GraphScheduler renders a graph of independent chains the same way
+// AudioProcessorGraph does serially, with and without worker threads.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "graph_scheduler.h"
+
+namespace
+{
+    using Graph = juce::AudioProcessorGraph;
+    using IOProcessor = Graph::AudioGraphIOProcessor;
+
+    // stateless, so two copies of the same graph produce the same output
+    class TestProcessor final : public juce::AudioProcessor
+    {
+    public:
+        explicit TestProcessor (float g)
+            : juce::AudioProcessor (BusesProperties()
+                                        .withInput ("Input", juce::AudioChannelSet::stereo())
+                                        .withOutput ("Output", juce::AudioChannelSet::stereo())),
+              gain (g)
+        {
+        }
+
+        void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override
+        {
+            const auto offset = 0.01f * (float) midi.getNumEvents();
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    buffer.setSample (ch, i, buffer.getSample (ch, i) * 0.5f + gain * (float) (i + 1) / 64.f + offset);
+
+            midi.addEvent (juce::MidiMessage::noteOn (1, 60, 1.f), 0);
+        }
+
+        const juce::String getName() const override { return "Test"; }
+        void prepareToPlay (double, int) override {}
+        void releaseResources() override {}
+        double getTailLengthSeconds() const override { return 0.; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return true; }
+        juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override {}
+        const juce::String getProgramName (int) override { return {}; }
+        void changeProgramName (int, const juce::String&) override {}
+        void getStateInformation (juce::MemoryBlock&) override {}
+        void setStateInformation (const void*, int) override {}
+
+    private:
+        float gain;
+    };
+
+    // midi in -> four chains of two processors each, two of them merging, -> audio and midi out
+    void buildGraph (Graph& graph)
+    {
+        graph.setPlayConfigDetails (0, 2, 48000., 128);
+
+        auto out = graph.addNode (std::make_unique<IOProcessor> (IOProcessor::audioOutputNode))->nodeID;
+        auto midiIn = graph.addNode (std::make_unique<IOProcessor> (IOProcessor::midiInputNode))->nodeID;
+        auto midiOut = graph.addNode (std::make_unique<IOProcessor> (IOProcessor::midiOutputNode))->nodeID;
+
+        std::vector<Graph::NodeID> lastInChain;
+        for (int chain = 0; chain < 4; ++chain)
+        {
+            auto a = graph.addNode (std::make_unique<TestProcessor> (0.1f * (float) (chain + 1)))->nodeID;
+            auto b = graph.addNode (std::make_unique<TestProcessor> (0.05f * (float) (chain + 1)))->nodeID;
+
+            graph.addConnection ({ { midiIn, Graph::midiChannelIndex }, { a, Graph::midiChannelIndex } });
+            graph.addConnection ({ { a, Graph::midiChannelIndex }, { b, Graph::midiChannelIndex } });
+            for (int ch = 0; ch < 2; ++ch)
+                graph.addConnection ({ { a, ch }, { b, ch } });
+
+            lastInChain.push_back (b);
+        }
+
+        // the last two chains meet in one more processor
+        auto merge = graph.addNode (std::make_unique<TestProcessor> (0.3f))->nodeID;
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            graph.addConnection ({ { lastInChain[2], ch }, { merge, ch } });
+            graph.addConnection ({ { lastInChain[3], ch }, { merge, ch } });
+        }
+
+        for (auto node : { lastInChain[0], lastInChain[1], merge })
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                graph.addConnection ({ { node, ch }, { out, ch } });
+            graph.addConnection ({ { node, Graph::midiChannelIndex }, { midiOut, Graph::midiChannelIndex } });
+        }
+
+        graph.prepareToPlay (48000., 128);
+    }
+
+    void requireSameBlocks (int numThreads)
+    {
+        Graph serialGraph, parallelGraph;
+        buildGraph (serialGraph);
+        buildGraph (parallelGraph);
+
+        auto workers = std::make_shared<BKRenderWorkerPool>();
+        workers->setNumThreads (numThreads);
+        workers->setUseRealtimePriority (false);
+        workers->prepare (128, 48000.);
+
+        bitklavier::GraphScheduler scheduler (parallelGraph, workers);
+        scheduler.prepare (128);
+
+        for (int block = 0; block < 50; ++block)
+        {
+            juce::AudioBuffer<float> expected (2, 128), actual (2, 128);
+            expected.clear();
+            actual.clear();
+
+            juce::MidiBuffer expectedMidi, actualMidi;
+            expectedMidi.addEvent (juce::MidiMessage::noteOn (1, 64, 0.5f), 10);
+            actualMidi.addEvent (juce::MidiMessage::noteOn (1, 64, 0.5f), 10);
+
+            serialGraph.processBlock (expected, expectedMidi);
+            REQUIRE (scheduler.process (actual, actualMidi));
+
+            REQUIRE (actualMidi.getNumEvents() == expectedMidi.getNumEvents());
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < 128; ++i)
+                    REQUIRE_THAT (actual.getSample (ch, i), Catch::Matchers::WithinAbs (expected.getSample (ch, i), 1.0e-5));
+        }
+
+        workers->stop();
+    }
+}
+
+TEST_CASE ("GraphScheduler matches serial graph processing", "[render]")
+{
+    SECTION ("with workers")
+    {
+        requireSameBlocks (3);
+    }
+
+    SECTION ("serial")
+    {
+        requireSameBlocks (0);
+    }
+}
+
+TEST_CASE ("GraphScheduler falls back when switched off", "[render]")
+{
+    Graph graph;
+    buildGraph (graph);
+
+    bitklavier::GraphScheduler scheduler (graph, std::make_shared<BKRenderWorkerPool>());
+    scheduler.prepare (128);
+    scheduler.setParallelEnabled (false);
+
+    juce::AudioBuffer<float> audio (2, 128);
+    juce::MidiBuffer midi;
+    REQUIRE_FALSE (scheduler.process (audio, midi));
+}
@@ -0,0 +1,70 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that a lazily loaded sound can't be started until its sample is in, and can't be
+// unloaded while a voice is playing it.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "Sample.h"
+
+namespace
+{
+    using BKSound = BKSamplerSound<juce::AudioFormatReader>;
+
+    std::shared_ptr<Sample<juce::AudioFormatReader>> makeSample()
+    {
+        auto reader = makeTestWavReader (1, 2000, 16);
+        return std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, SampleStorage::native);
+    }
+
+    BKSynthesiserSound::Ptr makeUnloadedSound()
+    {
+        juce::BigInteger keys, velocities;
+        keys.setBit (60);
+        velocities.setRange (0, 128, true);
+        return new BKSound ("C4v1", nullptr, keys, 60, 0, velocities, 1, -50.f);
+    }
+}
+
+TEST_CASE ("A lazily loaded sound only starts once its sample is loaded", "[samples]")
+{
+    auto sound = makeUnloadedSound();
+    auto* sampler = static_cast<BKSound*> (sound->getSamplerSoundBase());
+
+    REQUIRE_FALSE (sound->isLoaded());
+    REQUIRE_FALSE (sound->pinIfLoaded());
+    REQUIRE (sound->takeLoadRequest());
+    REQUIRE_FALSE (sound->takeLoadRequest());
+
+    sampler->setLoadedSample (makeSample(), -50.f);
+    REQUIRE (sampler->getSample() != nullptr);
+    REQUIRE (sound->dBFSLevel == sampler->getSample()->getRMS());
+    REQUIRE (sound->pinIfLoaded());
+    sound->unpin();
+}
+
+TEST_CASE ("A lazily loaded sound isn't unloaded while a voice plays it", "[samples]")
+{
+    auto sound = makeUnloadedSound();
+    auto* sampler = static_cast<BKSound*> (sound->getSamplerSoundBase());
+    sampler->setLoadedSample (makeSample(), -50.f);
+
+    {
+        BKPlayingSoundPtr voice;
+        voice = sound.get();
+
+        // a graveyard slot copying the voice holds it too
+        BKPlayingSoundPtr graveyard (voice);
+        voice = nullptr;
+
+        REQUIRE_FALSE (sound->beginUnload());
+        REQUIRE (sound->isLoaded());
+    }
+
+    REQUIRE (sound->beginUnload());
+    REQUIRE_FALSE (sound->pinIfLoaded());
+    sampler->releaseSample();
+    REQUIRE (sampler->getSample() == nullptr);
+}
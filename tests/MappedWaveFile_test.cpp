@@ -0,0 +1,92 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that a float WAV file is only mapped when its data can be read in place as floats,
+// and that a mapped file doesn't hold on to a file descriptor.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "MappedWaveFile.h"
+
+namespace
+{
+    // a mono float WAV; an 18-byte fmt chunk (with cbSize) puts the data 2 bytes off a float boundary
+    juce::MemoryBlock makeFloatWav (int fmtChunkSize, int numFrames)
+    {
+        juce::MemoryOutputStream fmt;
+        fmt.writeShort (3); // WAVE_FORMAT_IEEE_FLOAT
+        fmt.writeShort (1);
+        fmt.writeInt (44100);
+        fmt.writeInt (44100 * 4);
+        fmt.writeShort (4);
+        fmt.writeShort (32);
+        if (fmtChunkSize > 16)
+            fmt.writeRepeatedByte (0, (size_t) (fmtChunkSize - 16));
+
+        juce::MemoryOutputStream body;
+        body.write ("WAVE", 4);
+        body.write ("fmt ", 4);
+        body.writeInt ((int) fmt.getDataSize());
+        body.write (fmt.getData(), fmt.getDataSize());
+        body.write ("data", 4);
+        body.writeInt (numFrames * 4);
+        for (int i = 0; i < numFrames; ++i)
+            body.writeFloat (0.5f * std::sin (0.01f * (float) i));
+
+        juce::MemoryOutputStream wav;
+        wav.write ("RIFF", 4);
+        wav.writeInt ((int) body.getDataSize());
+        wav.write (body.getData(), body.getDataSize());
+        return wav.getMemoryBlock();
+    }
+}
+
+TEST_CASE ("MappedWaveFile only maps float data it can read in place", "[samples]")
+{
+    for (auto [fmtChunkSize, aligned] : { std::pair { 16, true }, std::pair { 18, false } })
+    {
+        juce::TemporaryFile file (".wav");
+        const auto wav = makeFloatWav (fmtChunkSize, 1000);
+        REQUIRE (file.getFile().replaceWithData (wav.getData(), wav.getSize()));
+
+        const auto mapped = MappedWaveFile::open (file.getFile());
+        REQUIRE ((mapped != nullptr) == aligned);
+
+        if (mapped != nullptr)
+        {
+            REQUIRE (mapped->isFloatingPoint());
+            REQUIRE (mapped->getNumFrames() == 1000);
+            REQUIRE (reinterpret_cast<uintptr_t> (mapped->getFrames()) % alignof (float) == 0);
+        }
+    }
+}
+
+#if ! JUCE_WINDOWS
+TEST_CASE ("MappedWaveFile doesn't keep its file open", "[samples]")
+{
+    auto countOpenFiles = [] { return juce::File ("/dev/fd").getNumberOfChildFiles (juce::File::findFilesAndDirectories); };
+
+    juce::TemporaryFile file (".wav");
+    const auto wav = makeFloatWav (16, 1000);
+    REQUIRE (file.getFile().replaceWithData (wav.getData(), wav.getSize()));
+
+    const auto openBefore = countOpenFiles();
+
+    std::vector<std::shared_ptr<const MappedWaveFile>> mapped;
+    for (int i = 0; i < 50; ++i)
+    {
+        mapped.push_back (MappedWaveFile::open (file.getFile()));
+        REQUIRE (mapped.back() != nullptr);
+    }
+
+    REQUIRE (countOpenFiles() == openBefore);
+
+    // and the frames are still there to read
+    for (const auto& m : mapped)
+    {
+        const auto* frames = reinterpret_cast<const float*> (m->getFrames());
+        REQUIRE (frames[999] == 0.5f * std::sin (0.01f * 999.f));
+    }
+}
+#endif
@@ -0,0 +1,106 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that ResonancePartialTable finds the same coinciding partials, in the same order,
+// as comparing every pair of partials of the two keys, in equal temperament and under a tuning.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "ResonanceProcessor.h"
+
+TEST_CASE ("ResonancePartialTable matches the pairwise partial search", "[resonance]")
+{
+    auto table = std::make_unique<ResonancePartialTable>();
+    std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1> partialStructure;
+    juce::Random random (7);
+
+    for (int trial = 0; trial < 50; ++trial)
+    {
+        for (auto& partial : partialStructure)
+            partial = { random.nextBool(), (random.nextFloat() - 0.3f) * 40.f, (random.nextFloat() - 0.5f) * 20.f };
+
+        table->setPartials (partialStructure);
+
+        for (int pair = 0; pair < 20; ++pair)
+        {
+            const auto heldKey = random.nextInt (128);
+            const auto struckKey = random.nextInt (128);
+
+            std::vector<std::pair<float, float>> expected;
+            for (const auto& held : partialStructure)
+            {
+                if (! std::get<0> (held)) continue;
+                for (const auto& struck : partialStructure)
+                {
+                    if (! std::get<0> (struck)) continue;
+                    const auto heldPartial = static_cast<float> (heldKey) + std::get<1> (held);
+                    const auto struckPartial = static_cast<float> (struckKey) + std::get<1> (struck);
+                    if (std::round (heldPartial) == std::round (struckPartial))
+                        expected.emplace_back (std::get<1> (held), struckPartial);
+                }
+            }
+
+            std::vector<std::pair<float, float>> found;
+            table->forEachCoincidence (table->getKey (heldKey, nullptr), table->getKey (struckKey, nullptr),
+                [&found] (const auto& held, const auto& struck) { found.emplace_back (held.transposition, struck.position); });
+
+            REQUIRE (found == expected);
+        }
+    }
+}
+
+TEST_CASE ("ResonancePartialTable places partials with the string's tuning", "[resonance]")
+{
+    auto table = std::make_unique<ResonancePartialTable>();
+    auto tuning = std::make_unique<TuningState>();
+    std::array<PartialSpec, TotalNumberOfPartialKeysInUI + 1> partialStructure;
+    juce::Random random (11);
+
+    for (auto& partial : partialStructure)
+        partial = { random.nextBool(), (random.nextFloat() - 0.3f) * 40.f, (random.nextFloat() - 0.5f) * 20.f };
+    table->setPartials (partialStructure);
+
+    for (int retune = 0; retune < 5; ++retune)
+    {
+        // up to half a semitone either way, so partials can round to a different key than in ET
+        for (int pc = 0; pc < 12; ++pc)
+            tuning->setCircularKeyOffset (pc, (random.nextFloat() - 0.5f) * 100.f);
+        tuning->invalidateFrequencyTable();
+
+        for (int pair = 0; pair < 20; ++pair)
+        {
+            const auto heldKey = random.nextInt (128);
+            const auto struckKey = random.nextInt (128);
+
+            const auto tuningOffset = [&tuning] (int key) -> float {
+                return ftom (tuning->computeTargetFrequency (key, 0, false), 440.) - static_cast<float> (key);
+            };
+            const auto heldOffset = tuningOffset (heldKey);
+            const auto struckOffset = tuningOffset (struckKey);
+
+            std::vector<std::pair<float, float>> expected;
+            for (const auto& held : partialStructure)
+            {
+                if (! std::get<0> (held)) continue;
+                for (const auto& struck : partialStructure)
+                {
+                    if (! std::get<0> (struck)) continue;
+                    const auto heldPartial = static_cast<float> (heldKey) + std::get<1> (held) + heldOffset;
+                    const auto struckPartial = static_cast<float> (struckKey) + std::get<1> (struck) + struckOffset;
+                    if (std::round (heldPartial) == std::round (struckPartial))
+                        expected.emplace_back (std::get<1> (held) + heldOffset, struckPartial);
+                }
+            }
+
+            std::vector<std::pair<float, float>> found;
+            table->forEachCoincidence (table->getKey (heldKey, tuning.get()), table->getKey (struckKey, tuning.get()),
+                [&found] (const auto& held, const auto& struck) { found.emplace_back (held.transposition, struck.position); });
+
+            REQUIRE (found == expected);
+        }
+
+        // the same partial structure again leaves the keys as they are
+        table->setPartials (partialStructure);
+    }
+}
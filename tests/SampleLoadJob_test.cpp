@@ -0,0 +1,176 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that a bK soundset loaded by parallel SampleLoadJobs comes out in the same order as a
+// single-threaded load, that cancelling a load part way neither hangs nor leaks, and that a
+// pitch whose file is corrupt is left out rather than holding up the soundset.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "SampleLoadManager.h"
+#include "Synthesiser/Sample.h"
+
+namespace
+{
+    struct NoUpdates : juce::AsyncUpdater
+    {
+        void handleAsyncUpdate() override {}
+    };
+
+    /** Main samples, two velocity layers a pitch, across the keyboard; emptyPitches get a file with no audio in it. */
+    struct GeneratedSoundset
+    {
+        explicit GeneratedSoundset (const juce::StringArray& emptyPitches = {})
+        {
+            directory.createDirectory();
+
+            for (int octave = 1; octave <= 7; ++octave)
+            {
+                for (auto pitchClass : { "C", "D#", "F#", "A" })
+                {
+                    const auto pitch = juce::String (pitchClass) + juce::String (octave);
+                    juce::Array<juce::File> files;
+                    for (int layer = 1; layer <= 2; ++layer)
+                    {
+                        const auto wav = makeTestWav (1, emptyPitches.contains (pitch) ? 0 : 2000 * layer, 16);
+                        auto file = directory.getChildFile (pitch + "v" + juce::String (layer) + ".wav");
+                        file.replaceWithData (wav.getData(), wav.getSize());
+                        files.add (file);
+                    }
+                    pitches.add (pitch);
+                    pitchFiles.push_back (files);
+                }
+            }
+        }
+
+        ~GeneratedSoundset() { directory.deleteRecursively(); }
+
+        /** Queues one job per pitchesPerJob pitches on pool, assembling into soundset. */
+        std::shared_ptr<SoundsetAssembly> queue (juce::ThreadPool& pool,
+                                                 SampleLoadManager& loader,
+                                                 juce::ReferenceCountedArray<BKSynthesiserSound>* soundset,
+                                                 int pitchesPerJob = 3)
+        {
+            const int numJobs = ((int) pitchFiles.size() + pitchesPerJob - 1) / pitchesPerJob;
+            auto assembly = std::make_shared<SoundsetAssembly> (soundset, "generated", numJobs);
+
+            for (int job = 0; job < numJobs; ++job)
+                pool.addJob (makeJob (loader, assembly, job, pitchesPerJob), true);
+
+            return assembly;
+        }
+
+        SampleLoadJob* makeJob (SampleLoadManager& loader, std::shared_ptr<SoundsetAssembly> assembly, int job, int pitchesPerJob)
+        {
+            std::vector<PitchSamplesInfo> infos;
+            for (int i = job * pitchesPerJob; i < juce::jmin ((job + 1) * pitchesPerJob, (int) pitchFiles.size()); ++i)
+            {
+                juce::BigInteger keys;
+                keys.setBit (noteNameToRoot (pitches[i]));
+                infos.push_back ({ bitklavier::utils::BKPianoMain, 2, keys,
+                    std::make_unique<FileArrayAudioFormatReaderFactory> (pitchFiles[(size_t) i]) });
+            }
+
+            return new SampleLoadJob (loader.audioFormatManager.get(), std::move (infos), std::move (assembly), job,
+                &updates, nullptr, 0, loader);
+        }
+
+        juce::File directory = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                                   .getNonexistentChildFile ("bkGeneratedSoundset", "", false);
+        juce::StringArray pitches;
+        std::vector<juce::Array<juce::File>> pitchFiles;
+        NoUpdates updates;
+    };
+
+    /** (key, lowest velocity) of each sound, in soundset order. */
+    std::vector<std::pair<int, int>> describe (const juce::ReferenceCountedArray<BKSynthesiserSound>& soundset)
+    {
+        std::vector<std::pair<int, int>> sounds;
+        for (auto* sound : soundset)
+        {
+            auto* sampler = static_cast<BKSamplerSound<juce::AudioFormatReader>*> (sound->getSamplerSoundBase());
+            sounds.emplace_back (sampler->getMidiNotes().findNextSetBit (0), sampler->getMidiVelocities().findNextSetBit (0));
+        }
+        return sounds;
+    }
+}
+
+TEST_CASE ("A soundset loaded in parallel comes out in queue order", "[samples]")
+{
+    GeneratedSoundset generated;
+    SampleLoadManager loader (nullptr, nullptr);
+
+    juce::ReferenceCountedArray<BKSynthesiserSound> serial, parallel;
+    {
+        juce::ThreadPool one (1);
+        generated.queue (one, loader, &serial);
+        REQUIRE (one.removeAllJobs (false, 30000));
+    }
+    {
+        juce::ThreadPool many (8);
+        generated.queue (many, loader, &parallel, 1);
+        REQUIRE (many.removeAllJobs (false, 30000));
+    }
+
+    REQUIRE (serial.size() == 2 * generated.pitches.size());
+    REQUIRE (describe (parallel) == describe (serial));
+
+    // pitch by pitch, softest layer first
+    const auto sounds = describe (serial);
+    for (int i = 0; i < generated.pitches.size(); ++i)
+    {
+        REQUIRE (sounds[(size_t) (2 * i)].first == noteNameToRoot (generated.pitches[i]));
+        REQUIRE (sounds[(size_t) (2 * i + 1)].first == noteNameToRoot (generated.pitches[i]));
+        REQUIRE (sounds[(size_t) (2 * i)].second < sounds[(size_t) (2 * i + 1)].second);
+    }
+}
+
+TEST_CASE ("A soundset load cancelled part way stops without leaking", "[samples]")
+{
+    GeneratedSoundset generated;
+    SampleLoadManager loader (nullptr, nullptr);
+    juce::ReferenceCountedArray<BKSynthesiserSound> soundset;
+
+    std::weak_ptr<SoundsetAssembly> assembly;
+    {
+        juce::ThreadPool pool (4);
+        assembly = generated.queue (pool, loader, &soundset, 1);
+
+        while (pool.getNumJobs() == generated.pitches.size())
+            juce::Thread::yield();
+
+        // the jobs still running are asked to stop, the rest never start
+        REQUIRE (pool.removeAllJobs (true, 10000));
+        REQUIRE (pool.getNumJobs() == 0);
+    }
+
+    // every job has gone, and the parts it loaded with them
+    REQUIRE (assembly.expired());
+
+    // a cancelled load never assembles part of a soundset; a load that beat the cancel is whole
+    REQUIRE ((soundset.isEmpty() || soundset.size() == 2 * generated.pitches.size()));
+}
+
+TEST_CASE ("A pitch with a corrupt sample file is left out of the soundset", "[samples]")
+{
+    GeneratedSoundset generated ({ "D#3", "A5" });
+    SampleLoadManager loader (nullptr, nullptr);
+    juce::ReferenceCountedArray<BKSynthesiserSound> soundset;
+
+    const int pitchesPerJob = (int) generated.pitchFiles.size();
+    auto assembly = std::make_shared<SoundsetAssembly> (&soundset, "generated", 1);
+    std::unique_ptr<SampleLoadJob> job (generated.makeJob (loader, assembly, 0, pitchesPerJob));
+
+    // run the job the way the pool would, which gives up on it after maxAttempts at most
+    int runs = 0;
+    while (job->runJob() == juce::ThreadPoolJob::jobNeedsRunningAgain)
+        REQUIRE (++runs < SampleLoadJob::maxAttempts);
+
+    REQUIRE (soundset.size() == 2 * (generated.pitches.size() - 2));
+    for (const auto& sound : describe (soundset))
+    {
+        REQUIRE (sound.first != noteNameToRoot ("D#3"));
+        REQUIRE (sound.first != noteNameToRoot ("A5"));
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that the soundfont index records an SFZ file's regions, comes back the same from
+// disk, and rescans a file once it changes.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "SoundfontIndex.h"
+
+namespace
+{
+    // the samples don't need to exist; scanning never reads them
+    const char* const twoRegions = "<region> sample=a.wav lokey=48 hikey=59\n"
+                                   "<region> sample=b.wav lokey=60 hikey=72\n";
+}
+
+TEST_CASE ("SoundfontIndex scans an SFZ file's regions", "[samples]")
+{
+    juce::TemporaryFile sfz (".sfz");
+    REQUIRE (sfz.getFile().replaceWithText (twoRegions));
+
+    const auto entry = SoundfontIndex::scan (sfz.getFile());
+    REQUIRE (entry.size == sfz.getFile().getSize());
+    REQUIRE (entry.presets.size() == 1);
+    REQUIRE (entry.presets[0].numRegions == 2);
+    REQUIRE (entry.presets[0].loKey == 48);
+    REQUIRE (entry.presets[0].hiKey == 72);
+}
+
+TEST_CASE ("SoundfontIndex is saved, read back, and rescans changed files", "[samples]")
+{
+    juce::TemporaryFile sfz (".sfz");
+    juce::TemporaryFile indexFile (".bkindex");
+    REQUIRE (sfz.getFile().replaceWithText (twoRegions));
+
+    {
+        SoundfontIndex index;
+        index.load (indexFile.getFile());
+        index.refresh ({ sfz.getFile() });
+    }
+
+    REQUIRE (indexFile.getFile().existsAsFile());
+
+    SoundfontIndex index;
+    index.load (indexFile.getFile());
+
+    SoundfontIndex::Entry entry;
+    REQUIRE (index.lookUp (sfz.getFile(), entry));
+    REQUIRE (entry.presets.size() == 1);
+    REQUIRE (entry.presets[0].numRegions == 2);
+
+    REQUIRE (sfz.getFile().replaceWithText ("<region> sample=a.wav lokey=30 hikey=40\n"));
+    REQUIRE (sfz.getFile().setLastModificationTime (juce::Time::getCurrentTime() + juce::RelativeTime::seconds (10)));
+    REQUIRE_FALSE (index.lookUp (sfz.getFile(), entry));
+
+    entry = index.getOrScan (sfz.getFile());
+    REQUIRE (entry.presets[0].numRegions == 1);
+    REQUIRE (entry.presets[0].loKey == 30);
+    REQUIRE (index.lookUp (sfz.getFile(), entry));
+}
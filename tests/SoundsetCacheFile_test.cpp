@@ -0,0 +1,124 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that a soundset written to a .bkcache file comes back with the same sounds and
+// frames, and that a stale or damaged file is ignored.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "Sample.h"
+#include "SoundsetCache.h"
+#include "SoundsetCacheFile.h"
+
+namespace
+{
+    using BKSound = BKSamplerSound<juce::AudioFormatReader>;
+
+    std::shared_ptr<Sample<juce::AudioFormatReader>> makeSample (int numChannels, int bitsPerSample, SampleStorage storage)
+    {
+        auto reader = makeTestWavReader (numChannels, 3000, bitsPerSample);
+        return std::make_shared<Sample<juce::AudioFormatReader>> (*reader, 90, storage);
+    }
+
+    SharedSoundset makeSoundset()
+    {
+        juce::BigInteger keys, soft, loud, all;
+        keys.setRange (21, 3, true);
+        soft.setRange (0, 64, true);
+        loud.setRange (64, 65, true); // 129 bits, as the even split in getVelLayers can give
+        all.setRange (0, 128, true);
+
+        SharedSoundset soundset;
+        auto* quiet = soundset.sounds[""].add (new BKSound ("A0v1", makeSample (2, 16, SampleStorage::native), keys, 21, 0, soft, 2, -50.f));
+        soundset.sounds[""].add (new BKSound ("A0v2", makeSample (2, 24, SampleStorage::native), keys, 21, 0, loud, 2, quiet->dBFSLevel));
+        soundset.sounds["Hammers"].add (new BKSound ("rel1", makeSample (1, 24, SampleStorage::float32), keys, 21, 0, all, 1, -50.f));
+        return soundset;
+    }
+
+    void requireSameFrames (const CompactSampleData& a, const CompactSampleData& b)
+    {
+        REQUIRE (a.getStorage() == b.getStorage());
+        REQUIRE (a.getNumChannels() == b.getNumChannels());
+        REQUIRE (a.getLength() == b.getLength());
+        REQUIRE (a.getScale() == b.getScale());
+
+        a.forEachFormat ([&] (const auto& x, float) {
+            b.forEachFormat ([&] (const auto& y, float) {
+                for (int i = 0; i < a.getLength() + CompactSampleData::kPadding; ++i)
+                {
+                    REQUIRE (x.left (i) == y.left (i));
+                    REQUIRE (x.right (i) == y.right (i));
+                }
+            });
+        });
+    }
+}
+
+TEST_CASE ("SoundsetCacheFile restores a soundset as it was written", "[samples]")
+{
+    juce::TemporaryFile file (".bkcache");
+    const auto written = makeSoundset();
+    REQUIRE (SoundsetCacheFile::write (file.getFile(), 1234, written));
+
+    auto restored = SoundsetCacheFile::read (file.getFile(), 1234);
+    REQUIRE (restored != nullptr);
+    REQUIRE (restored->sounds.size() == written.sounds.size());
+
+    for (const auto& [suffix, sounds] : written.sounds)
+    {
+        const auto& restoredSounds = restored->sounds.at (suffix);
+        REQUIRE (restoredSounds.size() == sounds.size());
+
+        for (int i = 0; i < sounds.size(); ++i)
+        {
+            auto* before = dynamic_cast<BKSound*> (sounds[i].get());
+            auto* after = dynamic_cast<BKSound*> (restoredSounds[i].get());
+            REQUIRE (after != nullptr);
+
+            REQUIRE (after->getMidiNotes() == before->getMidiNotes());
+            REQUIRE (after->getMidiVelocities() == before->getMidiVelocities());
+            REQUIRE (after->rootMidiNote == before->rootMidiNote);
+            REQUIRE (after->numLayers == before->numLayers);
+            REQUIRE (after->dBFSLevel == before->dBFSLevel);
+            REQUIRE (after->dBFSBelow == before->dBFSBelow);
+            REQUIRE (after->getCentreFrequencyInHz() == before->getCentreFrequencyInHz());
+            REQUIRE (after->getSample()->getSampleRate() == before->getSample()->getSampleRate());
+            REQUIRE (after->getSample()->getData().isMapped());
+
+            requireSameFrames (after->getSample()->getData(), before->getSample()->getData());
+        }
+    }
+}
+
+TEST_CASE ("SoundsetCacheFile ignores stale and damaged files", "[samples]")
+{
+    juce::TemporaryFile file (".bkcache");
+    REQUIRE (SoundsetCacheFile::write (file.getFile(), 1234, makeSoundset()));
+
+    // the WAV files changed since it was written
+    REQUIRE (SoundsetCacheFile::read (file.getFile(), 5678) == nullptr);
+
+    juce::MemoryBlock contents;
+    REQUIRE (file.getFile().loadFileAsData (contents));
+    contents.setSize (contents.getSize() / 2);
+    REQUIRE (file.getFile().replaceWithData (contents.getData(), contents.getSize()));
+    REQUIRE (SoundsetCacheFile::read (file.getFile(), 1234) == nullptr);
+
+    REQUIRE (SoundsetCacheFile::read (juce::File(), 1234) == nullptr);
+}
+
+TEST_CASE ("SoundsetCacheFile fingerprints change with the source files", "[samples]")
+{
+    juce::TemporaryFile wav (".wav");
+    REQUIRE (wav.getFile().replaceWithText ("not really audio"));
+
+    const juce::Array<juce::File> sources { wav.getFile() };
+    const auto original = SoundsetCacheFile::fingerprint (sources, "native");
+
+    REQUIRE (SoundsetCacheFile::fingerprint (sources, "native") == original);
+    REQUIRE (SoundsetCacheFile::fingerprint (sources, "int16") != original);
+
+    REQUIRE (wav.getFile().replaceWithText ("not really audio either"));
+    REQUIRE (SoundsetCacheFile::fingerprint (sources, "native") != original);
+}
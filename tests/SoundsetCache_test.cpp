@@ -0,0 +1,45 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that SoundsetCache hands every instance the same loaded soundset, and
+// lets it go once nobody is using it.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "SoundsetCache.h"
+
+TEST_CASE ("SoundsetCache shares a soundset between instances", "[samples]")
+{
+    juce::SharedResourcePointer<SoundsetCache> first, second;
+    const juce::String key = "/samples/Yamaha|native|resident";
+
+    std::shared_ptr<const SharedSoundset> loaded = std::make_shared<SharedSoundset>();
+    REQUIRE (first->add (key, loaded) == loaded);
+    REQUIRE (second->find (key) == loaded);
+
+    // another instance finishing the same load later gets the one already cached
+    std::shared_ptr<const SharedSoundset> late = std::make_shared<SharedSoundset>();
+    REQUIRE (second->add (key, late) == loaded);
+
+    // different load options are a different soundset
+    REQUIRE (second->find ("/samples/Yamaha|int16|resident") == nullptr);
+}
+
+TEST_CASE ("SoundsetCache frees a soundset when the last user lets go", "[samples]")
+{
+    juce::SharedResourcePointer<SoundsetCache> cache;
+    const juce::String key = "/samples/Salamander|native|resident";
+
+    auto loaded = cache->add (key, std::make_shared<SharedSoundset>());
+    auto attached = cache->find (key);
+    std::weak_ptr<const SharedSoundset> watch = loaded;
+
+    loaded.reset();
+    REQUIRE (cache->find (key) == attached);
+
+    attached.reset();
+    REQUIRE (watch.expired());
+    REQUIRE (cache->find (key) == nullptr);
+    REQUIRE (cache->getNumSoundsets() == 0);
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that SpringTuning steps from the sample clock, so the same notes over the same
+// stretch of samples end up in the same place however the samples are split into blocks.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "SpringTuning/SpringTuning.h"
+
+TEST_CASE ("SpringTuning is independent of the block size", "[tuning]")
+{
+    SpringTuningParams params;
+    std::array<std::atomic<float>, 12> customTuning {};
+
+    auto fixedBlocks = std::make_unique<SpringTuning> (params, customTuning);
+    auto randomBlocks = std::make_unique<SpringTuning> (params, customTuning);
+    fixedBlocks->prepareToPlay (48000.);
+    randomBlocks->prepareToPlay (48000.);
+
+    juce::Random random (3);
+    const int chord[] = { 60, 64, 67, 70 };
+
+    for (auto note : chord)
+    {
+        fixedBlocks->addNote (note);
+        randomBlocks->addNote (note);
+
+        constexpr int numSamples = 64 * 300;
+        for (int i = 0; i < numSamples; i += 64)
+            fixedBlocks->advance (64);
+
+        for (int done = 0; done < numSamples;)
+        {
+            const auto n = juce::jmin (1 + random.nextInt (700), numSamples - done);
+            randomBlocks->advance (n);
+            done += n;
+        }
+    }
+
+    // the springs have pulled the major third away from equal temperament
+    REQUIRE (fixedBlocks->getFrequency (64, 440.f) != fixedBlocks->getTetherFrequency (64, 440.f));
+
+    for (int note = 0; note < SpringTuning::numNotes; ++note)
+        REQUIRE (fixedBlocks->getFrequency (note, 440.f) == randomBlocks->getFrequency (note, 440.f));
+}
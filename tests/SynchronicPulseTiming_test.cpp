@@ -0,0 +1,67 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that Synchronic plays its pulses on the same samples, with the same notes, however
+// a run is split into blocks, including blocks long enough to hold several pulses.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "SynchronicProcessor.h"
+
+namespace
+{
+    // the run's sample and note number of every pulse note, for a chord held from 0.1 s to 0.35 s
+    std::vector<std::pair<juce::int64, int>> runPulses (int blockSize)
+    {
+        constexpr double sampleRate = 48000.;
+        constexpr juce::int64 noteOnAt = 4800;
+        constexpr juce::int64 noteOffAt = 16800;
+        constexpr juce::int64 runLength = 4 * 48000;
+
+        PluginProcessor parent;
+        SynchronicProcessor synchronic (parent, juce::ValueTree (IDs::synchronic), nullptr);
+        synchronic.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        synchronic.prepareToPlay (sampleRate, blockSize);
+
+        std::vector<std::pair<juce::int64, int>> pulses;
+        juce::MidiBuffer midi;
+
+        for (juce::int64 blockStart = 0; blockStart < runLength; blockStart += blockSize)
+        {
+            const auto numSamples = (int) std::min<juce::int64> (blockSize, runLength - blockStart);
+            const auto inBlock = [&] (juce::int64 sample) { return sample >= blockStart && sample < blockStart + numSamples; };
+
+            midi.clear();
+            for (int note : { 60, 64, 67 })
+            {
+                if (inBlock (noteOnAt))
+                    midi.addEvent (juce::MidiMessage::noteOn (1, note, (juce::uint8) 100), (int) (noteOnAt - blockStart));
+                if (inBlock (noteOffAt))
+                    midi.addEvent (juce::MidiMessage::noteOff (1, note), (int) (noteOffAt - blockStart));
+            }
+
+            synchronic.ProcessMIDIBlock (midi, numSamples);
+
+            for (int i = 0; i < synchronic.getNumPulseNotes(); ++i)
+            {
+                const auto& note = synchronic.getPulseNote (i);
+                pulses.emplace_back (blockStart + note.samplePosition, note.noteNumber);
+            }
+        }
+
+        // clusters play their pulses one after another, so compare in time order
+        std::sort (pulses.begin(), pulses.end());
+        return pulses;
+    }
+}
+
+TEST_CASE ("Synchronic pulses land on the same samples whatever the block size", "[synchronic]")
+{
+    const auto reference = runPulses (512);
+    REQUIRE_FALSE (reference.empty());
+
+    // the beat is half a second (24000 samples) by default, so the last two hold several pulses
+    for (int blockSize : { 32, 441, 4096, 50000, 96000 })
+        REQUIRE (runPulses (blockSize) == reference);
+}
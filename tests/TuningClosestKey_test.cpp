@@ -0,0 +1,54 @@
+// Copyright (C) 2022-2026 Dan Trueman
+// SPDX-License-Identifier: GPL-3.0-or-later
+//
+// Checks that under Spring and Adaptive tunings every note finds the key nearest its own
+// frequency, not the key of whichever note was pressed last.
+
+#include "helpers/test_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include "TuningProcessor.h"
+
+namespace
+{
+    void setTuningType (TuningState& tuning, TuningType type)
+    {
+        *tuning.tuningType = (int) *magic_enum::enum_index (type);
+        tuning.invalidateFrequencyTable();
+    }
+
+    int nearestKey (TuningState& tuning, int note, float transp)
+    {
+        const auto frequency = tuning.getCachedTargetFrequency (note, transp, false);
+        return (int) std::round (ftom (frequency, tuning.getGlobalTuningReference()));
+    }
+}
+
+TEST_CASE ("Spring and Adaptive tunings give each note its own closest key", "[tuning]")
+{
+    for (auto type : { TuningType::Spring_Tuning, TuningType::Adaptive, TuningType::Adaptive_Anchored })
+    {
+        auto tuning = std::make_unique<TuningState>();
+        tuning->springTuner = std::make_unique<SpringTuning> (tuning->springTuningParams, tuning->circularTuningOffset_custom);
+        tuning->springTuner->prepareToPlay (48000.);
+        setTuningType (*tuning, type);
+
+        // a chord, with its top note pressed last
+        const int chord[] = { 48, 60, 64, 67 };
+        for (auto note : chord)
+            tuning->keyPressed (note);
+
+        for (auto note : chord)
+        {
+            REQUIRE (tuning->getClosestKey (note, 0.f, false) == note);
+            REQUIRE (tuning->getClosestKey (note, 0.f, false) == nearestKey (*tuning, note, 0.f));
+
+            // transposed copies of each chord note land on their own keys too
+            for (auto transp : { -12.f, -5.f, 7.f, 12.f })
+            {
+                REQUIRE (tuning->getClosestKey (note, transp, false) == note + (int) transp);
+                REQUIRE (tuning->getClosestKey (note, transp, false) == nearestKey (*tuning, note, transp));
+            }
+        }
+    }
+}
@@ -32,3 +32,47 @@
     plugin.editorBeingDeleted (editor);
     delete editor;
 }
+
+/* A synthetic sample for the sample loading and playback tests (and benchmarks), as WAV data:
+ * a sine per channel, each channel an octave above the one before, optionally decaying.
+ */
+[[maybe_unused]] static juce::MemoryBlock makeTestWav (int numChannels,
+                                                       int numSamples,
+                                                       int bitsPerSample = 24,
+                                                       double sampleRate = 44100.,
+                                                       double frequency = 261.6,
+                                                       double decayPerSecond = 0.)
+{
+    juce::AudioBuffer<float> source (numChannels, numSamples);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* data = source.getWritePointer (ch);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto t = (double) i / sampleRate;
+            data[i] = (float) (0.5 / (ch + 1) * std::exp (-decayPerSecond * t)
+                               * std::sin (juce::MathConstants<double>::twoPi * frequency * (ch + 1) * t));
+        }
+    }
+
+    juce::MemoryBlock block;
+    juce::WavAudioFormat wav;
+    {
+        std::unique_ptr<juce::AudioFormatWriter> writer (
+            wav.createWriterFor (new juce::MemoryOutputStream (block, false), sampleRate, (unsigned int) numChannels, bitsPerSample, {}, 0));
+        writer->writeFromAudioSampleBuffer (source, 0, numSamples);
+    }
+
+    return block;
+}
+
+/* A reader over makeTestWav()'s data. */
+[[maybe_unused]] static std::unique_ptr<juce::AudioFormatReader> makeTestWavReader (int numChannels,
+                                                                                    int numSamples,
+                                                                                    int bitsPerSample = 24,
+                                                                                    double sampleRate = 44100.)
+{
+    juce::WavAudioFormat wav;
+    return std::unique_ptr<juce::AudioFormatReader> (
+        wav.createReaderFor (new juce::MemoryInputStream (makeTestWav (numChannels, numSamples, bitsPerSample, sampleRate), true), true));
+}
@@ -0,0 +1,94 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+	std::shared_ptr<MappedFile> file(new MappedFile());
+
+#ifdef _WIN32
+	int wide_length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	std::wstring wide_path(wide_length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide_path[0], wide_length);
+
+	HANDLE handle =
+		CreateFileW(
+			wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return nullptr;
+	file->file_handle = handle;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0)
+		return nullptr;
+	file->mapping_handle = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (file->mapping_handle == nullptr)
+		return nullptr;
+	file->start = (const uint8_t*) MapViewOfFile(file->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if (file->start == nullptr)
+		return nullptr;
+	file->length = file_size.QuadPart;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return nullptr;
+		}
+	void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping keeps the file open by itself.
+	close(fd);
+	if (address == MAP_FAILED)
+		return nullptr;
+	file->start = (const uint8_t*) address;
+	file->length = info.st_size;
+#endif
+
+	return file;
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (start)
+		UnmapViewOfFile(start);
+	if (mapping_handle)
+		CloseHandle(mapping_handle);
+	if (file_handle)
+		CloseHandle(file_handle);
+#else
+	if (start)
+		munmap((void*) start, length);
+#endif
+}
+
+
+void MappedFile::will_need(uint64_t offset, uint64_t num_bytes) const
+{
+	if (offset >= length)
+		return;
+	if (num_bytes > length - offset)
+		num_bytes = length - offset;
+
+#ifndef _WIN32
+	// madvise() wants a page-aligned start.
+	uintptr_t page_size = sysconf(_SC_PAGESIZE);
+	uintptr_t first = (uintptr_t) (start + offset);
+	uintptr_t aligned = first & ~(page_size - 1);
+	posix_madvise((void*) aligned, num_bytes + (first - aligned), POSIX_MADV_WILLNEED);
+#endif
+}
+
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+
+// A whole file mapped read-only. The pages live in the OS page cache, so
+// every process mapping the same file shares them.
+class MappedFile {
+	public:
+		// Returns nullptr if the file can't be opened or mapped.
+		static std::shared_ptr<MappedFile> open(const std::string& path);
+		~MappedFile();
+
+		const uint8_t* data() const { return start; }
+		uint64_t size() const { return length; }
+
+		// Asks the OS to start reading a range in, without waiting for it.
+		void will_need(uint64_t offset, uint64_t num_bytes) const;
+
+	protected:
+		MappedFile() {}
+
+		const uint8_t* start = nullptr;
+		uint64_t length = 0;
+#ifdef _WIN32
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#endif
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+	};
+
@@ -5,11 +5,12 @@
 #include "RIFF.h"
 #include "SF2.h"
 #include "SF2Generator.h"
+#include "MappedFile.h"
 #include <iostream>
 
 
-SF2Reader::SF2Reader(SF2Sound* sound_in, std::string path)
-	: sound(sound_in)
+SF2Reader::SF2Reader(SF2Sound* sound_in, std::string path_in)
+	: sound(sound_in), path(path_in)
 {
 	file = new std::fstream(path);
 }
@@ -155,7 +156,7 @@ void SF2Reader::read()
 }
 
 
-SampleBuffer* SF2Reader::read_samples(std::function<void(double)> progress_fn)
+SampleBuffer* SF2Reader::read_samples(std::function<void(double)> progress_fn, bool map_file)
 {
 	static const unsigned long buffer_size = 32768;
 
@@ -193,15 +194,36 @@ SampleBuffer* SF2Reader::read_samples(std::function<void(double)> progress_fn)
 		return nullptr;
 		}
 
-	// Allocate the SampleBuffer.
 	unsigned long num_samples = chunk.size / sizeof(int16_t);
+
+	// Point the SampleBuffer at the mapped "smpl" chunk.  The SF2 spec requires
+	// 46 zero samples after each sample, so interpolation padding is already there.
+	if (map_file) {
+		auto mapped = MappedFile::open(path);
+		if (mapped) {
+			uint64_t offset = chunk.start;
+			SampleBuffer* sample_buffer =
+				new SampleBuffer(
+					1, num_samples, 16, SampleBuffer::Little, SampleBuffer::Interleaved,
+					mapped, offset);
+			if (sample_buffer->valid()) {
+				mapped->will_need(offset, num_samples * sizeof(int16_t));
+				if (progress_fn)
+					progress_fn(1.0);
+				return sample_buffer;
+				}
+			delete sample_buffer;
+			}
+		}
+
+	// Allocate the SampleBuffer.
 	SampleBuffer* sample_buffer =
 		new SampleBuffer(1, num_samples, 16, SampleBuffer::Little, SampleBuffer::Interleaved);
 
 	// Read and convert.
 	int16_t* buffer = new int16_t[buffer_size];
 	unsigned long samples_left = num_samples;
-	uint8_t* out = sample_buffer->channel_start(0);
+	uint8_t* out = sample_buffer->writable_channel_start(0);
 	while (samples_left > 0) {
 		// Read the buffer.
 		unsigned long samples_to_read = buffer_size;
@@ -17,11 +17,14 @@ class SF2Reader {
 		~SF2Reader();
 
 		void read();
-		SampleBuffer* read_samples(std::function<void(double)> progress_fn = {});
+		// With "map_file", the returned buffer points into a memory-mapped copy
+		// of the file instead of holding its own copy of the samples.
+		SampleBuffer* read_samples(std::function<void(double)> progress_fn = {}, bool map_file = false);
 
 	protected:
 		SF2Sound* sound;
 		std::fstream* file;
+		std::string path;
 
 		void add_generator_to_region(
 			word genOper, SF2::genAmountType* amount, SFZRegion* region);
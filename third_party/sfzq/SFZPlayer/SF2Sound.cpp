@@ -50,7 +50,7 @@ void SF2Sound::load_regions()
 void SF2Sound::load_samples(std::function<void(double)> progress_fn)
 {
 	SF2Reader reader(this, path);
-	SampleBuffer* buffer = reader.read_samples(progress_fn);
+	SampleBuffer* buffer = reader.read_samples(progress_fn, memory_mapped);
 	if (buffer) {
 		// All the SFZSamples will share the buffer.
 		for (auto& kv: samples_by_rate)
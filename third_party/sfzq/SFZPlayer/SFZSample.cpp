@@ -1,10 +1,13 @@
 #include "SFZSample.h"
 #include "SampleBuffer.h"
 #include "WAVReader.h"
+#include "MappedFile.h"
 #include <iostream>
 
+static const int interpolation_padding = 4;
 
-bool SFZSample::load()
+
+bool SFZSample::load(bool map_file)
 {
 	WAVReader reader(path);
 	if (!reader.valid())
@@ -12,13 +15,37 @@ bool SFZSample::load()
 	sample_rate = reader.sample_rate;
 	num_samples = reader.num_samples;
 
+	if (map_file && num_samples > interpolation_padding) {
+		auto file = MappedFile::open(path);
+		if (file) {
+			buffer =
+				new SampleBuffer(
+					reader.num_channels, num_samples,
+					reader.bits_per_sample, SampleBuffer::Little, SampleBuffer::Interleaved,
+					file, reader.data_offset());
+			if (!buffer->valid()) {
+				// Truncated file; read what's there the usual way.
+				delete buffer;
+				buffer = nullptr;
+				}
+			else {
+				// There's no zero padding in the file, so leave the last few
+				// samples out instead, and interpolation stays inside the mapping.
+				num_samples -= interpolation_padding;
+				file->will_need(reader.data_offset(), (uint64_t) buffer->num_samples * buffer->stride);
+				}
+			}
+		}
+
 	// Read some extra samples, which will be filled with zeros, so interpolation
 	// can be done without having to check for the edge all the time.
-	buffer =
-		new SampleBuffer(
-			reader.num_channels, num_samples + 4,
-			reader.bits_per_sample, SampleBuffer::Little, SampleBuffer::Interleaved);
-	reader.read_samples_into(0, num_samples, buffer);
+	if (buffer == nullptr) {
+		buffer =
+			new SampleBuffer(
+				reader.num_channels, num_samples + interpolation_padding,
+				reader.bits_per_sample, SampleBuffer::Little, SampleBuffer::Interleaved);
+		reader.read_samples_into(0, num_samples, buffer);
+		}
 	auto num_loops = reader.num_loops();
 	if (num_loops > 0) {
 		auto loop = reader.loop(0);
@@ -14,7 +14,9 @@ class SFZSample {
 			: sample_rate(sample_rate_in) {}
 		~SFZSample();
 
-		bool load();
+		// With "map_file", the samples are read straight from a memory-mapped
+		// file rather than copied; see SampleBuffer.
+		bool load(bool map_file = false);
 		std::string short_name();
 		std::string get_path() {
 			return path;
@@ -78,7 +78,7 @@ void SFZSound::load_samples(std::function<void(double)> progress_fn)
 	double num_samples_loaded = 1.0, num_samples = samples.size();
 	for (const auto& kv: samples) {
 		auto sample = kv.second;
-		bool ok = sample->load();
+		bool ok = sample->load(memory_mapped);
 		if (!ok)
 			add_error("Couldn't load sample \"" + sample->short_name() + "\"");
 
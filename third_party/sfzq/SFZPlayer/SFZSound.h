@@ -21,6 +21,9 @@ class SFZSound {
 
 		virtual void load_regions();
 		virtual void load_samples(std::function<void(double)> progress_fn = {});
+		// Memory-map sample data instead of copying it, where the format allows.
+		// Set before load_samples().
+		void set_memory_mapped(bool new_memory_mapped) { memory_mapped = new_memory_mapped; }
 
 		SFZRegion* get_region_for(
 			int note, int velocity, float rand_val, SFZRegion::Trigger trigger = SFZRegion::attack);
@@ -45,6 +48,7 @@ class SFZSound {
 		std::map<std::string, SFZSample*> samples;
 		std::vector<std::string> errors;
 		std::map<std::string, std::string> unsupported_opcodes;
+		bool memory_mapped = false;
 
 		std::string sibling_path(std::string from, std::string filename);
 		std::string fix_slashes(std::string str);
@@ -6,6 +6,28 @@ SampleBuffer::SampleBuffer(
 	int bits_per_sample, SampleBuffer::Endianness endianness, SampleBuffer::Layout layout)
 	: num_channels(num_channels_in), num_samples(num_samples_in),
 	sample_data(num_channels_in * num_samples_in * (bits_per_sample / 8))
+{
+	data_start = sample_data.data();
+	set_format(bits_per_sample, endianness, layout);
+}
+
+
+SampleBuffer::SampleBuffer(
+	int num_channels_in, int num_samples_in,
+	int bits_per_sample, SampleBuffer::Endianness endianness, SampleBuffer::Layout layout,
+	std::shared_ptr<MappedFile> file, uint64_t offset)
+	: num_channels(num_channels_in), num_samples(num_samples_in),
+	mapped_file(file)
+{
+	uint64_t num_bytes = (uint64_t) num_channels * num_samples * (bits_per_sample / 8);
+	if (file == nullptr || num_samples < 0 || offset > file->size() || num_bytes > file->size() - offset)
+		return;
+	data_start = file->data() + offset;
+	set_format(bits_per_sample, endianness, layout);
+}
+
+
+void SampleBuffer::set_format(int bits_per_sample, SampleBuffer::Endianness endianness, SampleBuffer::Layout layout)
 {
 	stride = bits_per_sample / 8;
 	if (layout == Interleaved) {
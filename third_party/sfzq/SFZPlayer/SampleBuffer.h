@@ -1,7 +1,9 @@
 #pragma once
 
 #include "SFZFloat.h"
+#include "MappedFile.h"
 #include <vector>
+#include <memory>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -17,18 +19,28 @@ class SampleBuffer {
 		typedef sfz_float (*ReadFn)(const uint8_t*);
 
 		SampleBuffer(int num_channels, int num_samples, int bits_per_sample, Endianness endianness, Layout layout);
+		// The samples are already in "file", starting "offset" bytes in; the
+		// buffer keeps the mapping alive and never copies them. Invalid if the
+		// samples would run past the end of the file.
+		SampleBuffer(
+			int num_channels, int num_samples, int bits_per_sample, Endianness endianness, Layout layout,
+			std::shared_ptr<MappedFile> file, uint64_t offset);
 		bool valid() {
 			return read_sample != nullptr;
 			}
+		bool is_mapped() { return mapped_file != nullptr; }
 
 		int num_channels, num_samples;
-		std::vector<uint8_t> sample_data;
+		std::vector<uint8_t> sample_data; 	// Empty if mapped.
+		std::shared_ptr<MappedFile> mapped_file;
 
 		ptrdiff_t stride = 0;
 		ptrdiff_t channel_offset = 0;
 		ReadFn read_sample = nullptr;
-		uint8_t* channel_start(int channel) { return sample_data.data() + channel * channel_offset; }
-		uint8_t* channel_end(int channel) { return channel_start(channel) + channel_offset; }
+		const uint8_t* channel_start(int channel) const { return data_start + channel * channel_offset; }
+		const uint8_t* channel_end(int channel) const { return channel_start(channel) + channel_offset; }
+		// For readers filling in a buffer they allocated; not for mapped buffers.
+		uint8_t* writable_channel_start(int channel) { return sample_data.data() + channel * channel_offset; }
 
 		/* How to use:
 			 auto in_read = in_buffer->read_sample;
@@ -38,6 +50,11 @@ class SampleBuffer {
 				in_p += in_buffer->stride;
 				 }
 		*/
+
+	protected:
+		const uint8_t* data_start = nullptr;
+
+		void set_format(int bits_per_sample, Endianness endianness, Layout layout);
 	};
 
 
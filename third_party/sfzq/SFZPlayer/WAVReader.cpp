@@ -76,7 +76,7 @@ bool WAVReader::read_samples_into(uint64_t start, uint64_t num_samples, SampleBu
 	if (!file.good())
 		return false;
 
-	file.read((char*) buffer->channel_start(0), num_samples * bytes_per_sample * num_channels);
+	file.read((char*) buffer->writable_channel_start(0), num_samples * bytes_per_sample * num_channels);
 	if (!file.good())
 		return false;
 
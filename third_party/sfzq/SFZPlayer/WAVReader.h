@@ -18,6 +18,8 @@ class WAVReader {
 
 		bool valid() { return is_valid; }
 		bool read_samples_into(uint64_t start, uint64_t num_samples, SampleBuffer* buffer);
+		// Where the samples start in the file, in bytes.
+		uint64_t data_offset() { return samples_offset; }
 
 		struct Loop {
 			uint64_t start = 0, end = 0;